@@ -58,15 +58,9 @@ namespace std {
     template<>
     struct hash<Image> {
         size_t operator()(const Image& img) const {
-            size_t seed = hash<size_t>{}(img.width);
-            seed ^= hash<size_t>{}(img.height) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            
-            for (const auto& row : img.data) {
-                for (const auto& val : row) {
-                    seed ^= hash<double>{}(val) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-                }
-            }
-            return seed;
+            // Each row is hashed in bulk rather than element by element
+            uint64_t seed = flowgraph::hash_value(img.width, img.height);
+            return flowgraph::hash_value(img.data, seed);
         }
     };
 }
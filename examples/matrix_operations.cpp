@@ -13,14 +13,8 @@ namespace std {
     template<>
     struct hash<Matrix> {
         size_t operator()(const Matrix& m) const {
-            size_t seed = m.size();
-            for (const auto& row : m) {
-                seed ^= row.size() + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-                for (const auto& val : row) {
-                    seed ^= std::hash<double>{}(val) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-                }
-            }
-            return seed;
+            // Each row is hashed in bulk rather than element by element
+            return flowgraph::hash_value(m);
         }
     };
 
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+
+namespace flowgraph {
+
+namespace detail {
+    // Implemented by thread pools that react to their workers blocking
+    class BlockingObserver {
+    public:
+        virtual void enter_blocking() = 0;
+        virtual void exit_blocking() = 0;
+
+    protected:
+        ~BlockingObserver() = default;
+    };
+
+    // Observer of the calling thread, set by the pool that owns it
+    inline thread_local BlockingObserver* blocking_observer = nullptr;
+    inline thread_local size_t blocking_depth = 0;
+}
+
+// Marks the calling thread as blocked (on I/O, a future, a lock held
+// elsewhere) for the lifetime of the region. Inside a pool worker this lets
+// an elastic pool start another worker meanwhile; elsewhere it is a no-op.
+// Regions may nest; only the outermost one is reported.
+class BlockingRegion {
+public:
+    BlockingRegion() {
+        if (detail::blocking_depth++ == 0 && detail::blocking_observer) {
+            observer_ = detail::blocking_observer;
+            observer_->enter_blocking();
+        }
+    }
+
+    ~BlockingRegion() {
+        --detail::blocking_depth;
+        if (observer_) {
+            observer_->exit_blocking();
+        }
+    }
+
+    BlockingRegion(const BlockingRegion&) = delete;
+    BlockingRegion& operator=(const BlockingRegion&) = delete;
+
+private:
+    detail::BlockingObserver* observer_ = nullptr;
+};
+
+// Run f inside a BlockingRegion and return its result
+template<typename F>
+decltype(auto) blocking_region(F&& f) {
+    BlockingRegion region;
+    return std::forward<F>(f)();
+}
+
+} // namespace flowgraph
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace flowgraph {
+
+// Move-only void() callable stored entirely inline, so submitting it never
+// allocates. Callables larger than Capacity bytes are rejected at compile time.
+template<size_t Capacity>
+class BasicInlineTask {
+public:
+    BasicInlineTask() noexcept = default;
+
+    template<typename F>
+        requires (!std::is_same_v<std::decay_t<F>, BasicInlineTask> &&
+                  std::is_invocable_r_v<void, std::decay_t<F>&>)
+    BasicInlineTask(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "Callable is too large for inline task storage");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Callable is over-aligned for inline task storage");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "Callable must be nothrow move constructible");
+        ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+        ops_ = &ops_for<Fn>;
+    }
+
+    BasicInlineTask(BasicInlineTask&& other) noexcept {
+        move_from(other);
+    }
+
+    BasicInlineTask& operator=(BasicInlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    BasicInlineTask(const BasicInlineTask&) = delete;
+    BasicInlineTask& operator=(const BasicInlineTask&) = delete;
+
+    ~BasicInlineTask() {
+        reset();
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    void operator()() {
+        ops_->invoke(storage_);
+    }
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*relocate)(void* to, void* from) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr Ops ops_for{
+        [](void* self) { std::invoke(*static_cast<Fn*>(self)); },
+        [](void* to, void* from) noexcept {
+            ::new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        },
+        [](void* self) noexcept { static_cast<Fn*>(self)->~Fn(); }
+    };
+
+    void move_from(BasicInlineTask& other) noexcept {
+        if (other.ops_) {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+// 48 bytes of captures; the whole task occupies one cache line
+using InlineTask = BasicInlineTask<48>;
+
+} // namespace flowgraph
@@ -0,0 +1,330 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+namespace flowgraph {
+
+// CPU layout of the machine's NUMA nodes, read from sysfs without libnuma.
+// A simulated topology has the same shape but is never used for pinning or
+// memory binding, so NUMA-aware scheduling can be exercised on any machine.
+class NumaTopology {
+public:
+    NumaTopology() = default;
+
+    size_t node_count() const { return node_cpus_.size(); }
+    const std::vector<int>& cpus_of(size_t node) const { return node_cpus_.at(node); }
+    bool simulated() const { return simulated_; }
+
+    std::optional<size_t> node_of_cpu(int cpu) const {
+        for (size_t node = 0; node < node_cpus_.size(); ++node) {
+            for (int c : node_cpus_[node]) {
+                if (c == cpu) {
+                    return node;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Parse a kernel cpulist such as "0-3,8-11"
+    static std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            auto first = range.find_first_not_of(" \t\n");
+            if (first == std::string::npos) {
+                continue;
+            }
+            auto last = range.find_last_not_of(" \t\n");
+            range = range.substr(first, last - first + 1);
+            try {
+                auto dash = range.find('-');
+                int begin = std::stoi(range.substr(0, dash));
+                int end = dash == std::string::npos ? begin : std::stoi(range.substr(dash + 1));
+                if (end < begin) {
+                    throw std::invalid_argument(range);
+                }
+                for (int cpu = begin; cpu <= end; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            } catch (const std::exception&) {
+                throw std::invalid_argument("Invalid cpu list: " + list);
+            }
+        }
+        return cpus;
+    }
+
+    // Read node<N>/cpulist entries under the given sysfs directory.
+    // Memory-only nodes (empty cpulist) are skipped. Returns a single node
+    // holding every CPU when the directory is missing or unreadable.
+    static NumaTopology from_sysfs(const std::filesystem::path& root = "/sys/devices/system/node") {
+        std::vector<std::pair<size_t, std::vector<int>>> found;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(root, ec)) {
+            auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file(entry.path() / "cpulist");
+            std::string list;
+            if (!file || !std::getline(file, list)) {
+                continue;
+            }
+            auto cpus = parse_cpu_list(list);
+            if (!cpus.empty()) {
+                found.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+            }
+        }
+        if (found.empty()) {
+            return single_node();
+        }
+
+        std::sort(found.begin(), found.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        NumaTopology topology;
+        for (auto& [id, cpus] : found) {
+            topology.node_ids_.push_back(id);
+            topology.node_cpus_.push_back(std::move(cpus));
+        }
+        return topology;
+    }
+
+    static NumaTopology detect() {
+        return from_sysfs();
+    }
+
+    // One node spanning every hardware thread
+    static NumaTopology single_node() {
+        size_t count = std::max(1u, std::thread::hardware_concurrency());
+        NumaTopology topology;
+        topology.node_ids_.push_back(0);
+        topology.node_cpus_.emplace_back();
+        for (size_t cpu = 0; cpu < count; ++cpu) {
+            topology.node_cpus_.back().push_back(static_cast<int>(cpu));
+        }
+        return topology;
+    }
+
+    // nodes x cpus_per_node layout with consecutive CPU ids
+    static NumaTopology simulated(size_t nodes, size_t cpus_per_node) {
+        if (nodes == 0 || cpus_per_node == 0) {
+            throw std::invalid_argument("Simulated topology needs at least one node and one CPU per node");
+        }
+        NumaTopology topology;
+        topology.simulated_ = true;
+        for (size_t node = 0; node < nodes; ++node) {
+            topology.node_ids_.push_back(node);
+            topology.node_cpus_.emplace_back();
+            for (size_t cpu = 0; cpu < cpus_per_node; ++cpu) {
+                topology.node_cpus_.back().push_back(static_cast<int>(node * cpus_per_node + cpu));
+            }
+        }
+        return topology;
+    }
+
+    // Kernel node id of the node at the given index, for mbind
+    size_t kernel_node_id(size_t node) const { return node_ids_.at(node); }
+
+private:
+    std::vector<size_t> node_ids_;
+    std::vector<std::vector<int>> node_cpus_;
+    bool simulated_ = false;
+};
+
+namespace numa {
+
+namespace detail {
+    // NUMA node (topology index) of the calling thread, set by NUMA-aware pools
+    inline thread_local std::optional<size_t> current_node;
+    // Kernel node id to bind to, empty when the topology is simulated
+    inline thread_local std::optional<size_t> current_kernel_node;
+}
+
+inline std::optional<size_t> current_node() {
+    return detail::current_node;
+}
+
+inline void set_current_node(const NumaTopology& topology, std::optional<size_t> node) {
+    detail::current_node = node;
+    detail::current_kernel_node.reset();
+    if (node && !topology.simulated()) {
+        detail::current_kernel_node = topology.kernel_node_id(*node);
+    }
+}
+
+// CPUs the calling thread may run on; every hardware thread when the
+// platform has no affinity API
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        cpus = NumaTopology::single_node().cpus_of(0);
+    }
+    return cpus;
+}
+
+// Restrict the calling thread to the given CPUs. Returns false when the
+// platform has no affinity API or the kernel rejects the mask.
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return false;
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// Prefer the given kernel node for pages of [addr, addr + length).
+// addr must be page aligned. Best effort: returns false on failure.
+inline bool bind_memory(void* addr, size_t length, size_t kernel_node) {
+#ifdef __linux__
+    constexpr size_t bits = sizeof(unsigned long) * 8;
+    if (kernel_node >= bits * 16) {
+        return false;
+    }
+    unsigned long mask[16] = {};
+    mask[kernel_node / bits] = 1UL << (kernel_node % bits);
+    return syscall(SYS_mbind, addr, length, MPOL_PREFERRED, mask, bits * 16, 0) == 0;
+#else
+    (void)addr;
+    (void)length;
+    (void)kernel_node;
+    return false;
+#endif
+}
+
+inline size_t page_size() {
+#ifdef __linux__
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+} // namespace numa
+
+// Allocator placing its memory on the NUMA node of the thread that creates
+// it. A node value built on it inside a pool task lands on the socket of
+// the worker computing the node; its consumers share that socket only as
+// far as the per-node queues keep successors there. Nothing in the graph
+// allocates with it on its own: node values opt in through their type.
+// Allocations of at least one page are mapped directly and bound with
+// mbind; smaller ones use the global heap.
+template<typename T>
+class NumaAllocator {
+public:
+    using value_type = T;
+    // Any instance can free memory from any other; the node only steers placement
+    using is_always_equal = std::true_type;
+
+    NumaAllocator() noexcept
+        : node_(numa::detail::current_node)
+        , kernel_node_(numa::detail::current_kernel_node) {}
+
+    // Place memory on an explicit node of the given topology
+    NumaAllocator(const NumaTopology& topology, size_t node)
+        : node_(node) {
+        if (!topology.simulated()) {
+            kernel_node_ = topology.kernel_node_id(node);
+        }
+    }
+
+    template<typename U>
+    NumaAllocator(const NumaAllocator<U>& other) noexcept
+        : node_(other.node())
+        , kernel_node_(other.kernel_node()) {}
+
+    // Topology index of the node this allocator places memory on
+    std::optional<size_t> node() const noexcept { return node_; }
+    std::optional<size_t> kernel_node() const noexcept { return kernel_node_; }
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        size_t bytes = n * sizeof(T);
+#ifdef __linux__
+        if (bytes >= numa::page_size() && alignof(T) <= numa::page_size()) {
+            void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            if (kernel_node_) {
+                // Pages are not touched yet, so the policy applies on first fault
+                numa::bind_memory(memory, bytes, *kernel_node_);
+            }
+            return static_cast<T*>(memory);
+        }
+#endif
+        return static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T))));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        size_t bytes = n * sizeof(T);
+#ifdef __linux__
+        if (bytes >= numa::page_size() && alignof(T) <= numa::page_size()) {
+            munmap(p, bytes);
+            return;
+        }
+#endif
+        ::operator delete(p, std::align_val_t(alignof(T)));
+    }
+
+    template<typename U>
+    bool operator==(const NumaAllocator<U>&) const noexcept {
+        return true;
+    }
+
+private:
+    std::optional<size_t> node_;
+    std::optional<size_t> kernel_node_;
+};
+
+template<typename T>
+using numa_vector = std::vector<T, NumaAllocator<T>>;
+
+} // namespace flowgraph
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "thread_pool.hpp"
+
+namespace flowgraph {
+
+// Statically partition [0, count) into contiguous chunks of at least
+// min_chunk_size elements and run body(begin, end) for each chunk on the pool.
+// The calling thread executes the first chunk itself and then helps drain the
+// pool queue until every chunk has finished, so the call acts as a barrier.
+// The first exception thrown by any chunk is rethrown after the barrier.
+// All chunks are submitted as one batch; if a bounded pool rejects it,
+// they run on the calling thread.
+template<typename F>
+void parallel_for(ThreadPool& pool, size_t count, size_t min_chunk_size, F&& body) {
+    if (count == 0) {
+        return;
+    }
+
+    min_chunk_size = std::max<size_t>(min_chunk_size, 1);
+    size_t max_chunks = (count + min_chunk_size - 1) / min_chunk_size;
+    size_t chunks = std::min(max_chunks, pool.active_thread_count() + 1);
+    if (chunks <= 1) {
+        body(size_t{0}, count);
+        return;
+    }
+
+    struct Barrier {
+        std::atomic<size_t> remaining;
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+    };
+    auto barrier = std::make_shared<Barrier>();
+    barrier->remaining.store(chunks - 1, std::memory_order_relaxed);
+
+    size_t chunk_size = (count + chunks - 1) / chunks;
+    auto run_chunk = [&body, barrier](size_t begin, size_t end) {
+        try {
+            body(begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(barrier->exception_mutex);
+            if (!barrier->exception) {
+                barrier->exception = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(chunks - 1);
+    for (size_t c = 1; c < chunks; ++c) {
+        size_t begin = std::min(c * chunk_size, count);
+        size_t end = std::min(begin + chunk_size, count);
+        tasks.emplace_back([run_chunk, barrier, begin, end]() {
+            run_chunk(begin, end);
+            barrier->remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+    try {
+        pool.enqueue_bulk(tasks);
+    } catch (const QueueFullError&) {
+        // A bounded pool turned the chunks away; run them here instead
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+
+    run_chunk(0, std::min(chunk_size, count));
+
+    while (barrier->remaining.load(std::memory_order_acquire) != 0) {
+        if (!pool.run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (barrier->exception) {
+        std::rethrow_exception(barrier->exception);
+    }
+}
+
+} // namespace flowgraph
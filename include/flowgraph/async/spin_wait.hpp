@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+namespace flowgraph {
+
+// Tell the CPU the caller is in a spin loop, so it can yield pipeline
+// resources to a sibling hyperthread and save power
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Exponential backoff for polling loops: each pause() issues twice as many
+// cpu_relax() hints as the previous one, up to a cap, so a long wait polls
+// shared state less often without ever giving up the core
+class SpinBackoff {
+public:
+    void pause() {
+        for (uint32_t i = 0; i < relax_count_; ++i) {
+            cpu_relax();
+        }
+        if (relax_count_ < max_relax_count) {
+            relax_count_ <<= 1;
+        }
+    }
+
+    void reset() { relax_count_ = 1; }
+
+    static constexpr uint32_t max_relax_count = 64;
+
+private:
+    uint32_t relax_count_ = 1;
+};
+
+} // namespace flowgraph
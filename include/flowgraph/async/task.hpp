@@ -4,6 +4,8 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <utility>
+#include "blocking_region.hpp"
 
 namespace flowgraph {
 
@@ -15,6 +17,9 @@ public:
         std::exception_ptr exception_;
         std::atomic<bool> promise_fulfilled_{false};
         std::coroutine_handle<> continuation_;
+        // Set by the first of the awaiter registering continuation_ and the
+        // coroutine reaching its final suspend point
+        std::atomic<bool> continuation_ready_{false};
     };
 
     struct promise_type {
@@ -28,9 +33,14 @@ public:
             inline bool await_ready() noexcept { return false; }
             
             inline void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
-                auto& promise = h.promise();
-                if (auto continuation = promise.shared_state_->continuation_) {
-                    continuation.resume();
+                // Publish completion only once the frame is suspended, so a
+                // waiter may destroy it as soon as it observes the flag
+                auto state = h.promise().shared_state_;
+                state->promise_fulfilled_.store(true, std::memory_order_release);
+                // Whichever of this and the awaiter's registration comes
+                // second resumes the awaiting coroutine
+                if (state->continuation_ready_.exchange(true, std::memory_order_acq_rel)) {
+                    state->continuation_.resume();
                 }
             }
             
@@ -41,12 +51,10 @@ public:
         
         inline void return_value(T value) {
             shared_state_->result_ = std::move(value);
-            shared_state_->promise_fulfilled_.store(true, std::memory_order_release);
         }
         
         inline void unhandled_exception() {
             shared_state_->exception_ = std::current_exception();
-            shared_state_->promise_fulfilled_.store(true, std::memory_order_release);
         }
 
         inline T get_result() {
@@ -92,8 +100,9 @@ public:
             return shared_state_->promise_fulfilled_.load(std::memory_order_acquire);
         }
 
-        inline void await_suspend(std::coroutine_handle<> h) {
+        inline bool await_suspend(std::coroutine_handle<> h) {
             shared_state_->continuation_ = h;
+            return !shared_state_->continuation_ready_.exchange(true, std::memory_order_acq_rel);
         }
 
         inline T await_resume() {
@@ -110,13 +119,21 @@ public:
         return awaiter{shared_state_};
     }
 
+    // Whether the coroutine has finished, so get() returns without waiting
+    inline bool is_ready() const noexcept {
+        return shared_state_ && shared_state_->promise_fulfilled_.load(std::memory_order_acquire);
+    }
+
     // Synchronously get the result
     inline T get() {
         if (!shared_state_) {
             throw std::runtime_error("Task has no shared state");
         }
-        while (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
-            std::this_thread::yield();
+        if (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
+            BlockingRegion region;
+            while (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
         }
         if (shared_state_->exception_) {
             std::rethrow_exception(shared_state_->exception_);
@@ -137,6 +154,9 @@ public:
         std::exception_ptr exception_;
         std::atomic<bool> promise_fulfilled_{false};
         std::coroutine_handle<> continuation_;
+        // Set by the first of the awaiter registering continuation_ and the
+        // coroutine reaching its final suspend point
+        std::atomic<bool> continuation_ready_{false};
     };
 
     struct promise_type {
@@ -150,9 +170,14 @@ public:
             inline bool await_ready() noexcept { return false; }
             
             inline void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
-                auto& promise = h.promise();
-                if (auto continuation = promise.shared_state_->continuation_) {
-                    continuation.resume();
+                // Publish completion only once the frame is suspended, so a
+                // waiter may destroy it as soon as it observes the flag
+                auto state = h.promise().shared_state_;
+                state->promise_fulfilled_.store(true, std::memory_order_release);
+                // Whichever of this and the awaiter's registration comes
+                // second resumes the awaiting coroutine
+                if (state->continuation_ready_.exchange(true, std::memory_order_acq_rel)) {
+                    state->continuation_.resume();
                 }
             }
             
@@ -161,13 +186,10 @@ public:
 
         inline final_awaiter final_suspend() noexcept { return {}; }
         
-        inline void return_void() {
-            shared_state_->promise_fulfilled_.store(true, std::memory_order_release);
-        }
+        inline void return_void() {}
         
         inline void unhandled_exception() {
             shared_state_->exception_ = std::current_exception();
-            shared_state_->promise_fulfilled_.store(true, std::memory_order_release);
         }
 
         inline void get_result() {
@@ -212,8 +234,9 @@ public:
             return shared_state_->promise_fulfilled_.load(std::memory_order_acquire);
         }
 
-        inline void await_suspend(std::coroutine_handle<> h) {
+        inline bool await_suspend(std::coroutine_handle<> h) {
             shared_state_->continuation_ = h;
+            return !shared_state_->continuation_ready_.exchange(true, std::memory_order_acq_rel);
         }
 
         inline void await_resume() {
@@ -229,13 +252,21 @@ public:
         return awaiter{shared_state_};
     }
 
+    // Whether the coroutine has finished, so get() returns without waiting
+    inline bool is_ready() const noexcept {
+        return shared_state_ && shared_state_->promise_fulfilled_.load(std::memory_order_acquire);
+    }
+
     // Synchronously get the result
     inline void get() {
         if (!shared_state_) {
             throw std::runtime_error("Task has no shared state");
         }
-        while (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
-            std::this_thread::yield();
+        if (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
+            BlockingRegion region;
+            while (!shared_state_->promise_fulfilled_.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
         }
         if (shared_state_->exception_) {
             std::rethrow_exception(shared_state_->exception_);
@@ -247,4 +278,16 @@ private:
     std::shared_ptr<SharedState> shared_state_;
 };
 
+// Fire-and-forget coroutine: starts eagerly and frees its own frame on
+// completion. Nobody observes its result, so it must not let exceptions escape.
+struct DetachedTask {
+    struct promise_type {
+        inline DetachedTask get_return_object() noexcept { return {}; }
+        inline std::suspend_never initial_suspend() noexcept { return {}; }
+        inline std::suspend_never final_suspend() noexcept { return {}; }
+        inline void return_void() noexcept {}
+        inline void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
 } // namespace flowgraph
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+namespace flowgraph {
+
+// Quality-of-service class of pool work. Interactive work is served before
+// batch work; tasks spawned by a running task inherit its class.
+enum class TaskPriority {
+    Interactive,    // Latency-critical (default)
+    Batch           // Throughput-oriented, may be delayed by interactive work
+};
+
+inline constexpr size_t task_priority_count = 2;
+
+inline constexpr size_t priority_index(TaskPriority priority) {
+    return static_cast<size_t>(priority);
+}
+
+// How a worker chooses between the interactive and batch lanes
+enum class PriorityPolicy {
+    Strict,     // Batch work only runs when no interactive work is queued
+    Weighted    // Serve a batch task after every interactive_weight interactive tasks
+};
+
+} // namespace flowgraph
@@ -1,61 +1,189 @@
 #pragma once
 #include <vector>
 #include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
 #include <condition_variable>
 #include <functional>
 #include <future>
 #include <memory>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
 #include <coroutine>
 #include "task.hpp"
+#include "numa.hpp"
+#include "task_priority.hpp"
+#include "inline_task.hpp"
+#include "mpmc_queue.hpp"
+#include "blocking_region.hpp"
+#include "spin_wait.hpp"
 
 namespace flowgraph {
 
-class ThreadPool {
+// Construction options for ThreadPool
+struct ThreadPoolOptions {
+    size_t num_threads = std::thread::hardware_concurrency();
+
+    // Split workers into contiguous blocks, one per NUMA node, each with its
+    // own injection queue. Idle workers steal within their node before
+    // looking at other nodes.
+    bool numa_aware = false;
+
+    // Topology to use in NUMA-aware mode; detected from sysfs when empty.
+    // A simulated topology shapes the queues but never pins or binds memory.
+    std::optional<NumaTopology> topology;
+
+    // Restrict each worker to the CPUs of its node in NUMA-aware mode, and
+    // to a single CPU in polling mode
+    bool pin_workers = true;
+
+    // Polling mode: an idle worker keeps polling the queues for this long,
+    // with pause backoff, before parking on the condition variable. Trades
+    // a busy core for the wakeup latency of a sleeping worker. Zero parks
+    // immediately.
+    std::chrono::microseconds spin_budget{0};
+
+    // How workers choose between queued interactive and batch tasks
+    PriorityPolicy priority_policy = PriorityPolicy::Strict;
+
+    // Weighted policy: interactive tasks served per batch task when both wait
+    size_t interactive_weight = 4;
+
+    // Workers (the lowest indices) that only ever run interactive tasks,
+    // so interactive latency does not depend on batch task lengths
+    size_t reserved_interactive_workers = 0;
+
+    // Admission bound per priority class on queued tasks. Submissions from
+    // threads outside the pool throw QueueFullError once the class has this
+    // many tasks waiting; work spawned by running tasks is always accepted so
+    // admitted executions can finish. Zero means unbounded.
+    size_t max_queued_tasks = 0;
+
+    // Slots in the lock-free ring behind post() (rounded up to a power of two)
+    size_t post_queue_capacity = 4096;
+
+    // Elastic mode: num_threads workers always run, and up to max_threads
+    // are started while workers sit in blocking regions or queues are deep.
+    // Workers beyond num_threads retire after idle_timeout without work.
+    bool elastic = false;
+    size_t max_threads = 0;   // 0 means 4 * num_threads
+    std::chrono::milliseconds idle_timeout{1000};
+    // Grow once more than this many tasks are queued per runnable worker
+    size_t grow_queue_depth = 64;
+};
+
+// Thrown when a bounded ThreadPool rejects a submission
+class QueueFullError : public std::runtime_error {
+public:
+    explicit QueueFullError(TaskPriority priority)
+        : std::runtime_error(priority == TaskPriority::Interactive
+              ? "ThreadPool interactive queue is full"
+              : "ThreadPool batch queue is full")
+        , priority_(priority) {}
+
+    TaskPriority priority() const { return priority_; }
+
+private:
+    TaskPriority priority_;
+};
+
+// Snapshot of the work done for one priority class
+struct PriorityMetrics {
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    std::chrono::nanoseconds total_queue_time{0};
+    std::chrono::nanoseconds max_queue_time{0};
+    std::chrono::nanoseconds total_run_time{0};
+    uint64_t rejected = 0;
+
+    std::chrono::nanoseconds mean_queue_time() const {
+        return completed ? total_queue_time / static_cast<int64_t>(completed) : std::chrono::nanoseconds{0};
+    }
+};
+
+// Thread pool with shared injection queues plus one deque per worker.
+// Workers run tasks pinned to them first, then pop their own deque LIFO
+// (most recently produced, cache-hot work first), then the injection queue
+// of their NUMA node, then steal FIFO from other workers of the same node,
+// and only then move on to the queues and workers of other nodes.
+// Without NUMA awareness the whole pool forms a single node.
+// Every queue has one lane per TaskPriority; the whole search above runs
+// for the interactive lane before the batch lane is considered.
+// post() bypasses all of this: it pushes an InlineTask onto a bounded
+// lock-free ring that workers drain before looking at any other queue.
+// In elastic mode the pool has max_threads worker slots, of which only the
+// running ones are active; queues of inactive slots stay empty.
+class ThreadPool : private detail::BlockingObserver {
 public:
     explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency())
-        : stop_(false) {
+        : ThreadPool(make_options(num_threads)) {}
+
+    explicit ThreadPool(ThreadPoolOptions options)
+        : stop_(false)
+        , numa_aware_(options.numa_aware)
+        , priority_policy_(options.priority_policy)
+        , interactive_weight_(std::max<size_t>(options.interactive_weight, 1))
+        , reserved_workers_(options.reserved_interactive_workers)
+        , max_queued_tasks_(options.max_queued_tasks)
+        , posted_(std::make_unique<MpmcQueue<InlineTask>>(options.post_queue_capacity))
+        , elastic_(options.elastic)
+        , idle_timeout_(options.idle_timeout)
+        , grow_queue_depth_(std::max<size_t>(options.grow_queue_depth, 1))
+        , spin_budget_(options.spin_budget) {
+        const size_t num_threads = options.num_threads;
+        if (reserved_workers_ > 0 && reserved_workers_ >= num_threads) {
+            throw std::invalid_argument("Reserved interactive workers must leave at least one worker for batch tasks");
+        }
+        base_threads_ = num_threads;
+        size_t slots = num_threads;
+        if (elastic_) {
+            slots = options.max_threads ? options.max_threads : 4 * num_threads;
+            if (slots < num_threads) {
+                throw std::invalid_argument("Elastic ThreadPool max_threads must be at least num_threads");
+            }
+        }
+        if (numa_aware_) {
+            topology_ = options.topology ? std::move(*options.topology) : NumaTopology::detect();
+        }
+        const size_t domains = numa_aware_ ? std::max<size_t>(topology_.node_count(), 1) : 1;
+
+        for (size_t d = 0; d < domains; ++d) {
+            domain_queues_.push_back(std::make_unique<DomainQueue>());
+        }
+        for (size_t i = 0; i < slots; ++i) {
+            local_queues_.push_back(std::make_unique<WorkerQueue>());
+            worker_domain_.push_back(i * domains / slots);
+        }
+        build_steal_plans(domains);
+
+        pin_workers_ = options.pin_workers &&
+                       (numa_aware_ ? !topology_.simulated() : spin_budget_.count() > 0);
+        if (pin_workers_ && !numa_aware_) {
+            allowed_cpus_ = numa::allowed_cpus();
+        }
+        workers_.resize(slots);
+        std::lock_guard<std::mutex> lock(resize_mutex_);
         for (size_t i = 0; i < num_threads; ++i) {
-            workers_.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex_);
-                        condition_.wait(lock, [this] {
-                            return stop_ || !tasks_.empty();
-                        });
-                        
-                        if (stop_ && tasks_.empty()) {
-                            return;
-                        }
-                        
-                        task = std::move(tasks_.front());
-                        tasks_.pop();
-                    }
-                    task();
-                }
-            });
+            start_worker(i);
         }
     }
 
     template<typename F, typename... Args>
     inline auto enqueue(F&& f, Args&&... args) {
         using return_type = std::invoke_result_t<F, Args...>;
-        
+
         auto task = std::make_shared<std::packaged_task<return_type()>>(
             std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-        
+
         std::future<return_type> result = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (stop_) {
-                throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
-            }
-            tasks_.emplace([task]() { (*task)(); });
-        }
-        condition_.notify_one();
+        push_shared([task]() { (*task)(); });
         return result;
     }
 
@@ -78,14 +206,7 @@ public:
             }
         };
 
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (stop_) {
-                throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
-            }
-            tasks_.emplace(std::move(task));
-        }
-        condition_.notify_one();
+        push_shared(std::move(task));
         return future;
     }
 
@@ -107,38 +228,809 @@ public:
             }
         };
 
+        push_shared(std::move(task));
+        return future;
+    }
+
+    // Fast fire-and-forget submission: no future, no allocation, no lock.
+    // Returns false, leaving task untouched, when the ring is full. Posted
+    // tasks skip priority lanes, admission bounds and metrics, and must not
+    // throw.
+    inline bool try_post(InlineTask& task) {
+        check_running();
+        if (!posted_->try_push(task)) {
+            return false;
+        }
+        // Pairs with the sleeper's sleeping_ increment before it rechecks
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_workers(1, TaskPriority::Interactive);
+        return true;
+    }
+
+    // post() that helps drain the pool while the ring is full
+    template<typename F>
+    inline void post(F&& f) {
+        InlineTask task(std::forward<F>(f));
+        while (!try_post(task)) {
+            if (!run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Fire-and-forget submission to the injection queue of the caller's
+    // NUMA node (round-robin over nodes when called from outside the pool)
+    inline void enqueue_shared(std::function<void()> task) {
+        push_shared(std::move(task));
+    }
+
+    // Fire-and-forget submission to the calling worker's own deque, where it
+    // stays cache-local unless another worker steals it. Falls back to the
+    // shared queue when called from outside the pool.
+    inline void enqueue_local(std::function<void()> task) {
+        auto worker = current_worker_index();
+        if (!worker) {
+            push_shared(std::move(task));
+            return;
+        }
+        check_running();
+        auto queued = make_queued(std::move(task));
+        auto lane = priority_index(queued.priority);
+        auto& queue = *local_queues_[*worker];
+        pending_[lane].fetch_add(1);
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (stop_) {
-                throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks[lane].push_back(std::move(queued));
+        }
+        wake_workers(1, queued_priority(lane));
+        maybe_grow();
+    }
+
+    // Fire-and-forget submission of a batch of tasks to the shared queue with
+    // one lock, one pending-count update and one wakeup sized to the batch.
+    // Admission is all-or-nothing: a bounded pool rejects the whole batch.
+    template<std::ranges::input_range R>
+    inline void enqueue_bulk(R&& tasks) {
+        push_bulk(make_queued_bulk(std::forward<R>(tasks)), false);
+    }
+
+    // enqueue_bulk() onto the calling worker's own deque, falling back to the
+    // shared queue when called from outside the pool
+    template<std::ranges::input_range R>
+    inline void enqueue_local_bulk(R&& tasks) {
+        push_bulk(make_queued_bulk(std::forward<R>(tasks)), true);
+    }
+
+    // Fire-and-forget submission pinned to a specific worker (modulo the
+    // worker count). Pinned tasks are never stolen and run in FIFO order
+    // before the worker looks at any other queue.
+    inline void enqueue_to(size_t worker, std::function<void()> task) {
+        if (local_queues_.empty()) {
+            push_shared(std::move(task));
+            return;
+        }
+        check_running();
+        size_t slot = worker % local_queues_.size();
+        auto& queue = *local_queues_[slot];
+        auto queued = make_queued(std::move(task));
+        queue.pinned_count.fetch_add(1);
+        bool inactive;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.pinned.push_back(std::move(queued));
+            inactive = !queue.active.load();
+        }
+        if (inactive) {
+            // Elastic slot without a running worker; none starts once the
+            // pool is stopping
+            std::lock_guard<std::mutex> lock(resize_mutex_);
+            if (!stop_flag_.load(std::memory_order_acquire)) {
+                start_worker(slot);
             }
-            tasks_.emplace(std::move(task));
+            return;
+        }
+        // The target worker cannot be woken selectively on a shared condition
+        if (sleeping_.load() > 0) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            condition_.notify_all();
         }
-        condition_.notify_one();
-        return future;
+    }
+
+    // Index of the calling thread within this pool, if it is one of its workers
+    inline std::optional<size_t> current_worker_index() const {
+        if (current_pool_ == this) {
+            return current_worker_;
+        }
+        return std::nullopt;
+    }
+
+    // Priority inherited by tasks submitted from the calling thread
+    static TaskPriority current_priority() {
+        return current_priority_;
+    }
+
+    // Sets the calling thread's submission priority for the scope's lifetime
+    class PriorityScope {
+    public:
+        explicit PriorityScope(TaskPriority priority)
+            : previous_(current_priority_) {
+            current_priority_ = priority;
+        }
+        ~PriorityScope() {
+            current_priority_ = previous_;
+        }
+        PriorityScope(const PriorityScope&) = delete;
+        PriorityScope& operator=(const PriorityScope&) = delete;
+
+    private:
+        TaskPriority previous_;
+    };
+
+    // How long the task running on the calling thread waited in its queue
+    static std::chrono::nanoseconds current_queue_delay() {
+        return current_queue_delay_;
+    }
+
+    // Tasks of the class currently waiting in stealable queues
+    inline size_t queued_tasks(TaskPriority priority) const {
+        return pending_[priority_index(priority)].load();
+    }
+
+    // Whether an external submission of the class would currently be accepted
+    inline bool admits(TaskPriority priority) const {
+        return max_queued_tasks_ == 0 || queued_tasks(priority) < max_queued_tasks_;
+    }
+
+    // Exponential moving average of recent queue delays of the class
+    inline std::chrono::nanoseconds recent_queue_delay(TaskPriority priority) const {
+        return std::chrono::nanoseconds(
+            counters_[priority_index(priority)].recent_queue_ns.load(std::memory_order_relaxed));
+    }
+
+    inline PriorityMetrics metrics(TaskPriority priority) const {
+        const auto& counters = counters_[priority_index(priority)];
+        PriorityMetrics metrics;
+        metrics.submitted = counters.submitted.load(std::memory_order_relaxed);
+        metrics.completed = counters.completed.load(std::memory_order_relaxed);
+        metrics.total_queue_time = std::chrono::nanoseconds(counters.queue_ns.load(std::memory_order_relaxed));
+        metrics.max_queue_time = std::chrono::nanoseconds(counters.max_queue_ns.load(std::memory_order_relaxed));
+        metrics.total_run_time = std::chrono::nanoseconds(counters.run_ns.load(std::memory_order_relaxed));
+        metrics.rejected = counters.rejected.load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+    inline size_t reserved_interactive_workers() const {
+        return reserved_workers_;
+    }
+
+    inline bool numa_aware() const {
+        return numa_aware_;
+    }
+
+    // Topology the pool was built for (empty unless NUMA-aware)
+    inline const NumaTopology& topology() const {
+        return topology_;
+    }
+
+    // NUMA node index the given worker belongs to
+    inline size_t numa_node_of_worker(size_t worker) const {
+        return worker_domain_.at(worker);
+    }
+
+    // Workers in the order the given worker steals from them: its own
+    // node first, then the following nodes
+    inline std::vector<size_t> steal_order(size_t worker) const {
+        std::vector<size_t> order;
+        for (const auto& step : steal_plans_.at(worker)) {
+            order.insert(order.end(), step.victims.begin(), step.victims.end());
+        }
+        return order;
+    }
+
+    // Allocator placing memory on the node of the given worker, for outputs
+    // that will be consumed by a task pinned to that worker
+    template<typename T>
+    inline NumaAllocator<T> allocator_for_worker(size_t worker) const {
+        if (!numa_aware_) {
+            return NumaAllocator<T>();
+        }
+        return NumaAllocator<T>(topology_, worker_domain_.at(worker));
     }
 
     ~ThreadPool() {
         {
+            // Stopping under resize_mutex_ orders it against start_worker,
+            // which sees the flag and starts nothing from here on
+            std::lock_guard<std::mutex> resize(resize_mutex_);
             std::unique_lock<std::mutex> lock(queue_mutex_);
             stop_ = true;
+            stop_flag_.store(true, std::memory_order_release);
         }
         condition_.notify_all();
+        // workers_ no longer changes, and joining without resize_mutex_ lets
+        // a task waiting for it in enqueue_to() finish
         for (std::thread& worker : workers_) {
-            worker.join();
+            if (worker.joinable()) {
+                worker.join();
+            }
         }
     }
 
+    // Worker slots; affinity hints and enqueue_to() indices wrap around this
     inline size_t thread_count() const {
         return workers_.size();
     }
 
+    // Workers currently running (below thread_count() only in elastic mode)
+    inline size_t active_thread_count() const {
+        return active_count_.load();
+    }
+
+    // Active workers currently inside a BlockingRegion
+    inline size_t blocked_thread_count() const {
+        return blocked_.load();
+    }
+
+    inline bool elastic() const {
+        return elastic_;
+    }
+
+    // Run one queued task on the calling thread, if any is available.
+    // Lets threads that block on pool work help drain the queue instead of idling.
+    inline bool run_pending_task() {
+        QueuedTask task;
+        auto worker = current_worker_index();
+        if (!(worker ? try_pop(*worker, task) : try_pop_external(task))) {
+            return run_posted();
+        }
+        run_task(task);
+        return true;
+    }
+
+    // Awaitable that resumes the awaiting coroutine on one of this pool's
+    // workers under the given priority; a no-op on a worker already. When
+    // the pool refuses the task (bounded and full, or stopping) the
+    // coroutine carries on where it is.
+    class ScheduleAwaiter {
+    public:
+        ScheduleAwaiter(ThreadPool& pool, TaskPriority priority)
+            : pool_(pool), priority_(priority) {}
+
+        bool await_ready() const noexcept {
+            return pool_.current_worker_index().has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            PriorityScope scope(priority_);
+            try {
+                pool_.push_shared([handle] { handle.resume(); });
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        ThreadPool& pool_;
+        TaskPriority priority_;
+    };
+
+    inline ScheduleAwaiter schedule(TaskPriority priority = current_priority()) {
+        return ScheduleAwaiter(*this, priority);
+    }
+
 private:
+    // Start the worker of an inactive slot. Caller holds resize_mutex_.
+    inline void start_worker(size_t slot) {
+        auto& queue = *local_queues_[slot];
+        if (queue.active.load() || stop_flag_.load()) {
+            return;
+        }
+        // A retired worker of this slot may still be on its way out
+        if (workers_[slot].joinable()) {
+            workers_[slot].join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.active.store(true);
+        }
+        active_count_.fetch_add(1);
+        workers_[slot] = std::thread([this, slot] { worker_loop(slot); });
+    }
+
+    inline void worker_loop(size_t i) {
+        current_pool_ = this;
+        current_worker_ = i;
+        detail::blocking_observer = this;
+        if (numa_aware_) {
+            numa::set_current_node(topology_, worker_domain_[i]);
+        }
+        if (pin_workers_) {
+            numa::pin_current_thread(worker_cpus(i));
+        }
+        auto& own = *local_queues_[i];
+        const size_t lanes = i < reserved_workers_ ? 1 : task_priority_count;
+        auto has_work = [this, &own, lanes] {
+            if (posted_->size_approx() > 0) {
+                return true;
+            }
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                if (pending_[lane].load() > 0) {
+                    return true;
+                }
+            }
+            return own.pinned_count.load() > 0;
+        };
+        const bool may_retire = elastic_ && i >= reserved_workers_;
+
+        while (true) {
+            if (run_posted()) {
+                continue;
+            }
+            QueuedTask task;
+            if (try_pop(i, task)) {
+                run_task(task);
+                continue;
+            }
+            if (spin_budget_.count() > 0 && poll_for_work(has_work)) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            sleeping_.fetch_add(1);
+            bool woken = true;
+            if (may_retire) {
+                woken = condition_.wait_for(lock, idle_timeout_, [this, &has_work] {
+                    return stop_ || has_work();
+                });
+            } else {
+                condition_.wait(lock, [this, &has_work] {
+                    return stop_ || has_work();
+                });
+            }
+            sleeping_.fetch_sub(1);
+
+            if (stop_ && !has_work()) {
+                return;
+            }
+            if (!woken && try_retire(i)) {
+                return;
+            }
+        }
+    }
+
+    // Spin until has_work() or the spin budget runs out
+    template<typename Pred>
+    inline bool poll_for_work(Pred& has_work) {
+        auto deadline = clock::now() + spin_budget_;
+        SpinBackoff backoff;
+        while (!stop_flag_.load(std::memory_order_acquire)) {
+            if (has_work()) {
+                return true;
+            }
+            backoff.pause();
+            if (clock::now() >= deadline) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // CPUs worker i is restricted to: its node's CPUs in NUMA-aware mode,
+    // narrowed to one of them per worker when polling
+    inline std::vector<int> worker_cpus(size_t i) const {
+        auto cpus = numa_aware_ ? topology_.cpus_of(worker_domain_[i]) : allowed_cpus_;
+        if (spin_budget_.count() > 0 && !cpus.empty()) {
+            return {cpus[i % cpus.size()]};
+        }
+        return cpus;
+    }
+
+    // Idle elastic worker leaves if the pool is above its base size
+    inline bool try_retire(size_t i) {
+        size_t active = active_count_.load();
+        while (active > base_threads_) {
+            if (active_count_.compare_exchange_weak(active, active - 1)) {
+                auto& own = *local_queues_[i];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (own.pinned.empty()) {
+                    own.active.store(false);
+                    return true;
+                }
+                // Work was pinned here meanwhile; stay
+                active_count_.fetch_add(1);
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // Start one more worker while capacity is lost to blocking or queues
+    // are deep relative to the workers able to drain them
+    inline void maybe_grow() {
+        if (!elastic_) {
+            return;
+        }
+        size_t active = active_count_.load();
+        if (active >= workers_.size()) {
+            return;
+        }
+        size_t blocked = blocked_.load();
+        size_t runnable = active > blocked ? active - blocked : 0;
+        size_t queued = pending_[0].load() + pending_[1].load();
+        bool starved = runnable < base_threads_ && queued > 0;
+        bool deep = queued > grow_queue_depth_ * std::max<size_t>(runnable, 1);
+        if (!starved && !deep) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(resize_mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;  // Someone else is resizing right now
+        }
+        for (size_t slot = 0; slot < workers_.size(); ++slot) {
+            if (!local_queues_[slot]->active.load()) {
+                start_worker(slot);
+                return;
+            }
+        }
+    }
+
+    void enter_blocking() override {
+        blocked_.fetch_add(1);
+        maybe_grow();
+    }
+
+    void exit_blocking() override {
+        blocked_.fetch_sub(1);
+    }
+
+    static ThreadPoolOptions make_options(size_t num_threads) {
+        ThreadPoolOptions options;
+        options.num_threads = num_threads;
+        return options;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    struct QueuedTask {
+        std::function<void()> fn;
+        TaskPriority priority = TaskPriority::Interactive;
+        clock::time_point enqueued;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::array<std::deque<QueuedTask>, task_priority_count> tasks;
+        std::deque<QueuedTask> pinned;
+        std::atomic<size_t> pinned_count{0};
+        // Whether a worker thread runs this slot; written under mutex
+        std::atomic<bool> active{false};
+        // Interactive tasks served in a row; only touched by the owning worker
+        size_t interactive_streak = 0;
+    };
+
+    struct DomainQueue {
+        std::mutex mutex;
+        std::array<std::queue<QueuedTask>, task_priority_count> tasks;
+    };
+
+    struct ClassCounters {
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> queue_ns{0};
+        std::atomic<uint64_t> max_queue_ns{0};
+        std::atomic<uint64_t> run_ns{0};
+        std::atomic<uint64_t> recent_queue_ns{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+
+    static TaskPriority queued_priority(size_t lane) {
+        return static_cast<TaskPriority>(lane);
+    }
+
+    inline QueuedTask make_queued(std::function<void()> fn) {
+        auto priority = current_priority_;
+        admit(priority, 1);
+        return QueuedTask{std::move(fn), priority, clock::now()};
+    }
+
+    template<typename R>
+    inline std::vector<QueuedTask> make_queued_bulk(R&& tasks) {
+        check_running();
+        auto priority = current_priority_;
+        auto now = clock::now();
+        std::vector<QueuedTask> batch;
+        if constexpr (std::ranges::sized_range<R>) {
+            batch.reserve(std::ranges::size(tasks));
+        }
+        for (auto&& task : tasks) {
+            batch.push_back(QueuedTask{std::function<void()>(std::forward<decltype(task)>(task)), priority, now});
+        }
+        admit(priority, batch.size());
+        return batch;
+    }
+
+    // Count submissions, refusing them when threads outside the pool would
+    // push a bounded class past its limit
+    inline void admit(TaskPriority priority, size_t count) {
+        auto& counters = counters_[priority_index(priority)];
+        if (max_queued_tasks_ != 0 && current_pool_ != this &&
+            pending_[priority_index(priority)].load() + count > max_queued_tasks_) {
+            counters.rejected.fetch_add(count, std::memory_order_relaxed);
+            throw QueueFullError(priority);
+        }
+        counters.submitted.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    inline bool run_posted() {
+        InlineTask task;
+        if (!posted_->try_pop(task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    // Run a task under its own priority, so whatever it submits inherits it
+    inline void run_task(QueuedTask& task) {
+        auto& counters = counters_[priority_index(task.priority)];
+        auto start = clock::now();
+        auto waited = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - task.enqueued).count());
+        counters.queue_ns.fetch_add(waited, std::memory_order_relaxed);
+        auto max = counters.max_queue_ns.load(std::memory_order_relaxed);
+        while (waited > max && !counters.max_queue_ns.compare_exchange_weak(max, waited, std::memory_order_relaxed)) {
+        }
+        // Racy read-modify-write is fine for a smoothed estimate (weight 1/8)
+        auto recent = counters.recent_queue_ns.load(std::memory_order_relaxed);
+        counters.recent_queue_ns.store(recent - recent / 8 + waited / 8, std::memory_order_relaxed);
+
+        {
+            PriorityScope scope(task.priority);
+            auto previous_delay = current_queue_delay_;
+            current_queue_delay_ = std::chrono::nanoseconds(waited);
+            task.fn();
+            current_queue_delay_ = previous_delay;
+        }
+
+        counters.run_ns.fetch_add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count()),
+            std::memory_order_relaxed);
+        counters.completed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // One NUMA node's injection queue and the workers to steal from there
+    struct StealStep {
+        size_t domain;
+        std::vector<size_t> victims;
+    };
+
+    // Steal plan for every worker, plus one for external threads (last entry)
+    inline void build_steal_plans(size_t domains) {
+        const size_t num_threads = local_queues_.size();
+        for (size_t i = 0; i <= num_threads; ++i) {
+            const size_t home = i < num_threads ? worker_domain_[i] : 0;
+            std::vector<StealStep> plan;
+            for (size_t k = 0; k < domains; ++k) {
+                StealStep step{(home + k) % domains, {}};
+                // Start after the thief so victims are spread across thieves
+                for (size_t j = 1; j <= num_threads; ++j) {
+                    size_t victim = (i + j) % num_threads;
+                    if (victim != i && worker_domain_[victim] == step.domain) {
+                        step.victims.push_back(victim);
+                    }
+                }
+                plan.push_back(std::move(step));
+            }
+            steal_plans_.push_back(std::move(plan));
+        }
+    }
+
+    inline void check_running() const {
+        if (stop_flag_.load(std::memory_order_acquire)) {
+            throw std::runtime_error("Cannot enqueue on stopped ThreadPool");
+        }
+    }
+
+    inline void push_shared(std::function<void()> task) {
+        check_running();
+        auto queued = make_queued(std::move(task));
+        auto lane = priority_index(queued.priority);
+        auto& queue = shared_queue();
+        pending_[lane].fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks[lane].push(std::move(queued));
+        }
+        wake_workers(1, queued_priority(lane));
+        maybe_grow();
+    }
+
+    inline void push_bulk(std::vector<QueuedTask> batch, bool local) {
+        if (batch.empty()) {
+            return;
+        }
+        auto lane = priority_index(batch.front().priority);
+        auto worker = current_worker_index();
+        pending_[lane].fetch_add(batch.size());
+        if (local && worker) {
+            auto& queue = *local_queues_[*worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            auto& tasks = queue.tasks[lane];
+            tasks.insert(tasks.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        } else {
+            auto& queue = shared_queue();
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (auto& queued : batch) {
+                queue.tasks[lane].push(std::move(queued));
+            }
+        }
+        wake_workers(batch.size(), queued_priority(lane));
+        maybe_grow();
+    }
+
+    // Injection queue of the caller's NUMA node, round-robin from outside
+    inline DomainQueue& shared_queue() {
+        size_t domain = 0;
+        if (domain_queues_.size() > 1) {
+            auto worker = current_worker_index();
+            domain = worker ? worker_domain_[*worker]
+                            : next_domain_.fetch_add(1, std::memory_order_relaxed) % domain_queues_.size();
+        }
+        return *domain_queues_[domain];
+    }
+
+    // Wake sleepers after pending_ has been raised and the work pushed.
+    // The sequentially consistent pending_/sleeping_ pair guarantees that
+    // either the pusher sees a sleeper and notifies it, or the sleeper sees
+    // the new work before it blocks. A batch covering every sleeper takes a
+    // single notify_all. Batch work wakes everyone when some workers are
+    // reserved, since a woken reserved worker would ignore it.
+    inline void wake_workers(size_t count, TaskPriority priority) {
+        auto sleeping = sleeping_.load();
+        if (sleeping > 0) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (count >= sleeping || (reserved_workers_ != 0 && priority == TaskPriority::Batch)) {
+                condition_.notify_all();
+            } else {
+                for (size_t i = 0; i < count; ++i) {
+                    condition_.notify_one();
+                }
+            }
+        }
+    }
+
+    inline bool try_pop(size_t worker, QueuedTask& task) {
+        auto& own = *local_queues_[worker];
+        if (own.pinned_count.load() > 0) {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.pinned.empty()) {
+                task = std::move(own.pinned.front());
+                own.pinned.pop_front();
+                own.pinned_count.fetch_sub(1);
+                return true;
+            }
+        }
+
+        if (worker < reserved_workers_) {
+            return try_pop_lane(worker, priority_index(TaskPriority::Interactive), task);
+        }
+
+        // Weighted: let one batch task through after a full interactive streak
+        bool batch_first = priority_policy_ == PriorityPolicy::Weighted &&
+                           own.interactive_streak >= interactive_weight_;
+        for (size_t k = 0; k < task_priority_count; ++k) {
+            size_t lane = batch_first ? task_priority_count - 1 - k : k;
+            if (try_pop_lane(worker, lane, task)) {
+                if (task.priority == TaskPriority::Interactive) {
+                    ++own.interactive_streak;
+                } else {
+                    own.interactive_streak = 0;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool try_pop_lane(size_t worker, size_t lane, QueuedTask& task) {
+        if (pending_[lane].load() == 0) {
+            return false;
+        }
+        {
+            auto& queue = *local_queues_[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks[lane].empty()) {
+                task = std::move(queue.tasks[lane].back());
+                queue.tasks[lane].pop_back();
+                pending_[lane].fetch_sub(1);
+                return true;
+            }
+        }
+        return try_pop_shared_or_steal(worker, lane, task);
+    }
+
+    // Threads outside the pool serve lanes strictly by priority
+    inline bool try_pop_external(QueuedTask& task) {
+        for (size_t lane = 0; lane < task_priority_count; ++lane) {
+            if (pending_[lane].load() > 0 && try_pop_shared_or_steal(workers_.size(), lane, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Walk the thief's steal plan: each node's injection queue, then the
+    // deques of that node's workers, own node first
+    inline bool try_pop_shared_or_steal(size_t thief, size_t lane, QueuedTask& task) {
+        for (const auto& step : steal_plans_[thief]) {
+            {
+                auto& queue = *domain_queues_[step.domain];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks[lane].empty()) {
+                    task = std::move(queue.tasks[lane].front());
+                    queue.tasks[lane].pop();
+                    pending_[lane].fetch_sub(1);
+                    return true;
+                }
+            }
+            for (size_t victim : step.victims) {
+                auto& queue = *local_queues_[victim];
+                if (!queue.active.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks[lane].empty()) {
+                    task = std::move(queue.tasks[lane].front());
+                    queue.tasks[lane].pop_front();
+                    pending_[lane].fetch_sub(1);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    std::vector<std::unique_ptr<WorkerQueue>> local_queues_;
+    std::vector<std::unique_ptr<DomainQueue>> domain_queues_;
+    std::vector<size_t> worker_domain_;
+    std::vector<std::vector<StealStep>> steal_plans_;
     std::mutex queue_mutex_;
     std::condition_variable condition_;
     bool stop_;
+    std::atomic<bool> stop_flag_{false};
+    // Stealable (non-pinned) queued tasks per lane
+    std::array<std::atomic<size_t>, task_priority_count> pending_{};
+    std::atomic<size_t> sleeping_{0};
+    std::atomic<size_t> next_domain_{0};
+    bool numa_aware_;
+    NumaTopology topology_;
+    PriorityPolicy priority_policy_;
+    size_t interactive_weight_;
+    size_t reserved_workers_;
+    size_t max_queued_tasks_;
+    std::unique_ptr<MpmcQueue<InlineTask>> posted_;
+    bool elastic_;
+    std::chrono::milliseconds idle_timeout_;
+    size_t grow_queue_depth_;
+    std::chrono::microseconds spin_budget_;
+    // CPUs available to polling workers outside NUMA-aware mode, captured
+    // at construction since workers may be started from pinned threads
+    std::vector<int> allowed_cpus_;
+    size_t base_threads_ = 0;
+    bool pin_workers_ = false;
+    std::mutex resize_mutex_;
+    std::atomic<size_t> active_count_{0};
+    std::atomic<size_t> blocked_{0};
+    std::array<ClassCounters, task_priority_count> counters_;
+
+    static inline thread_local const ThreadPool* current_pool_ = nullptr;
+    static inline thread_local size_t current_worker_ = 0;
+    static inline thread_local TaskPriority current_priority_ = TaskPriority::Interactive;
+    static inline thread_local std::chrono::nanoseconds current_queue_delay_{0};
 };
 
 } // namespace flowgraph
@@ -0,0 +1,322 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "content_hash.hpp"
+
+namespace flowgraph {
+
+// Snapshot of an ApproximateMemo's lookups
+struct ApproximateMemoMetrics {
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t exact_hits = 0;   // Hits on identical inputs
+    uint64_t candidates = 0;   // Entries compared against lookup inputs
+    size_t entries = 0;
+
+    double hit_rate() const {
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// Memo of outputs keyed by a precision level and a set of numeric inputs,
+// hitting when every input is within tolerance of the corresponding input
+// of a memoized set (the closest such set wins). Candidates come from
+// hash tables and are always checked exactly:
+// - sets of up to max_probed_inputs values are fingerprinted by their
+//   cells on a grid of tolerance-wide cells; a lookup probes the
+//   neighbouring cells too, so it finds every set within tolerance
+// - larger sets (vectors) go through locality-sensitive hashing: each
+//   of `tables` keys joins `hashes_per_table` random Gaussian projections
+//   (of block sums of the inputs), quantized to 4 times the largest
+//   projected distance within tolerance. A set within tolerance shares at
+//   least one key with high probability (over 98% at the worst case of
+//   every input off by the full tolerance, with the defaults), not
+//   certainty.
+// A tolerance of 0 matches identical inputs only. Sets with non-finite
+// inputs are never memoized. Least recently used entries are evicted
+// beyond capacity. Thread-safe.
+template<typename Output>
+class ApproximateMemo {
+public:
+    static constexpr size_t max_probed_inputs = 3;
+
+    explicit ApproximateMemo(double tolerance, size_t capacity = 1024, size_t tables = 8,
+                             size_t hashes_per_table = 4)
+        : tolerance_(tolerance), capacity_(capacity), tables_(tables), hashes_per_table_(hashes_per_table) {
+        if (!(tolerance >= 0.0) || !std::isfinite(tolerance)) {
+            throw std::invalid_argument("Memo tolerance must be finite and non-negative");
+        }
+        if (capacity == 0 || tables == 0 || hashes_per_table == 0) {
+            throw std::invalid_argument("Memo capacity, tables and hashes per table must be positive");
+        }
+    }
+
+    double tolerance() const { return tolerance_; }
+
+    std::optional<Output> find(std::span<const double> inputs, size_t precision_level) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.lookups;
+        if (!all_finite(inputs)) {
+            return std::nullopt;
+        }
+        Entry* best = nullptr;
+        double best_distance = 0.0;
+        const uint64_t lookup = metrics_.lookups;
+        for (auto key : lookup_keys(inputs, precision_level)) {
+            auto [begin, end] = index_.equal_range(key);
+            for (auto it = begin; it != end; ++it) {
+                Entry& entry = *it->second;
+                if (entry.lookup == lookup || entry.level != precision_level ||
+                    entry.inputs.size() != inputs.size()) {
+                    continue;
+                }
+                entry.lookup = lookup;
+                ++metrics_.candidates;
+                auto distance = within_tolerance(entry.inputs, inputs);
+                if (distance && (!best || *distance < best_distance)) {
+                    best = &entry;
+                    best_distance = *distance;
+                }
+            }
+        }
+        if (!best) {
+            return std::nullopt;
+        }
+        ++metrics_.hits;
+        if (best_distance == 0.0) {
+            ++metrics_.exact_hits;
+        }
+        entries_.splice(entries_.begin(), entries_, best->position);
+        return best->output;
+    }
+
+    void insert(std::span<const double> inputs, size_t precision_level, Output output) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!all_finite(inputs)) {
+            return;
+        }
+        entries_.push_front(Entry{precision_level, std::vector<double>(inputs.begin(), inputs.end()),
+                                  std::move(output), insert_keys(inputs, precision_level), {}, 0});
+        entries_.front().position = entries_.begin();
+        for (auto key : entries_.front().keys) {
+            index_.emplace(key, &entries_.front());
+        }
+        while (entries_.size() > capacity_) {
+            evict(entries_.back());
+            entries_.pop_back();
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.clear();
+        entries_.clear();
+    }
+
+    ApproximateMemoMetrics metrics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto metrics = metrics_;
+        metrics.entries = entries_.size();
+        return metrics;
+    }
+
+private:
+    struct Entry {
+        size_t level;
+        std::vector<double> inputs;
+        Output output;
+        std::vector<uint64_t> keys;
+        typename std::list<Entry>::iterator position;
+        uint64_t lookup;   // Last lookup that compared against it
+    };
+
+    static uint64_t mix(uint64_t h, uint64_t v) {
+        // splitmix64 finalizer over the running hash and the next value
+        uint64_t x = h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static bool all_finite(std::span<const double> inputs) {
+        return std::all_of(inputs.begin(), inputs.end(), [](double v) { return std::isfinite(v); });
+    }
+
+    bool probed(size_t size) const {
+        return tolerance_ == 0.0 || size <= max_probed_inputs;
+    }
+
+    // Largest input difference, if every one is within tolerance
+    std::optional<double> within_tolerance(const std::vector<double>& a, std::span<const double> b) const {
+        double distance = 0.0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            distance = std::max(distance, std::abs(a[i] - b[i]));
+            if (distance > tolerance_) {
+                return std::nullopt;
+            }
+        }
+        return distance;
+    }
+
+    // floor(q) as an integer, saturating where it leaves the int64 range
+    // (tiny tolerances, huge inputs); the exact check keeps such keys sound
+    static int64_t clamped_floor(double q) {
+        constexpr double limit = 9.2e18;   // Just inside int64
+        return static_cast<int64_t>(std::floor(std::clamp(q, -limit, limit)));
+    }
+
+    int64_t cell(double v) const {
+        return clamped_floor(v / tolerance_);
+    }
+
+    std::vector<uint64_t> insert_keys(std::span<const double> inputs, size_t level) {
+        if (tolerance_ == 0.0) {
+            return {hashing::hash64(inputs, mix(level, inputs.size()))};
+        }
+        if (probed(inputs.size())) {
+            uint64_t h = mix(level, inputs.size());
+            for (double v : inputs) {
+                h = mix(h, static_cast<uint64_t>(cell(v)));
+            }
+            return {h};
+        }
+        return projection_keys(inputs, level);
+    }
+
+    std::vector<uint64_t> lookup_keys(std::span<const double> inputs, size_t level) {
+        if (!probed(inputs.size())) {
+            return projection_keys(inputs, level);
+        }
+        if (tolerance_ == 0.0) {
+            return insert_keys(inputs, level);
+        }
+        // Every combination of the cell below, at and above each input
+        size_t combinations = 1;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            combinations *= 3;
+        }
+        std::vector<uint64_t> keys;
+        keys.reserve(combinations);
+        for (size_t c = 0; c < combinations; ++c) {
+            uint64_t h = mix(level, inputs.size());
+            size_t digits = c;
+            for (double v : inputs) {
+                // Wrapping arithmetic: the clamped cells sit at the int64 limits
+                h = mix(h, static_cast<uint64_t>(cell(v)) + digits % 3 - 1);
+                digits /= 3;
+            }
+            keys.push_back(h);
+        }
+        return keys;
+    }
+
+    // Inputs are first summed in up to sketch_size contiguous blocks; the
+    // projections are of the block sums, so a lookup costs an add per
+    // input and a few thousand multiply-adds whatever the size
+    static constexpr size_t sketch_size = 64;
+
+    std::vector<uint64_t> projection_keys(std::span<const double> inputs, size_t level) {
+        const auto& projection = projection_for(inputs.size());
+        const size_t blocks = projection.bounds.size() - 1;
+        std::vector<double> sketch(blocks);
+        for (size_t j = 0; j < blocks; ++j) {
+            double sum = 0.0;
+            for (size_t i = projection.bounds[j]; i < projection.bounds[j + 1]; ++i) {
+                sum += inputs[i];
+            }
+            sketch[j] = sum;
+        }
+        std::vector<uint64_t> keys(tables_);
+        for (size_t t = 0; t < tables_; ++t) {
+            uint64_t h = mix(mix(level, inputs.size()), t);
+            for (size_t k = 0; k < hashes_per_table_; ++k) {
+                size_t row = t * hashes_per_table_ + k;
+                const double* a = projection.directions.data() + row * blocks;
+                double dot = 0.0;
+                for (size_t j = 0; j < blocks; ++j) {
+                    dot += a[j] * sketch[j];
+                }
+                h = mix(h, static_cast<uint64_t>(
+                               clamped_floor(dot / projection.width + projection.offsets[row])));
+            }
+            keys[t] = h;
+        }
+        return keys;
+    }
+
+    // Per input size: the blocks of the sketch, Gaussian directions and
+    // uniform offsets (in widths) drawn once from a fixed seed, and the
+    // width, 4 times the largest distance between the sketches of two
+    // sets within tolerance
+    struct Projection {
+        std::vector<size_t> bounds;
+        std::vector<double> directions;
+        std::vector<double> offsets;
+        double width = 0.0;
+    };
+
+    const Projection& projection_for(size_t size) {
+        auto [it, inserted] = projections_.try_emplace(size);
+        if (inserted) {
+            auto& projection = it->second;
+            const size_t blocks = std::min(size, sketch_size);
+            double squares = 0.0;
+            for (size_t j = 0; j <= blocks; ++j) {
+                projection.bounds.push_back(j * size / blocks);
+                if (j > 0) {
+                    auto length = static_cast<double>(projection.bounds[j] - projection.bounds[j - 1]);
+                    squares += length * length;
+                }
+            }
+            projection.width = 4.0 * tolerance_ * std::sqrt(squares);
+
+            std::mt19937_64 rng(mix(0x5eed, size));
+            std::normal_distribution<double> normal;
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            const size_t rows = tables_ * hashes_per_table_;
+            projection.directions.resize(rows * blocks);
+            for (double& a : projection.directions) {
+                a = normal(rng);
+            }
+            projection.offsets.resize(rows);
+            for (double& b : projection.offsets) {
+                b = uniform(rng);
+            }
+        }
+        return it->second;
+    }
+
+    void evict(const Entry& entry) {
+        for (auto key : entry.keys) {
+            auto [begin, end] = index_.equal_range(key);
+            for (auto it = begin; it != end; ++it) {
+                if (it->second == &entry) {
+                    index_.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+
+    double tolerance_;
+    size_t capacity_;
+    size_t tables_;
+    size_t hashes_per_table_;
+    std::list<Entry> entries_;
+    std::unordered_multimap<uint64_t, Entry*> index_;
+    std::unordered_map<size_t, Projection> projections_;
+    ApproximateMemoMetrics metrics_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace flowgraph
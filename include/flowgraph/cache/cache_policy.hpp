@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
+#include "content_hash.hpp"
 
 namespace flowgraph {
 
@@ -57,7 +58,7 @@ public:
 private:
     std::size_t capacity_;
     std::list<T> access_list_;
-    std::unordered_map<T, typename std::list<T>::iterator> item_map_;
+    std::unordered_map<T, typename std::list<T>::iterator, ContentHash> item_map_;
 };
 
 // LFU (Least Frequently Used) cache policy
@@ -96,7 +97,7 @@ public:
 
 private:
     std::size_t capacity_;
-    std::unordered_map<T, std::size_t> freq_map_;
+    std::unordered_map<T, std::size_t, ContentHash> freq_map_;
 };
 
 } // namespace flowgraph
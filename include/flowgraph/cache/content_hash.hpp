@@ -0,0 +1,499 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FLOWGRAPH_X86_SIMD 1
+#endif
+
+namespace flowgraph {
+
+// Content hashing of values for caches and memoization. Buffers are hashed
+// with a 64-bit-lane multiply-accumulate hash in the style of XXH3 (not
+// bit-compatible with it): 64-byte stripes feed eight accumulators, which
+// are scrambled every 1 KiB, and inputs up to 128 bytes take short paths.
+// Hashes are for use within a process: they are not stable across byte
+// orders or versions.
+namespace hashing {
+
+// Both halves of a 128-bit hash
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    friend bool operator==(const Hash128&, const Hash128&) = default;
+};
+
+namespace detail {
+
+inline constexpr uint64_t prime32_1 = 0x9E3779B1u;
+inline constexpr uint64_t prime32_2 = 0x85EBCA77u;
+inline constexpr uint64_t prime32_3 = 0xC2B2AE3Du;
+inline constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ull;
+inline constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4Full;
+inline constexpr uint64_t prime64_3 = 0x165667B19E3779F9ull;
+inline constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ull;
+inline constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ull;
+
+inline constexpr size_t stripe = 64;
+inline constexpr size_t stripes_per_block = 16;
+inline constexpr size_t block = stripe * stripes_per_block;
+
+// Key words: stripes take [0, 24) (stripe s of a block from word s; the
+// last stripe of the input from word 16), scrambles [24, 32) and the
+// final merges [32, 40) and [40, 48). Short inputs take [0, 16), and
+// [24, 40) for the high half of a 128-bit hash.
+struct Secret {
+    std::array<uint64_t, 48> keys{};
+};
+
+constexpr Secret make_secret() {
+    Secret secret;
+    uint64_t state = 0x243F6A8885A308D3ull;
+    for (auto& key : secret.keys) {
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        key = z ^ (z >> 31);
+    }
+    return secret;
+}
+
+inline constexpr Secret default_secret = make_secret();
+
+inline Secret seeded_secret(uint64_t seed) {
+    Secret secret = default_secret;
+    for (size_t i = 0; i < secret.keys.size(); i += 2) {
+        secret.keys[i] += seed;
+        secret.keys[i + 1] -= seed;
+    }
+    return secret;
+}
+
+// Folds the 128-bit product of a and b to 64 bits
+inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ using uint128 = unsigned __int128;
+    auto product = static_cast<uint128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t read64(const std::byte* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read32(const std::byte* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Floating zeros folded before hashing, so that 0.0 and -0.0 (which
+// compare equal) hash alike
+enum class Zeros { Raw, Float32, Float64 };
+
+template<typename E>
+inline constexpr Zeros zeros_of = std::is_same_v<E, double> ? Zeros::Float64
+                                : std::is_same_v<E, float> ? Zeros::Float32 : Zeros::Raw;
+
+template<Zeros Z>
+inline uint64_t load_lane(const std::byte* p) {
+    uint64_t v = read64(p);
+    if constexpr (Z == Zeros::Float64) {
+        if (std::bit_cast<double>(v) == 0.0) {
+            v = 0;
+        }
+    } else if constexpr (Z == Zeros::Float32) {
+        if (std::bit_cast<float>(static_cast<uint32_t>(v)) == 0.0f) {
+            v &= 0xFFFFFFFF00000000ull;
+        }
+        if (std::bit_cast<float>(static_cast<uint32_t>(v >> 32)) == 0.0f) {
+            v &= 0x00000000FFFFFFFFull;
+        }
+    }
+    return v;
+}
+
+using accumulate_fn = void (*)(uint64_t* acc, const std::byte* p, size_t stripes, const uint64_t* keys);
+using scramble_fn = void (*)(uint64_t* acc, const uint64_t* keys);
+
+// Stripes at p into the accumulators, stripe s keyed from keys + s
+template<Zeros Z>
+inline void accumulate_scalar(uint64_t* acc, const std::byte* p, size_t stripes, const uint64_t* keys) {
+    for (size_t s = 0; s < stripes; ++s) {
+        for (size_t i = 0; i < 8; ++i) {
+            uint64_t data = load_lane<Z>(p + s * stripe + i * 8);
+            uint64_t keyed = data ^ keys[s + i];
+            acc[i ^ 1] += data;
+            acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    }
+}
+
+inline void scramble_scalar(uint64_t* acc, const uint64_t* keys) {
+    for (size_t i = 0; i < 8; ++i) {
+        acc[i] = (acc[i] ^ (acc[i] >> 47) ^ keys[i]) * prime32_1;
+    }
+}
+
+#if defined(FLOWGRAPH_X86_SIMD) && defined(__SSE2__)
+
+template<Zeros Z>
+inline __m128i load_sse2(const std::byte* p) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if constexpr (Z == Zeros::Float64) {
+        v = _mm_andnot_si128(_mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(v), _mm_setzero_pd())), v);
+    } else if constexpr (Z == Zeros::Float32) {
+        v = _mm_andnot_si128(_mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(v), _mm_setzero_ps())), v);
+    }
+    return v;
+}
+
+template<Zeros Z>
+inline void accumulate_sse2(uint64_t* acc, const std::byte* p, size_t stripes, const uint64_t* keys) {
+    __m128i a[4];
+    for (size_t i = 0; i < 4; ++i) {
+        a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+    }
+    for (size_t s = 0; s < stripes; ++s) {
+        for (size_t i = 0; i < 4; ++i) {
+            __m128i data = load_sse2<Z>(p + s * stripe + i * 16);
+            __m128i keyed = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + s + i * 2)));
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+    }
+}
+
+inline void scramble_sse2(uint64_t* acc, const uint64_t* keys) {
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(prime32_1));
+    for (size_t i = 0; i < 4; ++i) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+        a = _mm_xor_si128(_mm_xor_si128(a, _mm_srli_epi64(a, 47)),
+                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys) + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
+
+#ifdef FLOWGRAPH_X86_SIMD
+
+template<Zeros Z>
+__attribute__((target("avx2"))) inline __m256i load_avx2(const std::byte* p) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    if constexpr (Z == Zeros::Float64) {
+        __m256d zero = _mm256_cmp_pd(_mm256_castsi256_pd(v), _mm256_setzero_pd(), _CMP_EQ_OQ);
+        v = _mm256_andnot_si256(_mm256_castpd_si256(zero), v);
+    } else if constexpr (Z == Zeros::Float32) {
+        __m256 zero = _mm256_cmp_ps(_mm256_castsi256_ps(v), _mm256_setzero_ps(), _CMP_EQ_OQ);
+        v = _mm256_andnot_si256(_mm256_castps_si256(zero), v);
+    }
+    return v;
+}
+
+template<Zeros Z>
+__attribute__((target("avx2"))) inline void accumulate_avx2(uint64_t* acc, const std::byte* p, size_t stripes,
+                                                             const uint64_t* keys) {
+    __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+    __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + 1);
+    for (size_t s = 0; s < stripes; ++s) {
+        const std::byte* q = p + s * stripe;
+        __m256i d0 = load_avx2<Z>(q);
+        __m256i d1 = load_avx2<Z>(q + 32);
+        __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + s)));
+        __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + s + 4)));
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_shuffle_epi32(k0, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_shuffle_epi32(k1, _MM_SHUFFLE(0, 3, 0, 1)));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), a0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + 1, a1);
+}
+
+__attribute__((target("avx2"))) inline void scramble_avx2(uint64_t* acc, const uint64_t* keys) {
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(prime32_1));
+    for (size_t i = 0; i < 2; ++i) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+        a = _mm256_xor_si256(_mm256_xor_si256(a, _mm256_srli_epi64(a, 47)),
+                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys) + i));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif // FLOWGRAPH_X86_SIMD
+
+struct Kernels {
+    accumulate_fn accumulate;
+    scramble_fn scramble;
+};
+
+template<Zeros Z>
+inline constexpr Kernels scalar_kernels{accumulate_scalar<Z>, scramble_scalar};
+
+// Widest kernels this CPU runs, picked once
+template<Zeros Z>
+inline const Kernels& best_kernels() {
+    static const Kernels kernels = [] {
+#ifdef FLOWGRAPH_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernels{accumulate_avx2<Z>, scramble_avx2};
+        }
+#endif
+#if defined(FLOWGRAPH_X86_SIMD) && defined(__SSE2__)
+        return Kernels{accumulate_sse2<Z>, scramble_sse2};
+#else
+        return scalar_kernels<Z>;
+#endif
+    }();
+    return kernels;
+}
+
+// Inputs of at most 128 bytes, keyed from keys
+inline uint64_t hash_short(const std::byte* p, size_t len, const uint64_t* keys, uint64_t start) {
+    if (len == 0) {
+        return avalanche(start ^ keys[0] ^ keys[1]);
+    }
+    if (len <= 3) {
+        uint64_t combined = (std::to_integer<uint64_t>(p[0]) << 16) | (std::to_integer<uint64_t>(p[len >> 1]) << 24) |
+                            std::to_integer<uint64_t>(p[len - 1]) | (uint64_t{len} << 8);
+        return avalanche(mul128_fold64(combined ^ keys[0], start ^ keys[1] ^ prime64_1));
+    }
+    if (len <= 8) {
+        uint64_t combined = (read32(p) << 32) | read32(p + len - 4);
+        return avalanche(mul128_fold64(combined ^ keys[0], (start + len) ^ keys[1]));
+    }
+    if (len <= 16) {
+        uint64_t lo = read64(p) ^ keys[0];
+        uint64_t hi = read64(p + len - 8) ^ keys[1];
+        return avalanche(start + len + std::rotl(lo, 32) + hi + mul128_fold64(lo, hi));
+    }
+    uint64_t acc = start + len * prime64_1;
+    const size_t chunks = (len + 15) / 16;
+    for (size_t i = 0; i < chunks; ++i) {
+        const std::byte* chunk = p + std::min(i * 16, len - 16);
+        acc += mul128_fold64(read64(chunk) ^ keys[2 * i], read64(chunk + 8) ^ keys[2 * i + 1]);
+    }
+    return avalanche(acc);
+}
+
+inline uint64_t merge(const uint64_t* acc, const uint64_t* keys, uint64_t start) {
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; ++i) {
+        result += mul128_fold64(acc[2 * i] ^ keys[2 * i], acc[2 * i + 1] ^ keys[2 * i + 1]);
+    }
+    return avalanche(result);
+}
+
+// Inputs over 128 bytes
+inline Hash128 hash_long(const std::byte* p, size_t len, const Secret& secret, const Kernels& kernels) {
+    alignas(32) uint64_t acc[8] = {prime32_3, prime64_1, prime64_2, prime64_3,
+                                   prime64_4, prime32_2, prime64_5, prime32_1};
+    const uint64_t* keys = secret.keys.data();
+    const size_t blocks = (len - 1) / block;
+    for (size_t b = 0; b < blocks; ++b) {
+        kernels.accumulate(acc, p + b * block, stripes_per_block, keys);
+        kernels.scramble(acc, keys + 24);
+    }
+    kernels.accumulate(acc, p + blocks * block, ((len - 1) - blocks * block) / stripe, keys);
+    kernels.accumulate(acc, p + len - stripe, 1, keys + 16);
+    return {merge(acc, keys + 32, len * prime64_1), merge(acc, keys + 40, ~(len * prime64_2))};
+}
+
+// Short inputs with floating zeros folded into a copy
+template<Zeros Z>
+inline const std::byte* folded(const std::byte* p, size_t len, std::array<std::byte, 128>& copy) {
+    if constexpr (Z == Zeros::Raw) {
+        return p;
+    } else {
+        using E = std::conditional_t<Z == Zeros::Float64, double, float>;
+        std::memcpy(copy.data(), p, len);
+        for (size_t i = 0; i + sizeof(E) <= len; i += sizeof(E)) {
+            E v;
+            std::memcpy(&v, copy.data() + i, sizeof(E));
+            if (v == E{0}) {
+                std::memset(copy.data() + i, 0, sizeof(E));
+            }
+        }
+        return copy.data();
+    }
+}
+
+template<Zeros Z>
+inline uint64_t hash64(const std::byte* p, size_t len, uint64_t seed, bool vectorized) {
+    if (len <= 128) {
+        std::array<std::byte, 128> copy;
+        return hash_short(folded<Z>(p, len, copy), len, default_secret.keys.data(), seed);
+    }
+    const auto& kernels = vectorized ? best_kernels<Z>() : scalar_kernels<Z>;
+    return hash_long(p, len, seed ? seeded_secret(seed) : default_secret, kernels).low;
+}
+
+template<Zeros Z>
+inline Hash128 hash128(const std::byte* p, size_t len, uint64_t seed, bool vectorized) {
+    if (len <= 128) {
+        std::array<std::byte, 128> copy;
+        const std::byte* data = folded<Z>(p, len, copy);
+        return {hash_short(data, len, default_secret.keys.data(), seed),
+                hash_short(data, len, default_secret.keys.data() + 24, ~seed)};
+    }
+    const auto& kernels = vectorized ? best_kernels<Z>() : scalar_kernels<Z>;
+    return hash_long(p, len, seed ? seeded_secret(seed) : default_secret, kernels);
+}
+
+} // namespace detail
+
+// Element types hashed by their bytes; floating zeros hash alike
+template<typename E>
+concept HashableElement = std::is_arithmetic_v<E> || std::is_enum_v<E>;
+
+inline uint64_t hash64(std::span<const std::byte> bytes, uint64_t seed = 0) {
+    return detail::hash64<detail::Zeros::Raw>(bytes.data(), bytes.size(), seed, true);
+}
+
+inline Hash128 hash128(std::span<const std::byte> bytes, uint64_t seed = 0) {
+    return detail::hash128<detail::Zeros::Raw>(bytes.data(), bytes.size(), seed, true);
+}
+
+template<HashableElement E>
+uint64_t hash64(std::span<const E> values, uint64_t seed = 0) {
+    auto bytes = std::as_bytes(values);
+    return detail::hash64<detail::zeros_of<E>>(bytes.data(), bytes.size(), seed, true);
+}
+
+template<HashableElement E>
+Hash128 hash128(std::span<const E> values, uint64_t seed = 0) {
+    auto bytes = std::as_bytes(values);
+    return detail::hash128<detail::zeros_of<E>>(bytes.data(), bytes.size(), seed, true);
+}
+
+// Mixes a value's hash into a running one, for composite values
+inline uint64_t combine(uint64_t seed, uint64_t value) {
+    return detail::avalanche(detail::mul128_fold64(seed ^ detail::prime64_1, value ^ detail::prime64_2));
+}
+
+// The same hashes computed one lane at a time, without SIMD
+namespace scalar {
+
+inline uint64_t hash64(std::span<const std::byte> bytes, uint64_t seed = 0) {
+    return detail::hash64<detail::Zeros::Raw>(bytes.data(), bytes.size(), seed, false);
+}
+
+inline Hash128 hash128(std::span<const std::byte> bytes, uint64_t seed = 0) {
+    return detail::hash128<detail::Zeros::Raw>(bytes.data(), bytes.size(), seed, false);
+}
+
+template<HashableElement E>
+uint64_t hash64(std::span<const E> values, uint64_t seed = 0) {
+    auto bytes = std::as_bytes(values);
+    return detail::hash64<detail::zeros_of<E>>(bytes.data(), bytes.size(), seed, false);
+}
+
+} // namespace scalar
+} // namespace hashing
+
+namespace hash_value_detail {
+
+// Hides flowgraph::hash_value from unqualified lookup, leaving ADL
+void hash_value() = delete;
+
+template<typename T>
+concept AdlHashable = requires(const T& value) {
+    { hash_value(value) } -> std::convertible_to<uint64_t>;
+};
+
+template<typename T>
+concept ContiguousBuffer = std::ranges::contiguous_range<const T> && std::ranges::sized_range<const T> &&
+                           hashing::HashableElement<std::ranges::range_value_t<const T>>;
+
+template<typename T>
+concept StdHashable = requires(const T& value) {
+    { std::hash<T>{}(value) } -> std::convertible_to<size_t>;
+};
+
+struct hash_value_fn {
+    template<typename T>
+    uint64_t operator()(const T& value, uint64_t seed = 0) const {
+        if constexpr (AdlHashable<T>) {
+            return hashing::combine(seed, static_cast<uint64_t>(hash_value(value)));
+        } else if constexpr (hashing::HashableElement<T>) {
+            return hashing::hash64(std::span<const T>(&value, 1), seed);
+        } else if constexpr (ContiguousBuffer<T>) {
+            return hashing::hash64(std::span(std::ranges::data(value), std::ranges::size(value)), seed);
+        } else if constexpr (std::ranges::input_range<const T>) {
+            uint64_t h = hashing::combine(seed, hashing::detail::prime64_3);
+            size_t count = 0;
+            for (const auto& element : value) {
+                h = hashing::combine(h, (*this)(element));
+                ++count;
+            }
+            return hashing::combine(h, count);
+        } else if constexpr (StdHashable<T>) {
+            return hashing::combine(seed, static_cast<uint64_t>(std::hash<T>{}(value)));
+        } else {
+            static_assert(StdHashable<T>, "hash_value needs an ADL hash_value(const T&), a range or std::hash<T>");
+        }
+    }
+};
+
+} // namespace hash_value_detail
+
+// Content hash of a value, in order of preference through:
+// - an ADL-found hash_value(const T&), the customization point for types
+//   whose equality is not member-wise
+// - the bytes of arithmetic values and contiguous buffers of them
+//   (vectors, arrays, strings), hashed in bulk
+// - the hashes of the elements of other ranges (nested containers)
+// - std::hash<T>
+inline namespace cpo {
+inline constexpr hash_value_detail::hash_value_fn hash_value{};
+}
+
+// Hasher for unordered containers of values, through hash_value
+struct ContentHash {
+    template<typename T>
+    size_t operator()(const T& value) const {
+        return static_cast<size_t>(hash_value(value));
+    }
+};
+
+} // namespace flowgraph
@@ -2,8 +2,14 @@
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <unordered_set>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 #include "cache_policy.hpp"
+#include "content_hash.hpp"
+#include "value_compression.hpp"
 
 namespace flowgraph {
 
@@ -11,7 +17,13 @@ template<typename T>
 class GraphCache {
 private:
     std::unique_ptr<CachePolicy<T>> policy_;
-    std::unordered_set<T> cache_;
+    // Values held in full, with the run each was last read or stored in
+    mutable std::unordered_map<T, size_t, ContentHash> cache_;
+    // Values compressed after going unread, by hash_value
+    [[no_unique_address]] mutable std::conditional_t<CompressibleValue<T>,
+        std::unordered_multimap<uint64_t, cold_value_t<T>>, std::monostate> cold_;
+    ColdCompressionOptions cold_options_;
+    size_t run_ = 0;
     mutable std::mutex mutex_;
 
 public:
@@ -20,8 +32,12 @@ public:
 
     void store(const T& value) {
         std::lock_guard<std::mutex> lock(mutex_);
-        
-        if (cache_.find(value) != cache_.end()) {
+
+        auto it = cache_.find(value);
+        if (it != cache_.end()) {
+            it->second = run_;
+        }
+        if (it != cache_.end() || thaw(value)) {
             if (policy_) {
                 policy_->on_access(value);
             }
@@ -31,31 +47,136 @@ public:
         if (policy_) {
             if (!policy_->should_cache(value)) {
                 T victim = policy_->select_victim();
-                cache_.erase(victim);
+                if (cache_.erase(victim) == 0) {
+                    erase_cold(victim);
+                }
             }
             policy_->on_insert(value);
         }
 
-        cache_.insert(value);
+        cache_.emplace(value, run_);
     }
 
     std::optional<T> get(const T& key) const {
         std::lock_guard<std::mutex> lock(mutex_);
-        
+
         auto it = cache_.find(key);
-        if (it != cache_.end()) {
-            if (policy_) {
-                policy_->on_access(key);
+        if (it == cache_.end()) {
+            auto thawed = thaw(key);
+            if (!thawed) {
+                return std::nullopt;
             }
-            return *it;
+            it = *thawed;
         }
-        
-        return std::nullopt;
+        it->second = run_;
+        if (policy_) {
+            policy_->on_access(key);
+        }
+        return it->first;
     }
 
     void clear() {
         std::lock_guard<std::mutex> lock(mutex_);
         cache_.clear();
+        if constexpr (CompressibleValue<T>) {
+            cold_.clear();
+        }
+    }
+
+    // Values not read for options.idle_runs runs are compressed at the end
+    // of a run and decompressed, back in full, when next read
+    void set_cold_compression(ColdCompressionOptions options) requires CompressibleValue<T> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cold_options_ = std::move(options);
+    }
+
+    // Ends a run and compresses the values that have gone cold. The
+    // compression itself runs without the lock held; values read in the
+    // meantime stay in full, and values that do not shrink are tried again
+    // idle_runs runs later.
+    void end_run() {
+        std::vector<T> candidates;
+        size_t run;
+        ColdCompressionOptions options;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            run = ++run_;
+            options = cold_options_;
+            if constexpr (CompressibleValue<T>) {
+                if (options.idle_runs > 0) {
+                    for (const auto& [value, last_run] : cache_) {
+                        if (run - last_run > options.idle_runs) {
+                            candidates.push_back(value);
+                        }
+                    }
+                }
+            }
+        }
+        if constexpr (CompressibleValue<T>) {
+            if (candidates.empty()) {
+                return;
+            }
+            std::vector<std::optional<CompressedValue<T>>> compressed;
+            compressed.reserve(candidates.size());
+            for (const auto& value : candidates) {
+                compressed.push_back(CompressedValue<T>::compress(value, options.min_bytes));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                auto it = cache_.find(candidates[i]);
+                if (it == cache_.end() || it->second >= run) {
+                    continue;
+                }
+                if (!compressed[i]) {
+                    it->second = run - 1;
+                    continue;
+                }
+                if (options.stats) {
+                    options.stats->record_compression(compressed[i]->original_bytes(), compressed[i]->bytes());
+                }
+                cold_.emplace(hash_value(candidates[i]), std::move(*compressed[i]));
+                cache_.erase(it);
+            }
+        }
+    }
+
+    // Values held compressed
+    size_t compressed_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if constexpr (CompressibleValue<T>) {
+            return cold_.size();
+        } else {
+            return 0;
+        }
+    }
+
+private:
+    // Moves a compressed value equal to key back in full
+    std::optional<typename std::unordered_map<T, size_t, ContentHash>::iterator> thaw(const T& key) const {
+        if constexpr (CompressibleValue<T>) {
+            auto [begin, end] = cold_.equal_range(hash_value(key));
+            for (auto it = begin; it != end; ++it) {
+                auto value = timed_decompression(cold_options_, [&] { return it->second.decompress(); });
+                if (value == key) {
+                    cold_.erase(it);
+                    return cache_.emplace(std::move(value), run_).first;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    void erase_cold(const T& key) {
+        if constexpr (CompressibleValue<T>) {
+            auto [begin, end] = cold_.equal_range(hash_value(key));
+            for (auto it = begin; it != end; ++it) {
+                if (it->second.decompress() == key) {
+                    cold_.erase(it);
+                    return;
+                }
+            }
+        }
     }
 };
 
@@ -0,0 +1,386 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace flowgraph {
+
+// Linux pressure stall information for memory: the share of the last ten
+// seconds, in percent, in which some (or all) runnable tasks were stalled
+// waiting for memory
+struct MemoryPressure {
+    double some_avg10 = 0.0;
+    double full_avg10 = 0.0;
+
+    // nullopt where the file does not exist or cannot be parsed (kernels
+    // without PSI, other systems)
+    static std::optional<MemoryPressure> read(const std::string& path = "/proc/pressure/memory") {
+        std::ifstream in(path);
+        if (!in) {
+            return std::nullopt;
+        }
+        MemoryPressure pressure;
+        bool some = false;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string kind, avg10;
+            fields >> kind >> avg10;
+            if (avg10.rfind("avg10=", 0) != 0) {
+                continue;
+            }
+            double value = 0.0;
+            auto text = std::string_view(avg10).substr(6);
+            if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc{}) {
+                return std::nullopt;
+            }
+            if (kind == "some") {
+                pressure.some_avg10 = value;
+                some = true;
+            } else if (kind == "full") {
+                pressure.full_avg10 = value;
+            }
+        }
+        return some ? std::optional(pressure) : std::nullopt;
+    }
+};
+
+// Where one record lives in a SpillFile
+struct SpillSlot {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// Growable file of variable-sized records, written with pwrite and read
+// through a shared mapping of the whole file, so spilled data sits in the
+// page cache (which the kernel can write back and reclaim) rather than in
+// the process. Freed space is reused first fit. The file is unlinked as
+// soon as it is created and goes away with the descriptor.
+class SpillFile {
+public:
+    explicit SpillFile(const std::string& directory = {}) {
+        auto dir = directory.empty() ? std::filesystem::temp_directory_path().string() : directory;
+        std::string path = dir + "/flowgraph-spill-XXXXXX";
+        fd_ = ::mkostemp(path.data(), O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "mkstemp " + path);
+        }
+        ::unlink(path.c_str());
+    }
+
+    ~SpillFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+        ::close(fd_);
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    SpillSlot write(std::span<const std::byte> data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SpillSlot slot{allocate(data.size()), data.size()};
+        size_t written = 0;
+        while (written < data.size()) {
+            auto n = ::pwrite(fd_, data.data() + written, data.size() - written,
+                              static_cast<off_t>(slot.offset + written));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                release(slot);
+                throw std::system_error(error, std::generic_category(), "pwrite spill file");
+            }
+            written += static_cast<size_t>(n);
+        }
+        used_ += padded(slot.size);
+        return slot;
+    }
+
+    // Copies a record out and drops its pages from the process; they stay
+    // in the page cache until the kernel needs the memory
+    void read(SpillSlot slot, std::span<std::byte> out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (out.size() != slot.size || slot.offset + slot.size > size_) {
+            throw std::out_of_range("Spill slot does not match its record");
+        }
+        if (slot.size == 0) {
+            return;
+        }
+        std::memcpy(out.data(), data_ + slot.offset, slot.size);
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t begin = slot.offset - slot.offset % page;
+        ::madvise(data_ + begin, slot.offset + slot.size - begin, MADV_DONTNEED);
+    }
+
+    void free(SpillSlot slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        used_ -= padded(slot.size);
+        release(slot);
+    }
+
+    // Bytes of the file, and of the records in it
+    size_t file_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    size_t used_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return used_;
+    }
+
+private:
+    static constexpr size_t alignment = 64;
+
+    static size_t padded(size_t size) {
+        return std::max<size_t>(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    uint64_t allocate(size_t size) {
+        size = padded(size);
+        for (auto it = free_.begin(); it != free_.end(); ++it) {
+            if (it->second >= size) {
+                auto [offset, extent] = *it;
+                free_.erase(it);
+                if (extent > size) {
+                    free_.emplace(offset + size, extent - size);
+                }
+                return offset;
+            }
+        }
+        uint64_t offset = end_;
+        if (offset + size > size_) {
+            grow(offset + size);
+        }
+        end_ = offset + size;
+        return offset;
+    }
+
+    // Returns a record's space to the free list, merged with its neighbours
+    void release(SpillSlot slot) {
+        uint64_t offset = slot.offset;
+        uint64_t extent = padded(slot.size);
+        auto next = free_.lower_bound(offset);
+        if (next != free_.end() && offset + extent == next->first) {
+            extent += next->second;
+            next = free_.erase(next);
+        }
+        if (next != free_.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += extent;
+                return;
+            }
+        }
+        free_.emplace(offset, extent);
+    }
+
+    // Doubles the file (at least 1 MiB) and maps it again
+    void grow(size_t min_size) {
+        size_t size = std::max<size_t>(size_t{1} << 20, size_ * 2);
+        while (size < min_size) {
+            size *= 2;
+        }
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate spill file");
+        }
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (data == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap spill file");
+        }
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+        data_ = static_cast<std::byte*>(data);
+        size_ = size;
+    }
+
+    int fd_ = -1;
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    uint64_t end_ = 0;
+    size_t used_ = 0;
+    std::map<uint64_t, uint64_t> free_;
+    mutable std::mutex mutex_;
+};
+
+// When cached levels spill: over a budget of resident bytes, or once the
+// kernel reports memory pressure
+struct SpillOptions {
+    // Resident bytes of cached levels allowed across the trees sharing the
+    // store; 0 for no budget
+    size_t memory_budget = 0;
+    // PSI "some avg10" percentage at which every level idle for a run
+    // spills; 0 to ignore pressure
+    double pressure_threshold = 0.0;
+    std::string pressure_path = "/proc/pressure/memory";
+    // Directory of the spill file; empty for the system temp directory
+    std::string directory;
+};
+
+// Snapshot of spilling
+struct SpillMetrics {
+    uint64_t levels_spilled = 0;
+    uint64_t bytes_spilled = 0;
+    uint64_t levels_reloaded = 0;
+    uint64_t bytes_reloaded = 0;
+    std::chrono::nanoseconds total_reload_time{0};
+    std::chrono::nanoseconds max_reload_time{0};
+    // Bytes of records on disk now, and of the file holding them
+    size_t bytes_on_disk = 0;
+    size_t file_bytes = 0;
+
+    std::chrono::nanoseconds mean_reload_time() const {
+        return levels_reloaded ? total_reload_time / static_cast<int64_t>(levels_reloaded)
+                               : std::chrono::nanoseconds{0};
+    }
+};
+
+// One level of a tree as seen by spilling
+struct LevelUsage {
+    size_t level = 0;
+    size_t bytes = 0;       // Held in memory
+    size_t idle_runs = 0;   // Runs since it was last read
+};
+
+// Spill file and policy shared by the trees of a graph. The file is
+// created on the first spill.
+class SpillStore {
+public:
+    explicit SpillStore(SpillOptions options = {}) : options_(std::move(options)) {}
+
+    const SpillOptions& options() const { return options_; }
+
+    SpillSlot write(std::span<const std::byte> data) {
+        auto slot = file().write(data);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.levels_spilled;
+        metrics_.bytes_spilled += data.size();
+        return slot;
+    }
+
+    std::vector<std::byte> read(SpillSlot slot) {
+        std::vector<std::byte> data(slot.size);
+        file().read(slot, data);
+        return data;
+    }
+
+    void free(SpillSlot slot) {
+        file().free(slot);
+    }
+
+    // A reload, timed from the read to the value being back in memory
+    void record_reload(size_t bytes, std::chrono::nanoseconds elapsed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.levels_reloaded;
+        metrics_.bytes_reloaded += bytes;
+        metrics_.total_reload_time += elapsed;
+        metrics_.max_reload_time = std::max(metrics_.max_reload_time, elapsed);
+    }
+
+    // Whether PSI reports pressure at or above the threshold
+    bool under_pressure() const {
+        if (options_.pressure_threshold <= 0.0) {
+            return false;
+        }
+        auto pressure = MemoryPressure::read(options_.pressure_path);
+        return pressure && pressure->some_avg10 >= options_.pressure_threshold;
+    }
+
+    SpillMetrics metrics() const {
+        SpillMetrics metrics;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            metrics = metrics_;
+        }
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (file_) {
+            metrics.bytes_on_disk = file_->used_bytes();
+            metrics.file_bytes = file_->file_bytes();
+        }
+        return metrics;
+    }
+
+private:
+    SpillFile& file() {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (!file_) {
+            file_ = std::make_unique<SpillFile>(options_.directory);
+        }
+        return *file_;
+    }
+
+    SpillOptions options_;
+    std::unique_ptr<SpillFile> file_;
+    mutable std::mutex file_mutex_;
+    SpillMetrics metrics_;
+    mutable std::mutex mutex_;
+};
+
+// Spills levels of the holders (trees or nodes: anything with
+// memory_bytes(), level_usage() and spill_level(level), held by pointer)
+// until their resident bytes are within the store's budget, longest idle
+// and then largest first. Under memory pressure every level idle for at
+// least a run spills as well. Returns the bytes freed.
+template<std::ranges::range R>
+size_t enforce_spill_budget(R&& holders, SpillStore& store) {
+    const size_t budget = store.options().memory_budget;
+    const bool pressure = store.under_pressure();
+    size_t resident = 0;
+    for (const auto& holder : holders) {
+        resident += holder->memory_bytes();
+    }
+    if ((budget == 0 || resident <= budget) && !pressure) {
+        return 0;
+    }
+
+    using holder_type = decltype(&*std::declval<std::ranges::range_reference_t<R>>());
+    std::vector<std::pair<holder_type, LevelUsage>> levels;
+    for (const auto& holder : holders) {
+        for (const auto& usage : holder->level_usage()) {
+            levels.emplace_back(&*holder, usage);
+        }
+    }
+    std::sort(levels.begin(), levels.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.second.idle_runs, a.second.bytes) > std::tie(b.second.idle_runs, b.second.bytes);
+    });
+
+    size_t freed = 0;
+    for (auto& [holder, usage] : levels) {
+        bool over_budget = budget > 0 && resident > budget;
+        if (!over_budget && !(pressure && usage.idle_runs > 0)) {
+            break;
+        }
+        size_t bytes = holder->spill_level(usage.level);
+        resident -= std::min(resident, bytes);
+        freed += bytes;
+    }
+    return freed;
+}
+
+} // namespace flowgraph
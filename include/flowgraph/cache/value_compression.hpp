@@ -0,0 +1,566 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "../core/precision_storage.hpp"
+#include "../distributed/value_codec.hpp"
+
+namespace flowgraph {
+
+enum class CompressionCodec : uint8_t {
+    Bytes,   // LZ block codec over the value's encoded bytes
+    Floats,  // XOR with the previous element, byte planes, then LZ
+    Raw      // Encoded bytes as they are, for values that do not shrink
+};
+
+inline std::string_view to_string(CompressionCodec codec) {
+    switch (codec) {
+        case CompressionCodec::Bytes: return "bytes";
+        case CompressionCodec::Floats: return "floats";
+        case CompressionCodec::Raw: return "raw";
+    }
+    return "unknown";
+}
+
+namespace compression {
+
+// LZ block format in the style of LZ4: a run of sequences, each a token
+// byte (literal count in the high nibble, match length - 4 in the low one,
+// 15 meaning more length bytes follow, 255 meaning more again), the
+// literals, then a 2-byte little-endian match offset and the match length
+// bytes. The last sequence has literals only. The decompressed size is not
+// stored; callers keep it.
+inline constexpr size_t min_match = 4;
+inline constexpr size_t last_literals = 5;
+inline constexpr size_t max_offset = 65535;
+inline constexpr int hash_bits = 12;
+
+namespace detail {
+
+inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void put_length(std::vector<std::byte>& out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out.push_back(std::byte{255});
+    }
+    out.push_back(static_cast<std::byte>(length));
+}
+
+inline void put_sequence(std::vector<std::byte>& out, const uint8_t* literals, size_t literal_count,
+                         size_t offset, size_t match_length) {
+    size_t extra = match_length - min_match;
+    out.push_back(static_cast<std::byte>((std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(extra, 15)));
+    if (literal_count >= 15) {
+        put_length(out, literal_count - 15);
+    }
+    size_t at = out.size();
+    out.resize(at + literal_count);
+    std::memcpy(out.data() + at, literals, literal_count);
+    out.push_back(static_cast<std::byte>(offset & 0xff));
+    out.push_back(static_cast<std::byte>(offset >> 8));
+    if (extra >= 15) {
+        put_length(out, extra - 15);
+    }
+}
+
+inline void put_last_literals(std::vector<std::byte>& out, const uint8_t* literals, size_t literal_count) {
+    out.push_back(static_cast<std::byte>(std::min<size_t>(literal_count, 15) << 4));
+    if (literal_count >= 15) {
+        put_length(out, literal_count - 15);
+    }
+    size_t at = out.size();
+    out.resize(at + literal_count);
+    if (literal_count > 0) {
+        std::memcpy(out.data() + at, literals, literal_count);
+    }
+}
+
+inline size_t read_length(std::span<const std::byte> in, size_t& ip, size_t length) {
+    uint8_t b;
+    do {
+        if (ip >= in.size()) {
+            throw std::runtime_error("Compressed value is truncated");
+        }
+        b = static_cast<uint8_t>(in[ip++]);
+        length += b;
+    } while (b == 255);
+    return length;
+}
+
+// Bytes equal at a and b, up to limit
+inline size_t match_length(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t length = 0;
+    while (length + 8 <= limit) {
+        uint64_t diff = load64(a + length) ^ load64(b + length);
+        if (diff != 0) {
+            return length + static_cast<size_t>(std::countr_zero(diff) / 8);
+        }
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+} // namespace detail
+
+// Greedy single-pass compression with a 4096-entry hash table; the search
+// skips ahead faster the longer it goes without a match, so incompressible
+// input costs little more than a copy
+inline std::vector<std::byte> lz_compress(std::span<const std::byte> in) {
+    const auto* base = reinterpret_cast<const uint8_t*>(in.data());
+    const size_t n = in.size();
+    std::vector<std::byte> out;
+    out.reserve(n + n / 255 + 16);
+
+    size_t anchor = 0;
+    if (n >= min_match + last_literals) {
+        std::array<uint32_t, size_t{1} << hash_bits> table{};
+        const size_t limit = n - last_literals - min_match;
+        size_t pos = 1;
+        size_t misses = 0;
+        while (pos <= limit) {
+            uint32_t sequence = detail::load32(base + pos);
+            size_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(pos);
+            if (candidate >= pos || pos - candidate > max_offset || detail::load32(base + candidate) != sequence) {
+                pos += 1 + (misses++ >> 6);
+                continue;
+            }
+            while (pos > anchor && candidate > 0 && base[pos - 1] == base[candidate - 1]) {
+                --pos;
+                --candidate;
+            }
+            size_t length = min_match + detail::match_length(base + pos + min_match, base + candidate + min_match,
+                                                             n - last_literals - pos - min_match);
+            detail::put_sequence(out, base + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+            misses = 0;
+        }
+    }
+    detail::put_last_literals(out, base + anchor, n - anchor);
+    return out;
+}
+
+// Fills out, whose size must be the original size, and throws
+// std::runtime_error on input that does not decode to exactly that many
+// bytes
+inline void lz_decompress(std::span<const std::byte> in, std::span<std::byte> out) {
+    auto* dst = reinterpret_cast<uint8_t*>(out.data());
+    size_t ip = 0;
+    size_t op = 0;
+    while (true) {
+        if (ip >= in.size()) {
+            throw std::runtime_error("Compressed value is truncated");
+        }
+        auto token = static_cast<uint8_t>(in[ip++]);
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals = detail::read_length(in, ip, literals);
+        }
+        if (literals > in.size() - ip || literals > out.size() - op) {
+            throw std::runtime_error("Compressed value overruns its buffer");
+        }
+        // Short copies go 16 bytes at a time where both buffers have room
+        // past them; later writes overwrite the excess
+        if (literals <= 16 && in.size() - ip >= 16 && out.size() - op >= 16) {
+            std::memcpy(dst + op, in.data() + ip, 16);
+        } else if (literals > 0) {
+            std::memcpy(dst + op, in.data() + ip, literals);
+        }
+        ip += literals;
+        op += literals;
+        if (ip == in.size()) {
+            break;
+        }
+
+        if (in.size() - ip < 2) {
+            throw std::runtime_error("Compressed value is truncated");
+        }
+        size_t offset = static_cast<size_t>(in[ip]) | (static_cast<size_t>(in[ip + 1]) << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15) {
+            length = detail::read_length(in, ip, length);
+        }
+        length += min_match;
+        if (offset == 0 || offset > op || length > out.size() - op) {
+            throw std::runtime_error("Compressed value overruns its buffer");
+        }
+        const uint8_t* src = dst + op - offset;
+        if (offset >= 16 && length <= 32 && out.size() - op >= 32) {
+            std::memcpy(dst + op, src, 16);
+            std::memcpy(dst + op + 16, src + 16, 16);
+            op += length;
+            continue;
+        }
+        // An overlapping match repeats the last offset bytes; each copy
+        // doubles the span it can copy from
+        size_t copied = 0;
+        while (copied < length) {
+            size_t chunk = std::min(length - copied, static_cast<size_t>(dst + op + copied - src));
+            std::memcpy(dst + op + copied, src, chunk);
+            copied += chunk;
+        }
+        op += length;
+    }
+    if (op != out.size()) {
+        throw std::runtime_error("Compressed value has the wrong size");
+    }
+}
+
+// Floating-point buffers: each element XORed with the one before, which
+// for slowly varying data zeroes the sign, exponent and high mantissa
+// bits, then split into byte planes (every element's byte 0, then every
+// byte 1, ...) so those zeros form long runs for lz_compress. Planes are
+// split per block of float_block elements, which keeps the planes being
+// read or written in L1 instead of a whole value's size apart.
+inline constexpr size_t float_block = 1024;
+
+template<PackableElement E>
+std::vector<std::byte> compress_floats(std::span<const E> values) {
+    using bits_type = std::conditional_t<sizeof(E) == 4, uint32_t, uint64_t>;
+    thread_local std::vector<std::byte> planes;
+    planes.resize(values.size_bytes());
+    auto* plane = reinterpret_cast<uint8_t*>(planes.data());
+    bits_type previous = 0;
+    for (size_t begin = 0; begin < values.size(); begin += float_block) {
+        const size_t n = std::min(float_block, values.size() - begin);
+        for (size_t i = 0; i < n; ++i) {
+            auto bits = std::bit_cast<bits_type>(values[begin + i]);
+            bits_type x = bits ^ previous;
+            previous = bits;
+            for (size_t b = 0; b < sizeof(E); ++b) {
+                plane[b * n + i] = static_cast<uint8_t>(x >> (8 * b));
+            }
+        }
+        plane += n * sizeof(E);
+    }
+    return lz_compress(planes);
+}
+
+namespace detail {
+
+// Joins the byte planes of n elements back into elements and undoes the
+// XOR, carrying the last element in previous
+template<PackableElement E, typename Bits>
+void join_planes(const uint8_t* plane, size_t n, E* out, Bits& previous) {
+    size_t i = 0;
+#if defined(FLOWGRAPH_X86_SIMD) && defined(__SSE2__)
+    // 16 elements at a time: interleave bytes, then pairs, then quads
+    // (for doubles) of the planes, then a prefix XOR within each vector
+    __m128i carry = _mm_set1_epi64x(static_cast<int64_t>(previous));
+    for (; i + 16 <= n; i += 16) {
+        __m128i r[sizeof(E)];
+        for (size_t b = 0; b < sizeof(E); ++b) {
+            r[b] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + b * n + i));
+        }
+        __m128i v[sizeof(E)];
+        if constexpr (sizeof(E) == 4) {
+            __m128i lo01 = _mm_unpacklo_epi8(r[0], r[1]), hi01 = _mm_unpackhi_epi8(r[0], r[1]);
+            __m128i lo23 = _mm_unpacklo_epi8(r[2], r[3]), hi23 = _mm_unpackhi_epi8(r[2], r[3]);
+            v[0] = _mm_unpacklo_epi16(lo01, lo23);
+            v[1] = _mm_unpackhi_epi16(lo01, lo23);
+            v[2] = _mm_unpacklo_epi16(hi01, hi23);
+            v[3] = _mm_unpackhi_epi16(hi01, hi23);
+            carry = _mm_shuffle_epi32(carry, 0x00);
+            for (auto& x : v) {
+                x = _mm_xor_si128(x, _mm_slli_si128(x, 4));
+                x = _mm_xor_si128(x, _mm_slli_si128(x, 8));
+                x = _mm_xor_si128(x, carry);
+                carry = _mm_shuffle_epi32(x, 0xff);
+            }
+        } else {
+            __m128i p[8];
+            for (size_t b = 0; b < 8; b += 2) {
+                p[b] = _mm_unpacklo_epi8(r[b], r[b + 1]);
+                p[b + 1] = _mm_unpackhi_epi8(r[b], r[b + 1]);
+            }
+            __m128i q[8];
+            for (size_t h = 0; h < 2; ++h) {
+                // Bytes 0-3 from planes 0-3, bytes 4-7 from planes 4-7
+                q[4 * h + 0] = _mm_unpacklo_epi16(p[4 * h], p[4 * h + 2]);
+                q[4 * h + 1] = _mm_unpackhi_epi16(p[4 * h], p[4 * h + 2]);
+                q[4 * h + 2] = _mm_unpacklo_epi16(p[4 * h + 1], p[4 * h + 3]);
+                q[4 * h + 3] = _mm_unpackhi_epi16(p[4 * h + 1], p[4 * h + 3]);
+            }
+            for (size_t k = 0; k < 4; ++k) {
+                v[2 * k] = _mm_unpacklo_epi32(q[k], q[4 + k]);
+                v[2 * k + 1] = _mm_unpackhi_epi32(q[k], q[4 + k]);
+            }
+            for (auto& x : v) {
+                x = _mm_xor_si128(x, _mm_slli_si128(x, 8));
+                x = _mm_xor_si128(x, carry);
+                carry = _mm_unpackhi_epi64(x, x);
+            }
+        }
+        for (size_t k = 0; k < sizeof(E); ++k) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + k * (16 / sizeof(E))), v[k]);
+        }
+    }
+    if (i > 0) {
+        std::memcpy(&previous, out + i - 1, sizeof(E));
+    }
+#endif
+    for (; i < n; ++i) {
+        Bits x = 0;
+        for (size_t b = 0; b < sizeof(E); ++b) {
+            x |= static_cast<Bits>(plane[b * n + i]) << (8 * b);
+        }
+        previous ^= x;
+        out[i] = std::bit_cast<E>(previous);
+    }
+}
+
+} // namespace detail
+
+template<PackableElement E>
+void decompress_floats(std::span<const std::byte> in, std::span<E> out) {
+    using bits_type = std::conditional_t<sizeof(E) == 4, uint32_t, uint64_t>;
+    thread_local std::vector<std::byte> planes;
+    planes.resize(out.size_bytes());
+    lz_decompress(in, planes);
+    const auto* plane = reinterpret_cast<const uint8_t*>(planes.data());
+    bits_type previous = 0;
+    for (size_t begin = 0; begin < out.size(); begin += float_block) {
+        const size_t n = std::min(float_block, out.size() - begin);
+        detail::join_planes(plane, n, out.data() + begin, previous);
+        plane += n * sizeof(E);
+    }
+}
+
+} // namespace compression
+
+template<typename T>
+concept CompressibleValue = PackableNumeric<T> || EncodableValue<T>;
+
+// A value held compressed: numeric containers of float or double with
+// the float codec, anything else with a ValueCodec as LZ-compressed bytes
+template<CompressibleValue T>
+class CompressedValue {
+public:
+    // nullopt for values under min_bytes or that do not shrink
+    static std::optional<CompressedValue> compress(const T& value, size_t min_bytes = 64) {
+        CompressedValue compressed;
+        if constexpr (PackableNumeric<T>) {
+            auto elements = std::span(std::ranges::data(value), std::ranges::size(value));
+            compressed.codec_ = CompressionCodec::Floats;
+            compressed.original_bytes_ = elements.size_bytes();
+            if (compressed.original_bytes_ < min_bytes) {
+                return std::nullopt;
+            }
+            compressed.data_ = compression::compress_floats(std::span<const std::ranges::range_value_t<T>>(elements));
+        } else {
+            compressed.codec_ = CompressionCodec::Bytes;
+            compressed.original_bytes_ = ValueCodec<T>::size(value);
+            if (compressed.original_bytes_ < min_bytes) {
+                return std::nullopt;
+            }
+            thread_local std::vector<std::byte> encoded;
+            encoded.resize(compressed.original_bytes_);
+            ValueCodec<T>::encode(value, encoded.data());
+            compressed.data_ = compression::lz_compress(encoded);
+        }
+        if (compressed.data_.size() >= compressed.original_bytes_) {
+            return std::nullopt;
+        }
+        compressed.data_.shrink_to_fit();
+        return compressed;
+    }
+
+    // Compressed where that shrinks the value, held Raw otherwise
+    static CompressedValue encode(const T& value) {
+        if (auto compressed = compress(value, 0)) {
+            return std::move(*compressed);
+        }
+        CompressedValue raw;
+        raw.codec_ = CompressionCodec::Raw;
+        if constexpr (PackableNumeric<T>) {
+            auto elements = std::as_bytes(std::span(std::ranges::data(value), std::ranges::size(value)));
+            raw.data_.assign(elements.begin(), elements.end());
+        } else {
+            raw.data_.resize(ValueCodec<T>::size(value));
+            ValueCodec<T>::encode(value, raw.data_.data());
+        }
+        raw.original_bytes_ = raw.data_.size();
+        return raw;
+    }
+
+    // From the codec, original size and data() of a value, read back from
+    // wherever they were kept. Corrupt data makes decompress() throw.
+    static CompressedValue restore(CompressionCodec codec, size_t original_bytes, std::vector<std::byte> data) {
+        CompressedValue restored;
+        restored.codec_ = codec;
+        restored.original_bytes_ = original_bytes;
+        restored.data_ = std::move(data);
+        return restored;
+    }
+
+    T decompress() const {
+        if (codec_ == CompressionCodec::Raw) {
+            if (data_.size() != original_bytes_) {
+                throw std::runtime_error("Compressed value has the wrong size");
+            }
+            if constexpr (PackableNumeric<T>) {
+                using element_type = std::ranges::range_value_t<T>;
+                T value;
+                value.resize(original_bytes_ / sizeof(element_type));
+                if (!data_.empty()) {
+                    std::memcpy(std::ranges::data(value), data_.data(), data_.size());
+                }
+                return value;
+            } else {
+                return ValueCodec<T>::decode(data_);
+            }
+        }
+        if constexpr (PackableNumeric<T>) {
+            using element_type = std::ranges::range_value_t<T>;
+            T value;
+            value.resize(original_bytes_ / sizeof(element_type));
+            compression::decompress_floats(std::span<const std::byte>(data_),
+                                           std::span(std::ranges::data(value), std::ranges::size(value)));
+            return value;
+        } else {
+            thread_local std::vector<std::byte> encoded;
+            encoded.resize(original_bytes_);
+            compression::lz_decompress(data_, encoded);
+            return ValueCodec<T>::decode(encoded);
+        }
+    }
+
+    CompressionCodec codec() const { return codec_; }
+    std::span<const std::byte> data() const { return data_; }
+    size_t bytes() const { return data_.size(); }
+    size_t original_bytes() const { return original_bytes_; }
+
+private:
+    CompressedValue() = default;
+
+    CompressionCodec codec_ = CompressionCodec::Bytes;
+    size_t original_bytes_ = 0;
+    std::vector<std::byte> data_;
+};
+
+// CompressedValue<T> where T can be compressed, for members that exist
+// only then
+template<typename T>
+struct cold_value {
+    using type = std::monostate;
+};
+
+template<CompressibleValue T>
+struct cold_value<T> {
+    using type = CompressedValue<T>;
+};
+
+template<typename T>
+using cold_value_t = typename cold_value<T>::type;
+
+// Snapshot of cold-value compression
+struct CompressionMetrics {
+    uint64_t values_compressed = 0;
+    uint64_t bytes_before = 0;
+    uint64_t bytes_after = 0;
+    uint64_t decompressions = 0;
+    std::chrono::nanoseconds total_decompression_time{0};
+    std::chrono::nanoseconds max_decompression_time{0};
+
+    // Uncompressed over compressed bytes of every value compressed so far
+    double ratio() const {
+        return bytes_after ? static_cast<double>(bytes_before) / static_cast<double>(bytes_after) : 0.0;
+    }
+
+    std::chrono::nanoseconds mean_decompression_time() const {
+        return decompressions ? total_decompression_time / static_cast<int64_t>(decompressions)
+                              : std::chrono::nanoseconds{0};
+    }
+};
+
+// Counters shared by the caches and trees of one graph
+class CompressionStats {
+public:
+    void record_compression(size_t before, size_t after) {
+        values_compressed_.fetch_add(1, std::memory_order_relaxed);
+        bytes_before_.fetch_add(before, std::memory_order_relaxed);
+        bytes_after_.fetch_add(after, std::memory_order_relaxed);
+    }
+
+    void record_decompression(std::chrono::nanoseconds elapsed) {
+        decompressions_.fetch_add(1, std::memory_order_relaxed);
+        decompression_ns_.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+        auto ns = static_cast<uint64_t>(elapsed.count());
+        auto max = max_decompression_ns_.load(std::memory_order_relaxed);
+        while (ns > max && !max_decompression_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    CompressionMetrics snapshot() const {
+        CompressionMetrics metrics;
+        metrics.values_compressed = values_compressed_.load(std::memory_order_relaxed);
+        metrics.bytes_before = bytes_before_.load(std::memory_order_relaxed);
+        metrics.bytes_after = bytes_after_.load(std::memory_order_relaxed);
+        metrics.decompressions = decompressions_.load(std::memory_order_relaxed);
+        metrics.total_decompression_time =
+            std::chrono::nanoseconds(static_cast<int64_t>(decompression_ns_.load(std::memory_order_relaxed)));
+        metrics.max_decompression_time =
+            std::chrono::nanoseconds(static_cast<int64_t>(max_decompression_ns_.load(std::memory_order_relaxed)));
+        return metrics;
+    }
+
+private:
+    std::atomic<uint64_t> values_compressed_{0};
+    std::atomic<uint64_t> bytes_before_{0};
+    std::atomic<uint64_t> bytes_after_{0};
+    std::atomic<uint64_t> decompressions_{0};
+    std::atomic<uint64_t> decompression_ns_{0};
+    std::atomic<uint64_t> max_decompression_ns_{0};
+};
+
+// Cold tier of GraphCache and FractalTreeNode: a value not read for
+// idle_runs runs (end_run() calls) is compressed in place and
+// decompressed when next read. idle_runs = 0 turns the tier off.
+struct ColdCompressionOptions {
+    size_t idle_runs = 0;
+    size_t min_bytes = 256;
+    std::shared_ptr<CompressionStats> stats;
+};
+
+// Times one decompression into the options' stats, if any
+template<typename F>
+auto timed_decompression(const ColdCompressionOptions& options, F&& decompress) {
+    auto start = std::chrono::steady_clock::now();
+    auto value = decompress();
+    if (options.stats) {
+        options.stats->record_decompression(std::chrono::steady_clock::now() - start);
+    }
+    return value;
+}
+
+} // namespace flowgraph
@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../core/node.hpp"
+#include "../core/compute_result.hpp"
+#include "../core/error_state.hpp"
+
+namespace flowgraph {
+
+// Scalar value types the compiled engines support
+template<typename T>
+concept ScalarValue = std::same_as<T, float> || std::same_as<T, double>;
+
+enum class ArithmeticOp : uint8_t {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Min,
+    Max,
+    Negate,
+    Abs,
+    Sqrt
+};
+
+inline size_t arity(ArithmeticOp op) {
+    switch (op) {
+        case ArithmeticOp::Negate:
+        case ArithmeticOp::Abs:
+        case ArithmeticOp::Sqrt:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+inline const char* to_string(ArithmeticOp op) {
+    switch (op) {
+        case ArithmeticOp::Add: return "add";
+        case ArithmeticOp::Subtract: return "subtract";
+        case ArithmeticOp::Multiply: return "multiply";
+        case ArithmeticOp::Divide: return "divide";
+        case ArithmeticOp::Min: return "min";
+        case ArithmeticOp::Max: return "max";
+        case ArithmeticOp::Negate: return "negate";
+        case ArithmeticOp::Abs: return "abs";
+        case ArithmeticOp::Sqrt: return "sqrt";
+    }
+    return "unknown";
+}
+
+// The operation's result; b is ignored by unary operations. The compiled
+// forms of arithmetic graphs compute exactly this.
+template<ScalarValue T>
+T apply(ArithmeticOp op, T a, T b) {
+    switch (op) {
+        case ArithmeticOp::Add: return a + b;
+        case ArithmeticOp::Subtract: return a - b;
+        case ArithmeticOp::Multiply: return a * b;
+        case ArithmeticOp::Divide: return a / b;
+        case ArithmeticOp::Min: return std::min(a, b);
+        case ArithmeticOp::Max: return std::max(a, b);
+        case ArithmeticOp::Negate: return -a;
+        case ArithmeticOp::Abs: return std::abs(a);
+        case ArithmeticOp::Sqrt: return std::sqrt(a);
+    }
+    return a;
+}
+
+// Why the operation fails on these operands, or nullptr if it does not
+template<ScalarValue T>
+const char* failure(ArithmeticOp op, T a, T b) {
+    if (op == ArithmeticOp::Divide && b == T{0}) {
+        return "Division by zero";
+    }
+    if (op == ArithmeticOp::Sqrt && a < T{0}) {
+        return "Square root of a negative value";
+    }
+    return nullptr;
+}
+
+// Graph input: its value here, and its position in the input record of
+// compiled forms of the graph
+template<ScalarValue T>
+class ScalarInputNode : public Node<T> {
+public:
+    ScalarInputNode(std::string name, size_t slot, T value = T{})
+        : Node<T>(std::move(name))
+        , slot_(slot)
+        , value_(value) {}
+
+    size_t slot() const { return slot_; }
+    T value() const { return value_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        co_return ComputeResult<T>(value_);
+    }
+
+private:
+    size_t slot_;
+    T value_;
+};
+
+template<ScalarValue T>
+class ScalarConstantNode : public Node<T> {
+public:
+    ScalarConstantNode(std::string name, T value)
+        : Node<T>(std::move(name))
+        , value_(value) {}
+
+    T value() const { return value_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        co_return ComputeResult<T>(value_);
+    }
+
+private:
+    T value_;
+};
+
+// Arithmetic on the values of operand nodes, which must be in the same
+// graph and ordered before this node by edges. An operand's error is
+// propagated; division by zero and square roots of negative values fail
+// with a computation error.
+template<ScalarValue T>
+class ScalarOpNode : public Node<T> {
+public:
+    ScalarOpNode(std::string name, ArithmeticOp op, std::vector<std::shared_ptr<Node<T>>> operands)
+        : Node<T>(std::move(name))
+        , op_(op)
+        , operands_(std::move(operands)) {
+        if (operands_.size() != arity(op_)) {
+            throw std::invalid_argument(std::string("Operation ") + to_string(op_) + " takes " +
+                                        std::to_string(arity(op_)) + " operands");
+        }
+        for (const auto& operand : operands_) {
+            if (!operand) {
+                throw std::invalid_argument("Null operand");
+            }
+        }
+    }
+
+    ArithmeticOp op() const { return op_; }
+    const std::vector<std::shared_ptr<Node<T>>>& operands() const { return operands_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t precision_level) override {
+        T values[2] = {T{}, T{}};
+        for (size_t i = 0; i < operands_.size(); ++i) {
+            auto result = co_await operands_[i]->compute(precision_level);
+            if (result.has_error()) {
+                co_return result;
+            }
+            values[i] = result.value();
+        }
+        if (const char* message = failure(op_, values[0], values[1])) {
+            auto error = ErrorState::computation_error(message);
+            error.set_source_node(this->name());
+            co_return ComputeResult<T>(std::move(error));
+        }
+        co_return ComputeResult<T>(apply(op_, values[0], values[1]));
+    }
+
+private:
+    ArithmeticOp op_;
+    std::vector<std::shared_ptr<Node<T>>> operands_;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,336 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "arithmetic_nodes.hpp"
+#include "../core/graph.hpp"
+#include "../async/parallel_for.hpp"
+#include "../async/thread_pool.hpp"
+
+namespace flowgraph {
+
+// Graph of arithmetic nodes compiled to register-based bytecode. Registers
+// hold the input record, then the constants, then temporaries, which are
+// reused once their value is dead, so the register file stays small for
+// large graphs. Evaluating it is a loop over the instructions, with none
+// of the per-node virtual calls, coroutines and reference counting of
+// executing the graph. Operations are the nodes' own, apply() and
+// failure(); run() returns false where execution would report an error at
+// some output.
+template<ScalarValue T>
+class BytecodeProgram {
+public:
+    struct Instruction {
+        ArithmeticOp op;
+        uint32_t dst;
+        uint32_t a;
+        uint32_t b;  // equal to a for unary operations
+    };
+
+    // Records evaluated together by run_batch: each instruction processes
+    // this many lanes in a loop the compiler vectorizes for the target
+    static constexpr size_t lanes = 16;
+
+    // Compile the graph's nodes, which must all be arithmetic nodes.
+    // Outputs are the named nodes, in order; by default every node no
+    // other node reads, by name.
+    static BytecodeProgram compile(const Graph<T>& graph, const std::vector<std::string>& outputs = {}) {
+        struct Entry {
+            const Node<T>* node;
+            const ScalarOpNode<T>* op = nullptr;
+            int state = 0;  // 0 unvisited, 1 on the stack, 2 ordered
+            uint32_t reg = 0;
+            size_t last_use = 0;
+        };
+        std::unordered_map<const Node<T>*, Entry> entries;
+        std::unordered_map<std::string, const Node<T>*> by_name;
+        BytecodeProgram program;
+        for (const auto& node : graph.get_nodes()) {
+            Entry entry{node.get()};
+            if (auto* input = dynamic_cast<const ScalarInputNode<T>*>(node.get())) {
+                if (input->slot() >= std::numeric_limits<uint32_t>::max()) {
+                    throw std::invalid_argument("Input slot of " + node->name() + " is out of range");
+                }
+                program.input_count_ = std::max(program.input_count_, input->slot() + 1);
+            } else if (!dynamic_cast<const ScalarConstantNode<T>*>(node.get())) {
+                entry.op = dynamic_cast<const ScalarOpNode<T>*>(node.get());
+                if (!entry.op) {
+                    throw std::invalid_argument("Node " + node->name() + " is not an arithmetic node");
+                }
+            }
+            entries.emplace(node.get(), entry);
+            by_name.emplace(node->name(), node.get());
+        }
+        if (entries.empty()) {
+            throw std::invalid_argument("Cannot compile an empty graph");
+        }
+
+        std::vector<const Node<T>*> output_nodes;
+        if (outputs.empty()) {
+            std::unordered_map<const Node<T>*, bool> read;
+            for (const auto& [node, entry] : entries) {
+                if (entry.op) {
+                    for (const auto& operand : entry.op->operands()) {
+                        read[operand.get()] = true;
+                    }
+                }
+            }
+            for (const auto& [node, entry] : entries) {
+                if (!read.count(node)) {
+                    output_nodes.push_back(node);
+                }
+            }
+            std::sort(output_nodes.begin(), output_nodes.end(),
+                      [](const Node<T>* a, const Node<T>* b) { return a->name() < b->name(); });
+        } else {
+            for (const auto& name : outputs) {
+                auto it = by_name.find(name);
+                if (it == by_name.end()) {
+                    throw std::invalid_argument("Output node " + name + " is not in the graph");
+                }
+                output_nodes.push_back(it->second);
+            }
+        }
+
+        // Operands before their readers, visiting only what the outputs need
+        std::vector<Entry*> order;
+        std::vector<std::pair<Entry*, size_t>> stack;
+        for (const Node<T>* output : output_nodes) {
+            Entry* root = &entries.at(output);
+            if (root->state == 2) {
+                continue;
+            }
+            root->state = 1;
+            stack.emplace_back(root, 0);
+            while (!stack.empty()) {
+                auto& [entry, next] = stack.back();
+                size_t operand_count = entry->op ? entry->op->operands().size() : 0;
+                if (next == operand_count) {
+                    entry->state = 2;
+                    order.push_back(entry);
+                    stack.pop_back();
+                    continue;
+                }
+                const Node<T>* operand = entry->op->operands()[next++].get();
+                auto it = entries.find(operand);
+                if (it == entries.end()) {
+                    throw std::invalid_argument("Operand " + operand->name() + " of " + entry->node->name() +
+                                                " is not in the graph");
+                }
+                if (it->second.state == 1) {
+                    throw std::invalid_argument("Operands of " + operand->name() + " form a cycle");
+                }
+                if (it->second.state == 0) {
+                    it->second.state = 1;
+                    stack.emplace_back(&it->second, 0);
+                }
+            }
+        }
+
+        // Fixed registers for inputs and constants
+        std::vector<std::string> slots(program.input_count_);
+        uint32_t next_register = static_cast<uint32_t>(program.input_count_);
+        for (Entry* entry : order) {
+            if (auto* input = dynamic_cast<const ScalarInputNode<T>*>(entry->node)) {
+                if (!slots[input->slot()].empty()) {
+                    throw std::invalid_argument("Inputs " + slots[input->slot()] + " and " + entry->node->name() +
+                                                " share slot " + std::to_string(input->slot()));
+                }
+                slots[input->slot()] = entry->node->name();
+                entry->reg = static_cast<uint32_t>(input->slot());
+            } else if (auto* constant = dynamic_cast<const ScalarConstantNode<T>*>(entry->node)) {
+                entry->reg = next_register++;
+                program.constants_.push_back(constant->value());
+            }
+        }
+
+        // Temporaries are freed after their last reader; outputs never are
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (order[i]->op) {
+                for (const auto& operand : order[i]->op->operands()) {
+                    entries.at(operand.get()).last_use = i;
+                }
+            }
+        }
+        for (const Node<T>* output : output_nodes) {
+            entries.at(output).last_use = order.size();
+        }
+        const uint32_t first_temporary = next_register;
+        std::vector<uint32_t> free_registers;
+        for (size_t i = 0; i < order.size(); ++i) {
+            Entry* entry = order[i];
+            if (!entry->op) {
+                continue;
+            }
+            const auto& operands = entry->op->operands();
+            uint32_t a = entries.at(operands[0].get()).reg;
+            uint32_t b = operands.size() > 1 ? entries.at(operands[1].get()).reg : a;
+            // The result never shares a register with an operand, so lane
+            // kernels can treat their rows as unaliased
+            if (free_registers.empty()) {
+                entry->reg = next_register++;
+            } else {
+                entry->reg = free_registers.back();
+                free_registers.pop_back();
+            }
+            for (const auto& operand : operands) {
+                Entry& source = entries.at(operand.get());
+                if (source.op && source.last_use == i && source.reg >= first_temporary &&
+                    std::find(free_registers.begin(), free_registers.end(), source.reg) == free_registers.end()) {
+                    free_registers.push_back(source.reg);
+                }
+            }
+            program.code_.push_back({entry->op->op(), entry->reg, a, b});
+        }
+        program.register_count_ = next_register;
+        for (const Node<T>* output : output_nodes) {
+            program.outputs_.push_back(entries.at(output).reg);
+            program.output_names_.push_back(output->name());
+        }
+        return program;
+    }
+
+    size_t input_count() const { return input_count_; }
+    size_t output_count() const { return outputs_.size(); }
+    size_t register_count() const { return register_count_; }
+    const std::vector<Instruction>& code() const { return code_; }
+    // Values of the registers after the inputs
+    const std::vector<T>& constants() const { return constants_; }
+    const std::vector<uint32_t>& output_registers() const { return outputs_; }
+    const std::vector<std::string>& output_names() const { return output_names_; }
+
+    // One input record to one output record; false if an operation failed,
+    // in which case the outputs are unspecified
+    bool run(const T* in, T* out) const {
+        thread_local std::vector<T> scratch;
+        scratch.resize(std::max(scratch.size(), register_count_));
+        T* r = scratch.data();
+        std::copy_n(in, input_count_, r);
+        std::copy(constants_.begin(), constants_.end(), r + input_count_);
+        bool failed = false;
+        for (const Instruction& ins : code_) {
+            T a = r[ins.a];
+            T b = r[ins.b];
+            switch (ins.op) {
+                case ArithmeticOp::Add: r[ins.dst] = a + b; break;
+                case ArithmeticOp::Subtract: r[ins.dst] = a - b; break;
+                case ArithmeticOp::Multiply: r[ins.dst] = a * b; break;
+                case ArithmeticOp::Divide:
+                    failed |= b == T{0};
+                    r[ins.dst] = a / b;
+                    break;
+                case ArithmeticOp::Min: r[ins.dst] = std::min(a, b); break;
+                case ArithmeticOp::Max: r[ins.dst] = std::max(a, b); break;
+                case ArithmeticOp::Negate: r[ins.dst] = -a; break;
+                case ArithmeticOp::Abs: r[ins.dst] = std::abs(a); break;
+                case ArithmeticOp::Sqrt:
+                    failed |= a < T{0};
+                    r[ins.dst] = std::sqrt(a);
+                    break;
+            }
+        }
+        for (size_t i = 0; i < outputs_.size(); ++i) {
+            out[i] = r[outputs_[i]];
+        }
+        return !failed;
+    }
+
+    // count records stored back to back, `lanes` at a time: registers
+    // become rows of lanes, and each instruction runs across a row
+    void run_batch(const T* in, T* out, bool* ok, size_t count) const {
+        thread_local std::vector<T> scratch;
+        scratch.resize(std::max(scratch.size(), register_count_ * lanes));
+        T* r = scratch.data();
+        for (size_t c = 0; c < constants_.size(); ++c) {
+            std::fill_n(r + (input_count_ + c) * lanes, lanes, constants_[c]);
+        }
+        for (size_t base = 0; base < count; base += lanes) {
+            const size_t n = std::min(lanes, count - base);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                // Padding lanes repeat the last record
+                const T* record = in + (base + std::min(lane, n - 1)) * input_count_;
+                for (size_t s = 0; s < input_count_; ++s) {
+                    r[s * lanes + lane] = record[s];
+                }
+            }
+            lane_flag failed[lanes] = {};
+            for (const Instruction& ins : code_) {
+                run_lanes(ins, r, failed);
+            }
+            for (size_t lane = 0; lane < n; ++lane) {
+                T* record = out + (base + lane) * outputs_.size();
+                for (size_t i = 0; i < outputs_.size(); ++i) {
+                    record[i] = r[outputs_[i] * lanes + lane];
+                }
+                ok[base + lane] = !failed[lane];
+            }
+        }
+    }
+
+    // run_batch() split across the pool in whole blocks of lanes
+    void run_batch(ThreadPool& pool, const T* in, T* out, bool* ok, size_t count,
+                   size_t min_chunk = 1024) const {
+        const size_t blocks = (count + lanes - 1) / lanes;
+        parallel_for(pool, blocks, std::max<size_t>(min_chunk / lanes, 1), [&](size_t begin, size_t end) {
+            size_t first = begin * lanes;
+            size_t last = std::min(end * lanes, count);
+            run_batch(in + first * input_count_, out + first * outputs_.size(), ok + first, last - first);
+        });
+    }
+
+private:
+    // Lane failure flags as wide as the values, so their loops vectorize
+    // alongside the values'
+    using lane_flag = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+
+    template<ArithmeticOp Op>
+    static void lanes_of(T* __restrict dst, const T* a, const T* b, lane_flag* __restrict failed) {
+        // The conditions of failure(), written out so the loops vectorize
+        if constexpr (Op == ArithmeticOp::Divide) {
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                failed[lane] |= b[lane] == T{0};
+            }
+        } else if constexpr (Op == ArithmeticOp::Sqrt) {
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                failed[lane] |= a[lane] < T{0};
+            }
+        }
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            dst[lane] = apply(Op, a[lane], b[lane]);
+        }
+    }
+
+    static void run_lanes(const Instruction& ins, T* r, lane_flag* failed) {
+        T* dst = r + ins.dst * lanes;
+        const T* a = r + ins.a * lanes;
+        const T* b = r + ins.b * lanes;
+        switch (ins.op) {
+            case ArithmeticOp::Add: lanes_of<ArithmeticOp::Add>(dst, a, b, failed); break;
+            case ArithmeticOp::Subtract: lanes_of<ArithmeticOp::Subtract>(dst, a, b, failed); break;
+            case ArithmeticOp::Multiply: lanes_of<ArithmeticOp::Multiply>(dst, a, b, failed); break;
+            case ArithmeticOp::Divide: lanes_of<ArithmeticOp::Divide>(dst, a, b, failed); break;
+            case ArithmeticOp::Min: lanes_of<ArithmeticOp::Min>(dst, a, b, failed); break;
+            case ArithmeticOp::Max: lanes_of<ArithmeticOp::Max>(dst, a, b, failed); break;
+            case ArithmeticOp::Negate: lanes_of<ArithmeticOp::Negate>(dst, a, b, failed); break;
+            case ArithmeticOp::Abs: lanes_of<ArithmeticOp::Abs>(dst, a, b, failed); break;
+            case ArithmeticOp::Sqrt: lanes_of<ArithmeticOp::Sqrt>(dst, a, b, failed); break;
+        }
+    }
+
+    size_t input_count_ = 0;
+    size_t register_count_ = 0;
+    std::vector<T> constants_;
+    std::vector<Instruction> code_;
+    std::vector<uint32_t> outputs_;
+    std::vector<std::string> output_names_;
+};
+
+} // namespace flowgraph
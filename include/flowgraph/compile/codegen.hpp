@@ -0,0 +1,436 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "arithmetic_nodes.hpp"
+#include "../core/graph.hpp"
+
+namespace flowgraph {
+
+// How one node is written in generated code. Expressions refer to the
+// operands' values as $0, $1, ...; an input node instead names the slot
+// of the input record it reads.
+template<ScalarValue T>
+struct CodegenTerm {
+    std::vector<std::shared_ptr<Node<T>>> operands;
+    std::string expression;
+    // Condition under which the node fails, in the same notation; empty if
+    // it never does
+    std::string failure;
+    std::optional<size_t> input_slot;
+};
+
+template<ScalarValue T>
+const char* codegen_type_name() {
+    return std::same_as<T, float> ? "float" : "double";
+}
+
+// Exact C++ literal for a value (hexadecimal floating point)
+template<ScalarValue T>
+std::string codegen_literal(T value) {
+    std::string type = codegen_type_name<T>();
+    if (std::isnan(value)) {
+        return "std::numeric_limits<" + type + ">::quiet_NaN()";
+    }
+    if (std::isinf(value)) {
+        return std::string(value < 0 ? "-" : "") + "std::numeric_limits<" + type + ">::infinity()";
+    }
+    char buffer[64];
+    auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::hex);
+    std::string digits(buffer, end);
+    bool negative = digits.front() == '-';
+    std::string literal = (negative ? "-0x" + digits.substr(1) : "0x" + digits) +
+                          (std::same_as<T, float> ? "f" : "");
+    return negative ? "(" + literal + ")" : literal;
+}
+
+// Node kinds generated code can be written for, keyed by dynamic type.
+// The arithmetic node kinds are registered from the start.
+template<ScalarValue T>
+class CodegenRegistry {
+public:
+    using emitter = std::function<CodegenTerm<T>(const Node<T>&)>;
+
+    CodegenRegistry() {
+        register_kind<ScalarInputNode<T>>([](const ScalarInputNode<T>& node) {
+            CodegenTerm<T> term;
+            term.input_slot = node.slot();
+            return term;
+        });
+        register_kind<ScalarConstantNode<T>>([](const ScalarConstantNode<T>& node) {
+            return CodegenTerm<T>{{}, codegen_literal(node.value()), {}, std::nullopt};
+        });
+        register_kind<ScalarOpNode<T>>([](const ScalarOpNode<T>& node) {
+            return CodegenTerm<T>{node.operands(), expression(node.op()), failure_condition(node.op()), std::nullopt};
+        });
+    }
+
+    static CodegenRegistry& instance() {
+        static CodegenRegistry registry;
+        return registry;
+    }
+
+    template<typename N>
+        requires std::derived_from<N, Node<T>>
+    void register_kind(std::function<CodegenTerm<T>(const N&)> emit) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        emitters_[std::type_index(typeid(N))] = [emit = std::move(emit)](const Node<T>& node) {
+            return emit(static_cast<const N&>(node));
+        };
+    }
+
+    // Emitter for the node's kind; empty if the kind is not registered
+    emitter find(const Node<T>& node) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = emitters_.find(std::type_index(typeid(node)));
+        return it != emitters_.end() ? it->second : emitter{};
+    }
+
+private:
+    // Mirrors apply() and failure() in arithmetic_nodes.hpp
+    static std::string expression(ArithmeticOp op) {
+        switch (op) {
+            case ArithmeticOp::Add: return "$0 + $1";
+            case ArithmeticOp::Subtract: return "$0 - $1";
+            case ArithmeticOp::Multiply: return "$0 * $1";
+            case ArithmeticOp::Divide: return "$0 / $1";
+            case ArithmeticOp::Min: return "std::min($0, $1)";
+            case ArithmeticOp::Max: return "std::max($0, $1)";
+            case ArithmeticOp::Negate: return "-$0";
+            case ArithmeticOp::Abs: return "std::abs($0)";
+            case ArithmeticOp::Sqrt: return "std::sqrt($0)";
+        }
+        return "$0";
+    }
+
+    static std::string failure_condition(ArithmeticOp op) {
+        switch (op) {
+            case ArithmeticOp::Divide: return "$1 == 0";
+            case ArithmeticOp::Sqrt: return "$0 < 0";
+            default: return {};
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::type_index, emitter> emitters_;
+};
+
+struct CodegenOptions {
+    // Stem of the generated file names and namespace of the functions
+    std::string name = "generated_graph";
+    std::string namespace_name = "generated";
+    // Names of the nodes written to the output record, in order; by
+    // default every node no other node reads, by name
+    std::vector<std::string> outputs;
+    // Fewest records per chunk evaluate_batch hands to a pool worker
+    size_t min_batch_chunk = 256;
+    // Prefix of the flowgraph headers the generated files include, as
+    // found from flowgraph_core's include directory
+    std::string include_prefix = "include/flowgraph/";
+};
+
+struct GeneratedSource {
+    std::string header_name;
+    std::string header;
+    std::string source_name;
+    std::string source;
+};
+
+namespace codegen {
+
+// Replace $0, $1, ... with the given operand expressions
+inline std::string substitute(const std::string& pattern, const std::vector<std::string>& operands) {
+    std::string out;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '$' || i + 1 == pattern.size() || pattern[i + 1] < '0' || pattern[i + 1] > '9') {
+            out += pattern[i];
+            continue;
+        }
+        size_t index = 0;
+        while (i + 1 < pattern.size() && pattern[i + 1] >= '0' && pattern[i + 1] <= '9') {
+            index = index * 10 + static_cast<size_t>(pattern[++i] - '0');
+        }
+        if (index >= operands.size()) {
+            throw std::invalid_argument("Codegen expression refers to missing operand $" + std::to_string(index));
+        }
+        out += operands[index];
+    }
+    return out;
+}
+
+inline std::string string_literal(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            // Octal escapes stop after three digits, unlike hexadecimal ones
+            char escape[5];
+            std::snprintf(escape, sizeof(escape), "\\%03o", c);
+            out += escape;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+inline std::string comment_text(const std::string& s) {
+    std::string out = s;
+    for (char& c : out) {
+        if (c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return out;
+}
+
+} // namespace codegen
+
+// Write a C++ translation unit (and its header) evaluating the graph as
+// straight-line code over an input record, to be compiled into a binary
+// in place of executing the graph. Every node must be of a registered
+// kind. The generated code declares, in the given namespace:
+//
+//   input_count, output_count, input_names, output_names
+//   bool evaluate(const T* in, T* out) noexcept;
+//   void evaluate_batch(flowgraph::ThreadPool&, const T* in, T* out,
+//                       bool* ok, size_t count);
+//
+// evaluate() returns false if an operation failed, where executing the
+// graph would report an error at some output; the outputs are then
+// unspecified. It touches no shared state, so any number of threads may
+// call it; evaluate_batch() splits records across the pool with
+// parallel_for rather than starting threads of its own.
+template<ScalarValue T>
+GeneratedSource generate_cpp(const Graph<T>& graph, const CodegenOptions& options = {},
+                             const CodegenRegistry<T>& registry = CodegenRegistry<T>::instance()) {
+    struct Entry {
+        const Node<T>* node;
+        CodegenTerm<T> term;
+        std::vector<const Node<T>*> operands;
+        size_t variable = 0;
+        int state = 0;  // 0 unvisited, 1 on the stack, 2 emitted
+    };
+    std::unordered_map<const Node<T>*, Entry> entries;
+    std::unordered_map<std::string, const Node<T>*> by_name;
+    for (const auto& node : graph.get_nodes()) {
+        auto emit = registry.find(*node);
+        if (!emit) {
+            throw std::invalid_argument("Node " + node->name() + " is not of a codegen-capable kind");
+        }
+        Entry entry{node.get(), emit(*node), {}, 0, 0};
+        for (const auto& operand : entry.term.operands) {
+            entry.operands.push_back(operand.get());
+        }
+        entries.emplace(node.get(), std::move(entry));
+        by_name.emplace(node->name(), node.get());
+    }
+    if (entries.empty()) {
+        throw std::invalid_argument("Cannot generate code for an empty graph");
+    }
+
+    std::vector<const Node<T>*> outputs;
+    if (options.outputs.empty()) {
+        std::unordered_map<const Node<T>*, bool> read;
+        for (const auto& [node, entry] : entries) {
+            for (const Node<T>* operand : entry.operands) {
+                read[operand] = true;
+            }
+        }
+        for (const auto& [node, entry] : entries) {
+            if (!read.count(node)) {
+                outputs.push_back(node);
+            }
+        }
+        std::sort(outputs.begin(), outputs.end(),
+                  [](const Node<T>* a, const Node<T>* b) { return a->name() < b->name(); });
+    } else {
+        for (const auto& name : options.outputs) {
+            auto it = by_name.find(name);
+            if (it == by_name.end()) {
+                throw std::invalid_argument("Output node " + name + " is not in the graph");
+            }
+            outputs.push_back(it->second);
+        }
+    }
+
+    // Operands before their readers, visiting only what the outputs need
+    std::vector<Entry*> order;
+    std::vector<std::pair<Entry*, size_t>> stack;
+    for (const Node<T>* output : outputs) {
+        Entry* root = &entries.at(output);
+        if (root->state == 2) {
+            continue;
+        }
+        root->state = 1;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& [entry, next] = stack.back();
+            if (next == entry->operands.size()) {
+                entry->state = 2;
+                entry->variable = order.size();
+                order.push_back(entry);
+                stack.pop_back();
+                continue;
+            }
+            const Node<T>* operand = entry->operands[next++];
+            auto it = entries.find(operand);
+            if (it == entries.end()) {
+                throw std::invalid_argument("Operand " + operand->name() + " of " + entry->node->name() +
+                                            " is not in the graph");
+            }
+            if (it->second.state == 1) {
+                throw std::invalid_argument("Operands of " + operand->name() + " form a cycle");
+            }
+            if (it->second.state == 0) {
+                it->second.state = 1;
+                stack.emplace_back(&it->second, 0);
+            }
+        }
+    }
+
+    std::vector<std::string> input_names;
+    for (const Entry* entry : order) {
+        if (auto slot = entry->term.input_slot) {
+            if (*slot >= input_names.size()) {
+                input_names.resize(*slot + 1);
+            }
+            if (!input_names[*slot].empty()) {
+                throw std::invalid_argument("Inputs " + input_names[*slot] + " and " + entry->node->name() +
+                                            " share slot " + std::to_string(*slot));
+            }
+            input_names[*slot] = entry->node->name();
+        }
+    }
+
+    const std::string type = codegen_type_name<T>();
+    auto name_list = [](const std::vector<std::string>& names) {
+        std::string list;
+        for (const auto& name : names) {
+            list += (list.empty() ? "" : ", ") + codegen::string_literal(name);
+        }
+        return list.empty() ? std::string("\"\"") : list;
+    };
+    std::vector<std::string> output_names;
+    for (const Node<T>* output : outputs) {
+        output_names.push_back(output->name());
+    }
+
+    GeneratedSource generated;
+    generated.header_name = options.name + ".hpp";
+    generated.source_name = options.name + ".cpp";
+
+    std::ostringstream header;
+    header << "// Generated by flowgraph::generate_cpp; do not edit.\n"
+           << "#pragma once\n"
+           << "#include <cstddef>\n"
+           << "#include \"" << options.include_prefix << "async/thread_pool.hpp\"\n\n"
+           << "namespace " << options.namespace_name << " {\n\n"
+           << "inline constexpr std::size_t input_count = " << input_names.size() << ";\n"
+           << "inline constexpr std::size_t output_count = " << outputs.size() << ";\n"
+           << "// Node names by record position (unused input slots are empty)\n"
+           << "inline constexpr const char* input_names[] = {" << name_list(input_names) << "};\n"
+           << "inline constexpr const char* output_names[] = {" << name_list(output_names) << "};\n\n"
+           << "// One input record to one output record; false if an operation failed\n"
+           << "bool evaluate(const " << type << "* in, " << type << "* out) noexcept;\n\n"
+           << "// count records stored back to back, split across the pool\n"
+           << "void evaluate_batch(flowgraph::ThreadPool& pool, const " << type << "* in, " << type
+           << "* out, bool* ok, std::size_t count);\n\n"
+           << "} // namespace " << options.namespace_name << "\n";
+    generated.header = header.str();
+
+    std::ostringstream source;
+    source << "// Generated by flowgraph::generate_cpp; do not edit.\n"
+           << "#include \"" << generated.header_name << "\"\n"
+           << "#include <algorithm>\n"
+           << "#include <cmath>\n"
+           << "#include <limits>\n"
+           << "#include \"" << options.include_prefix << "async/parallel_for.hpp\"\n\n"
+           << "namespace " << options.namespace_name << " {\n\n"
+           << "bool evaluate(const " << type << "* in, " << type << "* out) noexcept {\n"
+           << "    bool ok = true;\n";
+    if (input_names.empty()) {
+        source << "    (void)in;\n";
+    }
+    std::vector<std::string> operands;
+    for (const Entry* entry : order) {
+        const std::string variable = "v" + std::to_string(entry->variable);
+        std::string value;
+        if (auto slot = entry->term.input_slot) {
+            value = "in[" + std::to_string(*slot) + "]";
+        } else {
+            operands.clear();
+            for (const Node<T>* operand : entry->operands) {
+                operands.push_back("v" + std::to_string(entries.at(operand).variable));
+            }
+            if (!entry->term.failure.empty()) {
+                source << "    ok &= !(" << codegen::substitute(entry->term.failure, operands) << ");\n";
+            }
+            value = codegen::substitute(entry->term.expression, operands);
+        }
+        source << "    const " << type << " " << variable << " = " << value << ";  // "
+               << codegen::comment_text(entry->node->name()) << "\n";
+    }
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        source << "    out[" << i << "] = v" << entries.at(outputs[i]).variable << ";\n";
+    }
+    source << "    return ok;\n"
+           << "}\n\n"
+           << "void evaluate_batch(flowgraph::ThreadPool& pool, const " << type << "* in, " << type
+           << "* out, bool* ok, std::size_t count) {\n"
+           << "    flowgraph::parallel_for(pool, count, " << std::max<size_t>(options.min_batch_chunk, 1)
+           << ", [&](std::size_t begin, std::size_t end) {\n"
+           << "        for (std::size_t r = begin; r < end; ++r) {\n"
+           << "            ok[r] = evaluate(in + r * input_count, out + r * output_count);\n"
+           << "        }\n"
+           << "    });\n"
+           << "}\n\n"
+           << "} // namespace " << options.namespace_name << "\n";
+    generated.source = source.str();
+    return generated;
+}
+
+// Write the generated files into a directory, leaving files whose
+// contents are unchanged untouched so builds do not recompile them
+inline void write_generated(const GeneratedSource& generated, const std::filesystem::path& directory) {
+    std::filesystem::create_directories(directory);
+    auto write = [&](const std::string& name, const std::string& contents) {
+        auto path = directory / name;
+        {
+            std::ifstream existing(path, std::ios::binary);
+            if (existing) {
+                std::string current((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+                if (current == contents) {
+                    return;
+                }
+            }
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << contents;
+        if (!out) {
+            throw std::runtime_error("Cannot write " + path.string());
+        }
+    };
+    write(generated.header_name, generated.header);
+    write(generated.source_name, generated.source);
+}
+
+} // namespace flowgraph
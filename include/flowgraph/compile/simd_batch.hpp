@@ -0,0 +1,399 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "arithmetic_nodes.hpp"
+#include "bytecode.hpp"
+#include "../async/parallel_for.hpp"
+#include "../async/thread_pool.hpp"
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FLOWGRAPH_X86_SIMD 1
+#endif
+
+namespace flowgraph {
+
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+inline const char* to_string(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+// Widest instruction set this CPU runs the batch kernels with
+inline SimdLevel detect_simd_level() {
+#ifdef FLOWGRAPH_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::Avx2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+namespace simd {
+
+// Records per block: each register holds one value per record of the
+// block, and each error mask is one word
+inline constexpr size_t block = 64;
+
+// Kernels of each operation over a block: run<Op> writes results, fail<Op>
+// returns the lanes where the operation fails. Results match apply() and
+// failure() exactly: std::min(a, b) is b < a ? b : a, which is what the
+// min instructions compute with their operands swapped (and likewise max).
+template<ScalarValue T>
+struct ScalarKernels {
+    template<ArithmeticOp Op>
+    static void run(T* __restrict dst, const T* a, const T* b) {
+        for (size_t lane = 0; lane < block; ++lane) {
+            dst[lane] = apply(Op, a[lane], b[lane]);
+        }
+    }
+
+    template<ArithmeticOp Op>
+    static uint64_t fail(const T* a, const T* b) {
+        uint64_t mask = 0;
+        for (size_t lane = 0; lane < block; ++lane) {
+            mask |= static_cast<uint64_t>(failure(Op, a[lane], b[lane]) != nullptr) << lane;
+        }
+        return mask;
+    }
+};
+
+#ifdef FLOWGRAPH_X86_SIMD
+
+template<ScalarValue T>
+struct Avx2Kernels;
+
+template<>
+struct Avx2Kernels<double> {
+    static constexpr size_t width = 4;
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx2"))) static void run(double* __restrict dst, const double* a, const double* b) {
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        for (size_t i = 0; i < block; i += width) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            __m256d y = _mm256_loadu_pd(b + i);
+            __m256d r;
+            if constexpr (Op == ArithmeticOp::Add) r = _mm256_add_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Subtract) r = _mm256_sub_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Multiply) r = _mm256_mul_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Divide) r = _mm256_div_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Min) r = _mm256_min_pd(y, x);
+            else if constexpr (Op == ArithmeticOp::Max) r = _mm256_max_pd(y, x);
+            else if constexpr (Op == ArithmeticOp::Negate) r = _mm256_xor_pd(x, sign);
+            else if constexpr (Op == ArithmeticOp::Abs) r = _mm256_andnot_pd(sign, x);
+            else r = _mm256_sqrt_pd(x);
+            _mm256_storeu_pd(dst + i, r);
+        }
+    }
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx2"))) static uint64_t fail(const double* a, const double* b) {
+        const __m256d zero = _mm256_setzero_pd();
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block; i += width) {
+            __m256d failed = Op == ArithmeticOp::Divide
+                ? _mm256_cmp_pd(_mm256_loadu_pd(b + i), zero, _CMP_EQ_OQ)
+                : _mm256_cmp_pd(_mm256_loadu_pd(a + i), zero, _CMP_LT_OQ);
+            mask |= static_cast<uint64_t>(_mm256_movemask_pd(failed)) << i;
+        }
+        return mask;
+    }
+};
+
+template<>
+struct Avx2Kernels<float> {
+    static constexpr size_t width = 8;
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx2"))) static void run(float* __restrict dst, const float* a, const float* b) {
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        for (size_t i = 0; i < block; i += width) {
+            __m256 x = _mm256_loadu_ps(a + i);
+            __m256 y = _mm256_loadu_ps(b + i);
+            __m256 r;
+            if constexpr (Op == ArithmeticOp::Add) r = _mm256_add_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Subtract) r = _mm256_sub_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Multiply) r = _mm256_mul_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Divide) r = _mm256_div_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Min) r = _mm256_min_ps(y, x);
+            else if constexpr (Op == ArithmeticOp::Max) r = _mm256_max_ps(y, x);
+            else if constexpr (Op == ArithmeticOp::Negate) r = _mm256_xor_ps(x, sign);
+            else if constexpr (Op == ArithmeticOp::Abs) r = _mm256_andnot_ps(sign, x);
+            else r = _mm256_sqrt_ps(x);
+            _mm256_storeu_ps(dst + i, r);
+        }
+    }
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx2"))) static uint64_t fail(const float* a, const float* b) {
+        const __m256 zero = _mm256_setzero_ps();
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block; i += width) {
+            __m256 failed = Op == ArithmeticOp::Divide
+                ? _mm256_cmp_ps(_mm256_loadu_ps(b + i), zero, _CMP_EQ_OQ)
+                : _mm256_cmp_ps(_mm256_loadu_ps(a + i), zero, _CMP_LT_OQ);
+            mask |= static_cast<uint64_t>(_mm256_movemask_ps(failed)) << i;
+        }
+        return mask;
+    }
+};
+
+template<ScalarValue T>
+struct Avx512Kernels;
+
+template<>
+struct Avx512Kernels<double> {
+    static constexpr size_t width = 8;
+
+    // Sign bit operations go through integer lanes: the floating point
+    // bitwise instructions need AVX-512DQ
+    template<ArithmeticOp Op>
+    __attribute__((target("avx512f"))) static void run(double* __restrict dst, const double* a, const double* b) {
+        const __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ULL));
+        for (size_t i = 0; i < block; i += width) {
+            __m512d x = _mm512_loadu_pd(a + i);
+            __m512d y = _mm512_loadu_pd(b + i);
+            __m512d r;
+            if constexpr (Op == ArithmeticOp::Add) r = _mm512_add_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Subtract) r = _mm512_sub_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Multiply) r = _mm512_mul_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Divide) r = _mm512_div_pd(x, y);
+            else if constexpr (Op == ArithmeticOp::Min) r = _mm512_min_pd(y, x);
+            else if constexpr (Op == ArithmeticOp::Max) r = _mm512_max_pd(y, x);
+            else if constexpr (Op == ArithmeticOp::Negate)
+                r = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x), sign));
+            else if constexpr (Op == ArithmeticOp::Abs)
+                r = _mm512_castsi512_pd(_mm512_andnot_si512(sign, _mm512_castpd_si512(x)));
+            else r = _mm512_sqrt_pd(x);
+            _mm512_storeu_pd(dst + i, r);
+        }
+    }
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx512f"))) static uint64_t fail(const double* a, const double* b) {
+        const __m512d zero = _mm512_setzero_pd();
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block; i += width) {
+            __mmask8 failed = Op == ArithmeticOp::Divide
+                ? _mm512_cmp_pd_mask(_mm512_loadu_pd(b + i), zero, _CMP_EQ_OQ)
+                : _mm512_cmp_pd_mask(_mm512_loadu_pd(a + i), zero, _CMP_LT_OQ);
+            mask |= static_cast<uint64_t>(failed) << i;
+        }
+        return mask;
+    }
+};
+
+template<>
+struct Avx512Kernels<float> {
+    static constexpr size_t width = 16;
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx512f"))) static void run(float* __restrict dst, const float* a, const float* b) {
+        const __m512i sign = _mm512_set1_epi32(static_cast<int>(0x80000000U));
+        for (size_t i = 0; i < block; i += width) {
+            __m512 x = _mm512_loadu_ps(a + i);
+            __m512 y = _mm512_loadu_ps(b + i);
+            __m512 r;
+            if constexpr (Op == ArithmeticOp::Add) r = _mm512_add_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Subtract) r = _mm512_sub_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Multiply) r = _mm512_mul_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Divide) r = _mm512_div_ps(x, y);
+            else if constexpr (Op == ArithmeticOp::Min) r = _mm512_min_ps(y, x);
+            else if constexpr (Op == ArithmeticOp::Max) r = _mm512_max_ps(y, x);
+            else if constexpr (Op == ArithmeticOp::Negate)
+                r = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x), sign));
+            else if constexpr (Op == ArithmeticOp::Abs)
+                r = _mm512_castsi512_ps(_mm512_andnot_si512(sign, _mm512_castps_si512(x)));
+            else r = _mm512_sqrt_ps(x);
+            _mm512_storeu_ps(dst + i, r);
+        }
+    }
+
+    template<ArithmeticOp Op>
+    __attribute__((target("avx512f"))) static uint64_t fail(const float* a, const float* b) {
+        const __m512 zero = _mm512_setzero_ps();
+        uint64_t mask = 0;
+        for (size_t i = 0; i < block; i += width) {
+            __mmask16 failed = Op == ArithmeticOp::Divide
+                ? _mm512_cmp_ps_mask(_mm512_loadu_ps(b + i), zero, _CMP_EQ_OQ)
+                : _mm512_cmp_ps_mask(_mm512_loadu_ps(a + i), zero, _CMP_LT_OQ);
+            mask |= static_cast<uint64_t>(failed) << i;
+        }
+        return mask;
+    }
+};
+
+#endif // FLOWGRAPH_X86_SIMD
+
+// Kernels of every operation for one instruction set, indexed by op
+template<ScalarValue T>
+struct KernelTable {
+    using run_kernel = void (*)(T*, const T*, const T*);
+    using fail_kernel = uint64_t (*)(const T*, const T*);
+
+    run_kernel run[9] = {};
+    fail_kernel fail[9] = {};  // null where the operation cannot fail
+
+    template<template<typename> class Kernels>
+    static KernelTable make() {
+        KernelTable table;
+        add<Kernels, ArithmeticOp::Add>(table);
+        add<Kernels, ArithmeticOp::Subtract>(table);
+        add<Kernels, ArithmeticOp::Multiply>(table);
+        add<Kernels, ArithmeticOp::Divide>(table);
+        add<Kernels, ArithmeticOp::Min>(table);
+        add<Kernels, ArithmeticOp::Max>(table);
+        add<Kernels, ArithmeticOp::Negate>(table);
+        add<Kernels, ArithmeticOp::Abs>(table);
+        add<Kernels, ArithmeticOp::Sqrt>(table);
+        return table;
+    }
+
+private:
+    template<template<typename> class Kernels, ArithmeticOp Op>
+    static void add(KernelTable& table) {
+        auto index = static_cast<size_t>(Op);
+        table.run[index] = &Kernels<T>::template run<Op>;
+        if constexpr (Op == ArithmeticOp::Divide || Op == ArithmeticOp::Sqrt) {
+            table.fail[index] = &Kernels<T>::template fail<Op>;
+        }
+    }
+};
+
+} // namespace simd
+
+// Columns of a batch evaluation: one array of `count` values per input
+// slot and per output (structure of arrays), and per output an error
+// bitmask with bit r % 64 of word r / 64 set where record r failed, in
+// place of a ComputeResult per record
+template<ScalarValue T>
+struct SimdBatch {
+    std::vector<const T*> inputs;
+    std::vector<T*> outputs;
+    std::vector<uint64_t*> errors;
+    size_t count = 0;
+
+    static size_t mask_words(size_t count) { return (count + simd::block - 1) / simd::block; }
+};
+
+// Evaluates a compiled arithmetic graph over many independent records at
+// once. Records go through in blocks of 64: every register holds a lane
+// array of the block's values, each instruction runs its operation's
+// vectorized kernel across the array, and errors are tracked per
+// register as a bitmask of failed lanes, propagated from operands to
+// results as graph execution propagates ComputeResult errors. Kernels are
+// chosen once for the widest instruction set both the CPU and the
+// requested level allow; the scalar ones are used elsewhere.
+template<ScalarValue T>
+class SimdBatchEvaluator {
+public:
+    explicit SimdBatchEvaluator(BytecodeProgram<T> program, SimdLevel level = detect_simd_level())
+        : program_(std::move(program))
+        , level_(std::min(level, detect_simd_level())) {
+        switch (level_) {
+#ifdef FLOWGRAPH_X86_SIMD
+            case SimdLevel::Avx512:
+                kernels_ = simd::KernelTable<T>::template make<simd::Avx512Kernels>();
+                break;
+            case SimdLevel::Avx2:
+                kernels_ = simd::KernelTable<T>::template make<simd::Avx2Kernels>();
+                break;
+#endif
+            default:
+                level_ = SimdLevel::Scalar;
+                kernels_ = simd::KernelTable<T>::template make<simd::ScalarKernels>();
+                break;
+        }
+    }
+
+    SimdLevel level() const { return level_; }
+    const BytecodeProgram<T>& program() const { return program_; }
+
+    void evaluate(const SimdBatch<T>& batch) const {
+        check(batch);
+        evaluate_blocks(batch, 0, SimdBatch<T>::mask_words(batch.count));
+    }
+
+    // evaluate() split across the pool in whole blocks, so no two workers
+    // write the same error mask word
+    void evaluate(ThreadPool& pool, const SimdBatch<T>& batch, size_t min_chunk = 4096) const {
+        check(batch);
+        parallel_for(pool, SimdBatch<T>::mask_words(batch.count), std::max<size_t>(min_chunk / simd::block, 1),
+                     [&](size_t begin, size_t end) { evaluate_blocks(batch, begin, end); });
+    }
+
+private:
+    void check(const SimdBatch<T>& batch) const {
+        if (batch.inputs.size() < program_.input_count() || batch.outputs.size() != program_.output_count() ||
+            batch.errors.size() != program_.output_count()) {
+            throw std::invalid_argument("Batch columns do not match the program's inputs and outputs");
+        }
+    }
+
+    void evaluate_blocks(const SimdBatch<T>& batch, size_t first_block, size_t last_block) const {
+        const size_t inputs = program_.input_count();
+        thread_local std::vector<T> values;
+        thread_local std::vector<uint64_t> masks;
+        values.resize(std::max(values.size(), program_.register_count() * simd::block));
+        masks.resize(std::max(masks.size(), program_.register_count()));
+        T* r = values.data();
+        uint64_t* m = masks.data();
+        std::fill_n(m, program_.register_count(), 0);
+        const auto& constants = program_.constants();
+        for (size_t c = 0; c < constants.size(); ++c) {
+            std::fill_n(r + (inputs + c) * simd::block, simd::block, constants[c]);
+        }
+
+        for (size_t b = first_block; b < last_block; ++b) {
+            const size_t base = b * simd::block;
+            const size_t n = std::min(simd::block, batch.count - base);
+            for (size_t s = 0; s < inputs; ++s) {
+                T* lanes = r + s * simd::block;
+                std::copy_n(batch.inputs[s] + base, n, lanes);
+                // Padding lanes repeat the last record and are masked off
+                std::fill(lanes + n, lanes + simd::block, lanes[n - 1]);
+            }
+            for (const auto& ins : program_.code()) {
+                auto op = static_cast<size_t>(ins.op);
+                const T* a = r + ins.a * simd::block;
+                const T* bv = r + ins.b * simd::block;
+                uint64_t failed = m[ins.a] | m[ins.b];
+                if (kernels_.fail[op]) {
+                    failed |= kernels_.fail[op](a, bv);
+                }
+                kernels_.run[op](r + ins.dst * simd::block, a, bv);
+                m[ins.dst] = failed;
+            }
+            const uint64_t valid = n == simd::block ? ~uint64_t{0} : (uint64_t{1} << n) - 1;
+            const auto& outputs = program_.output_registers();
+            for (size_t i = 0; i < outputs.size(); ++i) {
+                std::copy_n(r + outputs[i] * simd::block, n, batch.outputs[i] + base);
+                batch.errors[i][b] = m[outputs[i]] & valid;
+            }
+        }
+    }
+
+    BytecodeProgram<T> program_;
+    SimdLevel level_;
+    simd::KernelTable<T> kernels_;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include "../async/task_priority.hpp"
+
+namespace flowgraph {
+
+// Scheduling strategy used by Graph<T>::execute()
+enum class ExecutionStrategy {
+    DependencyDriven,     // Recursive per-node dependency resolution (default)
+    LevelSynchronous,     // One parallel-for and barrier per topological level
+    Dataflow              // Per-node dependency counting on the thread pool
+};
+
+// How pool-based executions react to queueing delay under overload
+enum class OverloadAction {
+    None,
+    Shed,       // Fail nodes whose task waited longer than the target with ResourceError
+    // Compute nodes at their maximum precision level, and step down towards
+    // their minimum while the recent queue delay exceeds the target.
+    // LevelSynchronous and Dataflow only.
+    Degrade
+};
+
+// Options controlling how a graph is executed
+struct ExecutionOptions {
+    ExecutionStrategy strategy = ExecutionStrategy::DependencyDriven;
+
+    // Smallest contiguous node range handed to a worker when a level is
+    // split for LevelSynchronous execution
+    size_t min_chunk_size = 256;
+
+    // Dataflow only: when a node finishes, run one newly ready successor
+    // immediately on the same worker (its input is still in that core's
+    // cache) and push the others to the worker's deque for stealing.
+    // When false, every ready successor goes through the shared queue.
+    bool continue_on_same_worker = true;
+
+    // Priority of the pool tasks an execution submits. DependencyDriven
+    // execution runs on the calling thread and is not affected.
+    TaskPriority priority = TaskPriority::Interactive;
+
+    // Overload protection for LevelSynchronous and Dataflow execution.
+    // Executions rejected by a bounded pool always fail fast with
+    // ResourceError; these options act on work that was admitted.
+    OverloadAction overload_action = OverloadAction::None;
+    std::chrono::microseconds queue_delay_target{1000};
+
+    // Share execution plans with other graphs built with the same topology
+    // through the process-wide PlanCache. Edges added while set are not
+    // checked for cycles one by one; a cycle is reported when the plan is
+    // built instead.
+    bool use_plan_cache = false;
+};
+
+} // namespace flowgraph
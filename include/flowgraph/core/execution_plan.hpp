@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "concepts.hpp"
+#include "node.hpp"
+#include "edge.hpp"
+
+namespace flowgraph {
+
+// Flattened, index-based view of a graph's topology.
+// Nodes are stored in topological order and grouped by level, so level i
+// occupies the contiguous range [level_offsets[i], level_offsets[i + 1]).
+// Adjacency is kept in CSR form to avoid scanning the edge set per node.
+template<typename T>
+    requires NodeValue<T>
+struct ExecutionPlan {
+    std::vector<std::shared_ptr<Node<T>>> nodes;
+    std::vector<size_t> level_offsets;
+    std::vector<size_t> predecessor_offsets;
+    std::vector<size_t> predecessors;
+    std::vector<size_t> successor_offsets;
+    std::vector<size_t> successors;
+    std::unordered_map<const NodeBase*, size_t> index;
+
+    size_t size() const { return nodes.size(); }
+
+    size_t level_count() const {
+        return level_offsets.empty() ? 0 : level_offsets.size() - 1;
+    }
+
+    std::span<const size_t> predecessors_of(size_t i) const {
+        return {predecessors.data() + predecessor_offsets[i],
+                predecessor_offsets[i + 1] - predecessor_offsets[i]};
+    }
+
+    std::span<const size_t> successors_of(size_t i) const {
+        return {successors.data() + successor_offsets[i],
+                successor_offsets[i + 1] - successor_offsets[i]};
+    }
+
+    static ExecutionPlan build(
+        const std::unordered_set<std::shared_ptr<Node<T>>>& graph_nodes,
+        const std::unordered_set<std::shared_ptr<Edge<T>>>& graph_edges
+    ) {
+        const size_t n = graph_nodes.size();
+
+        // Provisional indices in set iteration order
+        std::vector<std::shared_ptr<Node<T>>> provisional(graph_nodes.begin(), graph_nodes.end());
+        std::unordered_map<const NodeBase*, size_t> provisional_index;
+        provisional_index.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            provisional_index.emplace(provisional[i].get(), i);
+        }
+
+        // Resolve edges, ignoring those whose endpoints are not part of the graph
+        std::vector<std::pair<size_t, size_t>> links;
+        links.reserve(graph_edges.size());
+        for (const auto& edge : graph_edges) {
+            auto from = provisional_index.find(edge->from().get());
+            auto to = provisional_index.find(edge->to().get());
+            if (from != provisional_index.end() && to != provisional_index.end()) {
+                links.emplace_back(from->second, to->second);
+            }
+        }
+
+        // Kahn's algorithm, recording the longest-path level of every node
+        std::vector<size_t> out_offsets(n + 1, 0);
+        std::vector<size_t> in_degree(n, 0);
+        for (const auto& [from, to] : links) {
+            ++out_offsets[from + 1];
+            ++in_degree[to];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out_offsets[i + 1] += out_offsets[i];
+        }
+        std::vector<size_t> out_targets(links.size());
+        {
+            std::vector<size_t> cursor(out_offsets.begin(), out_offsets.end() - 1);
+            for (const auto& [from, to] : links) {
+                out_targets[cursor[from]++] = to;
+            }
+        }
+
+        std::vector<size_t> level(n, 0);
+        std::vector<size_t> ready;
+        ready.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (in_degree[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+        size_t max_level = 0;
+        for (size_t head = 0; head < ready.size(); ++head) {
+            size_t u = ready[head];
+            max_level = std::max(max_level, level[u]);
+            for (size_t e = out_offsets[u]; e < out_offsets[u + 1]; ++e) {
+                size_t v = out_targets[e];
+                level[v] = std::max(level[v], level[u] + 1);
+                if (--in_degree[v] == 0) {
+                    ready.push_back(v);
+                }
+            }
+        }
+        if (ready.size() != n) {
+            throw std::runtime_error("Graph contains a cycle");
+        }
+
+        // Bucket nodes by level to obtain the final ordering
+        ExecutionPlan plan;
+        plan.level_offsets.assign(n == 0 ? 1 : max_level + 2, 0);
+        for (size_t i = 0; i < n; ++i) {
+            ++plan.level_offsets[level[i] + 1];
+        }
+        for (size_t l = 1; l < plan.level_offsets.size(); ++l) {
+            plan.level_offsets[l] += plan.level_offsets[l - 1];
+        }
+        std::vector<size_t> final_index(n);
+        {
+            std::vector<size_t> cursor(plan.level_offsets.begin(), plan.level_offsets.end() - 1);
+            for (size_t i : ready) {
+                final_index[i] = cursor[level[i]]++;
+            }
+        }
+        plan.nodes.resize(n);
+        plan.index.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            plan.nodes[final_index[i]] = provisional[i];
+            plan.index.emplace(provisional[i].get(), final_index[i]);
+        }
+
+        // CSR adjacency in final indices
+        plan.predecessor_offsets.assign(n + 1, 0);
+        plan.successor_offsets.assign(n + 1, 0);
+        for (const auto& [from, to] : links) {
+            ++plan.successor_offsets[final_index[from] + 1];
+            ++plan.predecessor_offsets[final_index[to] + 1];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            plan.successor_offsets[i + 1] += plan.successor_offsets[i];
+            plan.predecessor_offsets[i + 1] += plan.predecessor_offsets[i];
+        }
+        plan.successors.resize(links.size());
+        plan.predecessors.resize(links.size());
+        {
+            std::vector<size_t> succ_cursor(plan.successor_offsets.begin(), plan.successor_offsets.end() - 1);
+            std::vector<size_t> pred_cursor(plan.predecessor_offsets.begin(), plan.predecessor_offsets.end() - 1);
+            for (const auto& [from, to] : links) {
+                size_t f = final_index[from];
+                size_t t = final_index[to];
+                plan.successors[succ_cursor[f]++] = t;
+                plan.predecessors[pred_cursor[t]++] = f;
+            }
+        }
+
+        return plan;
+    }
+};
+
+} // namespace flowgraph
@@ -1,11 +1,17 @@
 #pragma once
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
 #include <optional>
+#include <variant>
 #include <vector>
 #include <cmath>
 #include "concepts.hpp"
+#include "precision_storage.hpp"
+#include "../cache/spill_store.hpp"
+#include "../cache/value_compression.hpp"
 
 namespace flowgraph {
 
@@ -30,6 +36,14 @@ public:
     FractalTreeNode(size_t max_depth = 8, double compression_threshold = 0.001)
         : max_depth_(max_depth), compression_threshold_(compression_threshold) {}
 
+    ~FractalTreeNode() {
+        if constexpr (CompressibleValue<T>) {
+            for (const auto& [level, spilled] : spilled_levels_) {
+                spill_store_->free(spilled.slot);
+            }
+        }
+    }
+
     // Store a value at a specific precision level
     void store(const T& value, size_t precision_level) {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -56,17 +70,15 @@ public:
             precision_level = max_depth_;
         }
 
-        // Check if we have an absolute value at this level
-        auto it = absolute_values_.find(precision_level);
-        if (it != absolute_values_.end()) {
-            return it->second;
+        // Check if we have a value at this level
+        if (has_level(precision_level)) {
+            return level_value(precision_level);
         }
 
         // If not, try to find the closest available level
         for (size_t level = precision_level; level > 0; --level) {
-            it = absolute_values_.find(level - 1);
-            if (it != absolute_values_.end()) {
-                return expand_value(it->second, level - 1, precision_level);
+            if (has_level(level - 1)) {
+                return expand_value(level_value(level - 1), level - 1, precision_level);
             }
         }
 
@@ -76,6 +88,12 @@ public:
     // Merge all pending updates into absolute values
     void merge_all() {
         std::lock_guard<std::mutex> lock(mutex_);
+        if constexpr (PackableNumeric<T>) {
+            if (level_encoding_ == LevelEncoding::Delta) {
+                merge_all_delta();
+                return;
+            }
+        }
         std::vector<size_t> levels;
         for (const auto& [level, _] : pending_updates_) {
             levels.push_back(level);
@@ -89,7 +107,442 @@ public:
     // Get the maximum supported precision level
     size_t max_depth() const { return max_depth_; }
 
+    // Differences below this are treated as equal
+    double compression_threshold() const { return compression_threshold_; }
+
+    // Storage formats of numeric container values by level, from level 0
+    // up; levels past the end use the last. By default every level keeps
+    // the elements' own type. Values already merged are converted.
+    void set_storage_formats(std::vector<StorageFormat> formats) requires PackableNumeric<T> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto levels = decode_levels();
+        storage_formats_ = std::move(formats);
+        encode_levels(levels);
+    }
+
+    // With Delta, only the lowest level of numeric container values is held
+    // in full (in its storage format). Each level above holds its values'
+    // differences from the level below, both counted in whole multiples of
+    // compression_threshold, as 0 to 4 bytes per element; a level reads
+    // back within half a threshold of what was stored. Levels whose values
+    // do not fit (not finite, say) are held in full. Values already merged
+    // are converted.
+    void set_level_encoding(LevelEncoding encoding) requires PackableNumeric<T> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto levels = decode_levels();
+        level_encoding_ = encoding;
+        encode_levels(levels);
+    }
+
+    LevelEncoding level_encoding() const requires PackableNumeric<T> { return level_encoding_; }
+
+    StorageFormat storage_format(size_t level) const requires PackableNumeric<T> {
+        using element_type = std::ranges::range_value_t<T>;
+        if (storage_formats_.empty()) {
+            return native_storage_format<element_type>();
+        }
+        auto format = storage_formats_[std::min(level, storage_formats_.size() - 1)];
+        return std::min(format, native_storage_format<element_type>());
+    }
+
+    // Bytes held in memory by merged values, counting the elements of
+    // numeric containers and the encoding of values with a ValueCodec
+    size_t memory_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t bytes = 0;
+        for (const auto& [level, stored] : absolute_values_) {
+            bytes += stored_bytes(stored);
+        }
+        if constexpr (PackableNumeric<T>) {
+            for (const auto& [level, residual] : residual_levels_) {
+                bytes += residual.bytes();
+            }
+        }
+        if constexpr (CompressibleValue<T>) {
+            for (const auto& [level, compressed] : cold_values_) {
+                bytes += compressed.bytes();
+            }
+        }
+        return bytes;
+    }
+
+    // Levels held in full that are not read for options.idle_runs runs are
+    // compressed at the end of a run and decompressed when next read.
+    // Merging a level, or with Delta any level, decompresses it.
+    void set_cold_compression(ColdCompressionOptions options) requires CompressibleValue<T> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cold_options_ = std::move(options);
+    }
+
+    // Ends a run and compresses the levels that have gone cold, without
+    // holding the lock while compressing; a level read or changed in the
+    // meantime is left in full, as is one whose compressed value is no
+    // smaller than its packed storage
+    void end_run() {
+        std::vector<std::pair<size_t, T>> candidates;
+        std::vector<size_t> held_bytes;
+        size_t run;
+        size_t version;
+        ColdCompressionOptions options;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            run = ++run_;
+            version = version_;
+            options = cold_options_;
+            if constexpr (CompressibleValue<T>) {
+                if (options.idle_runs > 0) {
+                    for (const auto& [level, stored] : absolute_values_) {
+                        if (run - last_read_run(level) > options.idle_runs) {
+                            candidates.emplace_back(level, from_stored(stored));
+                            held_bytes.push_back(stored_bytes(stored));
+                        }
+                    }
+                }
+            }
+        }
+        if constexpr (CompressibleValue<T>) {
+            if (candidates.empty()) {
+                return;
+            }
+            std::vector<std::optional<CompressedValue<T>>> compressed;
+            compressed.reserve(candidates.size());
+            for (const auto& [level, value] : candidates) {
+                compressed.push_back(CompressedValue<T>::compress(value, options.min_bytes));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (version_ != version) {
+                return;
+            }
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                size_t level = candidates[i].first;
+                if (last_read_run(level) >= run || !absolute_values_.contains(level)) {
+                    continue;
+                }
+                if (!compressed[i] || compressed[i]->bytes() >= held_bytes[i]) {
+                    // Tried again idle_runs runs later
+                    level_runs_[level] = run - 1;
+                    continue;
+                }
+                if (options.stats) {
+                    options.stats->record_compression(compressed[i]->original_bytes(), compressed[i]->bytes());
+                }
+                cold_values_.emplace(level, std::move(*compressed[i]));
+                absolute_values_.erase(level);
+            }
+        }
+    }
+
+    // Levels held compressed
+    size_t compressed_levels() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if constexpr (CompressibleValue<T>) {
+            return cold_values_.size();
+        } else {
+            return 0;
+        }
+    }
+
+    // Levels can be written to the store's spill file (spill_level) and
+    // are read back from it when next read. Changing stores reloads the
+    // levels spilled to the old one first.
+    void set_spill_store(std::shared_ptr<SpillStore> store) requires CompressibleValue<T> {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!spilled_levels_.empty()) {
+            stored_at(spilled_levels_.begin()->first);
+        }
+        spill_store_ = std::move(store);
+    }
+
+    // Levels held in memory, in full or compressed, for choosing what to
+    // spill
+    std::vector<LevelUsage> level_usage() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<LevelUsage> usage;
+        for (const auto& [level, stored] : absolute_values_) {
+            usage.push_back({level, stored_bytes(stored), run_ - last_read_run(level)});
+        }
+        if constexpr (CompressibleValue<T>) {
+            for (const auto& [level, compressed] : cold_values_) {
+                usage.push_back({level, compressed.bytes(), run_ - last_read_run(level)});
+            }
+        }
+        return usage;
+    }
+
+    // Writes a level held in memory to the spill file, compressed where
+    // that shrinks it, and returns the bytes freed: 0 without a spill
+    // store or for levels not in memory. Residual (Delta) levels stay, as
+    // do packed levels that would take more room on disk than they free.
+    size_t spill_level(size_t level) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if constexpr (CompressibleValue<T>) {
+            if (!spill_store_) {
+                return 0;
+            }
+            size_t freed = 0;
+            std::optional<CompressedValue<T>> encoded;
+            const CompressedValue<T>* value = nullptr;
+            if (auto it = cold_values_.find(level); it != cold_values_.end()) {
+                freed = it->second.bytes();
+                value = &it->second;
+            } else if (auto it = absolute_values_.find(level); it != absolute_values_.end()) {
+                freed = stored_bytes(it->second);
+                encoded = CompressedValue<T>::encode(from_stored(it->second));
+                if (encoded->bytes() > freed) {
+                    return 0;
+                }
+                value = &*encoded;
+            } else {
+                return 0;
+            }
+            SpilledLevel spilled{spill_store_->write(value->data()), value->codec(), value->original_bytes()};
+            cold_values_.erase(level);
+            absolute_values_.erase(level);
+            spilled_levels_.emplace(level, spilled);
+            ++version_;
+            return freed;
+        } else {
+            return 0;
+        }
+    }
+
+    // Levels held in the spill file
+    size_t spilled_levels() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if constexpr (CompressibleValue<T>) {
+            return spilled_levels_.size();
+        } else {
+            return 0;
+        }
+    }
+
 private:
+    // Numeric containers are held packed in their level's storage format
+    using stored_type = std::conditional_t<PackableNumeric<T>, PackedValues, T>;
+
+    stored_type to_stored(const T& value, size_t level) const {
+        if constexpr (PackableNumeric<T>) {
+            return PackedValues(std::span(std::ranges::data(value), std::ranges::size(value)), storage_format(level));
+        } else {
+            return value;
+        }
+    }
+
+    decltype(auto) from_stored(const stored_type& stored) const {
+        if constexpr (PackableNumeric<T>) {
+            T value;
+            value.resize(stored.size());
+            stored.unpack(std::span(std::ranges::data(value), std::ranges::size(value)));
+            return value;
+        } else {
+            return (stored);
+        }
+    }
+
+    bool has_level(size_t level) const {
+        if constexpr (PackableNumeric<T>) {
+            if (residual_levels_.contains(level)) {
+                return true;
+            }
+        }
+        return held_in_full(level);
+    }
+
+    bool held_in_full(size_t level) const {
+        if constexpr (CompressibleValue<T>) {
+            if (cold_values_.contains(level) || spilled_levels_.contains(level)) {
+                return true;
+            }
+        }
+        return absolute_values_.contains(level);
+    }
+
+    size_t stored_bytes(const stored_type& stored) const {
+        if constexpr (PackableNumeric<T>) {
+            return stored.bytes();
+        } else if constexpr (EncodableValue<T>) {
+            return ValueCodec<T>::size(stored);
+        } else {
+            return sizeof(T);
+        }
+    }
+
+    // A level held in full, decompressed first if cold and read back first
+    // if spilled; counts as a read
+    const stored_type& stored_at(size_t level) const {
+        if constexpr (CompressibleValue<T>) {
+            if (auto it = spilled_levels_.find(level); it != spilled_levels_.end()) {
+                auto start = std::chrono::steady_clock::now();
+                const auto& spilled = it->second;
+                auto value = CompressedValue<T>::restore(spilled.codec, spilled.original_bytes,
+                                                         spill_store_->read(spilled.slot)).decompress();
+                absolute_values_.emplace(level, to_stored(value, level));
+                spill_store_->free(spilled.slot);
+                spill_store_->record_reload(spilled.slot.size, std::chrono::steady_clock::now() - start);
+                spilled_levels_.erase(it);
+            }
+            if (auto it = cold_values_.find(level); it != cold_values_.end()) {
+                auto value = timed_decompression(cold_options_, [&] { return it->second.decompress(); });
+                cold_values_.erase(it);
+                absolute_values_.emplace(level, to_stored(value, level));
+            }
+        }
+        level_runs_[level] = run_;
+        return absolute_values_.at(level);
+    }
+
+    // Every level back in memory and in full
+    void thaw_all() const {
+        if constexpr (CompressibleValue<T>) {
+            while (!cold_values_.empty()) {
+                stored_at(cold_values_.begin()->first);
+            }
+            while (!spilled_levels_.empty()) {
+                stored_at(spilled_levels_.begin()->first);
+            }
+        }
+    }
+
+    size_t last_read_run(size_t level) const {
+        auto it = level_runs_.find(level);
+        return it != level_runs_.end() ? it->second : 0;
+    }
+
+    decltype(auto) level_value(size_t level) const {
+        if constexpr (PackableNumeric<T>) {
+            if (auto it = residual_levels_.find(level); it != residual_levels_.end()) {
+                // Residuals down to the nearest level held in full
+                std::vector<const QuantizedResidual*> chain = {&it->second};
+                size_t base = level;
+                while (base-- > 0 && !held_in_full(base)) {
+                    if (auto below = residual_levels_.find(base); below != residual_levels_.end()) {
+                        chain.push_back(&below->second);
+                    }
+                }
+                auto steps = level_steps(from_stored(stored_at(base))).value();
+                for (auto residual = chain.rbegin(); residual != chain.rend(); ++residual) {
+                    (*residual)->apply(steps);
+                }
+                return from_steps(steps);
+            }
+        }
+        return from_stored(stored_at(level));
+    }
+
+    // Numeric container values of every level, with the step counts of
+    // those read through residuals
+    struct DecodedLevel {
+        T value;
+        std::optional<std::vector<int64_t>> steps;
+    };
+
+    std::map<size_t, DecodedLevel> decode_levels() const requires PackableNumeric<T> {
+        thaw_all();
+        std::vector<size_t> order;
+        for (const auto& [level, _] : absolute_values_) {
+            order.push_back(level);
+        }
+        for (const auto& [level, _] : residual_levels_) {
+            order.push_back(level);
+        }
+        std::sort(order.begin(), order.end());
+
+        std::map<size_t, DecodedLevel> levels;
+        const std::vector<int64_t>* below = nullptr;
+        for (auto level : order) {
+            DecodedLevel decoded;
+            if (auto it = residual_levels_.find(level); it != residual_levels_.end()) {
+                std::vector<int64_t> steps = *below;
+                it->second.apply(steps);
+                decoded.value = from_steps(steps);
+                decoded.steps = std::move(steps);
+            } else {
+                decoded.value = from_stored(absolute_values_.at(level));
+                if (!residual_levels_.empty()) {
+                    decoded.steps = level_steps(decoded.value);
+                }
+            }
+            auto& inserted = levels.emplace(level, std::move(decoded)).first->second;
+            below = inserted.steps ? &*inserted.steps : nullptr;
+        }
+        return levels;
+    }
+
+    // Levels held as residuals keep the step counts they were decoded
+    // with, so re-encoding never moves them
+    void encode_levels(std::map<size_t, DecodedLevel>& levels) requires PackableNumeric<T> {
+        ++version_;
+        absolute_values_.clear();
+        residual_levels_.clear();
+        const std::vector<int64_t>* below = nullptr;
+        for (auto& [level, decoded] : levels) {
+            if (level_encoding_ == LevelEncoding::Delta) {
+                if (!decoded.steps) {
+                    decoded.steps = level_steps(decoded.value);
+                }
+                if (below && decoded.steps) {
+                    if (auto residual = QuantizedResidual::encode(*decoded.steps, *below)) {
+                        residual_levels_.emplace(level, std::move(*residual));
+                        below = &*decoded.steps;
+                        continue;
+                    }
+                }
+            }
+            auto& stored = absolute_values_.emplace(level, to_stored(decoded.value, level)).first->second;
+            if (level_encoding_ == LevelEncoding::Delta) {
+                // Levels above count from what this one reads back as
+                decoded.steps = level_steps(from_stored(stored));
+                below = decoded.steps ? &*decoded.steps : nullptr;
+            }
+        }
+    }
+
+    std::optional<std::vector<int64_t>> level_steps(const T& value) const requires PackableNumeric<T> {
+        return quantize_steps(std::span(std::ranges::data(value), std::ranges::size(value)), compression_threshold_);
+    }
+
+    T from_steps(const std::vector<int64_t>& steps) const requires PackableNumeric<T> {
+        T value;
+        value.resize(steps.size());
+        dequantize_steps(std::span<const int64_t>(steps), compression_threshold_,
+                         std::span(std::ranges::data(value), std::ranges::size(value)));
+        return value;
+    }
+
+    // merge_all() decoding and re-encoding the levels once
+    void merge_all_delta() requires PackableNumeric<T> {
+        auto levels = decode_levels();
+        bool changed = false;
+        for (auto& [level, updates] : pending_updates_) {
+            if (!updates.empty()) {
+                // Container values are not averaged: the latest one wins
+                levels[level] = DecodedLevel{std::move(updates.back().value), std::nullopt};
+                level_runs_[level] = run_;
+                updates.clear();
+                changed = true;
+            }
+        }
+        if (remove_redundant_levels(levels) || changed) {
+            encode_levels(levels);
+        }
+    }
+
+    // compress_tree() on decoded levels
+    bool remove_redundant_levels(std::map<size_t, DecodedLevel>& levels) const requires PackableNumeric<T> {
+        std::vector<size_t> levels_to_remove;
+        for (const auto& [level, decoded] : levels) {
+            if (auto it = levels.find(level - 1); level > 0 && it != levels.end() &&
+                difference(decoded.value, it->second.value) < compression_threshold_) {
+                levels_to_remove.push_back(level);
+            }
+        }
+        for (auto level : levels_to_remove) {
+            levels.erase(level);
+        }
+        return !levels_to_remove.empty();
+    }
+
     // Merge pending updates at a specific level
     void merge_level(size_t level) {
         auto updates_it = pending_updates_.find(level);
@@ -97,6 +550,8 @@ private:
             return;
         }
 
+        level_runs_[level] = run_;
+
         // Initialize merged_value with the first update
         T merged_value = updates_it->second[0].value;
         double total_weight = updates_it->second[0].weight;
@@ -117,17 +572,31 @@ private:
             }
         }
 
+        if constexpr (PackableNumeric<T>) {
+            if (level_encoding_ == LevelEncoding::Delta) {
+                auto levels = decode_levels();
+                levels[level] = DecodedLevel{std::move(merged_value), std::nullopt};
+                encode_levels(levels);
+                updates_it->second.clear();
+                return;
+            }
+        }
+
         // Update absolute value
+        ++version_;
+        if (held_in_full(level)) {
+            stored_at(level);
+        }
         if (auto it = absolute_values_.find(level); it != absolute_values_.end()) {
             // For arithmetic types, use exponential moving average
             if constexpr (std::is_arithmetic_v<T>) {
                 it->second = static_cast<T>(it->second * 0.7 + merged_value * 0.3);
             } else {
                 // For non-arithmetic types, just use the latest value
-                it->second = merged_value;
+                it->second = to_stored(merged_value, level);
             }
         } else {
-            absolute_values_[level] = merged_value;
+            absolute_values_.emplace(level, to_stored(merged_value, level));
         }
 
         // Clear pending updates
@@ -138,12 +607,22 @@ private:
     void compress_tree() {
         std::vector<size_t> levels_to_remove;
 
+        if constexpr (PackableNumeric<T>) {
+            if (level_encoding_ == LevelEncoding::Delta) {
+                auto levels = decode_levels();
+                if (remove_redundant_levels(levels)) {
+                    encode_levels(levels);
+                }
+                return;
+            }
+        }
+
         for (const auto& [level, value] : absolute_values_) {
             if (level > 0) {
                 auto lower_level = level - 1;
                 if (auto it = absolute_values_.find(lower_level); it != absolute_values_.end()) {
                     // Check if the difference between levels is below threshold
-                    if (difference(value, it->second) < compression_threshold_) {
+                    if (difference(from_stored(value), from_stored(it->second)) < compression_threshold_) {
                         levels_to_remove.push_back(level);
                     }
                 }
@@ -153,6 +632,9 @@ private:
         for (auto level : levels_to_remove) {
             absolute_values_.erase(level);
         }
+        if (!levels_to_remove.empty()) {
+            ++version_;
+        }
     }
 
     // Expand a value from one precision level to another
@@ -181,8 +663,29 @@ private:
     static constexpr size_t merge_threshold_ = 10;
     
     mutable std::mutex mutex_;
-    mutable std::unordered_map<size_t, T> absolute_values_;
+    std::vector<StorageFormat> storage_formats_;
+    LevelEncoding level_encoding_ = LevelEncoding::Absolute;
+    mutable std::unordered_map<size_t, stored_type> absolute_values_;
+    [[no_unique_address]] std::conditional_t<PackableNumeric<T>, std::unordered_map<size_t, QuantizedResidual>,
+                                             std::monostate> residual_levels_;
     mutable std::unordered_map<size_t, std::vector<PendingUpdate<T>>> pending_updates_;
+    // Cold tier: levels compressed after going unread, the run each level
+    // was last read in, and a count of changes to the levels held in full
+    [[no_unique_address]] mutable std::conditional_t<CompressibleValue<T>,
+        std::unordered_map<size_t, cold_value_t<T>>, std::monostate> cold_values_;
+    mutable std::unordered_map<size_t, size_t> level_runs_;
+    ColdCompressionOptions cold_options_;
+    size_t run_ = 0;
+    size_t version_ = 0;
+    // Levels written to the spill store's file
+    struct SpilledLevel {
+        SpillSlot slot;
+        CompressionCodec codec;
+        size_t original_bytes;
+    };
+    [[no_unique_address]] mutable std::conditional_t<CompressibleValue<T>,
+        std::unordered_map<size_t, SpilledLevel>, std::monostate> spilled_levels_;
+    std::shared_ptr<SpillStore> spill_store_;
 };
 
 } // namespace flowgraph
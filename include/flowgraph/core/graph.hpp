@@ -1,16 +1,27 @@
 #pragma once
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <memory>
+#include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <optional>
 #include <stdexcept>
 #include <mutex>
+#include <atomic>
+#include <thread>
 #include "concepts.hpp"
 #include "core.hpp"
 #include "node.hpp"
 #include "edge.hpp"
+#include "execution_options.hpp"
+#include "execution_plan.hpp"
+#include "plan_cache.hpp"
 #include "../async/task.hpp"
 #include "../async/thread_pool.hpp"
+#include "../async/parallel_for.hpp"
 #include "../async/future_helpers.hpp"
 #include "../cache/graph_cache.hpp"
 #include "../cache/cache_policy.hpp"
@@ -30,7 +41,7 @@ public:
 
     explicit Graph(std::unique_ptr<CachePolicy<T>> cache_policy = nullptr,
                   std::shared_ptr<ThreadPool> thread_pool = nullptr)
-        : cache_(std::make_unique<GraphCache<T>>(std::move(cache_policy))),
+        : cache_(std::make_shared<GraphCache<T>>(std::move(cache_policy))),
           thread_pool_(thread_pool ? thread_pool : std::make_shared<ThreadPool>()) {}
 
     void add_optimization_pass(std::unique_ptr<OptimizationPass<T>> pass) {
@@ -44,8 +55,19 @@ public:
     }
 
     void add_node(std::shared_ptr<node_type> node) {
-        nodes_.insert(node);
+        if (nodes_.insert(node).second) {
+            record_.add_node(node);
+        }
+        ++topology_version_;
         node->set_parent_graph(this);
+        if constexpr (CompressibleValue<T>) {
+            if (cold_options_.idle_runs > 0) {
+                node->set_cold_compression(cold_options_);
+            }
+            if (spill_store_) {
+                node->set_spill_store(spill_store_);
+            }
+        }
         node->add_completion_callback([this](const compute_result_type& result) {
             if (result.has_error()) {
                 std::lock_guard<std::mutex> lock(error_mutex_);
@@ -64,15 +86,25 @@ public:
         }
         node->set_parent_graph(nullptr);
         nodes_.erase(node);
+        record_.remove_node(node.get());
+        degraded_levels_.erase(node.get());
+        ++topology_version_;
         {
             std::lock_guard<std::mutex> lock(error_mutex_);
             node_errors_.erase(node->name());
         }
     }
 
+    // With the plan cache in use, a cycle is reported when the plan is
+    // built (by execution_plan() or execute()) instead of here: a cache
+    // hit is a topology already known to be acyclic, and a miss checks
+    // the whole graph once rather than searching on every edge
     void add_edge(std::shared_ptr<edge_type> edge) {
-        if (!has_cycle(edge)) {
-            edges_.insert(edge);
+        if (options_.use_plan_cache || !has_cycle(edge)) {
+            if (edges_.insert(edge).second) {
+                record_.add_edge(*edge);
+            }
+            ++topology_version_;
         } else {
             throw std::runtime_error("Adding edge would create a cycle");
         }
@@ -86,11 +118,93 @@ public:
         return thread_pool_;
     }
 
+    // Degrade acts only through the pool executors and on nodes with a
+    // precision range; choosing it where it has nothing to lower throws
+    void set_execution_options(const ExecutionOptions& options) {
+        if (options.overload_action == OverloadAction::Degrade) {
+            if (options.strategy == ExecutionStrategy::DependencyDriven) {
+                throw std::invalid_argument("OverloadAction::Degrade requires the LevelSynchronous or Dataflow strategy");
+            }
+            if (!nodes_.empty() && std::none_of(nodes_.begin(), nodes_.end(), [](const auto& node) {
+                    return node->max_precision_level() > node->min_precision_level();
+                })) {
+                throw std::invalid_argument("OverloadAction::Degrade needs a node with more than one precision level");
+            }
+        }
+        options_ = options;
+    }
+
+    const ExecutionOptions& execution_options() const {
+        return options_;
+    }
+
+    // Cold tier for the graph cache and every node's cached values: after
+    // each execution a batch-priority pass on the pool (run once no
+    // interactive work is queued) compresses values not read for
+    // options.idle_runs executions. Statistics go to options.stats, or to
+    // counters of the graph's own when it is null.
+    void set_cold_compression(ColdCompressionOptions options) requires CompressibleValue<T> {
+        if (!options.stats) {
+            options.stats = std::make_shared<CompressionStats>();
+        }
+        cold_options_ = std::move(options);
+        cache_->set_cold_compression(cold_options_);
+        for (const auto& node : nodes_) {
+            node->set_cold_compression(cold_options_);
+        }
+    }
+
+    CompressionMetrics compression_metrics() const {
+        return cold_options_.stats ? cold_options_.stats->snapshot() : CompressionMetrics{};
+    }
+
+    // Spill tier for every node's cached levels: the end-of-run pass also
+    // writes levels to the store's spill file while the nodes' resident
+    // bytes exceed its memory budget, or it reports memory pressure (see
+    // enforce_spill_budget). Spilled levels are read back when next read.
+    void set_spill_store(std::shared_ptr<SpillStore> store) requires CompressibleValue<T> {
+        spill_store_ = std::move(store);
+        for (const auto& node : nodes_) {
+            node->set_spill_store(spill_store_);
+        }
+    }
+
+    const std::shared_ptr<SpillStore>& spill_store() const {
+        return spill_store_;
+    }
+
+    // Blocks until the last queued end-of-run pass has run
+    void wait_for_cold_compression() {
+        if (cold_pass_.valid()) {
+            cold_pass_.wait();
+        }
+    }
+
+    // Topologically ordered, level-grouped view of the graph.
+    // Rebuilt lazily after nodes or edges change.
+    std::shared_ptr<const ExecutionPlan<T>> execution_plan() const {
+        std::lock_guard<std::mutex> lock(plan_mutex_);
+        refresh_plan();
+        return plan_;
+    }
+
+    // Shared topology entry behind the current plan, when the plan cache is
+    // in use
+    std::shared_ptr<const CachedTopology> cached_topology() const {
+        std::lock_guard<std::mutex> lock(plan_mutex_);
+        refresh_plan();
+        return topology_;
+    }
+
     // Accessor methods
     const std::unordered_set<std::shared_ptr<node_type>>& get_nodes() const {
         return nodes_;
     }
 
+    const std::unordered_set<std::shared_ptr<edge_type>>& get_edges() const {
+        return edges_;
+    }
+
     std::vector<std::shared_ptr<edge_type>> get_incoming_edges(const std::shared_ptr<node_type>& node) const {
         std::vector<std::shared_ptr<edge_type>> incoming;
         for (const auto& edge : edges_) {
@@ -122,16 +236,51 @@ public:
     }
 
     void set_cache_policy(std::unique_ptr<CachePolicy<T>> policy) {
-        cache_ = std::make_unique<GraphCache<T>>(std::move(policy));
+        cache_ = std::make_shared<GraphCache<T>>(std::move(policy));
+        if constexpr (CompressibleValue<T>) {
+            if (cold_options_.idle_runs > 0) {
+                cache_->set_cold_compression(cold_options_);
+            }
+        }
     }
 
     Task<void> execute() {
+        return execute(options_.priority);
+    }
+
+    // Execute with pool work queued under the given priority class
+    Task<void> execute(TaskPriority priority) {
         // Clear previous errors
         {
             std::lock_guard<std::mutex> lock(error_mutex_);
             node_errors_.clear();
         }
 
+        if (options_.strategy == ExecutionStrategy::LevelSynchronous ||
+            options_.strategy == ExecutionStrategy::Dataflow) {
+            if (!thread_pool_->admits(priority)) {
+                reject_execution(QueueFullError(priority).what());
+                co_return;
+            }
+            if (options_.overload_action == OverloadAction::Degrade) {
+                update_degradation(priority);
+            }
+
+            ThreadPool::PriorityScope scope(priority);
+            if (options_.strategy == ExecutionStrategy::LevelSynchronous) {
+                execute_level_synchronous();
+            } else {
+                execute_dataflow();
+            }
+            end_run();
+            co_return;
+        }
+
+        if (options_.use_plan_cache) {
+            // Edges were not checked for cycles as they were added
+            execution_plan();
+        }
+
         std::vector<std::pair<std::shared_ptr<node_type>, task_type>> tasks;
         std::unordered_set<std::shared_ptr<node_type>> visited;
         
@@ -180,6 +329,7 @@ public:
             }
         } while (changed);
 
+        end_run();
         co_return;
     }
 
@@ -192,6 +342,32 @@ public:
         return std::nullopt;
     }
 
+    // For executors that run the plan outside this graph (in other
+    // processes, say): clear errors as execute() does, then publish each
+    // plan node's outcome
+    void clear_node_errors() {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        node_errors_.clear();
+    }
+
+    void publish_plan_errors(
+        const ExecutionPlan<T>& plan,
+        const std::vector<std::optional<ErrorState>>& errors,
+        size_t begin,
+        size_t end
+    ) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        for (size_t i = begin; i < end; ++i) {
+            if (errors[i]) {
+                const auto& error = *errors[i];
+                if (error.source_node()) {
+                    node_errors_.try_emplace(error.source_node().value(), error);
+                }
+                node_errors_[plan.nodes[i]->name()] = error;
+            }
+        }
+    }
+
 private:
     std::shared_ptr<node_type> find_node_by_name(const std::string& name) const {
         for (const auto& node : nodes_) {
@@ -202,6 +378,25 @@ private:
         return nullptr;
     }
 
+    // Caller holds plan_mutex_
+    void refresh_plan() const {
+        if (plan_ && plan_version_ == topology_version_ && (topology_ != nullptr) == options_.use_plan_cache) {
+            return;
+        }
+        if (options_.use_plan_cache) {
+            if (record_.stale()) {
+                record_.rebuild(edges_);
+            }
+            auto lookup = PlanCache::instance().plan_for(record_, nodes_, edges_);
+            plan_ = std::move(lookup.plan);
+            topology_ = std::move(lookup.topology);
+        } else {
+            plan_ = std::make_shared<const ExecutionPlan<T>>(ExecutionPlan<T>::build(nodes_, edges_));
+            topology_.reset();
+        }
+        plan_version_ = topology_version_;
+    }
+
     bool has_cycle(std::shared_ptr<edge_type> new_edge) {
         std::unordered_set<std::shared_ptr<node_type>> visited;
         auto to_node = std::dynamic_pointer_cast<node_type>(new_edge->to());
@@ -274,8 +469,15 @@ private:
             }
         }
 
-        // Execute node computation
-        auto result = co_await node->compute();
+        // Execute node computation. A node that suspends on I/O resumes us
+        // on the thread completing it; hop back to the pool before going on.
+        auto priority = ThreadPool::current_priority();
+        auto compute = node->compute();
+        bool suspended = !compute.is_ready();
+        auto result = co_await compute;
+        if (suspended) {
+            co_await thread_pool_->schedule(priority);
+        }
         
         // Handle errors from computation
         if (result.has_error()) {
@@ -298,13 +500,376 @@ private:
         co_return result;
     }
 
+    // Queues the cold and spill tiers' end-of-run pass as batch work. The
+    // pass holds the cache, nodes and store it works on, so it may outlive
+    // the graph. A bounded pool with a full batch lane skips this run's
+    // pass rather than failing the run; the next pass catches up.
+    void end_run() {
+        if (cold_options_.idle_runs == 0 && !spill_store_) {
+            return;
+        }
+        std::vector<std::shared_ptr<node_type>> nodes(nodes_.begin(), nodes_.end());
+        ThreadPool::PriorityScope scope(TaskPriority::Batch);
+        try {
+            cold_pass_ = thread_pool_->enqueue([cache = cache_, nodes = std::move(nodes), spill = spill_store_] {
+                cache->end_run();
+                for (const auto& node : nodes) {
+                    node->end_run();
+                }
+                if (spill) {
+                    enforce_spill_budget(nodes, *spill);
+                }
+            }).share();
+        } catch (const QueueFullError&) {
+        }
+    }
+
+    // Bulk-synchronous execution: every topological level runs as a
+    // statically chunked parallel-for followed by a single barrier.
+    // Errors are propagated along plan edges as levels complete. Nodes
+    // suspended on I/O release their worker and finish back on the pool;
+    // the barrier waits for them too.
+    void execute_level_synchronous() {
+        auto plan = execution_plan();
+        std::vector<std::optional<ErrorState>> errors(plan->size());
+
+        for (size_t level = 0; level < plan->level_count(); ++level) {
+            size_t begin = plan->level_offsets[level];
+            size_t end = plan->level_offsets[level + 1];
+            std::atomic<size_t> suspended{0};
+
+            parallel_for(*thread_pool_, end - begin, options_.min_chunk_size,
+                [&](size_t chunk_begin, size_t chunk_end) {
+                    bool shed = should_shed();
+                    for (size_t i = begin + chunk_begin; i < begin + chunk_end; ++i) {
+                        if (auto error = planned_node_error(*plan, i, errors, shed)) {
+                            errors[i] = std::move(error);
+                            continue;
+                        }
+                        const auto& node = plan->nodes[i];
+                        auto compute = node->compute(planned_precision(*node));
+                        if (compute.is_ready()) {
+                            errors[i] = finish_planned_node(*node, compute.get());
+                            continue;
+                        }
+                        suspended.fetch_add(1, std::memory_order_relaxed);
+                        resume_level_node(node, std::move(compute), errors[i], suspended,
+                                          ThreadPool::current_priority());
+                    }
+                });
+
+            while (suspended.load(std::memory_order_acquire) != 0) {
+                if (!thread_pool_->run_pending_task()) {
+                    std::this_thread::yield();
+                }
+            }
+
+            // Publish this level's errors once, rather than per node
+            publish_plan_errors(*plan, errors, begin, end);
+        }
+    }
+
+    // Finish a level node once its I/O completes, back on the pool. The
+    // decrement is the last touch of the caller's state.
+    DetachedTask resume_level_node(std::shared_ptr<node_type> node, task_type compute,
+                                   std::optional<ErrorState>& error,
+                                   std::atomic<size_t>& suspended, TaskPriority priority) {
+        std::optional<compute_result_type> result;
+        std::optional<ErrorState> failure;
+        try {
+            result = co_await compute;
+        } catch (const std::exception& e) {
+            failure = ErrorState::computation_error(e.what());
+            failure->set_source_node(node->name());
+        }
+        co_await thread_pool_->schedule(priority);
+        error = result ? finish_planned_node(*node, *result) : std::move(failure);
+        suspended.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Shared state of one dataflow execution
+    struct DataflowRun {
+        std::shared_ptr<const ExecutionPlan<T>> plan;
+        std::unique_ptr<std::atomic<size_t>[]> pending_predecessors;
+        std::vector<std::optional<ErrorState>> errors;
+        std::atomic<size_t> remaining;
+    };
+
+    // Dependency-counting execution on the thread pool. A node becomes ready
+    // when its last predecessor finishes; the finishing worker continues with
+    // one ready successor itself and pushes the rest to its own deque, where
+    // idle workers can steal them. Nodes with an affinity hint for another
+    // worker are sent to that worker's deque instead.
+    void execute_dataflow() {
+        auto run = std::make_shared<DataflowRun>();
+        run->plan = execution_plan();
+        const auto& plan = *run->plan;
+        run->pending_predecessors = std::make_unique<std::atomic<size_t>[]>(plan.size());
+        for (size_t i = 0; i < plan.size(); ++i) {
+            run->pending_predecessors[i].store(plan.predecessors_of(i).size(), std::memory_order_relaxed);
+        }
+        run->errors.resize(plan.size());
+        run->remaining.store(plan.size(), std::memory_order_release);
+
+        size_t roots = plan.level_count() > 0 ? plan.level_offsets[1] : 0;
+        std::vector<size_t> ready(roots);
+        std::iota(ready.begin(), ready.end(), size_t{0});
+        dispatch_dataflow_nodes(run, ready);
+
+        while (run->remaining.load(std::memory_order_acquire) != 0) {
+            if (!thread_pool_->run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+
+        publish_plan_errors(plan, run->errors, 0, plan.size());
+    }
+
+    // Submit ready nodes. Nodes with an affinity hint go to their worker one
+    // by one; the rest are submitted as one batch so a wide fan-out takes a
+    // single queue lock and wakeup.
+    void dispatch_dataflow_nodes(const std::shared_ptr<DataflowRun>& run, const std::vector<size_t>& ready) {
+        std::vector<std::function<void()>> batch;
+        std::vector<size_t> batched;
+        for (size_t i : ready) {
+            auto task = [this, run, i]() { run_dataflow_chain(run, i); };
+            if (auto hint = run->plan->nodes[i]->affinity_hint()) {
+                try {
+                    thread_pool_->enqueue_to(*hint, std::move(task));
+                } catch (const QueueFullError& e) {
+                    reject_dataflow_node(run, i, e.what());
+                }
+            } else {
+                batch.emplace_back(std::move(task));
+                batched.push_back(i);
+            }
+        }
+        if (batch.empty()) {
+            return;
+        }
+        try {
+            if (options_.continue_on_same_worker) {
+                thread_pool_->enqueue_local_bulk(std::move(batch));
+            } else {
+                thread_pool_->enqueue_bulk(std::move(batch));
+            }
+        } catch (const QueueFullError& e) {
+            for (size_t i : batched) {
+                reject_dataflow_node(run, i, e.what());
+            }
+        }
+    }
+
+    // Only submissions from outside the pool are bounded, so this is the
+    // caller dispatching; fail the node and move on
+    void reject_dataflow_node(const std::shared_ptr<DataflowRun>& run, size_t i, const char* reason) {
+        auto error = ErrorState::resource_error(reason);
+        error.set_source_node(run->plan->nodes[i]->name());
+        run->errors[i] = std::move(error);
+        finish_dataflow_node(run, i, false);
+    }
+
+    void run_dataflow_chain(const std::shared_ptr<DataflowRun>& run, size_t i) {
+        const auto& plan = *run->plan;
+        // Only the head of a chain has been waiting in a queue
+        bool shed = should_shed();
+
+        while (true) {
+            try {
+                if (auto error = planned_node_error(plan, i, run->errors, shed)) {
+                    run->errors[i] = std::move(error);
+                } else {
+                    const auto& node = plan.nodes[i];
+                    auto compute = node->compute(planned_precision(*node));
+                    if (!compute.is_ready()) {
+                        // Suspended on I/O: free this worker; the node and
+                        // the rest of its chain carry on from the pool
+                        resume_dataflow_chain(run, i, std::move(compute), ThreadPool::current_priority());
+                        return;
+                    }
+                    run->errors[i] = finish_planned_node(*node, compute.get());
+                }
+            } catch (const std::exception& e) {
+                auto error = ErrorState::computation_error(e.what());
+                error.set_source_node(plan.nodes[i]->name());
+                run->errors[i] = std::move(error);
+            }
+
+            auto continuation = finish_dataflow_node(run, i, options_.continue_on_same_worker);
+            if (!continuation) {
+                return;
+            }
+            i = *continuation;
+            shed = false;
+        }
+    }
+
+    // Finish a dataflow node once its I/O completes, then continue its chain,
+    // back on the pool
+    DetachedTask resume_dataflow_chain(std::shared_ptr<DataflowRun> run, size_t i,
+                                       task_type compute, TaskPriority priority) {
+        const auto& node = run->plan->nodes[i];
+        std::optional<compute_result_type> result;
+        std::optional<ErrorState> failure;
+        try {
+            result = co_await compute;
+        } catch (const std::exception& e) {
+            failure = ErrorState::computation_error(e.what());
+            failure->set_source_node(node->name());
+        }
+        co_await thread_pool_->schedule(priority);
+        run->errors[i] = result ? finish_planned_node(*node, *result) : std::move(failure);
+
+        auto continuation = finish_dataflow_node(run, i, options_.continue_on_same_worker);
+        if (continuation) {
+            run_dataflow_chain(run, *continuation);
+        }
+    }
+
+    // Release the successors of a finished node. With continue_inline, the
+    // first ready successor that may run on this worker is returned for the
+    // caller to run next instead of being dispatched.
+    std::optional<size_t> finish_dataflow_node(
+        const std::shared_ptr<DataflowRun>& run, size_t i, bool continue_inline) {
+        const auto& plan = *run->plan;
+        auto worker = thread_pool_->current_worker_index();
+
+        std::optional<size_t> continuation;
+        std::vector<size_t> ready;
+        for (size_t succ : plan.successors_of(i)) {
+            if (run->pending_predecessors[succ].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                continue;
+            }
+            auto hint = plan.nodes[succ]->affinity_hint();
+            bool local = !hint || (worker && *hint % thread_pool_->thread_count() == *worker);
+            if (!continuation && local && continue_inline) {
+                continuation = succ;
+            } else {
+                ready.push_back(succ);
+            }
+        }
+        dispatch_dataflow_nodes(run, ready);
+
+        run->remaining.fetch_sub(1, std::memory_order_acq_rel);
+        return continuation;
+    }
+
+    // Fail every node of an execution the pool refused to admit
+    void reject_execution(const std::string& reason) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        for (const auto& node : nodes_) {
+            auto error = ErrorState::resource_error(reason);
+            error.set_source_node(node->name());
+            node_errors_[node->name()] = std::move(error);
+        }
+    }
+
+    bool should_shed() const {
+        return options_.overload_action == OverloadAction::Shed &&
+               ThreadPool::current_queue_delay() > options_.queue_delay_target;
+    }
+
+    // Step node precision down one level per execution while the pool's
+    // recent queue delay for this class exceeds the target, and back up one
+    // level per execution once it has fallen below half the target
+    void update_degradation(TaskPriority priority) {
+        auto delay = thread_pool_->recent_queue_delay(priority);
+        if (delay > options_.queue_delay_target) {
+            for (const auto& node : nodes_) {
+                if (degraded_precision(*node) > node->min_precision_level()) {
+                    ++degraded_levels_[node.get()];
+                }
+            }
+        } else if (delay < options_.queue_delay_target / 2) {
+            for (auto it = degraded_levels_.begin(); it != degraded_levels_.end();) {
+                if (--it->second == 0) {
+                    it = degraded_levels_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // Error of a plan node whose predecessors have all completed that is
+    // not to be computed: inherited from a failed predecessor, or shed
+    std::optional<ErrorState> planned_node_error(
+        const ExecutionPlan<T>& plan,
+        size_t i,
+        const std::vector<std::optional<ErrorState>>& errors,
+        bool shed
+    ) const {
+        const auto& node = plan.nodes[i];
+
+        for (size_t pred : plan.predecessors_of(i)) {
+            if (errors[pred]) {
+                auto error = *errors[pred];
+                error.add_propagation_path(node->name());
+                return error;
+            }
+        }
+
+        if (shed) {
+            auto error = ErrorState::resource_error("Shed after exceeding the queue delay target");
+            error.set_source_node(node->name());
+            return error;
+        }
+        return std::nullopt;
+    }
+
+    size_t planned_precision(const node_type& node) const {
+        return options_.overload_action == OverloadAction::Degrade ? degraded_precision(node) : 0;
+    }
+
+    // Degrading executions compute at each node's maximum precision level,
+    // less the levels overload has taken, never below its minimum
+    size_t degraded_precision(const node_type& node) const {
+        size_t level = node.max_precision_level();
+        if (auto it = degraded_levels_.find(&node); it != degraded_levels_.end()) {
+            level -= std::min(level, it->second);
+        }
+        return std::max(level, node.min_precision_level());
+    }
+
+    // Returns a computed plan node's error, if any, instead of publishing
+    // it, and caches its value otherwise
+    std::optional<ErrorState> finish_planned_node(const node_type& node, const compute_result_type& result) {
+        if (result.has_error()) {
+            auto error = result.error();
+            if (!error.source_node()) {
+                error.set_source_node(node.name());
+            }
+            return error;
+        }
+
+        if (cache_) {
+            const auto& value = result.value();
+            if (auto cached = cache_->get(value); !cached.has_value()) {
+                cache_->store(value);
+            }
+        }
+        return std::nullopt;
+    }
+
     std::unordered_set<std::shared_ptr<node_type>> nodes_;
     std::unordered_set<std::shared_ptr<edge_type>> edges_;
-    std::unique_ptr<GraphCache<T>> cache_;
+    ExecutionOptions options_;
+    size_t topology_version_ = 0;
+    mutable std::mutex plan_mutex_;
+    mutable std::shared_ptr<const ExecutionPlan<T>> plan_;
+    mutable std::shared_ptr<const CachedTopology> topology_;
+    mutable TopologyRecord<T> record_;
+    mutable size_t plan_version_ = 0;
+    std::shared_ptr<GraphCache<T>> cache_;
     std::shared_ptr<ThreadPool> thread_pool_;
+    ColdCompressionOptions cold_options_;
+    std::shared_ptr<SpillStore> spill_store_;
+    std::shared_future<void> cold_pass_;
     mutable std::mutex error_mutex_;
     std::unordered_map<std::string, ErrorState> node_errors_;
     std::vector<std::unique_ptr<OptimizationPass<T>>> optimization_passes_;
+    // Levels each node's precision has been lowered by overload degradation
+    std::unordered_map<const node_type*, size_t> degraded_levels_;
 };
 
 } // namespace flowgraph
@@ -92,10 +92,67 @@ void Node<T>::merge_updates() {
 
 template<typename T>
     requires NodeValue<T>
-Task<ComputeResult<T>> Node<T>::compute(size_t precision_level) {
+void Node<T>::set_storage_formats(std::vector<StorageFormat> formats) requires PackableNumeric<T> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_storage_.set_storage_formats(std::move(formats));
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::set_level_encoding(LevelEncoding encoding) requires PackableNumeric<T> {
     std::lock_guard<std::mutex> lock(mutex_);
-    
+    value_storage_.set_level_encoding(encoding);
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::set_cold_compression(ColdCompressionOptions options) requires CompressibleValue<T> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_storage_.set_cold_compression(std::move(options));
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::end_run() {
+    value_storage_.end_run();
+}
+
+template<typename T>
+    requires NodeValue<T>
+size_t Node<T>::memory_bytes() const {
+    return value_storage_.memory_bytes();
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::set_spill_store(std::shared_ptr<SpillStore> store) requires CompressibleValue<T> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    value_storage_.set_spill_store(std::move(store));
+}
+
+template<typename T>
+    requires NodeValue<T>
+std::vector<LevelUsage> Node<T>::level_usage() const {
+    return value_storage_.level_usage();
+}
+
+template<typename T>
+    requires NodeValue<T>
+size_t Node<T>::spill_level(size_t level) {
+    return value_storage_.spill_level(level);
+}
+
+template<typename T>
+    requires NodeValue<T>
+Task<ComputeResult<T>> Node<T>::compute(size_t precision_level) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool computing = false;
+
     try {
+        if (imported_) {
+            co_return *imported_;
+        }
+
         if (parent_graph_) {
             if (auto error = parent_graph_->get_node_error(name_)) {
                 co_return ComputeResult<T>(std::move(*error));
@@ -116,8 +173,21 @@ Task<ComputeResult<T>> Node<T>::compute(size_t precision_level) {
             co_return ComputeResult<T>(cached.value());
         }
 
+        if (auto it = pending_.find(precision_level); it != pending_.end()) {
+            auto pending = it->second;
+            co_await PendingAwaiter{pending, lock};
+            // The result is set once, before any waiter resumes
+            co_return *pending->result;
+        }
+        pending_[precision_level] = std::make_shared<PendingCompute>();
+        computing = true;
+
+        // compute_impl may suspend and resume on another thread (an I/O
+        // reactor's, say), and a mutex must be unlocked by its owner
+        lock.unlock();
         auto result = co_await compute_impl(precision_level);
-        
+        lock.lock();
+
         if (result.has_error()) {
             auto error = result.error();
             if (!error.source_node() || error.source_node().value() != name_) {
@@ -125,7 +195,9 @@ Task<ComputeResult<T>> Node<T>::compute(size_t precision_level) {
             } else {
                 error.set_source_node(name_);
             }
-            co_return ComputeResult<T>(std::move(error));
+            ComputeResult<T> failed(std::move(error));
+            complete_pending(lock, precision_level, failed);
+            co_return failed;
         }
 
         value_storage_.store(result.value(), precision_level);
@@ -138,12 +210,39 @@ Task<ComputeResult<T>> Node<T>::compute(size_t precision_level) {
             value_storage_.merge_all();
         }
 
+        complete_pending(lock, precision_level, result);
         co_return result;
     }
     catch (const std::exception& e) {
         auto error = ErrorState::computation_error(e.what());
         error.set_source_node(name_);
-        co_return ComputeResult<T>(std::move(error));
+        ComputeResult<T> failed(std::move(error));
+        if (computing) {
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            complete_pending(lock, precision_level, failed);
+        }
+        co_return failed;
+    }
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::complete_pending(std::unique_lock<std::mutex>& lock, size_t precision_level,
+                               const ComputeResult<T>& result) {
+    auto it = pending_.find(precision_level);
+    if (it == pending_.end()) {
+        lock.unlock();
+        return;
+    }
+    auto pending = std::move(it->second);
+    pending_.erase(it);
+    pending->result = result;
+    auto waiters = std::move(pending->waiters);
+    lock.unlock();
+    for (auto waiter : waiters) {
+        waiter.resume();
     }
 }
 
@@ -154,4 +253,66 @@ void Node<T>::add_completion_callback(callback_type callback) {
     completion_callbacks_.push_back(std::move(callback));
 }
 
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::import_result(ComputeResult<T> result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    imported_ = std::move(result);
+    if (!imported_->has_error()) {
+        for (const auto& callback : completion_callbacks_) {
+            callback(*imported_);
+        }
+    }
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::clear_imported_result() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    imported_.reset();
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::enable_approximate_memo(size_t capacity, std::optional<double> tolerance) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memo_ = std::make_unique<ApproximateMemo<T>>(
+        tolerance.value_or(value_storage_.compression_threshold()), capacity);
+}
+
+template<typename T>
+    requires NodeValue<T>
+std::optional<ApproximateMemoMetrics> Node<T>::approximate_memo_metrics() const {
+    return memo_ ? std::optional(memo_->metrics()) : std::nullopt;
+}
+
+template<typename T>
+    requires NodeValue<T>
+template<typename F>
+ComputeResult<T> Node<T>::memoize(std::span<const double> inputs, size_t precision_level, F&& compute) {
+    if (!memo_) {
+        return ComputeResult<T>(std::forward<F>(compute)());
+    }
+    if (auto cached = memo_->find(inputs, precision_level)) {
+        return ComputeResult<T>(std::move(*cached));
+    }
+    ComputeResult<T> result(std::forward<F>(compute)());
+    if (!result.has_error()) {
+        memo_->insert(inputs, precision_level, result.value());
+    }
+    return result;
+}
+
+template<typename T>
+    requires NodeValue<T>
+void Node<T>::set_affinity_hint(std::optional<size_t> worker) {
+    affinity_hint_ = worker;
+}
+
+template<typename T>
+    requires NodeValue<T>
+std::optional<size_t> Node<T>::affinity_hint() const {
+    return affinity_hint_;
+}
+
 } // namespace flowgraph
@@ -2,10 +2,20 @@
 #include "forward_decl.hpp"
 #include "concepts.hpp"
 #include "base.hpp"
+#include "compute_result.hpp"
+#include "precision_storage.hpp"
+#include "../cache/approximate_memo.hpp"
+#include "../cache/spill_store.hpp"
+#include "../cache/value_compression.hpp"
 #include "../async/task.hpp"
+#include <coroutine>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace flowgraph {
@@ -33,11 +43,78 @@ public:
     [[nodiscard]] Task<ComputeResult<T>> compute(size_t precision_level = 0);
     void add_completion_callback(callback_type callback);
 
+    // Adopt a result computed elsewhere (another process or host): compute()
+    // returns it instead of running compute_impl until cleared. Successful
+    // results are reported to completion callbacks as if computed here.
+    void import_result(ComputeResult<T> result);
+    void clear_imported_result();
+
+    // Storage formats and level encoding of cached values, for numeric
+    // containers (see FractalTreeNode)
+    void set_storage_formats(std::vector<StorageFormat> formats) requires PackableNumeric<T>;
+    void set_level_encoding(LevelEncoding encoding) requires PackableNumeric<T>;
+
+    // Cold tier of cached values (see FractalTreeNode::end_run). end_run
+    // does not take the node's lock, so computations are not held up.
+    void set_cold_compression(ColdCompressionOptions options) requires CompressibleValue<T>;
+    void end_run();
+    size_t memory_bytes() const;
+
+    // Spill tier of cached values (see FractalTreeNode::spill_level)
+    void set_spill_store(std::shared_ptr<SpillStore> store) requires CompressibleValue<T>;
+    std::vector<LevelUsage> level_usage() const;
+    size_t spill_level(size_t level);
+
+    // Approximate memo of the results of compute_impl implementations that
+    // go through memoize(): inputs within tolerance (by default the
+    // compression threshold) of memoized ones reuse their result at the
+    // same precision level (see ApproximateMemo). Enable before computing.
+    void enable_approximate_memo(size_t capacity = 1024, std::optional<double> tolerance = std::nullopt);
+    std::optional<ApproximateMemoMetrics> approximate_memo_metrics() const;
+
+    // Preferred ThreadPool worker for this node (a scheduling hint only)
+    void set_affinity_hint(std::optional<size_t> worker);
+    std::optional<size_t> affinity_hint() const;
+
 protected:
     virtual Task<ComputeResult<T>> compute_impl(size_t precision_level) = 0;
 
+    // For compute_impl: the memoized result for inputs (the values it
+    // computes from, flattened) or else compute()'s, memoized if it is not
+    // an error. Without an approximate memo, just compute().
+    template<typename F>
+    ComputeResult<T> memoize(std::span<const double> inputs, size_t precision_level, F&& compute);
+
 private:
+    // A computation of a level in progress. compute() calls for the same
+    // level made meanwhile await its result instead of computing again.
+    struct PendingCompute {
+        std::optional<ComputeResult<T>> result;
+        std::vector<std::coroutine_handle<>> waiters;
+    };
+
+    // Suspends on a PendingCompute, releasing the node's lock (held on
+    // entry) once registered; resumes, without the lock, on the thread
+    // that completes it
+    struct PendingAwaiter {
+        std::shared_ptr<PendingCompute> pending;
+        std::unique_lock<std::mutex>& lock;
+
+        bool await_ready() const noexcept { return pending->result.has_value(); }
+        void await_suspend(std::coroutine_handle<> waiter) {
+            // Disown the lock before the waiter can be resumed elsewhere
+            auto* mutex = lock.release();
+            pending->waiters.push_back(waiter);
+            mutex->unlock();
+        }
+        void await_resume() const noexcept {}
+    };
+
     bool should_merge_updates();
+    // Publishes the result of the pending computation of a level and
+    // resumes its waiters; lock is held on entry and released on return
+    void complete_pending(std::unique_lock<std::mutex>& lock, size_t precision_level,
+                          const ComputeResult<T>& result);
 
     std::string name_;
     std::mutex mutex_;
@@ -48,6 +125,10 @@ private:
     size_t max_precision_level_;
     size_t computation_count_ = 0;
     IGraph* parent_graph_ = nullptr;
+    std::optional<size_t> affinity_hint_;
+    std::optional<ComputeResult<T>> imported_;
+    std::unique_ptr<ApproximateMemo<T>> memo_;
+    std::unordered_map<size_t, std::shared_ptr<PendingCompute>> pending_;
 };
 
 } // namespace flowgraph
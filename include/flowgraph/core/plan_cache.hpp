@@ -0,0 +1,317 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "execution_plan.hpp"
+#include "node.hpp"
+#include "edge.hpp"
+
+namespace flowgraph {
+
+// Structural form of a graph as it was built: the kind (dynamic type) of
+// each node in the order nodes were added and the edges between those
+// positions. Graphs built alike (by the same code, per request) have
+// equal forms whatever their node names, parameters or values, and graphs
+// with equal forms are isomorphic through the positions. The hash folds
+// in each addition; it only has to be equal for graphs built alike, since
+// equality also compares the kinds and edges.
+struct TopologyForm {
+    std::vector<std::type_index> kinds;
+    std::vector<std::pair<size_t, size_t>> edges;
+    uint64_t hash = 0;
+
+    bool operator==(const TopologyForm& other) const {
+        return hash == other.hash && kinds == other.kinds && edges == other.edges;
+    }
+};
+
+namespace topology {
+
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline uint64_t combine(uint64_t seed, uint64_t value) {
+    return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+} // namespace topology
+
+// A graph's nodes in build order and its TopologyForm, kept up to date as
+// nodes and edges are added at O(1) each, so looking a graph up in the
+// PlanCache costs a hash probe rather than an analysis of the graph.
+// Removing a node, or adding an edge before one of its endpoints, leaves
+// the record stale until rebuild().
+template<typename T>
+class TopologyRecord {
+public:
+    void add_node(const std::shared_ptr<Node<T>>& node) {
+        position_.emplace(node.get(), nodes_.size());
+        nodes_.push_back(node);
+        form_.kinds.emplace_back(typeid(*node));
+        form_.hash = topology::combine(form_.hash, form_.kinds.back().hash_code());
+    }
+
+    void add_edge(const Edge<T>& edge) {
+        auto from = position_.find(edge.from().get());
+        auto to = position_.find(edge.to().get());
+        if (from == position_.end() || to == position_.end()) {
+            // Not part of the graph yet; ExecutionPlan::build ignores it
+            // until both endpoints are
+            stale_ = true;
+            return;
+        }
+        form_.edges.emplace_back(from->second, to->second);
+        form_.hash = topology::combine(topology::combine(form_.hash, ~from->second), to->second);
+    }
+
+    void remove_node(const NodeBase* node) {
+        // Positions shift, so searched for rather than looked up
+        auto it = std::find_if(nodes_.begin(), nodes_.end(),
+                               [node](const auto& candidate) { return candidate.get() == node; });
+        if (it == nodes_.end()) {
+            return;
+        }
+        nodes_.erase(it);
+        stale_ = true;
+    }
+
+    bool stale() const { return stale_; }
+
+    // Recompute positions and form over the remaining nodes and the
+    // graph's edges. The edges are replayed by position, not in set order,
+    // so identical graphs rebuild to identical forms.
+    void rebuild(const std::unordered_set<std::shared_ptr<Edge<T>>>& edges) {
+        auto nodes = std::move(nodes_);
+        nodes_.clear();
+        position_.clear();
+        form_ = {};
+        stale_ = false;
+        for (const auto& node : nodes) {
+            add_node(node);
+        }
+        std::vector<std::pair<size_t, size_t>> positions;
+        positions.reserve(edges.size());
+        for (const auto& edge : edges) {
+            auto from = position_.find(edge->from().get());
+            auto to = position_.find(edge->to().get());
+            if (from == position_.end() || to == position_.end()) {
+                stale_ = true;
+                continue;
+            }
+            positions.emplace_back(from->second, to->second);
+        }
+        std::sort(positions.begin(), positions.end());
+        for (const auto& [from, to] : positions) {
+            form_.edges.emplace_back(from, to);
+            form_.hash = topology::combine(topology::combine(form_.hash, ~from), to);
+        }
+    }
+
+    const TopologyForm& form() const { return form_; }
+    const std::vector<std::shared_ptr<Node<T>>>& nodes() const { return nodes_; }
+    size_t position(const NodeBase* node) const { return position_.at(node); }
+
+private:
+    std::vector<std::shared_ptr<Node<T>>> nodes_;
+    std::unordered_map<const NodeBase*, size_t> position_;
+    TopologyForm form_;
+    bool stale_ = false;
+};
+
+// An execution plan in TopologyForm positions, shared by every graph with
+// the same form
+class CachedTopology {
+public:
+    CachedTopology(TopologyForm form, std::vector<size_t> order, std::vector<size_t> level_offsets,
+                   std::vector<size_t> predecessor_offsets, std::vector<size_t> predecessors,
+                   std::vector<size_t> successor_offsets, std::vector<size_t> successors)
+        : form_(std::move(form))
+        , order_(std::move(order))
+        , level_offsets_(std::move(level_offsets))
+        , predecessor_offsets_(std::move(predecessor_offsets))
+        , predecessors_(std::move(predecessors))
+        , successor_offsets_(std::move(successor_offsets))
+        , successors_(std::move(successors)) {}
+
+    template<typename T>
+    static std::shared_ptr<const CachedTopology> from_plan(const TopologyRecord<T>& record,
+                                                           const ExecutionPlan<T>& plan) {
+        std::vector<size_t> order(plan.size());
+        for (size_t p = 0; p < plan.size(); ++p) {
+            order[p] = record.position(plan.nodes[p].get());
+        }
+        return std::make_shared<const CachedTopology>(record.form(), std::move(order), plan.level_offsets,
+            plan.predecessor_offsets, plan.predecessors, plan.successor_offsets, plan.successors);
+    }
+
+    const TopologyForm& form() const { return form_; }
+
+    // The plan over a graph's nodes in build order
+    template<typename T>
+    ExecutionPlan<T> instantiate(const std::vector<std::shared_ptr<Node<T>>>& nodes) const {
+        ExecutionPlan<T> plan;
+        plan.nodes.reserve(order_.size());
+        plan.index.reserve(order_.size());
+        for (size_t p = 0; p < order_.size(); ++p) {
+            plan.nodes.push_back(nodes[order_[p]]);
+            plan.index.emplace(plan.nodes.back().get(), p);
+        }
+        plan.level_offsets = level_offsets_;
+        plan.predecessor_offsets = predecessor_offsets_;
+        plan.predecessors = predecessors_;
+        plan.successor_offsets = successor_offsets_;
+        plan.successors = successors_;
+        return plan;
+    }
+
+private:
+    TopologyForm form_;
+    std::vector<size_t> order_;
+    std::vector<size_t> level_offsets_;
+    std::vector<size_t> predecessor_offsets_;
+    std::vector<size_t> predecessors_;
+    std::vector<size_t> successor_offsets_;
+    std::vector<size_t> successors_;
+};
+
+// Snapshot of a PlanCache's activity
+struct PlanCacheMetrics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+
+    double hit_rate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// Process-wide cache of execution plans keyed by TopologyForm, so graphs
+// built repeatedly in the same shape (per request, with different
+// parameters) skip topological sorting and cycle detection. Graphs use
+// it when ExecutionOptions::use_plan_cache is set; they then leave cycle
+// detection to the plan build of a miss instead of searching on every
+// added edge. Least recently used topologies are evicted beyond the
+// capacity.
+class PlanCache {
+public:
+    explicit PlanCache(size_t capacity = 1024) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    static PlanCache& instance() {
+        static PlanCache cache;
+        return cache;
+    }
+
+    template<typename T>
+    struct Lookup {
+        std::shared_ptr<const ExecutionPlan<T>> plan;
+        std::shared_ptr<const CachedTopology> topology;
+    };
+
+    // Plan for a graph's contents, described by an up-to-date (not stale)
+    // record of them; built and cached on a miss
+    template<typename T>
+    Lookup<T> plan_for(const TopologyRecord<T>& record,
+                       const std::unordered_set<std::shared_ptr<Node<T>>>& nodes,
+                       const std::unordered_set<std::shared_ptr<Edge<T>>>& edges) {
+        if (auto topology = find(record.form())) {
+            return {std::make_shared<const ExecutionPlan<T>>(topology->instantiate(record.nodes())), topology};
+        }
+        // Built outside the lock; throws on cycles, which are never cached
+        auto plan = std::make_shared<const ExecutionPlan<T>>(ExecutionPlan<T>::build(nodes, edges));
+        auto topology = insert(CachedTopology::from_plan(record, *plan));
+        return {std::move(plan), std::move(topology)};
+    }
+
+    PlanCacheMetrics metrics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PlanCacheMetrics metrics = metrics_;
+        metrics.entries = lru_.size();
+        return metrics;
+    }
+
+    void set_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = std::max<size_t>(capacity, 1);
+        evict();
+    }
+
+    // Drop every entry and reset the metrics
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        by_hash_.clear();
+        metrics_ = {};
+    }
+
+private:
+    using Entries = std::list<std::shared_ptr<const CachedTopology>>;
+
+    std::shared_ptr<const CachedTopology> find(const TopologyForm& form) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [begin, end] = by_hash_.equal_range(form.hash);
+        for (auto it = begin; it != end; ++it) {
+            if ((*it->second)->form() == form) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                ++metrics_.hits;
+                return *it->second;
+            }
+        }
+        ++metrics_.misses;
+        return nullptr;
+    }
+
+    std::shared_ptr<const CachedTopology> insert(std::shared_ptr<const CachedTopology> topology) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Another graph may have cached the same topology meanwhile
+        auto [begin, end] = by_hash_.equal_range(topology->form().hash);
+        for (auto it = begin; it != end; ++it) {
+            if ((*it->second)->form() == topology->form()) {
+                return *it->second;
+            }
+        }
+        lru_.push_front(topology);
+        by_hash_.emplace(topology->form().hash, lru_.begin());
+        evict();
+        return topology;
+    }
+
+    void evict() {
+        while (lru_.size() > capacity_) {
+            auto last = std::prev(lru_.end());
+            auto [begin, end] = by_hash_.equal_range((*last)->form().hash);
+            for (auto it = begin; it != end; ++it) {
+                if (it->second == last) {
+                    by_hash_.erase(it);
+                    break;
+                }
+            }
+            lru_.erase(last);
+            ++metrics_.evictions;
+        }
+    }
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    Entries lru_;
+    std::unordered_multimap<uint64_t, Entries::iterator> by_hash_;
+    PlanCacheMetrics metrics_;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,650 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FLOWGRAPH_X86_SIMD 1
+#endif
+
+namespace flowgraph {
+
+// Element types of numeric containers stored in reduced precision
+template<typename E>
+concept PackableElement = std::same_as<E, float> || std::same_as<E, double>;
+
+// Contiguous, resizable containers of float or double (std::vector, say)
+template<typename T>
+concept PackableNumeric = std::ranges::contiguous_range<T> &&
+                          PackableElement<std::ranges::range_value_t<T>> &&
+                          requires(T& c, size_t n) { c.resize(n); };
+
+// Formats from coarsest to finest. Int8 is symmetric with one scale per
+// buffer; BFloat16 keeps float's range with an 8-bit significand, Float16
+// an 11-bit significand up to 65504.
+enum class StorageFormat : uint8_t {
+    Int8,
+    BFloat16,
+    Float16,
+    Float32,
+    Float64
+};
+
+inline size_t element_bytes(StorageFormat format) {
+    switch (format) {
+        case StorageFormat::Int8: return 1;
+        case StorageFormat::BFloat16:
+        case StorageFormat::Float16: return 2;
+        case StorageFormat::Float32: return 4;
+        case StorageFormat::Float64: return 8;
+    }
+    return 8;
+}
+
+inline const char* to_string(StorageFormat format) {
+    switch (format) {
+        case StorageFormat::Int8: return "int8";
+        case StorageFormat::BFloat16: return "bf16";
+        case StorageFormat::Float16: return "fp16";
+        case StorageFormat::Float32: return "fp32";
+        case StorageFormat::Float64: return "fp64";
+    }
+    return "unknown";
+}
+
+template<PackableElement E>
+constexpr StorageFormat native_storage_format() {
+    return std::same_as<E, float> ? StorageFormat::Float32 : StorageFormat::Float64;
+}
+
+// One format per level 0..max_depth: int8 at the bottom, then bf16 and
+// fp16, fp32 through the middle and fp64 at the top
+inline std::vector<StorageFormat> tiered_storage_formats(size_t max_depth) {
+    std::vector<StorageFormat> formats;
+    for (size_t level = 0; level <= max_depth; ++level) {
+        size_t position = max_depth == 0 ? 8 : level * 8 / max_depth;
+        if (position == 0) formats.push_back(StorageFormat::Int8);
+        else if (position == 1) formats.push_back(StorageFormat::BFloat16);
+        else if (position == 2) formats.push_back(StorageFormat::Float16);
+        else if (position <= 5) formats.push_back(StorageFormat::Float32);
+        else formats.push_back(StorageFormat::Float64);
+    }
+    return formats;
+}
+
+// How FractalTreeNode holds the levels of numeric container values
+enum class LevelEncoding {
+    Absolute,  // Every level in full
+    Delta      // Lowest level in full, higher ones as quantized residuals
+};
+
+// Conversion kernels between float and the narrow formats. The dispatched
+// functions use AVX2 (with F16C) when the CPU has it and produce exactly
+// the scalar functions' results, bar NaN payloads.
+namespace packing {
+
+namespace scalar {
+
+// Round to nearest even, overflowing to infinity
+inline uint16_t to_half(float value) {
+    const uint32_t f16_max = (127u + 16u) << 23;
+    const float denormal_magic = std::bit_cast<float>(((127u - 15u) + (23u - 10u) + 1u) << 23);
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    uint32_t half;
+    if (bits >= f16_max) {
+        half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    } else if (bits < (113u << 23)) {
+        // Subnormal or zero: let the FPU round the shifted significand
+        half = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) + denormal_magic) -
+               std::bit_cast<uint32_t>(denormal_magic);
+    } else {
+        const uint32_t odd = (bits >> 13) & 1u;
+        bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu + odd;
+        half = bits >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+inline float from_half(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1fu;
+    const uint32_t mantissa = half & 0x3ffu;
+    if (exponent == 0) {
+        return std::bit_cast<float>(std::bit_cast<uint32_t>(static_cast<float>(mantissa) * 0x1p-24f) | sign);
+    }
+    if (exponent == 0x1f) {
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+inline uint16_t to_bfloat(float value) {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    if (std::isnan(value)) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u);
+    }
+    return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+inline float from_bfloat(uint16_t bfloat) {
+    return std::bit_cast<float>(static_cast<uint32_t>(bfloat) << 16);
+}
+
+// NaN quantizes to zero and infinities to the ends of the range
+inline int8_t to_int8(float value, float inverse_scale) {
+    float q = value * inverse_scale;
+    if (std::isnan(q)) {
+        return 0;
+    }
+    return static_cast<int8_t>(std::nearbyint(std::clamp(q, -127.0f, 127.0f)));
+}
+
+inline void narrow(const double* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(in[i]);
+}
+
+inline void widen(const float* in, double* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = in[i];
+}
+
+inline void to_half(const float* in, uint16_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = to_half(in[i]);
+}
+
+inline void from_half(const uint16_t* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = from_half(in[i]);
+}
+
+inline void to_bfloat(const float* in, uint16_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = to_bfloat(in[i]);
+}
+
+inline void from_bfloat(const uint16_t* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = from_bfloat(in[i]);
+}
+
+// Largest finite magnitude
+inline float max_magnitude(const float* in, size_t n) {
+    float max = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float magnitude = std::abs(in[i]);
+        if (magnitude < std::numeric_limits<float>::infinity()) {
+            max = std::max(max, magnitude);
+        }
+    }
+    return max;
+}
+
+inline void to_int8(const float* in, int8_t* out, size_t n, float inverse_scale) {
+    for (size_t i = 0; i < n; ++i) out[i] = to_int8(in[i], inverse_scale);
+}
+
+inline void from_int8(const int8_t* in, float* out, size_t n, float scale) {
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(in[i]) * scale;
+}
+
+// Multiples of 1 / inverse, rounded to nearest even; false if one is
+// 2^51 or more from zero (or not finite). Adding and subtracting 1.5 * 2^52
+// rounds without a libm call.
+inline bool to_steps(const double* in, int64_t* out, size_t n, double inverse) {
+    const double magic = 0x1.8p52;
+    bool representable = true;
+    for (size_t i = 0; i < n; ++i) {
+        double count = in[i] * inverse;
+        representable &= std::abs(count) < 0x1p51;
+        out[i] = static_cast<int64_t>((count + magic) - magic);
+    }
+    return representable;
+}
+
+inline void from_steps(const int64_t* in, double* out, size_t n, double step) {
+    for (size_t i = 0; i < n; ++i) out[i] = static_cast<double>(in[i]) * step;
+}
+
+template<typename I>
+void add_steps(int64_t* steps, const I* in, size_t n) {
+    for (size_t i = 0; i < n; ++i) steps[i] += in[i];
+}
+
+} // namespace scalar
+
+#ifdef FLOWGRAPH_X86_SIMD
+
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline void narrow(const double* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(in + i)));
+    }
+    scalar::narrow(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void widen(const float* in, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+    }
+    scalar::widen(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) inline void to_half(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), half);
+    }
+    scalar::to_half(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) inline void from_half(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    }
+    scalar::from_half(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i bfloat_bits(__m256 value) {
+    const __m256i bits = _mm256_castps_si256(value);
+    const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff))), 16);
+    const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+    const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_UNORD_Q));
+    return _mm256_blendv_epi8(rounded, quiet, nan);
+}
+
+__attribute__((target("avx2"))) inline void to_bfloat(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i low = bfloat_bits(_mm256_loadu_ps(in + i));
+        __m256i high = bfloat_bits(_mm256_loadu_ps(in + i + 8));
+        // Packing works within 128-bit lanes; restore element order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    scalar::to_bfloat(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void from_bfloat(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+    }
+    scalar::from_bfloat(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline float max_magnitude(const float* in, size_t n) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256 max = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 magnitude = _mm256_andnot_ps(sign, _mm256_loadu_ps(in + i));
+        __m256 finite = _mm256_cmp_ps(magnitude, infinity, _CMP_LT_OQ);
+        max = _mm256_max_ps(max, _mm256_and_ps(magnitude, finite));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, max);
+    return std::max(*std::max_element(lanes, lanes + 8), scalar::max_magnitude(in + i, n - i));
+}
+
+__attribute__((target("avx2"))) inline __m256i int8_lanes(const float* in, __m256 inverse_scale) {
+    __m256 q = _mm256_mul_ps(_mm256_loadu_ps(in), inverse_scale);
+    __m256 ordered = _mm256_cmp_ps(q, q, _CMP_ORD_Q);
+    q = _mm256_min_ps(_mm256_max_ps(q, _mm256_set1_ps(-127.0f)), _mm256_set1_ps(127.0f));
+    return _mm256_cvtps_epi32(_mm256_and_ps(q, ordered));
+}
+
+__attribute__((target("avx2"))) inline void to_int8(const float* in, int8_t* out, size_t n, float inverse_scale) {
+    const __m256 inverse = _mm256_set1_ps(inverse_scale);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i ab = _mm256_packs_epi32(int8_lanes(in + i, inverse), int8_lanes(in + i + 8, inverse));
+        __m256i cd = _mm256_packs_epi32(int8_lanes(in + i + 16, inverse), int8_lanes(in + i + 24, inverse));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(ab, cd), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    scalar::to_int8(in + i, out + i, n - i, inverse_scale);
+}
+
+__attribute__((target("avx2"))) inline void from_int8(const int8_t* in, float* out, size_t n, float scale) {
+    const __m256 factor = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i wide = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), factor));
+    }
+    scalar::from_int8(in + i, out + i, n - i, scale);
+}
+
+// Step counts below 2^51 move between doubles and integers by offsetting
+// the bits of 1.5 * 2^52
+__attribute__((target("avx2"))) inline bool to_steps(const double* in, int64_t* out, size_t n, double inverse) {
+    const __m256d magic = _mm256_set1_pd(0x1.8p52);
+    const __m256d factor = _mm256_set1_pd(inverse);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d limit = _mm256_set1_pd(0x1p51);
+    __m256d representable = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d count = _mm256_mul_pd(_mm256_loadu_pd(in + i), factor);
+        representable = _mm256_and_pd(representable, _mm256_cmp_pd(_mm256_andnot_pd(sign, count), limit, _CMP_LT_OQ));
+        __m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(count, magic)), _mm256_castpd_si256(magic));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), bits);
+    }
+    bool tail = scalar::to_steps(in + i, out + i, n - i, inverse);
+    return tail && _mm256_movemask_pd(representable) == 0xf;
+}
+
+__attribute__((target("avx2"))) inline void from_steps(const int64_t* in, double* out, size_t n, double step) {
+    const __m256d magic = _mm256_set1_pd(0x1.8p52);
+    const __m256d factor = _mm256_set1_pd(step);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i bits = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)),
+                                        _mm256_castpd_si256(magic));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_sub_pd(_mm256_castsi256_pd(bits), magic), factor));
+    }
+    scalar::from_steps(in + i, out + i, n - i, step);
+}
+
+template<typename I>
+__attribute__((target("avx2"))) void add_steps(int64_t* steps, const I* in, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i wide;
+        if constexpr (sizeof(I) == 1) {
+            int32_t packed;
+            std::memcpy(&packed, in + i, sizeof(packed));
+            wide = _mm256_cvtepi8_epi64(_mm_cvtsi32_si128(packed));
+        } else if constexpr (sizeof(I) == 2) {
+            wide = _mm256_cvtepi16_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+        } else {
+            wide = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        }
+        auto* out = reinterpret_cast<__m256i*>(steps + i);
+        _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), wide));
+    }
+    scalar::add_steps(steps + i, in + i, n - i);
+}
+
+} // namespace avx2
+
+inline bool use_avx2() {
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    }();
+    return supported;
+}
+
+#define FLOWGRAPH_PACKING_DISPATCH(function, ...) \
+    return use_avx2() ? avx2::function(__VA_ARGS__) : scalar::function(__VA_ARGS__)
+
+#else
+
+#define FLOWGRAPH_PACKING_DISPATCH(function, ...) return scalar::function(__VA_ARGS__)
+
+#endif // FLOWGRAPH_X86_SIMD
+
+inline void narrow(const double* in, float* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(narrow, in, out, n); }
+inline void widen(const float* in, double* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(widen, in, out, n); }
+inline void to_half(const float* in, uint16_t* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(to_half, in, out, n); }
+inline void from_half(const uint16_t* in, float* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(from_half, in, out, n); }
+inline void to_bfloat(const float* in, uint16_t* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(to_bfloat, in, out, n); }
+inline void from_bfloat(const uint16_t* in, float* out, size_t n) { FLOWGRAPH_PACKING_DISPATCH(from_bfloat, in, out, n); }
+inline float max_magnitude(const float* in, size_t n) { FLOWGRAPH_PACKING_DISPATCH(max_magnitude, in, n); }
+inline void to_int8(const float* in, int8_t* out, size_t n, float inverse_scale) {
+    FLOWGRAPH_PACKING_DISPATCH(to_int8, in, out, n, inverse_scale);
+}
+inline void from_int8(const int8_t* in, float* out, size_t n, float scale) {
+    FLOWGRAPH_PACKING_DISPATCH(from_int8, in, out, n, scale);
+}
+
+inline bool to_steps(const double* in, int64_t* out, size_t n, double inverse) {
+    FLOWGRAPH_PACKING_DISPATCH(to_steps, in, out, n, inverse);
+}
+inline void from_steps(const int64_t* in, double* out, size_t n, double step) {
+    FLOWGRAPH_PACKING_DISPATCH(from_steps, in, out, n, step);
+}
+template<typename I>
+void add_steps(int64_t* steps, const I* in, size_t n) {
+    FLOWGRAPH_PACKING_DISPATCH(add_steps, steps, in, n);
+}
+
+#undef FLOWGRAPH_PACKING_DISPATCH
+
+} // namespace packing
+
+// A buffer of float or double values held in a storage format. Narrow
+// formats convert through float, so doubles are rounded twice.
+class PackedValues {
+public:
+    PackedValues() = default;
+
+    // Formats wider than the elements store them as they are
+    template<PackableElement E>
+    PackedValues(std::span<const E> values, StorageFormat format)
+        : count_(values.size())
+        , format_(std::min(format, native_storage_format<E>())) {
+        data_.resize(count_ * element_bytes(format_));
+        if (format_ == native_storage_format<E>()) {
+            std::memcpy(data_.data(), values.data(), data_.size());
+            return;
+        }
+        const float* floats;
+        if constexpr (std::same_as<E, double>) {
+            if (format_ == StorageFormat::Float32) {
+                packing::narrow(values.data(), as<float>(), count_);
+                return;
+            }
+            floats = staging(values);
+        } else {
+            floats = values.data();
+        }
+        switch (format_) {
+            case StorageFormat::Float16:
+                packing::to_half(floats, as<uint16_t>(), count_);
+                break;
+            case StorageFormat::BFloat16:
+                packing::to_bfloat(floats, as<uint16_t>(), count_);
+                break;
+            case StorageFormat::Int8: {
+                scale_ = packing::max_magnitude(floats, count_) / 127.0f;
+                packing::to_int8(floats, as<int8_t>(), count_, scale_ == 0.0f ? 0.0f : 1.0f / scale_);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    StorageFormat format() const { return format_; }
+    size_t size() const { return count_; }
+    // Bytes of packed values
+    size_t bytes() const { return data_.size(); }
+
+    template<PackableElement E>
+    void unpack(std::span<E> out) const {
+        if (out.size() != count_) {
+            throw std::invalid_argument("Unpacking into a buffer of a different size");
+        }
+        if (format_ == native_storage_format<E>()) {
+            std::memcpy(out.data(), data_.data(), data_.size());
+            return;
+        }
+        if constexpr (std::same_as<E, float>) {
+            decode(out.data());
+        } else if (format_ == StorageFormat::Float32) {
+            packing::widen(as<float>(), out.data(), count_);
+        } else {
+            thread_local std::vector<float> floats;
+            floats.resize(count_);
+            decode(floats.data());
+            packing::widen(floats.data(), out.data(), count_);
+        }
+    }
+
+private:
+    template<typename U>
+    U* as() { return reinterpret_cast<U*>(data_.data()); }
+
+    template<typename U>
+    const U* as() const { return reinterpret_cast<const U*>(data_.data()); }
+
+    static const float* staging(std::span<const double> values) {
+        thread_local std::vector<float> floats;
+        floats.resize(values.size());
+        packing::narrow(values.data(), floats.data(), values.size());
+        return floats.data();
+    }
+
+    // Narrow formats (and fp64) to float
+    void decode(float* out) const {
+        switch (format_) {
+            case StorageFormat::Float64:
+                packing::narrow(as<double>(), out, count_);
+                break;
+            case StorageFormat::Float16:
+                packing::from_half(as<uint16_t>(), out, count_);
+                break;
+            case StorageFormat::BFloat16:
+                packing::from_bfloat(as<uint16_t>(), out, count_);
+                break;
+            case StorageFormat::Int8:
+                packing::from_int8(as<int8_t>(), out, count_, scale_);
+                break;
+            case StorageFormat::Float32:
+                std::memcpy(out, data_.data(), data_.size());
+                break;
+        }
+    }
+
+    std::vector<std::byte> data_;
+    size_t count_ = 0;
+    float scale_ = 0.0f;
+    StorageFormat format_ = StorageFormat::Float64;
+};
+
+// Values as whole multiples of a step, rounded to nearest; fails when a
+// value is not finite or too far from zero to count exactly
+template<PackableElement E>
+std::optional<std::vector<int64_t>> quantize_steps(std::span<const E> values, double step) {
+    if (!(step > 0.0)) {
+        return std::nullopt;
+    }
+    std::vector<int64_t> steps(values.size());
+    bool representable;
+    if constexpr (std::same_as<E, double>) {
+        representable = packing::to_steps(values.data(), steps.data(), values.size(), 1.0 / step);
+    } else {
+        std::vector<double> wide(values.size());
+        packing::widen(values.data(), wide.data(), values.size());
+        representable = packing::to_steps(wide.data(), steps.data(), values.size(), 1.0 / step);
+    }
+    if (!representable) {
+        return std::nullopt;
+    }
+    return steps;
+}
+
+template<PackableElement E>
+void dequantize_steps(std::span<const int64_t> steps, double step, std::span<E> out) {
+    if constexpr (std::same_as<E, double>) {
+        packing::from_steps(steps.data(), out.data(), steps.size(), step);
+    } else {
+        for (size_t i = 0; i < steps.size(); ++i) {
+            out[i] = static_cast<E>(static_cast<double>(steps[i]) * step);
+        }
+    }
+}
+
+// Differences between a buffer of step counts and a reference one, held in
+// the narrowest of 0 (all equal), 1, 2 or 4 bytes per element that fits
+// them. Applying the residual to the reference restores the counts exactly.
+class QuantizedResidual {
+public:
+    // Empty when the buffers differ in size or a difference needs more
+    // than 32 bits
+    static std::optional<QuantizedResidual> encode(std::span<const int64_t> steps,
+                                                   std::span<const int64_t> reference) {
+        if (steps.size() != reference.size()) {
+            return std::nullopt;
+        }
+        // Each width holds the magnitudes below a power of two, so the
+        // bitwise or of the magnitudes chooses it as their maximum would
+        uint64_t magnitudes = 0;
+        for (size_t i = 0; i < steps.size(); ++i) {
+            auto difference = static_cast<uint64_t>(steps[i] - reference[i]);
+            uint64_t sign = static_cast<uint64_t>(static_cast<int64_t>(difference) >> 63);
+            magnitudes |= (difference ^ sign) - sign;
+        }
+        QuantizedResidual residual;
+        residual.count_ = steps.size();
+        if (magnitudes == 0) residual.width_ = 0;
+        else if (magnitudes <= INT8_MAX) residual.width_ = 1;
+        else if (magnitudes <= INT16_MAX) residual.width_ = 2;
+        else if (magnitudes <= INT32_MAX) residual.width_ = 4;
+        else return std::nullopt;
+        residual.data_.resize(residual.count_ * residual.width_);
+        switch (residual.width_) {
+            case 1: residual.fill<int8_t>(steps, reference); break;
+            case 2: residual.fill<int16_t>(steps, reference); break;
+            case 4: residual.fill<int32_t>(steps, reference); break;
+            default: break;
+        }
+        return residual;
+    }
+
+    // Turns the reference counts into the encoded ones
+    void apply(std::span<int64_t> steps) const {
+        if (steps.size() != count_) {
+            throw std::invalid_argument("Residual applied to a buffer of a different size");
+        }
+        switch (width_) {
+            case 1: add<int8_t>(steps); break;
+            case 2: add<int16_t>(steps); break;
+            case 4: add<int32_t>(steps); break;
+            default: break;
+        }
+    }
+
+    size_t size() const { return count_; }
+    size_t width() const { return width_; }
+    size_t bytes() const { return data_.size(); }
+
+private:
+    template<typename I>
+    void fill(std::span<const int64_t> steps, std::span<const int64_t> reference) {
+        auto* out = reinterpret_cast<I*>(data_.data());
+        for (size_t i = 0; i < count_; ++i) {
+            out[i] = static_cast<I>(steps[i] - reference[i]);
+        }
+    }
+
+    template<typename I>
+    void add(std::span<int64_t> steps) const {
+        packing::add_steps(steps.data(), reinterpret_cast<const I*>(data_.data()), count_);
+    }
+
+    std::vector<std::byte> data_;
+    size_t count_ = 0;
+    uint8_t width_ = 0;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,488 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "partition.hpp"
+#include "../core/execution_plan.hpp"
+
+namespace flowgraph {
+
+// Undirected weighted view of a plan for partitioning. Vertex weights are
+// compute costs and edge weights the bytes a value costs to send across
+// the edge. Adjacency is CSR with both directions of every edge stored.
+struct PartitionGraph {
+    std::vector<double> vertex_weight;
+    std::vector<size_t> offsets{0};
+    std::vector<size_t> adjacency;
+    std::vector<double> edge_weight;
+
+    struct Link {
+        size_t from;
+        size_t to;
+        double bytes;
+    };
+
+    size_t size() const { return vertex_weight.size(); }
+
+    double total_weight() const {
+        return std::accumulate(vertex_weight.begin(), vertex_weight.end(), 0.0);
+    }
+
+    // Parallel links are merged and self links dropped
+    static PartitionGraph from_links(std::vector<double> vertex_weight, const std::vector<Link>& links) {
+        const size_t n = vertex_weight.size();
+        PartitionGraph graph;
+        graph.vertex_weight = std::move(vertex_weight);
+        std::vector<size_t> degree(n + 1, 0);
+        for (const auto& link : links) {
+            if (link.from >= n || link.to >= n) {
+                throw std::out_of_range("Partition link endpoint out of range");
+            }
+            if (link.from != link.to) {
+                ++degree[link.from + 1];
+                ++degree[link.to + 1];
+            }
+        }
+        std::partial_sum(degree.begin(), degree.end(), degree.begin());
+        std::vector<std::pair<size_t, double>> entries(degree[n]);
+        std::vector<size_t> fill(degree.begin(), degree.end() - 1);
+        for (const auto& link : links) {
+            if (link.from != link.to) {
+                entries[fill[link.from]++] = {link.to, link.bytes};
+                entries[fill[link.to]++] = {link.from, link.bytes};
+            }
+        }
+
+        graph.offsets.reserve(n + 1);
+        graph.adjacency.reserve(entries.size());
+        graph.edge_weight.reserve(entries.size());
+        for (size_t v = 0; v < n; ++v) {
+            auto begin = entries.begin() + static_cast<std::ptrdiff_t>(degree[v]);
+            auto end = entries.begin() + static_cast<std::ptrdiff_t>(degree[v + 1]);
+            std::sort(begin, end, [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto it = begin; it != end; ++it) {
+                if (graph.adjacency.size() > graph.offsets.back() && graph.adjacency.back() == it->first) {
+                    graph.edge_weight.back() += it->second;
+                } else {
+                    graph.adjacency.push_back(it->first);
+                    graph.edge_weight.push_back(it->second);
+                }
+            }
+            graph.offsets.push_back(graph.adjacency.size());
+        }
+        return graph;
+    }
+
+    // Costs default to 1 per node and 1 per edge when not given
+    template<typename T>
+    static PartitionGraph from_plan(const ExecutionPlan<T>& plan,
+                                    const std::function<double(const Node<T>&)>& cost = {},
+                                    const std::function<double(const Node<T>& from, const Node<T>& to)>& bytes = {}) {
+        std::vector<double> weights(plan.size(), 1.0);
+        std::vector<Link> links;
+        links.reserve(plan.successors.size());
+        for (size_t i = 0; i < plan.size(); ++i) {
+            if (cost) {
+                weights[i] = cost(*plan.nodes[i]);
+            }
+            for (size_t succ : plan.successors_of(i)) {
+                links.push_back({i, succ, bytes ? bytes(*plan.nodes[i], *plan.nodes[succ]) : 1.0});
+            }
+        }
+        return from_links(std::move(weights), links);
+    }
+};
+
+// Total weight of the edges whose endpoints are in different partitions
+inline double cut_weight(const PartitionGraph& graph, const PartitionMap& partition) {
+    double cut = 0.0;
+    for (size_t v = 0; v < graph.size(); ++v) {
+        for (size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            if (graph.adjacency[e] > v && partition[graph.adjacency[e]] != partition[v]) {
+                cut += graph.edge_weight[e];
+            }
+        }
+    }
+    return cut;
+}
+
+// Heaviest partition's load over the average load
+inline double partition_imbalance(const PartitionGraph& graph, const PartitionMap& partition, size_t parts) {
+    std::vector<double> load(parts, 0.0);
+    for (size_t v = 0; v < graph.size(); ++v) {
+        load[partition[v]] += graph.vertex_weight[v];
+    }
+    double total = std::accumulate(load.begin(), load.end(), 0.0);
+    return total > 0.0 ? *std::max_element(load.begin(), load.end()) * static_cast<double>(parts) / total : 1.0;
+}
+
+struct MultilevelOptions {
+    // Allowed load of a partition above the average, as a fraction
+    double imbalance = 0.05;
+    // Coarsening stops at about this many vertices per partition
+    size_t coarsest_vertices_per_part = 20;
+    // Refinement passes per level; a level also stops once nothing moves
+    size_t refinement_passes = 8;
+    // Randomised initial partitions tried on the coarsest graph, besides a
+    // sweep in plan order; the one with the smallest cut is kept
+    size_t initial_tries = 4;
+    uint64_t seed = 1;
+};
+
+namespace multilevel {
+
+// One level of heavy-edge matching: each vertex, in random order, merges
+// with the unmatched neighbour it shares the heaviest edge with. coarse_of
+// receives the coarse vertex of every vertex.
+inline PartitionGraph coarsen(const PartitionGraph& graph, double max_vertex_weight,
+                              std::vector<size_t>& coarse_of, std::mt19937_64& rng) {
+    constexpr size_t none = std::numeric_limits<size_t>::max();
+    const size_t n = graph.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    std::vector<size_t> match(n, none);
+    for (size_t v : order) {
+        if (match[v] != none) {
+            continue;
+        }
+        size_t best = v;
+        double best_weight = -1.0;
+        size_t best_distance = 0;
+        for (size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            size_t u = graph.adjacency[e];
+            if (match[u] != none || graph.vertex_weight[v] + graph.vertex_weight[u] > max_vertex_weight) {
+                continue;
+            }
+            // Ties go to the neighbour nearest in vertex order, which for
+            // plans is topological order, so merges stay local
+            size_t distance = u > v ? u - v : v - u;
+            if (graph.edge_weight[e] > best_weight ||
+                (graph.edge_weight[e] == best_weight && distance < best_distance)) {
+                best = u;
+                best_weight = graph.edge_weight[e];
+                best_distance = distance;
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    coarse_of.assign(n, none);
+    std::vector<size_t> members;
+    members.reserve(n);
+    size_t coarse_n = 0;
+    for (size_t v = 0; v < n; ++v) {
+        if (coarse_of[v] == none) {
+            coarse_of[v] = coarse_of[match[v]] = coarse_n++;
+            members.push_back(v);
+            if (match[v] != v) {
+                members.push_back(match[v]);
+            }
+        }
+    }
+
+    // Members are grouped by coarse vertex; merge their adjacency through
+    // a slot per coarse neighbour
+    PartitionGraph coarse;
+    coarse.vertex_weight.assign(coarse_n, 0.0);
+    coarse.offsets.reserve(coarse_n + 1);
+    coarse.adjacency.reserve(graph.adjacency.size() / 2);
+    coarse.edge_weight.reserve(graph.adjacency.size() / 2);
+    std::vector<size_t> slot(coarse_n, none);
+    for (size_t m = 0; m < members.size();) {
+        const size_t c = coarse_of[members[m]];
+        const size_t first = coarse.adjacency.size();
+        for (; m < members.size() && coarse_of[members[m]] == c; ++m) {
+            size_t v = members[m];
+            coarse.vertex_weight[c] += graph.vertex_weight[v];
+            for (size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                size_t cu = coarse_of[graph.adjacency[e]];
+                if (cu == c) {
+                    continue;
+                }
+                if (slot[cu] == none) {
+                    slot[cu] = coarse.adjacency.size();
+                    coarse.adjacency.push_back(cu);
+                    coarse.edge_weight.push_back(0.0);
+                }
+                coarse.edge_weight[slot[cu]] += graph.edge_weight[e];
+            }
+        }
+        for (size_t e = first; e < coarse.adjacency.size(); ++e) {
+            slot[coarse.adjacency[e]] = none;
+        }
+        coarse.offsets.push_back(coarse.adjacency.size());
+    }
+    return coarse;
+}
+
+// Greedy graph growing: each partition but the last grows from a seed by
+// repeatedly taking the vertex most strongly connected to it, until it
+// reaches its share of the weight
+inline PartitionMap initial_partition(const PartitionGraph& graph, size_t parts, double max_load,
+                                      std::mt19937_64& rng) {
+    constexpr size_t none = std::numeric_limits<size_t>::max();
+    const size_t n = graph.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    PartitionMap partition(n, none);
+    std::vector<double> connection(n, 0.0);
+    std::vector<size_t> touched;
+    double remaining = graph.total_weight();
+    size_t next_seed = 0;
+
+    for (size_t p = 0; p + 1 < parts; ++p) {
+        const double target = remaining / static_cast<double>(parts - p);
+        double load = 0.0;
+        std::priority_queue<std::pair<double, size_t>> frontier;
+        while (load < target) {
+            if (frontier.empty()) {
+                while (next_seed < n && partition[order[next_seed]] != none) {
+                    ++next_seed;
+                }
+                if (next_seed == n) {
+                    break;
+                }
+                frontier.emplace(0.0, order[next_seed++]);
+            }
+            auto [gain, v] = frontier.top();
+            frontier.pop();
+            if (partition[v] != none || gain != connection[v]) {
+                continue;
+            }
+            if (load > 0.0 && load + graph.vertex_weight[v] > max_load) {
+                continue;
+            }
+            partition[v] = p;
+            load += graph.vertex_weight[v];
+            for (size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                size_t u = graph.adjacency[e];
+                if (partition[u] == none) {
+                    if (connection[u] == 0.0) {
+                        touched.push_back(u);
+                    }
+                    connection[u] += graph.edge_weight[e];
+                    frontier.emplace(connection[u], u);
+                }
+            }
+        }
+        for (size_t u : touched) {
+            connection[u] = 0.0;
+        }
+        touched.clear();
+        remaining -= load;
+    }
+    for (auto& p : partition) {
+        if (p == none) {
+            p = parts - 1;
+        }
+    }
+    return partition;
+}
+
+// Contiguous runs of vertices with an equal share of the weight each.
+// Plan vertices are in topological order and coarse vertices are numbered
+// in the order of their first member, so runs keep DAG neighbourhoods
+// together.
+inline PartitionMap sweep_partition(const PartitionGraph& graph, size_t parts) {
+    const double share = graph.total_weight() / static_cast<double>(parts);
+    PartitionMap partition(graph.size());
+    double load = 0.0;
+    size_t p = 0;
+    for (size_t v = 0; v < graph.size(); ++v) {
+        if (load >= share * static_cast<double>(p + 1) && p + 1 < parts) {
+            ++p;
+        }
+        partition[v] = p;
+        load += graph.vertex_weight[v];
+    }
+    return partition;
+}
+
+// Gain-driven boundary refinement in the Kernighan-Lin/Fiduccia-Mattheyses
+// family: a vertex moves to the neighbouring partition it is most strongly
+// connected to when that reduces the cut (or keeps it and evens out the
+// load) without overloading the target. A vertex in an overloaded
+// partition moves even at a loss, to the best partition with room.
+inline void refine(const PartitionGraph& graph, PartitionMap& partition, size_t parts, double max_load,
+                   size_t passes) {
+    const size_t n = graph.size();
+    std::vector<double> load(parts, 0.0);
+    for (size_t v = 0; v < n; ++v) {
+        load[partition[v]] += graph.vertex_weight[v];
+    }
+    std::vector<double> connection(parts, 0.0);
+    std::vector<size_t> neighbours;
+
+    // Vertex order rather than a random one keeps the sweep cache friendly
+    for (size_t pass = 0; pass < passes; ++pass) {
+        size_t moved = 0;
+        for (size_t v = 0; v < n; ++v) {
+            const size_t from = partition[v];
+            const double weight = graph.vertex_weight[v];
+            const bool overloaded = load[from] > max_load;
+
+            neighbours.clear();
+            for (size_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+                size_t p = partition[graph.adjacency[e]];
+                if (connection[p] == 0.0) {
+                    neighbours.push_back(p);
+                }
+                connection[p] += graph.edge_weight[e];
+            }
+            const double internal = connection[from];
+            bool boundary = std::any_of(neighbours.begin(), neighbours.end(), [from](size_t p) { return p != from; });
+
+            size_t best = from;
+            double best_gain = 0.0;
+            if (boundary || overloaded) {
+                for (size_t p : neighbours) {
+                    if (p == from || load[p] + weight > max_load) {
+                        continue;
+                    }
+                    double gain = connection[p] - internal;
+                    bool better = best == from
+                        ? gain > 0.0 || (gain == 0.0 && load[p] + weight < load[from]) || overloaded
+                        : gain > best_gain || (gain == best_gain && load[p] < load[best]);
+                    if (better) {
+                        best = p;
+                        best_gain = gain;
+                    }
+                }
+                if (best == from && overloaded) {
+                    size_t lightest = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+                    if (load[lightest] + weight <= max_load) {
+                        best = lightest;
+                    }
+                }
+            }
+            for (size_t p : neighbours) {
+                connection[p] = 0.0;
+            }
+            connection[from] = 0.0;
+
+            if (best != from) {
+                partition[v] = best;
+                load[from] -= weight;
+                load[best] += weight;
+                ++moved;
+            }
+        }
+        if (moved == 0) {
+            break;
+        }
+    }
+}
+
+} // namespace multilevel
+
+// Multilevel k-way partitioning: coarsen by heavy-edge matching until the
+// graph has about coarsest_vertices_per_part vertices per partition, pick
+// the best of several initial partitions of the coarsest graph, then
+// project it back level by level, refining at each. Balances vertex weight (compute cost) while
+// keeping the cut weight (bytes crossing partitions) low.
+inline PartitionMap multilevel_partition(const PartitionGraph& graph, size_t parts,
+                                         const MultilevelOptions& options = {}) {
+    if (parts == 0) {
+        throw std::invalid_argument("Cannot partition into zero parts");
+    }
+    const size_t n = graph.size();
+    if (parts == 1 || n <= parts) {
+        PartitionMap partition(n);
+        for (size_t v = 0; v < n; ++v) {
+            partition[v] = v % parts;
+        }
+        return partition;
+    }
+
+    std::mt19937_64 rng(options.seed);
+    const double total = graph.total_weight();
+    const double max_load = (1.0 + options.imbalance) * total / static_cast<double>(parts);
+    const size_t coarsest = std::max<size_t>(parts * std::max<size_t>(options.coarsest_vertices_per_part, 1), 2);
+    // Keeps coarse vertices small enough to balance
+    const double max_vertex_weight = 1.5 * total / static_cast<double>(coarsest);
+
+    std::vector<PartitionGraph> levels;
+    std::vector<std::vector<size_t>> projections;
+    const PartitionGraph* current = &graph;
+    while (current->size() > coarsest) {
+        std::vector<size_t> coarse_of;
+        auto coarse = multilevel::coarsen(*current, max_vertex_weight, coarse_of, rng);
+        // Matching has stalled
+        if (coarse.size() * 20 > current->size() * 19) {
+            break;
+        }
+        projections.push_back(std::move(coarse_of));
+        levels.push_back(std::move(coarse));
+        current = &levels.back();
+    }
+
+    // Overloaded candidates rank behind balanced ones
+    auto score = [&](const PartitionGraph& level, const PartitionMap& candidate) {
+        return std::make_pair(partition_imbalance(level, candidate, parts) > 1.0 + options.imbalance,
+                              cut_weight(level, candidate));
+    };
+    auto swept = [&](const PartitionGraph& level) {
+        auto candidate = multilevel::sweep_partition(level, parts);
+        multilevel::refine(level, candidate, parts, max_load, options.refinement_passes);
+        return candidate;
+    };
+
+    auto partition = swept(*current);
+    auto best = score(*current, partition);
+    for (size_t attempt = 0; attempt < options.initial_tries; ++attempt) {
+        auto candidate = multilevel::initial_partition(*current, parts, max_load, rng);
+        multilevel::refine(*current, candidate, parts, max_load, options.refinement_passes);
+        auto candidate_score = score(*current, candidate);
+        if (candidate_score < best) {
+            partition = std::move(candidate);
+            best = candidate_score;
+        }
+    }
+    for (size_t level = levels.size(); level-- > 0;) {
+        const PartitionGraph& finer = level == 0 ? graph : levels[level - 1];
+        PartitionMap projected(finer.size());
+        for (size_t v = 0; v < finer.size(); ++v) {
+            projected[v] = partition[projections[level][v]];
+        }
+        partition = std::move(projected);
+        multilevel::refine(finer, partition, parts, max_load, options.refinement_passes);
+    }
+
+    // Coarsening cannot tell a bridge between distant regions from a local
+    // edge, and merges across bridges scatter coarse vertices; on graphs
+    // where locality lies mostly in plan order (long, banded pipelines) a
+    // refined sweep of the graph itself can come out ahead
+    if (!levels.empty()) {
+        auto candidate = swept(graph);
+        if (score(graph, candidate) < score(graph, partition)) {
+            partition = std::move(candidate);
+        }
+    }
+    return partition;
+}
+
+// Partitioner for the executors, weighing plan nodes by `cost` and edges
+// by `bytes` (1 each when not given)
+template<typename T>
+Partitioner<T> multilevel_partitioner(MultilevelOptions options = {},
+                                      std::function<double(const Node<T>&)> cost = {},
+                                      std::function<double(const Node<T>& from, const Node<T>& to)> bytes = {}) {
+    return [options, cost = std::move(cost), bytes = std::move(bytes)](const ExecutionPlan<T>& plan, size_t parts) {
+        return multilevel_partition(PartitionGraph::from_plan(plan, cost, bytes), parts, options);
+    };
+}
+
+} // namespace flowgraph
@@ -0,0 +1,64 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include "../core/execution_plan.hpp"
+
+namespace flowgraph {
+
+// Partition of each plan node, indexed like ExecutionPlan::nodes
+using PartitionMap = std::vector<size_t>;
+
+template<typename T>
+using Partitioner = std::function<PartitionMap(const ExecutionPlan<T>&, size_t parts)>;
+
+// Greedy partitioning in topological order: each node joins the partition
+// holding most of its predecessors, so chains stay together, unless that
+// partition is already full, in which case it goes to the least loaded
+// one. Partitions hold at most ceil(n / parts) nodes.
+template<typename T>
+PartitionMap greedy_partition(const ExecutionPlan<T>& plan, size_t parts) {
+    if (parts == 0) {
+        throw std::invalid_argument("Cannot partition into zero parts");
+    }
+    const size_t n = plan.size();
+    const size_t limit = (n + parts - 1) / parts;
+    PartitionMap partition(n, 0);
+    std::vector<size_t> load(parts, 0);
+    std::vector<size_t> votes(parts, 0);
+
+    for (size_t i = 0; i < n; ++i) {
+        std::fill(votes.begin(), votes.end(), 0);
+        for (size_t pred : plan.predecessors_of(i)) {
+            ++votes[partition[pred]];
+        }
+        size_t best = parts;
+        for (size_t p = 0; p < parts; ++p) {
+            if (load[p] < limit && votes[p] > 0 && (best == parts || votes[p] > votes[best])) {
+                best = p;
+            }
+        }
+        if (best == parts) {
+            best = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+        }
+        partition[i] = best;
+        ++load[best];
+    }
+    return partition;
+}
+
+// Number of plan edges whose endpoints are in different partitions
+template<typename T>
+size_t cut_edges(const ExecutionPlan<T>& plan, const PartitionMap& partition) {
+    size_t cut = 0;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        for (size_t succ : plan.successors_of(i)) {
+            cut += partition[i] != partition[succ];
+        }
+    }
+    return cut;
+}
+
+} // namespace flowgraph
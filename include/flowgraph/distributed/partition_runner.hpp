@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "partition.hpp"
+#include "../async/task.hpp"
+#include "../core/compute_result.hpp"
+#include "../core/error_state.hpp"
+#include "../core/execution_plan.hpp"
+
+namespace flowgraph {
+
+// Worker side of the partitioned executors: compute one partition's nodes
+// in plan order, the way Graph's executors do in-process. For each
+// predecessor held by another partition, await_remote(pred) blocks until
+// its result has arrived and been imported into the node, and returns the
+// predecessor's error, if any. After each node, publish(i, result,
+// destinations) hands the result on; destinations lists the other
+// partitions with successors of i. A node suspended on I/O is left
+// running while later nodes compute, and is finished before anything that
+// depends on it, directly or through another partition.
+template<typename T, typename AwaitRemote, typename Publish>
+void run_partition_nodes(const ExecutionPlan<T>& plan, const PartitionMap& partition, size_t self,
+                         AwaitRemote&& await_remote, Publish&& publish) {
+    const size_t n = plan.size();
+    std::vector<std::optional<ErrorState>> errors(n);
+    std::vector<char> resolved(n, 0);
+    std::vector<char> suspended(n, 0);
+    std::vector<size_t> destinations;
+    std::vector<std::pair<size_t, Task<ComputeResult<T>>>> pending;
+
+    auto finish = [&](size_t i, ComputeResult<T> result) {
+        if (result.has_error()) {
+            if (!result.error().source_node()) {
+                auto failed = result.error();
+                failed.set_source_node(plan.nodes[i]->name());
+                result = ComputeResult<T>(std::move(failed));
+            }
+            errors[i] = result.error();
+        }
+
+        destinations.clear();
+        for (size_t succ : plan.successors_of(i)) {
+            if (partition[succ] != self &&
+                std::find(destinations.begin(), destinations.end(), partition[succ]) == destinations.end()) {
+                destinations.push_back(partition[succ]);
+            }
+        }
+        publish(i, result, std::span<const size_t>(destinations));
+    };
+    auto drain = [&] {
+        for (auto& [i, task] : pending) {
+            suspended[i] = 0;
+            finish(i, task.get());
+        }
+        pending.clear();
+    };
+
+    try {
+        for (size_t i = 0; i < n; ++i) {
+            if (partition[i] != self) {
+                continue;
+            }
+            const auto& node = plan.nodes[i];
+
+            std::optional<ErrorState> error;
+            for (size_t pred : plan.predecessors_of(i)) {
+                if (partition[pred] != self && !resolved[pred]) {
+                    // The remote result may itself wait on a suspended node
+                    drain();
+                    errors[pred] = await_remote(pred);
+                    resolved[pred] = 1;
+                } else if (suspended[pred]) {
+                    drain();
+                }
+                if (!error && errors[pred]) {
+                    error = *errors[pred];
+                    error->add_propagation_path(node->name());
+                }
+            }
+
+            if (error) {
+                finish(i, ComputeResult<T>(std::move(*error)));
+                continue;
+            }
+            auto compute = node->compute(0);
+            if (compute.is_ready()) {
+                finish(i, compute.get());
+            } else {
+                suspended[i] = 1;
+                pending.emplace_back(i, std::move(compute));
+            }
+        }
+        drain();
+    } catch (...) {
+        // Suspended computations must not be torn down mid-I/O
+        for (auto& entry : pending) {
+            try {
+                entry.second.get();
+            } catch (...) {
+            }
+        }
+        throw;
+    }
+}
+
+} // namespace flowgraph
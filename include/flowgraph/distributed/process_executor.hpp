@@ -0,0 +1,379 @@
+#pragma once
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "partition.hpp"
+#include "partition_runner.hpp"
+#include "shm_ring.hpp"
+#include "value_codec.hpp"
+#include "../async/blocking_region.hpp"
+#include "../async/spin_wait.hpp"
+#include "../core/graph.hpp"
+
+namespace flowgraph {
+
+struct ProcessExecutorOptions {
+    // Worker processes (partitions); capped at the number of nodes
+    size_t processes = 2;
+    // Data bytes per ring; a single value may take up to half of it
+    size_t ring_bytes = size_t{1} << 20;
+    // How long a waiting process polls its rings before sleeping on its
+    // futex
+    std::chrono::microseconds spin_budget{50};
+};
+
+// Runs a graph's plan across forked worker processes on this host, one per
+// partition, so each partition computes on its own heap. Values crossing
+// partitions travel through single-producer single-consumer rings in a
+// shared anonymous mapping, one ring per ordered pair of processes, with a
+// futex doorbell per process for wakeups. Every result also goes back to
+// the calling process, where it is imported into the graph's nodes
+// (Node::import_result) and node errors are published as execute() would,
+// so results read the same as after an in-process run.
+//
+// Workers are forked per execution and see the graph as it was at the
+// fork: nodes run single-threaded in their worker, should not rely on
+// threads of the calling process (thread pools, I/O reactors), and read
+// upstream values through compute() as usual - values from other
+// partitions have been imported by then. The executor must not be called
+// while the graph is executing elsewhere.
+template<typename T>
+    requires EncodableValue<T>
+class ProcessExecutor {
+public:
+    explicit ProcessExecutor(ProcessExecutorOptions options = {})
+        : options_(options)
+        , partitioner_(greedy_partition<T>) {
+        if (options_.processes == 0) {
+            throw std::invalid_argument("ProcessExecutor needs at least one process");
+        }
+    }
+
+    void set_partitioner(Partitioner<T> partitioner) {
+        partitioner_ = std::move(partitioner);
+    }
+
+    // Partition of each plan node in the last execution
+    const PartitionMap& last_partition() const { return partition_; }
+
+    // Execute the graph once; returns when every node has a result
+    void execute(Graph<T>& graph) {
+        auto plan = graph.execution_plan();
+        const size_t n = plan->size();
+        for (const auto& node : plan->nodes) {
+            node->clear_imported_result();
+        }
+        graph.clear_node_errors();
+        if (n == 0) {
+            return;
+        }
+
+        const size_t parts = std::min(options_.processes, n);
+        partition_ = partitioner_(*plan, parts);
+        if (partition_.size() != n ||
+            std::any_of(partition_.begin(), partition_.end(), [parts](size_t p) { return p >= parts; })) {
+            throw std::invalid_argument("Partitioner returned an invalid partition map");
+        }
+        prepare_arena(parts);
+
+        std::vector<pid_t> children;
+        const pid_t parent = ::getpid();
+        for (size_t p = 0; p < parts; ++p) {
+            pid_t pid = ::fork();
+            if (pid < 0) {
+                int error = errno;
+                kill_all(children);
+                throw std::system_error(error, std::generic_category(), "fork");
+            }
+            if (pid == 0) {
+                ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+                int status = 0;
+                if (::getppid() != parent) {
+                    ::_exit(1);
+                }
+                try {
+                    run_partition(*plan, p);
+                } catch (const std::exception& e) {
+                    report_failure(p, e.what());
+                    status = 1;
+                } catch (...) {
+                    report_failure(p, "unknown exception");
+                    status = 1;
+                }
+                // Skip the parent's atexit handlers and stream flushes
+                ::_exit(status);
+            }
+            children.push_back(pid);
+        }
+
+        auto results = collect_results(*plan, children);
+
+        std::vector<std::optional<ErrorState>> errors(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (results[i]->has_error()) {
+                errors[i] = results[i]->error();
+            }
+            plan->nodes[i]->import_result(std::move(*results[i]));
+        }
+        graph.publish_plan_errors(*plan, errors, 0, n);
+    }
+
+private:
+    static constexpr size_t line = 64;
+    static constexpr size_t failure_bytes = 256;
+    static constexpr std::chrono::milliseconds sleep_slice{10};
+
+    // parts workers plus the caller, whose index is parts
+    struct Layout {
+        size_t parts = 0;
+        size_t ring_bytes = 0;
+        size_t ring_stride = 0;
+        size_t failures = 0;
+        size_t rings = 0;
+        size_t total = 0;
+    };
+
+    void prepare_arena(size_t parts) {
+        if (!arena_ || layout_.parts != parts || layout_.ring_bytes != options_.ring_bytes) {
+            Layout layout;
+            layout.parts = parts;
+            layout.ring_bytes = options_.ring_bytes;
+            layout.ring_stride = (SpscByteRing::footprint(options_.ring_bytes) + line - 1) / line * line;
+            layout.failures = (parts + 1) * line;
+            layout.rings = layout.failures + (parts + 1) * failure_bytes;
+            layout.total = layout.rings + parts * (parts + 1) * layout.ring_stride;
+            arena_.reset();
+            arena_ = std::make_unique<SharedArena>(layout.total);
+            layout_ = layout;
+        }
+        for (size_t p = 0; p <= parts; ++p) {
+            new (arena_->data() + p * line) Doorbell();
+            std::memset(arena_->data() + layout_.failures + p * failure_bytes, 0, failure_bytes);
+        }
+        for (size_t from = 0; from < parts; ++from) {
+            for (size_t to = 0; to <= parts; ++to) {
+                if (from != to) {
+                    SpscByteRing::create(ring_memory(from, to), options_.ring_bytes);
+                }
+            }
+        }
+    }
+
+    Doorbell& doorbell(size_t process) {
+        return *std::launder(reinterpret_cast<Doorbell*>(arena_->data() + process * line));
+    }
+
+    std::byte* ring_memory(size_t from, size_t to) {
+        return arena_->data() + layout_.rings + (from * (layout_.parts + 1) + to) * layout_.ring_stride;
+    }
+
+    SpscByteRing& ring(size_t from, size_t to) {
+        return *std::launder(reinterpret_cast<SpscByteRing*>(ring_memory(from, to)));
+    }
+
+    void report_failure(size_t process, const char* message) {
+        auto* slot = reinterpret_cast<char*>(arena_->data() + layout_.failures + process * failure_bytes);
+        std::strncpy(slot, message, failure_bytes - 1);
+    }
+
+    std::string failure_message(size_t process) {
+        auto* slot = reinterpret_cast<const char*>(arena_->data() + layout_.failures + process * failure_bytes);
+        return std::string(slot, strnlen(slot, failure_bytes - 1));
+    }
+
+    // Poll (receive) until done() holds, sleeping on this process's doorbell
+    // once the spin budget is spent. Receiving while waiting is what keeps
+    // two processes blocked on each other's full rings moving.
+    template<typename Receive, typename Done, typename Idle>
+    void wait_until(size_t self, Receive&& receive, Done&& done, Idle&& idle) {
+        auto deadline = std::chrono::steady_clock::now() + options_.spin_budget;
+        SpinBackoff backoff;
+        while (true) {
+            uint32_t sequence = doorbell(self).sequence();
+            receive();
+            if (done()) {
+                return;
+            }
+            if (std::chrono::steady_clock::now() < deadline) {
+                backoff.pause();
+                continue;
+            }
+            {
+                BlockingRegion region;
+                doorbell(self).wait(sequence, sleep_slice);
+            }
+            idle();
+        }
+    }
+
+    template<typename Receive, typename Done>
+    void wait_until(size_t self, Receive&& receive, Done&& done) {
+        wait_until(self, receive, done, [] {});
+    }
+
+    // Encode a result for node i straight into the ring to process `to`
+    void send(size_t self, size_t to, size_t i, const ComputeResult<T>& result,
+              const std::function<void()>& receive) {
+        size_t size = sizeof(uint64_t) + ResultCodec<T>::size(result);
+        auto write = [&] {
+            return ring(self, to).try_write(size, [&](std::byte* out) {
+                uint64_t index = i;
+                std::memcpy(out, &index, sizeof(index));
+                ResultCodec<T>::encode(result, out + sizeof(index));
+            });
+        };
+        if (!write()) {
+            wait_until(self, receive, write);
+        }
+        doorbell(to).ring();
+    }
+
+    // Drain the rings from every other worker into `on_result`
+    template<typename F>
+    bool receive_from_workers(size_t self, F&& on_result) {
+        bool any = false;
+        for (size_t from = 0; from < layout_.parts; ++from) {
+            if (from == self) {
+                continue;
+            }
+            bool read = false;
+            while (ring(from, self).try_read([&](std::span<const std::byte> record) {
+                uint64_t index;
+                std::memcpy(&index, record.data(), sizeof(index));
+                on_result(static_cast<size_t>(index), ResultCodec<T>::decode(record.subspan(sizeof(index))));
+            })) {
+                read = true;
+            }
+            if (read) {
+                // The sender may be waiting for space
+                doorbell(from).ring();
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    // Worker process body: compute this partition's nodes, importing remote
+    // predecessors' results as they arrive
+    void run_partition(const ExecutionPlan<T>& plan, size_t self) {
+        const size_t caller = layout_.parts;
+        std::vector<char> arrived(plan.size(), 0);
+        std::vector<std::optional<ErrorState>> errors(plan.size());
+
+        std::function<void()> receive = [&] {
+            receive_from_workers(self, [&](size_t index, ComputeResult<T> result) {
+                if (result.has_error()) {
+                    errors[index] = result.error();
+                }
+                plan.nodes[index]->import_result(std::move(result));
+                arrived[index] = 1;
+            });
+        };
+
+        run_partition_nodes(plan, partition_, self,
+            [&](size_t pred) {
+                if (!arrived[pred]) {
+                    wait_until(self, receive, [&] { return arrived[pred] != 0; });
+                }
+                return errors[pred];
+            },
+            [&](size_t i, const ComputeResult<T>& result, std::span<const size_t> destinations) {
+                send(self, caller, i, result, receive);
+                for (size_t to : destinations) {
+                    send(self, to, i, result, receive);
+                }
+            });
+    }
+
+    // Caller side: gather every node's result, failing the rest if a
+    // worker dies
+    std::vector<std::optional<ComputeResult<T>>> collect_results(
+        const ExecutionPlan<T>& plan, std::vector<pid_t>& children) {
+        const size_t n = plan.size();
+        const size_t self = layout_.parts;
+        std::vector<std::optional<ComputeResult<T>>> results(n);
+        size_t received = 0;
+        std::optional<std::string> failure;
+
+        auto receive = [&] {
+            receive_from_workers(self, [&](size_t index, ComputeResult<T> result) {
+                if (!results[index]) {
+                    ++received;
+                }
+                results[index] = std::move(result);
+            });
+        };
+        auto check_children = [&] {
+            for (size_t p = 0; p < children.size(); ++p) {
+                int status = 0;
+                if (children[p] <= 0 || ::waitpid(children[p], &status, WNOHANG) != children[p]) {
+                    continue;
+                }
+                children[p] = 0;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    auto message = failure_message(p);
+                    failure = "Partition process " + std::to_string(p) + " failed" +
+                              (message.empty() ? std::string() : ": " + message);
+                }
+            }
+        };
+
+        wait_until(self, receive, [&] { return received == n || failure.has_value(); }, check_children);
+        if (failure) {
+            // Whatever the failed worker had sent is in its ring
+            receive();
+            kill_all(children);
+            for (size_t i = 0; i < n; ++i) {
+                if (!results[i]) {
+                    auto error = ErrorState::resource_error(*failure);
+                    error.set_source_node(plan.nodes[i]->name());
+                    results[i].emplace(std::move(error));
+                }
+            }
+        }
+        for (pid_t pid : children) {
+            if (pid > 0) {
+                BlockingRegion region;
+                ::waitpid(pid, nullptr, 0);
+            }
+        }
+        return results;
+    }
+
+    static void kill_all(std::vector<pid_t>& children) {
+        for (pid_t& pid : children) {
+            if (pid > 0) {
+                ::kill(pid, SIGKILL);
+                ::waitpid(pid, nullptr, 0);
+                pid = 0;
+            }
+        }
+    }
+
+    ProcessExecutorOptions options_;
+    Partitioner<T> partitioner_;
+    PartitionMap partition_;
+    std::unique_ptr<SharedArena> arena_;
+    Layout layout_;
+};
+
+} // namespace flowgraph
+#endif
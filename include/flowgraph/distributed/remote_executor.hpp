@@ -0,0 +1,614 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "partition.hpp"
+#include "partition_runner.hpp"
+#include "tcp_transport.hpp"
+#include "value_codec.hpp"
+#include "../async/blocking_region.hpp"
+#include "../core/graph.hpp"
+
+namespace flowgraph {
+
+// Wire form of a partitioned plan. Nodes are code, so they are shipped by
+// name: every worker builds the same graph and resolves the names against
+// its own nodes.
+//
+//   u64 plan id, u32 receiving worker's partition, u32 partition count,
+//   per partition its worker's host and port, u64 node count, then per
+//   node in plan order its name, partition, predecessor count and
+//   predecessor indices
+template<typename T>
+struct PlanMessage {
+    uint64_t id = 0;
+    size_t self = 0;
+    std::vector<Endpoint> peers;
+    std::vector<std::string> names;
+    PartitionMap partition;
+    std::vector<std::vector<uint32_t>> predecessors;
+
+    static PlanMessage from_plan(uint64_t id, const ExecutionPlan<T>& plan, const PartitionMap& partition,
+                                 std::vector<Endpoint> peers) {
+        PlanMessage message;
+        message.id = id;
+        message.peers = std::move(peers);
+        message.partition = partition;
+        for (size_t i = 0; i < plan.size(); ++i) {
+            message.names.push_back(plan.nodes[i]->name());
+            auto preds = plan.predecessors_of(i);
+            message.predecessors.emplace_back(preds.begin(), preds.end());
+        }
+        return message;
+    }
+
+    std::vector<std::byte> encode() const {
+        FrameBuilder frame(FrameType::Plan);
+        frame.put<uint64_t>(id).put<uint32_t>(static_cast<uint32_t>(self))
+             .put<uint32_t>(static_cast<uint32_t>(peers.size()));
+        for (const auto& peer : peers) {
+            frame.put_string(peer.host).put<uint16_t>(peer.port);
+        }
+        frame.put<uint64_t>(names.size());
+        for (size_t i = 0; i < names.size(); ++i) {
+            frame.put_string(names[i]).put<uint32_t>(static_cast<uint32_t>(partition[i]))
+                 .put<uint32_t>(static_cast<uint32_t>(predecessors[i].size()));
+            for (uint32_t pred : predecessors[i]) {
+                frame.put<uint32_t>(pred);
+            }
+        }
+        return std::move(frame).finish();
+    }
+
+    static PlanMessage decode(std::span<const std::byte> payload) {
+        FrameReader in(payload);
+        PlanMessage message;
+        message.id = in.get<uint64_t>();
+        message.self = in.get<uint32_t>();
+        for (uint32_t count = in.get<uint32_t>(); count > 0; --count) {
+            Endpoint peer;
+            peer.host = in.get_string();
+            peer.port = in.get<uint16_t>();
+            message.peers.push_back(std::move(peer));
+        }
+        auto n = in.get<uint64_t>();
+        for (uint64_t i = 0; i < n; ++i) {
+            message.names.push_back(in.get_string());
+            message.partition.push_back(in.get<uint32_t>());
+            // Predecessors are distinct earlier nodes, each taking 4 bytes
+            auto count = in.get<uint32_t>();
+            if (count > i || count > in.rest().size() / sizeof(uint32_t)) {
+                throw std::runtime_error("Plan has an invalid predecessor count");
+            }
+            auto& preds = message.predecessors.emplace_back(count);
+            for (auto& pred : preds) {
+                pred = in.get<uint32_t>();
+                if (pred >= i) {
+                    throw std::runtime_error("Plan is not in topological order");
+                }
+            }
+        }
+        return message;
+    }
+
+    // Rebuild the plan over the given graph's nodes
+    ExecutionPlan<T> resolve(const Graph<T>& graph) const {
+        std::unordered_map<std::string, std::shared_ptr<Node<T>>> by_name;
+        for (const auto& node : graph.get_nodes()) {
+            if (!by_name.emplace(node->name(), node).second) {
+                throw std::runtime_error("Worker graph has two nodes named " + node->name());
+            }
+        }
+        const size_t n = names.size();
+        ExecutionPlan<T> plan;
+        plan.level_offsets = {0, n};
+        plan.predecessor_offsets.push_back(0);
+        std::vector<size_t> successor_counts(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            auto it = by_name.find(names[i]);
+            if (it == by_name.end()) {
+                throw std::runtime_error("Worker graph has no node named " + names[i]);
+            }
+            if (!plan.index.emplace(it->second.get(), i).second) {
+                throw std::runtime_error("Plan names node " + names[i] + " twice");
+            }
+            plan.nodes.push_back(it->second);
+            for (uint32_t pred : predecessors[i]) {
+                plan.predecessors.push_back(pred);
+                ++successor_counts[pred];
+            }
+            plan.predecessor_offsets.push_back(plan.predecessors.size());
+        }
+        plan.successor_offsets.assign(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            plan.successor_offsets[i + 1] = plan.successor_offsets[i] + successor_counts[i];
+        }
+        plan.successors.resize(plan.predecessors.size());
+        std::vector<size_t> fill(plan.successor_offsets.begin(), plan.successor_offsets.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            for (uint32_t pred : predecessors[i]) {
+                plan.successors[fill[pred]++] = i;
+            }
+        }
+        return plan;
+    }
+};
+
+template<typename T>
+    requires EncodableValue<T>
+std::vector<std::byte> encode_result_frame(uint64_t run, size_t index, const ComputeResult<T>& result) {
+    FrameBuilder frame(FrameType::Result);
+    frame.put<uint64_t>(run).put<uint64_t>(index);
+    ResultCodec<T>::encode(result, frame.reserve(ResultCodec<T>::size(result)));
+    return std::move(frame).finish();
+}
+
+// Serves partitions of a graph to a RemoteExecutor. Each worker process
+// builds the same graph and listens on its own port; per run it computes
+// its partition in plan order. Results needed by other partitions are
+// sent straight to the peer workers that need them, and every result is
+// also sent back to the coordinator. Sends are queued on per-connection
+// writer threads, so computation is never held up by the network, and
+// results from peers are imported into this graph's nodes as they arrive.
+template<typename T>
+    requires EncodableValue<T>
+class RemoteWorker {
+public:
+    explicit RemoteWorker(Graph<T>& graph, Endpoint endpoint = {"127.0.0.1", 0})
+        : graph_(graph)
+        , endpoint_(std::move(endpoint)) {
+        listen_fd_ = tcp::listen_on(endpoint_);
+        acceptor_ = std::thread([this] { accept_loop(); });
+    }
+
+    ~RemoteWorker() {
+        stop();
+        if (background_.joinable()) {
+            background_.join();
+        }
+    }
+
+    RemoteWorker(const RemoteWorker&) = delete;
+    RemoteWorker& operator=(const RemoteWorker&) = delete;
+
+    // Where the worker listens, with the chosen port if 0 was asked for
+    const Endpoint& endpoint() const { return endpoint_; }
+
+    // Run plans on the calling thread until stop()
+    void serve() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            changed_.wait(lock, [this] { return !commands_.empty() || stopping_; });
+            if (stopping_) {
+                return;
+            }
+            auto command = std::move(commands_.front());
+            commands_.pop_front();
+            lock.unlock();
+            handle(command);
+            lock.lock();
+        }
+    }
+
+    // serve() on a background thread
+    void start() {
+        background_ = std::thread([this] { serve(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            stopping_ = true;
+        }
+        changed_.notify_all();
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        acceptor_.join();
+        ::close(listen_fd_);
+        if (background_.joinable() && background_.get_id() != std::this_thread::get_id()) {
+            background_.join();
+        }
+        std::unordered_map<size_t, std::unique_ptr<TcpConnection>> inbound;
+        std::unordered_map<std::string, std::unique_ptr<TcpConnection>> peers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inbound.swap(inbound_);
+            peers.swap(peers_);
+        }
+        // Connections join their threads, whose handlers take mutex_
+        inbound.clear();
+        peers.clear();
+    }
+
+private:
+    struct Command {
+        FrameType type;
+        std::vector<std::byte> payload;
+        size_t connection;
+    };
+
+    // Thrown out of a run the coordinator abandoned
+    struct RunCancelled {};
+
+    void accept_loop() {
+        while (true) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            // Closed connections are released here, outside their own threads
+            std::vector<std::unique_ptr<TcpConnection>> closed;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                ::close(fd);
+                return;
+            }
+            for (auto it = inbound_.begin(); it != inbound_.end();) {
+                if (!it->second->is_open() && it->first != coordinator_) {
+                    closed.push_back(std::move(it->second));
+                    it = inbound_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            size_t id = next_connection_++;
+            inbound_.emplace(id, std::make_unique<TcpConnection>(fd,
+                [this, id](FrameType type, std::span<const std::byte> payload) { on_frame(id, type, payload); },
+                [this, id] { on_close(id); }));
+        }
+    }
+
+    // Reader threads: results go to the inbox, everything else is queued
+    // for serve() in arrival order
+    void on_frame(size_t connection, FrameType type, std::span<const std::byte> payload) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (type == FrameType::Result) {
+            FrameReader in(payload);
+            auto run = in.get<uint64_t>();
+            auto index = static_cast<size_t>(in.get<uint64_t>());
+            if (run > finished_run_) {
+                inbox_[run].insert_or_assign(index, ResultCodec<T>::decode(in.rest()));
+            }
+        } else if (type == FrameType::Cancel) {
+            cancelled_run_ = std::max(cancelled_run_, FrameReader(payload).get<uint64_t>());
+        } else {
+            commands_.push_back({type, std::vector<std::byte>(payload.begin(), payload.end()), connection});
+        }
+        changed_.notify_all();
+    }
+
+    void on_close(size_t connection) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (connection == coordinator_) {
+            // Nobody is waiting for the run in progress any more
+            cancelled_run_ = std::max(cancelled_run_, current_run_);
+        }
+        changed_.notify_all();
+    }
+
+    void handle(const Command& command) {
+        uint64_t run = 0;
+        try {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                coordinator_ = command.connection;
+            }
+            if (command.type == FrameType::Plan) {
+                auto message = PlanMessage<T>::decode(command.payload);
+                plan_ = message.resolve(graph_);
+                message_ = std::move(message);
+            } else if (command.type == FrameType::Run) {
+                FrameReader in(command.payload);
+                run = in.get<uint64_t>();
+                if (!message_ || in.get<uint64_t>() != message_->id) {
+                    throw std::runtime_error("Run for a plan this worker does not have");
+                }
+                execute(run);
+            }
+        } catch (const RunCancelled&) {
+        } catch (const std::exception& e) {
+            send_to_coordinator(std::move(FrameBuilder(FrameType::Failure)
+                .put<uint64_t>(run).put_string(e.what())).finish());
+        }
+        if (run != 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_run_ = std::max(finished_run_, run);
+            for (auto it = inbox_.begin(); it != inbox_.end();) {
+                it = it->first <= finished_run_ ? inbox_.erase(it) : std::next(it);
+            }
+        }
+    }
+
+    void execute(uint64_t run) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            current_run_ = run;
+        }
+        for (const auto& node : plan_.nodes) {
+            node->clear_imported_result();
+        }
+
+        run_partition_nodes(plan_, message_->partition, message_->self,
+            [&](size_t pred) -> std::optional<ErrorState> {
+                std::unique_lock<std::mutex> lock(mutex_);
+                auto arrived = [&] {
+                    auto it = inbox_.find(run);
+                    return it != inbox_.end() && it->second.count(pred) > 0;
+                };
+                if (!arrived()) {
+                    BlockingRegion region;
+                    changed_.wait(lock, [&] { return arrived() || cancelled_run_ >= run || stopping_; });
+                }
+                if (!arrived()) {
+                    throw RunCancelled{};
+                }
+                auto result = std::move(inbox_[run].at(pred));
+                inbox_[run].erase(pred);
+                lock.unlock();
+                std::optional<ErrorState> error;
+                if (result.has_error()) {
+                    error = result.error();
+                }
+                plan_.nodes[pred]->import_result(std::move(result));
+                return error;
+            },
+            [&](size_t i, const ComputeResult<T>& result, std::span<const size_t> destinations) {
+                auto frame = encode_result_frame<T>(run, i, result);
+                for (size_t to : destinations) {
+                    peer(message_->peers.at(to)).send(frame);
+                }
+                send_to_coordinator(std::move(frame));
+            });
+    }
+
+    TcpConnection& peer(const Endpoint& endpoint) {
+        auto key = endpoint.to_string();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = peers_.find(key);
+            if (it != peers_.end() && it->second->is_open()) {
+                return *it->second;
+            }
+        }
+        // Peers never send on this connection
+        auto connection = std::make_unique<TcpConnection>(tcp::connect_to(endpoint),
+            [](FrameType, std::span<const std::byte>) {});
+        std::unique_ptr<TcpConnection> stale;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = peers_[key];
+        stale = std::move(slot);
+        slot = std::move(connection);
+        return *slot;
+    }
+
+    void send_to_coordinator(std::vector<std::byte> frame) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = inbound_.find(coordinator_);
+        if (it != inbound_.end()) {
+            it->second->send(std::move(frame));
+        }
+    }
+
+    Graph<T>& graph_;
+    Endpoint endpoint_;
+    int listen_fd_ = -1;
+    std::thread acceptor_;
+    std::thread background_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::unordered_map<size_t, std::unique_ptr<TcpConnection>> inbound_;
+    std::unordered_map<std::string, std::unique_ptr<TcpConnection>> peers_;
+    size_t next_connection_ = 0;
+    size_t coordinator_ = SIZE_MAX;
+    std::deque<Command> commands_;
+    std::unordered_map<uint64_t, std::unordered_map<size_t, ComputeResult<T>>> inbox_;
+    uint64_t current_run_ = 0;
+    uint64_t finished_run_ = 0;
+    uint64_t cancelled_run_ = 0;
+    bool stopping_ = false;
+
+    // serve() thread only
+    std::optional<PlanMessage<T>> message_;
+    ExecutionPlan<T> plan_;
+};
+
+// Coordinator for RemoteWorkers: partitions the graph's plan across the
+// workers, ships it when it changes, starts each run and tracks
+// completion by counting node results. Results are imported into the
+// local graph's nodes and errors published as execute() would. If a
+// worker fails or disconnects, the run is cancelled on the others and
+// the nodes still missing fail with a resource error; the connection is
+// re-established on the next execution.
+template<typename T>
+    requires EncodableValue<T>
+class RemoteExecutor {
+public:
+    explicit RemoteExecutor(std::vector<Endpoint> workers)
+        : workers_(std::move(workers))
+        , partitioner_(greedy_partition<T>)
+        , connections_(workers_.size()) {
+        if (workers_.empty()) {
+            throw std::invalid_argument("RemoteExecutor needs at least one worker");
+        }
+    }
+
+    ~RemoteExecutor() {
+        for (auto& connection : connections_) {
+            connection.reset();
+        }
+    }
+
+    void set_partitioner(Partitioner<T> partitioner) {
+        partitioner_ = std::move(partitioner);
+        sent_plan_.reset();
+    }
+
+    const PartitionMap& last_partition() const { return partition_; }
+
+    void execute(Graph<T>& graph) {
+        auto plan = graph.execution_plan();
+        const size_t n = plan->size();
+        for (const auto& node : plan->nodes) {
+            node->clear_imported_result();
+        }
+        graph.clear_node_errors();
+        if (n == 0) {
+            return;
+        }
+
+        const size_t parts = std::min(workers_.size(), n);
+        connect(parts);
+        if (plan != sent_plan_) {
+            partition_ = partitioner_(*plan, parts);
+            if (partition_.size() != n ||
+                std::any_of(partition_.begin(), partition_.end(), [parts](size_t p) { return p >= parts; })) {
+                throw std::invalid_argument("Partitioner returned an invalid partition map");
+            }
+            auto message = PlanMessage<T>::from_plan(++plan_id_, *plan, partition_,
+                std::vector<Endpoint>(workers_.begin(), workers_.begin() + parts));
+            for (size_t w = 0; w < parts; ++w) {
+                message.self = w;
+                connections_[w]->send(message.encode());
+            }
+            sent_plan_ = plan;
+        }
+
+        uint64_t run;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            run = ++run_id_;
+            results_.assign(n, std::nullopt);
+            received_ = 0;
+            failure_.reset();
+        }
+        auto start = std::move(FrameBuilder(FrameType::Run).put<uint64_t>(run).put<uint64_t>(plan_id_)).finish();
+        for (size_t w = 0; w < parts; ++w) {
+            connections_[w]->send(start);
+        }
+
+        std::vector<std::optional<ComputeResult<T>>> results;
+        std::optional<std::string> failure;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            BlockingRegion region;
+            done_.wait(lock, [&] { return received_ == n || failure_.has_value(); });
+            results.swap(results_);
+            failure = failure_;
+            // Late results of this run are ignored from here on
+            ++run_id_;
+        }
+
+        if (failure) {
+            auto cancel = std::move(FrameBuilder(FrameType::Cancel).put<uint64_t>(run)).finish();
+            for (size_t w = 0; w < parts; ++w) {
+                if (connections_[w] && connections_[w]->is_open()) {
+                    connections_[w]->send(cancel);
+                }
+            }
+            // Workers may be left without the plan; ship it again next time
+            sent_plan_.reset();
+            for (size_t i = 0; i < n; ++i) {
+                if (!results[i]) {
+                    auto error = ErrorState::resource_error(*failure);
+                    error.set_source_node(plan->nodes[i]->name());
+                    results[i].emplace(std::move(error));
+                }
+            }
+        }
+
+        std::vector<std::optional<ErrorState>> errors(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (results[i]->has_error()) {
+                errors[i] = results[i]->error();
+            }
+            plan->nodes[i]->import_result(std::move(*results[i]));
+        }
+        graph.publish_plan_errors(*plan, errors, 0, n);
+    }
+
+private:
+    void connect(size_t parts) {
+        for (size_t w = 0; w < parts; ++w) {
+            if (connections_[w] && connections_[w]->is_open()) {
+                continue;
+            }
+            connections_[w].reset();
+            connections_[w] = std::make_unique<TcpConnection>(tcp::connect_to(workers_[w]),
+                [this, w](FrameType type, std::span<const std::byte> payload) { on_frame(w, type, payload); },
+                [this, w] { fail("Worker " + workers_[w].to_string() + " disconnected"); });
+            sent_plan_.reset();
+        }
+    }
+
+    void on_frame(size_t worker, FrameType type, std::span<const std::byte> payload) {
+        FrameReader in(payload);
+        auto run = in.get<uint64_t>();
+        if (type == FrameType::Result) {
+            auto index = static_cast<size_t>(in.get<uint64_t>());
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (run == run_id_ && index < results_.size()) {
+                if (!results_[index]) {
+                    ++received_;
+                }
+                results_[index] = ResultCodec<T>::decode(in.rest());
+                if (received_ == results_.size()) {
+                    done_.notify_all();
+                }
+            }
+        } else if (type == FrameType::Failure) {
+            auto message = in.get_string();
+            if (run == 0 || run == current_run()) {
+                fail("Worker " + workers_[worker].to_string() + " failed: " + message);
+            }
+        }
+    }
+
+    uint64_t current_run() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return run_id_;
+    }
+
+    void fail(std::string message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!failure_) {
+            failure_ = std::move(message);
+        }
+        done_.notify_all();
+    }
+
+    std::vector<Endpoint> workers_;
+    Partitioner<T> partitioner_;
+    PartitionMap partition_;
+    std::vector<std::unique_ptr<TcpConnection>> connections_;
+    std::shared_ptr<const ExecutionPlan<T>> sent_plan_;
+    uint64_t plan_id_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable done_;
+    uint64_t run_id_ = 0;
+    std::vector<std::optional<ComputeResult<T>>> results_;
+    size_t received_ = 0;
+    std::optional<std::string> failure_;
+};
+
+} // namespace flowgraph
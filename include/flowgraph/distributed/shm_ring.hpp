@@ -0,0 +1,187 @@
+#pragma once
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace flowgraph {
+
+// Memory shared with processes forked after it is created
+class SharedArena {
+public:
+    explicit SharedArena(size_t size) : size_(size) {
+        data_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (data_ == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap shared arena");
+        }
+    }
+
+    ~SharedArena() {
+        ::munmap(data_, size_);
+    }
+
+    SharedArena(const SharedArena&) = delete;
+    SharedArena& operator=(const SharedArena&) = delete;
+
+    std::byte* data() const { return static_cast<std::byte*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    void* data_;
+    size_t size_;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "Shared-memory rings need address-free atomics");
+
+// Futex-backed wakeup word for one waiting process. Waiters read sequence(),
+// check their condition, then wait(sequence) - a ring() in between makes
+// the wait return at once. Ringing only enters the kernel when someone is
+// asleep.
+class Doorbell {
+public:
+    Doorbell() = default;
+
+    uint32_t sequence() const { return sequence_.load(std::memory_order_acquire); }
+
+    void ring() {
+        sequence_.fetch_add(1, std::memory_order_acq_rel);
+        if (sleepers_.load(std::memory_order_acquire) > 0) {
+            futex(FUTEX_WAKE, INT32_MAX, nullptr);
+        }
+    }
+
+    // Sleep until rung after sequence was read, or the timeout passes
+    void wait(uint32_t sequence, std::chrono::microseconds timeout) {
+        sleepers_.fetch_add(1, std::memory_order_acq_rel);
+        if (sequence_.load(std::memory_order_acquire) == sequence) {
+            timespec ts{static_cast<time_t>(timeout.count() / 1000000),
+                        static_cast<long>(timeout.count() % 1000000 * 1000)};
+            futex(FUTEX_WAIT, sequence, &ts);
+        }
+        sleepers_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+private:
+    // Shared between processes, so no FUTEX_PRIVATE_FLAG
+    void futex(int op, uint32_t value, const timespec* timeout) {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence_), op, value, timeout, nullptr, 0);
+    }
+
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint32_t> sleepers_{0};
+};
+
+// Single-producer single-consumer ring of variable-length records, laid out
+// in caller-provided (typically shared) memory. Records are written and
+// read in place, so a value crosses the ring with one copy in and one out.
+// Each record is an 8-byte length followed by the payload padded to 8
+// bytes; a record that would straddle the end is preceded by a skip marker
+// and starts again at offset zero.
+class SpscByteRing {
+public:
+    static constexpr size_t header_size = 192;
+
+    // Bytes of memory a ring with the given data capacity occupies
+    static size_t footprint(size_t capacity) { return header_size + padded(capacity); }
+
+    // Construct an empty ring in memory of footprint(capacity) bytes
+    static SpscByteRing* create(void* memory, size_t capacity) {
+        return new (memory) SpscByteRing(padded(capacity));
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Largest payload a single record can hold. Half the ring, so a record
+    // fits behind a skip marker wherever the previous one ended.
+    size_t max_record() const { return capacity_ / 2 - sizeof(uint64_t); }
+
+    // Producer: reserve a record of size bytes and let fill(std::byte*) write
+    // it in place. Returns false, writing nothing, while the ring is too full.
+    template<typename F>
+    bool try_write(size_t size, F&& fill) {
+        if (size > max_record()) {
+            throw std::length_error("Record of " + std::to_string(size) + " bytes exceeds ring capacity");
+        }
+        size_t need = sizeof(uint64_t) + padded(size);
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t offset = static_cast<size_t>(tail % capacity_);
+        size_t contiguous = capacity_ - offset;
+        size_t skip = need > contiguous ? contiguous : 0;
+        if (capacity_ - (tail - head) < skip + need) {
+            return false;
+        }
+        if (skip) {
+            uint64_t marker = skip_marker;
+            std::memcpy(data() + offset, &marker, sizeof(marker));
+            tail += skip;
+            offset = 0;
+        }
+        uint64_t length = size;
+        std::memcpy(data() + offset, &length, sizeof(length));
+        fill(data() + offset + sizeof(uint64_t));
+        tail_.store(tail + need, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: pass the oldest record to consume(std::span<const std::byte>)
+    // while it is still in the ring, then release its space. Returns false
+    // when the ring is empty.
+    template<typename F>
+    bool try_read(F&& consume) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(head % capacity_);
+        uint64_t length;
+        std::memcpy(&length, data() + offset, sizeof(length));
+        if (length == skip_marker) {
+            head += capacity_ - offset;
+            offset = 0;
+            std::memcpy(&length, data(), sizeof(length));
+        }
+        consume(std::span<const std::byte>(data() + offset + sizeof(uint64_t), static_cast<size_t>(length)));
+        head_.store(head + sizeof(uint64_t) + padded(static_cast<size_t>(length)), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr uint64_t skip_marker = ~uint64_t{0};
+
+    static size_t padded(size_t size) { return (size + 7) & ~size_t{7}; }
+
+    explicit SpscByteRing(size_t capacity) : capacity_(capacity) {}
+
+    std::byte* data() { return reinterpret_cast<std::byte*>(this) + header_size; }
+
+    // Producer and consumer positions on their own cache lines
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) const size_t capacity_;
+};
+
+static_assert(sizeof(SpscByteRing) <= SpscByteRing::header_size);
+
+} // namespace flowgraph
+#endif
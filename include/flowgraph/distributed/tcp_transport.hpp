@@ -0,0 +1,376 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace flowgraph {
+
+struct Endpoint {
+    std::string host;
+    uint16_t port = 0;
+
+    std::string to_string() const { return host + ":" + std::to_string(port); }
+    bool operator==(const Endpoint&) const = default;
+};
+
+namespace tcp {
+
+inline void set_no_delay(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+inline sockaddr_in resolve(const Endpoint& endpoint) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(endpoint.port);
+    if (::inet_pton(AF_INET, endpoint.host.c_str(), &address.sin_addr) == 1) {
+        return address;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* info = nullptr;
+    if (::getaddrinfo(endpoint.host.c_str(), nullptr, &hints, &info) != 0 || !info) {
+        throw std::runtime_error("Cannot resolve " + endpoint.host);
+    }
+    address.sin_addr = reinterpret_cast<sockaddr_in*>(info->ai_addr)->sin_addr;
+    ::freeaddrinfo(info);
+    return address;
+}
+
+// Listening socket on host:port; port 0 picks a free port, written back
+inline int listen_on(Endpoint& endpoint) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address = resolve(endpoint);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 64) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "listen on " + endpoint.to_string());
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    endpoint.port = ntohs(address.sin_port);
+    return fd;
+}
+
+inline int connect_to(const Endpoint& endpoint) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    sockaddr_in address = resolve(endpoint);
+    while (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (errno != EINTR) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "connect to " + endpoint.to_string());
+        }
+    }
+    set_no_delay(fd);
+    return fd;
+}
+
+} // namespace tcp
+
+enum class FrameType : uint8_t {
+    Plan = 1,       // coordinator -> worker: partitioned plan
+    Run = 2,        // coordinator -> worker: execute the current plan
+    Result = 3,     // worker -> peer or coordinator: one node's result
+    Failure = 4,    // worker -> coordinator: the worker cannot run
+    Cancel = 5      // coordinator -> worker: abandon a run
+};
+
+// Frames are a u32 length (of everything after it), a u8 type and the
+// payload, in native byte order; all hosts are assumed to share it.
+class FrameBuilder {
+public:
+    static constexpr size_t max_frame = size_t{1} << 30;
+
+    explicit FrameBuilder(FrameType type) : bytes_(sizeof(uint32_t)) {
+        put(static_cast<uint8_t>(type));
+    }
+
+    template<typename V>
+        requires std::is_trivially_copyable_v<V>
+    FrameBuilder& put(V value) {
+        std::memcpy(reserve(sizeof(V)), &value, sizeof(V));
+        return *this;
+    }
+
+    FrameBuilder& put_string(const std::string& s) {
+        put(static_cast<uint32_t>(s.size()));
+        std::memcpy(reserve(s.size()), s.data(), s.size());
+        return *this;
+    }
+
+    // Append size bytes for the caller to fill in place
+    std::byte* reserve(size_t size) {
+        size_t offset = bytes_.size();
+        bytes_.resize(offset + size);
+        return bytes_.data() + offset;
+    }
+
+    // Throws if the frame is larger than a TcpConnection accepts
+    std::vector<std::byte> finish() && {
+        if (bytes_.size() - sizeof(uint32_t) > max_frame) {
+            throw std::length_error("Frame exceeds the maximum frame size");
+        }
+        auto length = static_cast<uint32_t>(bytes_.size() - sizeof(uint32_t));
+        std::memcpy(bytes_.data(), &length, sizeof(length));
+        return std::move(bytes_);
+    }
+
+private:
+    std::vector<std::byte> bytes_;
+};
+
+class FrameReader {
+public:
+    explicit FrameReader(std::span<const std::byte> payload) : in_(payload) {}
+
+    template<typename V>
+        requires std::is_trivially_copyable_v<V>
+    V get() {
+        V value;
+        std::memcpy(&value, take(sizeof(V)).data(), sizeof(V));
+        return value;
+    }
+
+    std::string get_string() {
+        auto length = get<uint32_t>();
+        auto bytes = take(length);
+        return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    std::span<const std::byte> rest() const { return in_; }
+
+private:
+    std::span<const std::byte> take(size_t size) {
+        if (in_.size() < size) {
+            throw std::runtime_error("Truncated frame");
+        }
+        auto bytes = in_.first(size);
+        in_ = in_.subspan(size);
+        return bytes;
+    }
+
+    std::span<const std::byte> in_;
+};
+
+// Framed, full-duplex TCP connection. send() only queues: a writer thread
+// takes everything queued since its last write and sends it with a single
+// sendmsg, so frames produced back to back share packets and the sender
+// never waits on the network. A reader thread hands each incoming frame
+// to on_frame and calls on_close once the peer goes away.
+class TcpConnection {
+public:
+    static constexpr size_t max_frame = FrameBuilder::max_frame;
+
+    using frame_handler = std::function<void(FrameType, std::span<const std::byte>)>;
+    using close_handler = std::function<void()>;
+
+    TcpConnection(int fd, frame_handler on_frame, close_handler on_close = {})
+        : fd_(fd)
+        , on_frame_(std::move(on_frame))
+        , on_close_(std::move(on_close)) {
+        tcp::set_no_delay(fd_);
+        reader_ = std::thread([this] { read_loop(); });
+        writer_ = std::thread([this] { write_loop(); });
+    }
+
+    ~TcpConnection() {
+        close();
+    }
+
+    TcpConnection(const TcpConnection&) = delete;
+    TcpConnection& operator=(const TcpConnection&) = delete;
+
+    void send(std::vector<std::byte> frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closing_) {
+                return;
+            }
+            queue_.push_back(std::move(frame));
+        }
+        queued_.notify_one();
+    }
+
+    bool is_open() const { return open_.load(std::memory_order_acquire); }
+
+    // Stop both threads and close the socket; frames still queued are
+    // dropped. Must not be called from on_frame or on_close.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) {
+                return;
+            }
+            closing_ = closed_ = true;
+        }
+        queued_.notify_one();
+        ::shutdown(fd_, SHUT_RDWR);
+        writer_.join();
+        reader_.join();
+        ::close(fd_);
+    }
+
+private:
+    void read_loop() {
+        std::vector<std::byte> buffer(size_t{64} << 10);
+        size_t filled = 0;
+        while (true) {
+            if (filled == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            ssize_t n = ::recv(fd_, buffer.data() + filled, buffer.size() - filled, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            filled += static_cast<size_t>(n);
+
+            // Dispatch every complete frame in the buffer
+            size_t offset = 0;
+            bool valid = true;
+            while (filled - offset >= sizeof(uint32_t)) {
+                uint32_t length;
+                std::memcpy(&length, buffer.data() + offset, sizeof(length));
+                if (length == 0 || length > max_frame) {
+                    valid = false;
+                    break;
+                }
+                if (filled - offset - sizeof(uint32_t) < length) {
+                    if (buffer.size() < sizeof(uint32_t) + length) {
+                        buffer.resize(sizeof(uint32_t) + length);
+                    }
+                    break;
+                }
+                const std::byte* frame = buffer.data() + offset + sizeof(uint32_t);
+                try {
+                    on_frame_(static_cast<FrameType>(frame[0]), std::span<const std::byte>(frame + 1, length - 1));
+                } catch (const std::exception&) {
+                    // A frame the handler cannot parse; drop the peer
+                    valid = false;
+                    break;
+                }
+                offset += sizeof(uint32_t) + length;
+            }
+            if (!valid) {
+                break;
+            }
+            std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+            filled -= offset;
+        }
+        open_.store(false, std::memory_order_release);
+        if (on_close_) {
+            on_close_();
+        }
+    }
+
+    void write_loop() {
+        std::vector<std::vector<std::byte>> batch;
+        std::vector<iovec> iov;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                queued_.wait(lock, [this] { return !queue_.empty() || closing_; });
+                if (closing_) {
+                    return;
+                }
+                batch.swap(queue_);
+            }
+            iov.clear();
+            for (auto& frame : batch) {
+                iov.push_back({frame.data(), frame.size()});
+            }
+            if (!write_all(iov)) {
+                // The peer is gone; later sends are dropped like after close()
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    closing_ = true;
+                    queue_.clear();
+                }
+                ::shutdown(fd_, SHUT_RDWR);
+                return;
+            }
+            batch.clear();
+        }
+    }
+
+    // False once the connection is broken (EPIPE, ECONNRESET, ...).
+    // MSG_NOSIGNAL keeps a write to a dead peer from raising SIGPIPE.
+    bool write_all(std::vector<iovec>& iov) {
+        size_t first = 0;
+        while (first < iov.size()) {
+            msghdr msg{};
+            msg.msg_iov = iov.data() + first;
+            msg.msg_iovlen = std::min<size_t>(iov.size() - first, IOV_MAX);
+            ssize_t n = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            // Skip what was written, possibly part of a frame
+            auto written = static_cast<size_t>(n);
+            while (first < iov.size() && written >= iov[first].iov_len) {
+                written -= iov[first].iov_len;
+                ++first;
+            }
+            if (first < iov.size()) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+        return true;
+    }
+
+    int fd_;
+    frame_handler on_frame_;
+    close_handler on_close_;
+    std::atomic<bool> open_{true};
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::vector<std::vector<std::byte>> queue_;
+    bool closing_ = false;
+    bool closed_ = false;
+
+    std::thread reader_;
+    std::thread writer_;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,180 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../core/compute_result.hpp"
+#include "../core/error_state.hpp"
+
+namespace flowgraph {
+
+// Byte encoding of node values for transport between processes or hosts.
+// Trivially copyable values and contiguous containers of them are copied
+// as raw bytes, with no per-element work; other value types need a
+// ValueCodec specialization providing size, encode and decode.
+template<typename T>
+struct ValueCodec;
+
+template<typename T>
+    requires std::is_trivially_copyable_v<T>
+struct ValueCodec<T> {
+    static size_t size(const T&) { return sizeof(T); }
+
+    static void encode(const T& value, std::byte* out) {
+        std::memcpy(out, &value, sizeof(T));
+    }
+
+    static T decode(std::span<const std::byte> in) {
+        if (in.size() != sizeof(T)) {
+            throw std::runtime_error("Encoded value has the wrong size");
+        }
+        T value;
+        std::memcpy(&value, in.data(), sizeof(T));
+        return value;
+    }
+};
+
+template<typename E>
+    requires std::is_trivially_copyable_v<E>
+struct ValueCodec<std::vector<E>> {
+    static size_t size(const std::vector<E>& value) { return value.size() * sizeof(E); }
+
+    static void encode(const std::vector<E>& value, std::byte* out) {
+        if (!value.empty()) {
+            std::memcpy(out, value.data(), value.size() * sizeof(E));
+        }
+    }
+
+    static std::vector<E> decode(std::span<const std::byte> in) {
+        if (in.size() % sizeof(E) != 0) {
+            throw std::runtime_error("Encoded vector has a partial element");
+        }
+        std::vector<E> value(in.size() / sizeof(E));
+        if (!value.empty()) {
+            std::memcpy(value.data(), in.data(), in.size());
+        }
+        return value;
+    }
+};
+
+template<typename C>
+struct ValueCodec<std::basic_string<C>> {
+    static size_t size(const std::basic_string<C>& value) { return value.size() * sizeof(C); }
+
+    static void encode(const std::basic_string<C>& value, std::byte* out) {
+        std::memcpy(out, value.data(), value.size() * sizeof(C));
+    }
+
+    static std::basic_string<C> decode(std::span<const std::byte> in) {
+        if (in.size() % sizeof(C) != 0) {
+            throw std::runtime_error("Encoded string has a partial character");
+        }
+        std::basic_string<C> value(in.size() / sizeof(C), C{});
+        std::memcpy(value.data(), in.data(), in.size());
+        return value;
+    }
+};
+
+template<typename T>
+concept EncodableValue = requires(const T& value, std::byte* out, std::span<const std::byte> in) {
+    { ValueCodec<T>::size(value) } -> std::convertible_to<size_t>;
+    ValueCodec<T>::encode(value, out);
+    { ValueCodec<T>::decode(in) } -> std::same_as<T>;
+};
+
+// Encoding of a node's ComputeResult: a u32 tag (0 value, 1 error), then
+// either the value's bytes or the error's type, message, source node and
+// propagation path
+template<typename T>
+    requires EncodableValue<T>
+struct ResultCodec {
+    static size_t size(const ComputeResult<T>& result) {
+        if (!result.has_error()) {
+            return sizeof(uint32_t) + ValueCodec<T>::size(result.value());
+        }
+        const auto& error = result.error();
+        size_t size = 3 * sizeof(uint32_t) + string_size(error.message()) + string_size(error.source_node().value_or(""));
+        for (const auto& node : error.propagation_path()) {
+            size += string_size(node);
+        }
+        return size + sizeof(uint32_t);
+    }
+
+    static void encode(const ComputeResult<T>& result, std::byte* out) {
+        if (!result.has_error()) {
+            put<uint32_t>(out, 0);
+            ValueCodec<T>::encode(result.value(), out);
+            return;
+        }
+        const auto& error = result.error();
+        put<uint32_t>(out, 1);
+        put<uint32_t>(out, static_cast<uint32_t>(error.type()));
+        put_string(out, error.message());
+        put<uint32_t>(out, error.source_node() ? 1 : 0);
+        put_string(out, error.source_node().value_or(""));
+        put<uint32_t>(out, static_cast<uint32_t>(error.propagation_path().size()));
+        for (const auto& node : error.propagation_path()) {
+            put_string(out, node);
+        }
+    }
+
+    static ComputeResult<T> decode(std::span<const std::byte> in) {
+        if (get<uint32_t>(in) == 0) {
+            return ComputeResult<T>(ValueCodec<T>::decode(in));
+        }
+        auto type = static_cast<ErrorType>(get<uint32_t>(in));
+        ErrorState error(type, get_string(in));
+        bool has_source = get<uint32_t>(in) != 0;
+        auto source = get_string(in);
+        if (has_source) {
+            error.set_source_node(source);
+        }
+        for (uint32_t count = get<uint32_t>(in); count > 0; --count) {
+            error.add_propagation_path(get_string(in));
+        }
+        return ComputeResult<T>(std::move(error));
+    }
+
+private:
+    static size_t string_size(const std::string& s) { return sizeof(uint32_t) + s.size(); }
+
+    template<typename V>
+    static void put(std::byte*& out, V value) {
+        std::memcpy(out, &value, sizeof(V));
+        out += sizeof(V);
+    }
+
+    static void put_string(std::byte*& out, const std::string& s) {
+        put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+        std::memcpy(out, s.data(), s.size());
+        out += s.size();
+    }
+
+    template<typename V>
+    static V get(std::span<const std::byte>& in) {
+        if (in.size() < sizeof(V)) {
+            throw std::runtime_error("Encoded result is truncated");
+        }
+        V value;
+        std::memcpy(&value, in.data(), sizeof(V));
+        in = in.subspan(sizeof(V));
+        return value;
+    }
+
+    static std::string get_string(std::span<const std::byte>& in) {
+        auto length = get<uint32_t>(in);
+        if (in.size() < length) {
+            throw std::runtime_error("Encoded result is truncated");
+        }
+        std::string s(reinterpret_cast<const char*>(in.data()), length);
+        in = in.subspan(length);
+        return s;
+    }
+};
+
+} // namespace flowgraph
@@ -0,0 +1,494 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapped_file.hpp"
+#include "../async/blocking_region.hpp"
+#include "../core/interfaces.hpp"
+#include "../core/node.hpp"
+
+namespace flowgraph {
+
+// Element type recorded for a column; Bytes marks opaque fixed-width values
+enum class ColumnType : uint32_t {
+    Int8, Int16, Int32, Int64,
+    UInt8, UInt16, UInt32, UInt64,
+    Float32, Float64,
+    Bytes
+};
+
+template<typename T>
+constexpr ColumnType column_type_of() {
+    if constexpr (std::is_same_v<T, float>) return ColumnType::Float32;
+    else if constexpr (std::is_same_v<T, double>) return ColumnType::Float64;
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        if constexpr (sizeof(T) == 1) return ColumnType::Int8;
+        else if constexpr (sizeof(T) == 2) return ColumnType::Int16;
+        else if constexpr (sizeof(T) == 4) return ColumnType::Int32;
+        else if constexpr (sizeof(T) == 8) return ColumnType::Int64;
+        else return ColumnType::Bytes;
+    } else if constexpr (std::is_integral_v<T>) {
+        if constexpr (sizeof(T) == 1) return ColumnType::UInt8;
+        else if constexpr (sizeof(T) == 2) return ColumnType::UInt16;
+        else if constexpr (sizeof(T) == 4) return ColumnType::UInt32;
+        else if constexpr (sizeof(T) == 8) return ColumnType::UInt64;
+        else return ColumnType::Bytes;
+    } else {
+        return ColumnType::Bytes;
+    }
+}
+
+struct ColumnSpec {
+    std::string name;
+    ColumnType type;
+    uint32_t width;     // bytes per value
+};
+
+// Columnar file layout (native byte order):
+//
+//   header   "FGCOLUM1", u32 version, u32 column count, u64 rows per chunk,
+//            then per column u32 type, u32 width, u32 name length, name;
+//            padded to 8 bytes
+//   chunks   per column, that chunk's values back to back, each column
+//            padded to 8 bytes so it can be viewed in place when mapped
+//   footer   per chunk u64 offset, u64 rows
+//   trailer  u64 footer offset, u64 chunk count, "FGCOLEND"
+namespace columnar {
+
+inline constexpr char header_magic[8] = {'F', 'G', 'C', 'O', 'L', 'U', 'M', '1'};
+inline constexpr char trailer_magic[8] = {'F', 'G', 'C', 'O', 'L', 'E', 'N', 'D'};
+inline constexpr uint32_t version = 1;
+inline constexpr size_t alignment = 8;
+inline constexpr size_t trailer_size = 24;
+
+inline size_t padded(size_t size) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+} // namespace columnar
+
+// Writes rows of fixed-width columns to a columnar file. Rows are filled in
+// place in a front chunk buffer; a full chunk is swapped with the back
+// buffer, which a background thread writes out, so the producer only waits
+// when the disk falls a whole chunk behind.
+class ColumnarWriter {
+public:
+    ColumnarWriter(const std::string& path, std::vector<ColumnSpec> columns, size_t rows_per_chunk = 4096)
+        : columns_(std::move(columns))
+        , rows_per_chunk_(rows_per_chunk) {
+        if (columns_.empty() || rows_per_chunk_ == 0) {
+            throw std::invalid_argument("ColumnarWriter needs at least one column and a non-empty chunk");
+        }
+        size_t chunk_bytes = 0;
+        for (const auto& column : columns_) {
+            if (column.width == 0) {
+                throw std::invalid_argument("Column " + column.name + " has zero width");
+            }
+            column_offsets_.push_back(chunk_bytes);
+            chunk_bytes += columnar::padded(column.width * rows_per_chunk_);
+        }
+        front_.resize(chunk_bytes);
+        back_.resize(chunk_bytes);
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        try {
+            write_header();
+        } catch (...) {
+            ::close(fd_);
+            throw;
+        }
+        writer_ = std::thread([this] { run(); });
+    }
+
+    ~ColumnarWriter() {
+        try {
+            close();
+        } catch (...) {
+            // Errors are only reported through an explicit close()
+        }
+    }
+
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+    const std::vector<ColumnSpec>& columns() const { return columns_; }
+
+    // Where column's value for the row being filled goes
+    std::byte* slot(size_t column) {
+        return front_.data() + column_offsets_[column] + front_rows_ * columns_[column].width;
+    }
+
+    // Finish the row being filled; hands the chunk off once it is full
+    void commit_row() {
+        if (++front_rows_ == rows_per_chunk_) {
+            hand_off();
+        }
+    }
+
+    // Rows committed so far, including those not yet on disk
+    uint64_t row_count() const { return rows_written_ + front_rows_; }
+
+    // Write the last partial chunk and the footer, then close the file.
+    // Rethrows the first write error.
+    void close() {
+        if (fd_ < 0) {
+            return;
+        }
+        if (front_rows_ > 0) {
+            hand_off();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_one();
+        writer_.join();
+
+        int fd = std::exchange(fd_, -1);
+        try {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            write_footer(fd);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw std::system_error(errno, std::generic_category(), "close");
+        }
+    }
+
+private:
+    struct ChunkIndex {
+        uint64_t offset;
+        uint64_t rows;
+    };
+
+    void hand_off() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (back_pending_) {
+            // The writer is a whole chunk behind
+            BlockingRegion region;
+            written_.wait(lock, [this] { return !back_pending_; });
+        }
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        std::swap(front_, back_);
+        back_rows_ = front_rows_;
+        back_pending_ = true;
+        rows_written_ += front_rows_;
+        front_rows_ = 0;
+        lock.unlock();
+        ready_.notify_one();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            ready_.wait(lock, [this] { return back_pending_ || stopping_; });
+            if (!back_pending_) {
+                return;
+            }
+            lock.unlock();
+            try {
+                if (!error_) {
+                    write_chunk();
+                }
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+            lock.lock();
+            back_pending_ = false;
+            written_.notify_all();
+        }
+    }
+
+    // Writer thread only (and close() once it has joined)
+    void write_chunk() {
+        ChunkIndex index{offset_, back_rows_};
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            // Padding bytes past the rows are stale data; zero them so the
+            // file does not depend on what the buffer held before
+            size_t bytes = columns_[c].width * back_rows_;
+            size_t padded = columnar::padded(bytes);
+            std::byte* column = back_.data() + column_offsets_[c];
+            std::memset(column + bytes, 0, padded - bytes);
+            write_all(fd_, column, padded);
+        }
+        chunks_.push_back(index);
+    }
+
+    void write_header() {
+        std::vector<std::byte> header;
+        auto append = [&header](const void* data, size_t size) {
+            auto* bytes = static_cast<const std::byte*>(data);
+            header.insert(header.end(), bytes, bytes + size);
+        };
+        uint32_t count = static_cast<uint32_t>(columns_.size());
+        uint64_t rows = rows_per_chunk_;
+        append(columnar::header_magic, sizeof(columnar::header_magic));
+        append(&columnar::version, sizeof(columnar::version));
+        append(&count, sizeof(count));
+        append(&rows, sizeof(rows));
+        for (const auto& column : columns_) {
+            uint32_t type = static_cast<uint32_t>(column.type);
+            uint32_t length = static_cast<uint32_t>(column.name.size());
+            append(&type, sizeof(type));
+            append(&column.width, sizeof(column.width));
+            append(&length, sizeof(length));
+            append(column.name.data(), column.name.size());
+        }
+        header.resize(columnar::padded(header.size()));
+        write_all(fd_, header.data(), header.size());
+    }
+
+    void write_footer(int fd) {
+        uint64_t footer_offset = offset_;
+        uint64_t chunk_count = chunks_.size();
+        write_all(fd, chunks_.data(), chunks_.size() * sizeof(ChunkIndex));
+        write_all(fd, &footer_offset, sizeof(footer_offset));
+        write_all(fd, &chunk_count, sizeof(chunk_count));
+        write_all(fd, columnar::trailer_magic, sizeof(columnar::trailer_magic));
+    }
+
+    void write_all(int fd, const void* data, size_t size) {
+        auto* bytes = static_cast<const char*>(data);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pwrite(fd, bytes + done, size - done, static_cast<off_t>(offset_ + done));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "pwrite");
+            }
+            done += static_cast<size_t>(n);
+        }
+        offset_ += size;
+    }
+
+    std::vector<ColumnSpec> columns_;
+    std::vector<size_t> column_offsets_;
+    size_t rows_per_chunk_;
+    int fd_ = -1;
+
+    // Producer side
+    std::vector<std::byte> front_;
+    size_t front_rows_ = 0;
+    uint64_t rows_written_ = 0;
+
+    // Handed between producer and writer under mutex_
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable written_;
+    std::vector<std::byte> back_;
+    size_t back_rows_ = 0;
+    bool back_pending_ = false;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+
+    // Writer side
+    uint64_t offset_ = 0;
+    std::vector<ChunkIndex> chunks_;
+    std::thread writer_;
+};
+
+// Reads a columnar file through a read-only mapping; columns come back as
+// views into the mapping, so nothing is copied or parsed per row.
+class ColumnarReader {
+public:
+    explicit ColumnarReader(const std::string& path)
+        : file_(MappedFile::open(path)) {
+        const std::byte* data = file_->data();
+        size_t size = file_->size();
+        if (size < sizeof(columnar::header_magic) + 16 + columnar::trailer_size ||
+            std::memcmp(data, columnar::header_magic, sizeof(columnar::header_magic)) != 0 ||
+            std::memcmp(data + size - sizeof(columnar::trailer_magic), columnar::trailer_magic,
+                        sizeof(columnar::trailer_magic)) != 0) {
+            throw std::runtime_error(path + " is not a complete columnar file");
+        }
+
+        size_t pos = sizeof(columnar::header_magic);
+        auto read = [&](void* out, size_t bytes) {
+            if (pos + bytes > size) {
+                throw std::runtime_error(path + " has a truncated header");
+            }
+            std::memcpy(out, data + pos, bytes);
+            pos += bytes;
+        };
+        uint32_t version = 0, count = 0;
+        uint64_t rows_per_chunk = 0;
+        read(&version, sizeof(version));
+        if (version != columnar::version) {
+            throw std::runtime_error(path + " has unsupported columnar version " + std::to_string(version));
+        }
+        read(&count, sizeof(count));
+        read(&rows_per_chunk, sizeof(rows_per_chunk));
+        for (uint32_t c = 0; c < count; ++c) {
+            uint32_t type = 0, width = 0, length = 0;
+            read(&type, sizeof(type));
+            read(&width, sizeof(width));
+            read(&length, sizeof(length));
+            std::string name(length, '\0');
+            read(name.data(), length);
+            columns_.push_back({std::move(name), static_cast<ColumnType>(type), width});
+        }
+
+        uint64_t footer_offset = 0, chunk_count = 0;
+        std::memcpy(&footer_offset, data + size - columnar::trailer_size, sizeof(footer_offset));
+        std::memcpy(&chunk_count, data + size - columnar::trailer_size + 8, sizeof(chunk_count));
+        if (footer_offset + chunk_count * 16 + columnar::trailer_size != size) {
+            throw std::runtime_error(path + " has a corrupt footer");
+        }
+        for (uint64_t i = 0; i < chunk_count; ++i) {
+            uint64_t entry[2];
+            std::memcpy(entry, data + footer_offset + i * sizeof(entry), sizeof(entry));
+            chunk_offsets_.push_back(entry[0]);
+            chunk_rows_.push_back(entry[1]);
+            row_count_ += entry[1];
+        }
+    }
+
+    const std::vector<ColumnSpec>& columns() const { return columns_; }
+    size_t chunk_count() const { return chunk_rows_.size(); }
+    size_t chunk_rows(size_t chunk) const { return chunk_rows_.at(chunk); }
+    uint64_t row_count() const { return row_count_; }
+    const std::shared_ptr<const MappedFile>& file() const { return file_; }
+
+    size_t column_index(std::string_view name) const {
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            if (columns_[c].name == name) {
+                return c;
+            }
+        }
+        throw std::out_of_range("No column named " + std::string(name));
+    }
+
+    // One chunk's values of a column, viewed in place
+    template<typename V>
+    MappedView<V> column(size_t chunk, size_t column) const {
+        const auto& spec = columns_.at(column);
+        if (spec.width != sizeof(V) ||
+            (column_type_of<V>() != ColumnType::Bytes && spec.type != column_type_of<V>())) {
+            throw std::invalid_argument("Column " + spec.name + " does not hold this element type");
+        }
+        size_t rows = chunk_rows_.at(chunk);
+        size_t offset = chunk_offsets_[chunk];
+        for (size_t c = 0; c < column; ++c) {
+            offset += columnar::padded(columns_[c].width * rows);
+        }
+        return MappedView<V>(file_, offset, rows);
+    }
+
+    template<typename V>
+    MappedView<V> column(size_t chunk, std::string_view name) const {
+        return column<V>(chunk, column_index(name));
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    std::vector<ColumnSpec> columns_;
+    std::vector<uint64_t> chunk_offsets_;
+    std::vector<uint64_t> chunk_rows_;
+    uint64_t row_count_ = 0;
+};
+
+// Appends one row per run with the latest value of each selected node to a
+// columnar file. Values are captured by completion callbacks as the nodes
+// compute, so recording a run copies a few fixed-width values into the
+// writer's buffer instead of calling compute() on every node. Columns are
+// "run" (u64), then per node its value and "<name>.valid" (u8, 0 when the
+// node failed or has not produced a value).
+template<typename T>
+class ColumnarSink {
+    static_assert(std::is_trivially_copyable_v<T>, "Columnar values must be trivially copyable");
+
+public:
+    ColumnarSink(const std::string& path, std::vector<std::shared_ptr<Node<T>>> nodes,
+                 size_t rows_per_chunk = 4096)
+        : nodes_(std::move(nodes))
+        , latest_(std::make_shared<Latest>(nodes_.size()))
+        , writer_(path, make_columns(nodes_), rows_per_chunk) {
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            // The callbacks share latest_, so they stay safe if the sink goes
+            // away before the nodes do
+            nodes_[i]->add_completion_callback([latest = latest_, i](const ComputeResult<T>& result) {
+                if (!result.has_error()) {
+                    std::lock_guard<std::mutex> lock(latest->mutex);
+                    latest->values[i] = result.value();
+                    latest->has_value[i] = 1;
+                }
+            });
+        }
+    }
+
+    // Record the outcome of a run of graph. Call after the run completes.
+    void record(const IGraph& graph, uint64_t run_id) {
+        std::memcpy(writer_.slot(0), &run_id, sizeof(run_id));
+        {
+            std::lock_guard<std::mutex> lock(latest_->mutex);
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                uint8_t valid = latest_->has_value[i];
+                std::memcpy(writer_.slot(1 + 2 * i), &latest_->values[i], sizeof(T));
+                if (valid && graph.get_node_error(nodes_[i]->name())) {
+                    valid = 0;
+                }
+                std::memcpy(writer_.slot(2 + 2 * i), &valid, sizeof(valid));
+            }
+        }
+        writer_.commit_row();
+    }
+
+    uint64_t row_count() const { return writer_.row_count(); }
+
+    // Flush and finalize the file; rethrows any write error
+    void close() { writer_.close(); }
+
+private:
+    struct Latest {
+        explicit Latest(size_t count) : values(count), has_value(count, 0) {}
+        std::mutex mutex;
+        std::vector<T> values;
+        std::vector<uint8_t> has_value;
+    };
+
+    static std::vector<ColumnSpec> make_columns(const std::vector<std::shared_ptr<Node<T>>>& nodes) {
+        std::vector<ColumnSpec> columns;
+        columns.push_back({"run", ColumnType::UInt64, sizeof(uint64_t)});
+        for (const auto& node : nodes) {
+            if (!node) {
+                throw std::invalid_argument("ColumnarSink given a null node");
+            }
+            columns.push_back({node->name(), column_type_of<T>(), static_cast<uint32_t>(sizeof(T))});
+            columns.push_back({node->name() + ".valid", ColumnType::UInt8, 1});
+        }
+        return columns;
+    }
+
+    std::vector<std::shared_ptr<Node<T>>> nodes_;
+    std::shared_ptr<Latest> latest_;
+    ColumnarWriter writer_;
+};
+
+} // namespace flowgraph
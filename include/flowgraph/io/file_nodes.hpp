@@ -0,0 +1,160 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io_reactor.hpp"
+#include "thread_io_reactor.hpp"
+#include "uring_io_reactor.hpp"
+#include "../core/node.hpp"
+
+namespace flowgraph {
+
+enum class IoBackend {
+    Auto,       // io_uring when the kernel allows it, threads otherwise
+    Uring,
+    Threads
+};
+
+inline std::shared_ptr<IoReactor> make_io_reactor(IoBackend backend = IoBackend::Auto) {
+#ifdef __linux__
+    if (backend == IoBackend::Uring || (backend == IoBackend::Auto && UringIoReactor::available())) {
+        return std::make_shared<UringIoReactor>();
+    }
+#else
+    if (backend == IoBackend::Uring) {
+        throw std::runtime_error("io_uring is only available on Linux");
+    }
+#endif
+    return std::make_shared<ThreadIoReactor>();
+}
+
+// Owning file descriptor
+class FileHandle {
+public:
+    FileHandle(const std::string& path, int flags, mode_t mode = 0644)
+        : fd_(::open(path.c_str(), flags | O_CLOEXEC, mode)) {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+    }
+
+    ~FileHandle() {
+        ::close(fd_);
+    }
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd() const { return fd_; }
+
+    uint64_t size() const {
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+        return static_cast<uint64_t>(st.st_size);
+    }
+
+private:
+    int fd_;
+};
+
+// Chunking shared by the file nodes
+struct FileTransferOptions {
+    size_t chunk_size = size_t{1} << 20;
+    size_t max_in_flight = 8;
+};
+
+// Source node reading a byte range of a file (the whole file by default)
+// into a buffer it owns, without blocking a pool thread on the disk. The
+// node's value is the number of bytes read; downstream nodes consume
+// data().
+template<typename T>
+class FileSourceNode : public Node<T> {
+public:
+    FileSourceNode(std::string name, std::shared_ptr<IoReactor> reactor, std::string path,
+                   uint64_t offset = 0, std::optional<size_t> length = std::nullopt,
+                   FileTransferOptions options = {})
+        : Node<T>(std::move(name))
+        , reactor_(std::move(reactor))
+        , path_(std::move(path))
+        , offset_(offset)
+        , length_(length)
+        , options_(options) {}
+
+    // Valid once the node has computed
+    const std::vector<std::byte>& data() const { return data_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        FileHandle file(path_, O_RDONLY);
+        size_t length = length_ ? *length_ : 0;
+        if (!length_) {
+            uint64_t size = file.size();
+            length = size > offset_ ? static_cast<size_t>(size - offset_) : 0;
+        }
+        data_.resize(length);
+        size_t read = co_await transfer_chunked(*reactor_, IoOp::Read, file.fd(), data_.data(), length,
+                                                offset_, options_.chunk_size, options_.max_in_flight);
+        data_.resize(read);
+        co_return ComputeResult<T>(static_cast<T>(read));
+    }
+
+private:
+    std::shared_ptr<IoReactor> reactor_;
+    std::string path_;
+    uint64_t offset_;
+    std::optional<size_t> length_;
+    FileTransferOptions options_;
+    std::vector<std::byte> data_;
+};
+
+// Sink node writing the bytes produced by `source` (typically a view of an
+// upstream node's buffer) to a file at the given offset. The file is
+// created if needed and, when writing from offset zero, truncated first.
+// The node's value is the number of bytes written.
+template<typename T>
+class FileSinkNode : public Node<T> {
+public:
+    using source_type = std::function<std::span<const std::byte>()>;
+
+    FileSinkNode(std::string name, std::shared_ptr<IoReactor> reactor, std::string path,
+                 source_type source, uint64_t offset = 0, FileTransferOptions options = {})
+        : Node<T>(std::move(name))
+        , reactor_(std::move(reactor))
+        , path_(std::move(path))
+        , source_(std::move(source))
+        , offset_(offset)
+        , options_(options) {}
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        FileHandle file(path_, O_WRONLY | O_CREAT | (offset_ == 0 ? O_TRUNC : 0));
+        auto bytes = source_();
+        // The reactor only reads from the buffer
+        auto* buffer = const_cast<std::byte*>(bytes.data());
+        size_t written = co_await transfer_chunked(*reactor_, IoOp::Write, file.fd(), buffer, bytes.size(),
+                                                   offset_, options_.chunk_size, options_.max_in_flight);
+        co_return ComputeResult<T>(static_cast<T>(written));
+    }
+
+private:
+    std::shared_ptr<IoReactor> reactor_;
+    std::string path_;
+    source_type source_;
+    uint64_t offset_;
+    FileTransferOptions options_;
+};
+
+} // namespace flowgraph
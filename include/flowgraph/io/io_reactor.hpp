@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <system_error>
+#include <vector>
+#include "../async/task.hpp"
+
+namespace flowgraph {
+
+enum class IoOp {
+    Read,
+    Write
+};
+
+// One positional read or write handed to a reactor
+struct IoRequest {
+    IoOp op = IoOp::Read;
+    int fd = -1;
+    void* buffer = nullptr;
+    size_t length = 0;
+    uint64_t offset = 0;
+    // Bytes transferred, or -errno
+    int64_t result = 0;
+    std::coroutine_handle<> waiter;
+};
+
+// Completes file I/O off the calling thread. Awaiting an operation suspends
+// the coroutine, which is resumed on the reactor's completion thread once
+// the kernel is done, so code after the co_await should stay short and hand
+// heavy work to downstream nodes. The graph executors resume such a node's
+// successors on the thread pool, never on the completion thread.
+class IoReactor {
+public:
+    class Operation;
+
+    virtual ~IoReactor() = default;
+
+    // Start the request; the reactor stores the result and resumes
+    // request.waiter. The request must stay alive until then.
+    virtual void submit(IoRequest& request) = 0;
+
+    virtual const char* backend_name() const = 0;
+
+    Operation read(int fd, void* buffer, size_t length, uint64_t offset);
+    Operation write(int fd, const void* buffer, size_t length, uint64_t offset);
+
+protected:
+    static void complete(IoRequest& request, int64_t result) {
+        request.result = result;
+        request.waiter.resume();
+    }
+};
+
+// Awaitable for a single request; yields the bytes transferred (zero at end
+// of file) and throws std::system_error on failure
+class IoReactor::Operation {
+public:
+    Operation(IoReactor& reactor, IoRequest request)
+        : reactor_(reactor)
+        , request_(request) {}
+
+    bool await_ready() const noexcept { return request_.length == 0; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        request_.waiter = h;
+        reactor_.submit(request_);
+    }
+
+    size_t await_resume() const {
+        if (request_.result < 0) {
+            throw std::system_error(static_cast<int>(-request_.result), std::generic_category(),
+                                    request_.op == IoOp::Read ? "read" : "write");
+        }
+        return static_cast<size_t>(request_.result);
+    }
+
+private:
+    IoReactor& reactor_;
+    IoRequest request_;
+};
+
+inline IoReactor::Operation IoReactor::read(int fd, void* buffer, size_t length, uint64_t offset) {
+    return Operation(*this, IoRequest{IoOp::Read, fd, buffer, length, offset, 0, {}});
+}
+
+inline IoReactor::Operation IoReactor::write(int fd, const void* buffer, size_t length, uint64_t offset) {
+    return Operation(*this, IoRequest{IoOp::Write, fd, const_cast<void*>(buffer), length, offset, 0, {}});
+}
+
+// Transfer exactly length bytes, reissuing short reads and writes. Reads
+// stop early at end of file; returns the bytes transferred.
+inline Task<size_t> transfer_exact(IoReactor& reactor, IoOp op, int fd, std::byte* buffer,
+                                   size_t length, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        size_t n = op == IoOp::Read
+            ? co_await reactor.read(fd, buffer + done, length - done, offset + done)
+            : co_await reactor.write(fd, buffer + done, length - done, offset + done);
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    co_return done;
+}
+
+// Transfer [offset, offset + length) in chunk_size requests with up to
+// max_in_flight of them outstanding at once. Returns the bytes transferred,
+// which is short only when a read reached end of file. Chunks already in
+// flight are always awaited, even after a failure, before returning or
+// rethrowing the first error.
+inline Task<size_t> transfer_chunked(IoReactor& reactor, IoOp op, int fd, std::byte* buffer,
+                                     size_t length, uint64_t offset,
+                                     size_t chunk_size, size_t max_in_flight) {
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    const size_t chunks = (length + chunk_size - 1) / chunk_size;
+    std::vector<std::optional<Task<size_t>>> window(std::min(chunks, std::max<size_t>(max_in_flight, 1)));
+    auto chunk_length = [&](size_t c) { return std::min(chunk_size, length - c * chunk_size); };
+
+    size_t issued = 0;
+    size_t total = 0;
+    bool stop = false;
+    std::exception_ptr error;
+    for (size_t c = 0; c < chunks; ++c) {
+        while (!stop && issued < chunks && issued - c < window.size()) {
+            size_t begin = issued * chunk_size;
+            window[issued % window.size()].emplace(
+                transfer_exact(reactor, op, fd, buffer + begin, chunk_length(issued), offset + begin));
+            ++issued;
+        }
+        if (c >= issued) {
+            break;
+        }
+        auto& slot = window[c % window.size()];
+        try {
+            size_t n = co_await *slot;
+            total += n;
+            stop = stop || n < chunk_length(c);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+        }
+        slot.reset();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    co_return total;
+}
+
+} // namespace flowgraph
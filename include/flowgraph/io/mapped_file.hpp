@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../core/node.hpp"
+
+namespace flowgraph {
+
+// Expected access pattern for a mapped region, passed to the kernel as an
+// madvise hint
+enum class AccessPattern {
+    Normal,
+    Sequential,   // Aggressive readahead, pages dropped soon after use
+    Random,       // No readahead
+    WillNeed      // Start paging the region in now
+};
+
+// Read-only private mapping of a whole file. Pages are only read from disk
+// when first touched, so consumers of a small region never pay for the rest.
+class MappedFile {
+public:
+    static std::shared_ptr<const MappedFile> open(const std::string& path) {
+        return std::shared_ptr<const MappedFile>(new MappedFile(path));
+    }
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::byte* data() const { return static_cast<const std::byte*>(data_); }
+    size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+
+    // Hint how [offset, offset + length) will be read. Best effort: returns
+    // false when the kernel rejects the hint.
+    bool advise(size_t offset, size_t length, AccessPattern pattern) const {
+        if (!data_ || length == 0 || offset >= size_) {
+            return false;
+        }
+        // madvise works on whole pages
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t begin = offset - offset % page;
+        size_t end = std::min(offset + length, size_);
+        int advice = POSIX_MADV_NORMAL;
+        switch (pattern) {
+            case AccessPattern::Normal: advice = POSIX_MADV_NORMAL; break;
+            case AccessPattern::Sequential: advice = POSIX_MADV_SEQUENTIAL; break;
+            case AccessPattern::Random: advice = POSIX_MADV_RANDOM; break;
+            case AccessPattern::WillNeed: advice = POSIX_MADV_WILLNEED; break;
+        }
+        return ::posix_madvise(static_cast<char*>(data_) + begin, end - begin, advice) == 0;
+    }
+
+private:
+    explicit MappedFile(const std::string& path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap " + path);
+            }
+            data_ = data;
+        }
+        // The mapping stays valid without the descriptor
+        ::close(fd);
+    }
+
+    std::string path_;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Typed read-only view into a mapped file. Copies share the mapping, which
+// stays alive as long as any view does, so a view is cheap to pass around
+// as a node value.
+template<typename T>
+class MappedView {
+    static_assert(std::is_trivially_copyable_v<T>, "Mapped elements must be trivially copyable");
+
+public:
+    using element_type = const T;
+
+    MappedView() = default;
+
+    // count elements starting byte_offset bytes into the file
+    MappedView(std::shared_ptr<const MappedFile> file, size_t byte_offset, size_t count)
+        : file_(std::move(file)) {
+        if (!file_) {
+            throw std::invalid_argument("MappedView needs a mapped file");
+        }
+        if (byte_offset % alignof(T) != 0) {
+            throw std::invalid_argument("MappedView offset is misaligned for the element type");
+        }
+        if (byte_offset > file_->size() || count > (file_->size() - byte_offset) / sizeof(T)) {
+            throw std::out_of_range("MappedView region extends past the end of " + file_->path());
+        }
+        span_ = std::span<const T>(reinterpret_cast<const T*>(file_->data() + byte_offset), count);
+    }
+
+    std::span<const T> span() const { return span_; }
+    const T* data() const { return span_.data(); }
+    size_t size() const { return span_.size(); }
+    bool empty() const { return span_.empty(); }
+    const T& operator[](size_t i) const { return span_[i]; }
+    auto begin() const { return span_.begin(); }
+    auto end() const { return span_.end(); }
+
+    // Sub-view of count elements starting at element offset
+    MappedView subview(size_t offset, size_t count) const {
+        if (offset > size() || count > size() - offset) {
+            throw std::out_of_range("MappedView subview out of range");
+        }
+        MappedView view;
+        view.file_ = file_;
+        view.span_ = span_.subspan(offset, count);
+        return view;
+    }
+
+    const std::shared_ptr<const MappedFile>& file() const { return file_; }
+
+    // Views are equal when they cover the same bytes of the same mapping
+    bool operator==(const MappedView& other) const {
+        return file_ == other.file_ && span_.data() == other.span_.data() && span_.size() == other.span_.size();
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    std::span<const T> span_;
+};
+
+// Source node exposing a region of a memory-mapped file as a typed view,
+// with no copy. The file is mapped on first compute (or shared with other
+// nodes when given a MappedFile), and only the node's region is advised,
+// so graphs page in just the regions their sources cover.
+template<typename T>
+class MappedSourceNode : public Node<MappedView<T>> {
+public:
+    // count elements from byte_offset; the rest of the file by default
+    MappedSourceNode(std::string name, std::string path, size_t byte_offset = 0,
+                     std::optional<size_t> count = std::nullopt,
+                     AccessPattern pattern = AccessPattern::Sequential)
+        : Node<MappedView<T>>(std::move(name))
+        , path_(std::move(path))
+        , byte_offset_(byte_offset)
+        , count_(count)
+        , pattern_(pattern) {}
+
+    MappedSourceNode(std::string name, std::shared_ptr<const MappedFile> file, size_t byte_offset = 0,
+                     std::optional<size_t> count = std::nullopt,
+                     AccessPattern pattern = AccessPattern::Sequential)
+        : Node<MappedView<T>>(std::move(name))
+        , path_(file ? file->path() : std::string())
+        , file_(std::move(file))
+        , byte_offset_(byte_offset)
+        , count_(count)
+        , pattern_(pattern) {}
+
+protected:
+    Task<ComputeResult<MappedView<T>>> compute_impl(size_t) override {
+        if (!file_) {
+            file_ = MappedFile::open(path_);
+        }
+        size_t count = count_ ? *count_
+            : (byte_offset_ < file_->size() ? (file_->size() - byte_offset_) / sizeof(T) : 0);
+        MappedView<T> view(file_, byte_offset_, count);
+        file_->advise(byte_offset_, count * sizeof(T), pattern_);
+        co_return ComputeResult<MappedView<T>>(std::move(view));
+    }
+
+private:
+    std::string path_;
+    std::shared_ptr<const MappedFile> file_;
+    size_t byte_offset_;
+    std::optional<size_t> count_;
+    AccessPattern pattern_;
+};
+
+} // namespace flowgraph
+
+// Identity hash, so views can be graph values (GraphCache keys on them)
+template<typename T>
+struct std::hash<flowgraph::MappedView<T>> {
+    size_t operator()(const flowgraph::MappedView<T>& view) const noexcept {
+        return std::hash<const T*>{}(view.data()) ^ (std::hash<size_t>{}(view.size()) << 1);
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "io_reactor.hpp"
+
+namespace flowgraph {
+
+// Portable reactor: a few dedicated threads issue blocking pread/pwrite
+// calls, so only they ever wait on the disk. Requests are served in
+// submission order.
+class ThreadIoReactor : public IoReactor {
+public:
+    explicit ThreadIoReactor(size_t threads = 2) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadIoReactor() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void submit(IoRequest& request) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(&request);
+        }
+        condition_.notify_one();
+    }
+
+    const char* backend_name() const override { return "threads"; }
+
+private:
+    void run() {
+        while (true) {
+            IoRequest* request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                request = queue_.front();
+                queue_.pop_front();
+            }
+            complete(*request, perform(*request));
+        }
+    }
+
+    static int64_t perform(const IoRequest& request) {
+        while (true) {
+            auto offset = static_cast<off_t>(request.offset);
+            ssize_t n = request.op == IoOp::Read
+                ? ::pread(request.fd, request.buffer, request.length, offset)
+                : ::pwrite(request.fd, request.buffer, request.length, offset);
+            if (n >= 0) {
+                return n;
+            }
+            if (errno != EINTR) {
+                return -errno;
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<IoRequest*> queue_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace flowgraph
@@ -0,0 +1,249 @@
+#pragma once
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "io_reactor.hpp"
+#include "../async/blocking_region.hpp"
+
+namespace flowgraph {
+
+// Reactor on a Linux io_uring, driven through the raw system calls. Any
+// thread may submit; one completion thread reaps the completion queue and
+// resumes the waiting coroutines. Requests in flight are capped at the
+// submission queue size, so the completion queue (twice as large) never
+// overflows.
+class UringIoReactor : public IoReactor {
+public:
+    explicit UringIoReactor(unsigned entries = 256) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+        capacity_ = params.sq_entries;
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap_) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap_ ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+        auto* sq = static_cast<char*>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        completion_thread_ = std::thread([this] { run(); });
+    }
+
+    ~UringIoReactor() override {
+        // A no-op with null user data tells the completion thread to finish
+        // once every outstanding request has completed
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            push_sqe(IORING_OP_NOP, -1, nullptr, 0, 0, 0);
+        }
+        completion_thread_.join();
+        munmap(sqes_, sqes_size_);
+        if (!single_mmap_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        munmap(sq_ring_, sq_ring_size_);
+        close(ring_fd_);
+    }
+
+    // Whether the running kernel lets this process create a ring
+    static bool available() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+        if (fd < 0) {
+            return false;
+        }
+        close(fd);
+        return true;
+    }
+
+    void submit(IoRequest& request) override {
+        std::unique_lock<std::mutex> lock(submit_mutex_);
+        while (in_flight_ == capacity_) {
+            if (std::this_thread::get_id() == completion_thread_.get_id()) {
+                // Only this thread frees slots, so reap without resuming
+                lock.unlock();
+                wait_for_completions();
+                lock.lock();
+            } else {
+                BlockingRegion region;
+                space_.wait(lock, [this] { return in_flight_ < capacity_; });
+            }
+        }
+        ++in_flight_;
+        // Lengths are 32-bit in the submission entry; the short transfer is
+        // completed by the caller's next request
+        auto length = static_cast<unsigned>(std::min<size_t>(request.length, 1u << 30));
+        try {
+            push_sqe(request.op == IoOp::Read ? IORING_OP_READ : IORING_OP_WRITE,
+                     request.fd, request.buffer, length, request.offset,
+                     reinterpret_cast<uint64_t>(&request));
+        } catch (...) {
+            --in_flight_;
+            space_.notify_all();
+            throw;
+        }
+    }
+
+    const char* backend_name() const override { return "io_uring"; }
+
+private:
+    struct Completion {
+        IoRequest* request;
+        int64_t result;
+    };
+
+    void* map(size_t size, off_t offset) {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+        if (ptr == MAP_FAILED) {
+            int error = errno;
+            close(ring_fd_);
+            throw std::runtime_error(std::string("io_uring mmap failed: ") + std::strerror(error));
+        }
+        return ptr;
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        while (true) {
+            int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0));
+            if (ret >= 0 || (errno != EINTR && errno != EAGAIN && errno != EBUSY)) {
+                return ret;
+            }
+            if (errno != EINTR) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Caller holds submit_mutex_. Without SQPOLL the kernel consumes the
+    // entry during io_uring_enter, so the submission queue is empty again
+    // on return.
+    void push_sqe(uint8_t opcode, int fd, void* buffer, unsigned length, uint64_t offset, uint64_t user_data) {
+        std::atomic_ref<unsigned> tail(*sq_tail_);
+        unsigned index = tail.load(std::memory_order_relaxed) & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        unsigned previous = tail.load(std::memory_order_relaxed);
+        tail.store(previous + 1, std::memory_order_release);
+        if (enter(1, 0, 0) < 0) {
+            int error = errno;
+            // Unpublish the entry, or the next enter would submit it for a
+            // request whose awaiter is about to unwind
+            tail.store(previous, std::memory_order_release);
+            throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(error));
+        }
+    }
+
+    // Block until at least one completion arrives and move every available
+    // one to ready_. Runs on the completion thread only.
+    void wait_for_completions() {
+        enter(0, 1, IORING_ENTER_GETEVENTS);
+        std::atomic_ref<unsigned> head(*cq_head_);
+        std::atomic_ref<unsigned> tail(*cq_tail_);
+        unsigned h = head.load(std::memory_order_relaxed);
+        unsigned t = tail.load(std::memory_order_acquire);
+        size_t reaped = 0;
+        for (; h != t; ++h) {
+            const io_uring_cqe& cqe = cqes_[h & cq_mask_];
+            if (cqe.user_data == 0) {
+                stopping_ = true;
+            } else {
+                ready_.push_back({reinterpret_cast<IoRequest*>(cqe.user_data), cqe.res});
+                ++reaped;
+            }
+        }
+        head.store(h, std::memory_order_release);
+        if (reaped > 0) {
+            {
+                std::lock_guard<std::mutex> lock(submit_mutex_);
+                in_flight_ -= reaped;
+            }
+            space_.notify_all();
+        }
+    }
+
+    void run() {
+        while (true) {
+            if (ready_.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(submit_mutex_);
+                    if (stopping_ && in_flight_ == 0) {
+                        return;
+                    }
+                }
+                wait_for_completions();
+                continue;
+            }
+            // Resuming may submit more work and reap into ready_ meanwhile
+            auto completion = ready_.front();
+            ready_.pop_front();
+            complete(*completion.request, completion.result);
+        }
+    }
+
+    int ring_fd_ = -1;
+    unsigned capacity_ = 0;
+    bool single_mmap_ = false;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::mutex submit_mutex_;
+    std::condition_variable space_;
+    unsigned in_flight_ = 0;
+    // Completion-thread state
+    std::deque<Completion> ready_;
+    bool stopping_ = false;
+    std::thread completion_thread_;
+};
+
+} // namespace flowgraph
+#endif
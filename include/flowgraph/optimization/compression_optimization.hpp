@@ -110,7 +110,7 @@ private:
     }
 
     void compress_inactive_nodes(
-        Graph<T>& /* graph */,  // Mark as intentionally unused
+        Graph<T>& graph,
         const ActivityStats& activity_stats
     ) {
         // Ensure at least one node gets compressed
@@ -124,6 +124,7 @@ private:
                     // Reduce precision level
                     node->adjust_precision(current_level - 1);
                     node->merge_updates(); // Force compression
+                    spill_inactive_levels(graph, node);
                     compressed_any = true;
                 }
             }
@@ -145,11 +146,25 @@ private:
                 if (current_level > node->min_precision_level()) {
                     node->adjust_precision(current_level - 1);
                     node->merge_updates();
+                    spill_inactive_levels(graph, node);
                 }
             }
         }
     }
 
+    // With a spill store on the graph, an inactive node keeps only the
+    // level it now computes at in memory; the others go to the spill file
+    void spill_inactive_levels(Graph<T>& graph, const std::shared_ptr<Node<T>>& node) {
+        if (!graph.spill_store()) {
+            return;
+        }
+        for (const auto& usage : node->level_usage()) {
+            if (usage.level != node->current_precision_level()) {
+                node->spill_level(usage.level);
+            }
+        }
+    }
+
     void expand_critical_path_nodes(
         Graph<T>& graph,
         const MemoryStats& memory_stats,
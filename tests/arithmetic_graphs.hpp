@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/flowgraph/compile/arithmetic_nodes.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// Fixed arithmetic DAG shared by the codegen sample, the tests and the
+// benchmarks. Eight inputs feed `layers` layers of `width` operations,
+// each reading its column of the previous layer and, for binary ones,
+// another node of it or a constant, so every node is read. The last
+// layer is summed pairwise, and the outputs are "ratio" (the square root
+// of the sum's magnitude over input x7, which fails when x7 is zero) and
+// "spread" (the sum minus x0).
+template<ScalarValue T>
+struct ArithmeticGraph {
+    static constexpr size_t input_count = 8;
+
+    std::vector<std::shared_ptr<ScalarInputNode<T>>> inputs;
+    std::shared_ptr<Node<T>> ratio;
+    std::shared_ptr<Node<T>> spread;
+    size_t node_count = 0;
+};
+
+template<ScalarValue T>
+ArithmeticGraph<T> build_arithmetic_graph(Graph<T>& graph, const std::array<T, 8>& input_values,
+                                          size_t layers = 8, size_t width = 32) {
+    ArithmeticGraph<T> built;
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    auto next = [&state](uint64_t bound) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (state >> 33) % bound;
+    };
+    auto add = [&](std::shared_ptr<Node<T>> node) {
+        graph.add_node(node);
+        ++built.node_count;
+        return node;
+    };
+    auto op = [&](const std::string& name, ArithmeticOp kind, std::vector<std::shared_ptr<Node<T>>> operands) {
+        auto node = add(std::make_shared<ScalarOpNode<T>>(name, kind, operands));
+        for (const auto& operand : operands) {
+            graph.add_edge(std::make_shared<Edge<T>>(operand, node));
+        }
+        return node;
+    };
+
+    std::vector<std::shared_ptr<Node<T>>> previous;
+    for (size_t i = 0; i < ArithmeticGraph<T>::input_count; ++i) {
+        auto input = std::make_shared<ScalarInputNode<T>>("x" + std::to_string(i), i, input_values[i]);
+        built.inputs.push_back(input);
+        add(input);
+    }
+    for (size_t i = 0; i < width; ++i) {
+        previous.push_back(built.inputs[i % built.inputs.size()]);
+    }
+    // Multiplying only by these keeps magnitudes in check across layers
+    auto half = add(std::make_shared<ScalarConstantNode<T>>("half", T(0.5)));
+    auto three_halves = add(std::make_shared<ScalarConstantNode<T>>("three_halves", T(1.5)));
+
+    const ArithmeticOp kinds[] = {ArithmeticOp::Add, ArithmeticOp::Subtract, ArithmeticOp::Multiply,
+                                  ArithmeticOp::Min, ArithmeticOp::Max, ArithmeticOp::Negate, ArithmeticOp::Abs};
+    for (size_t layer = 0; layer < layers; ++layer) {
+        std::vector<std::shared_ptr<Node<T>>> current;
+        for (size_t column = 0; column < width; ++column) {
+            auto name = "n" + std::to_string(layer) + "_" + std::to_string(column);
+            auto kind = kinds[next(std::size(kinds))];
+            auto other = previous[next(width)];
+            if (kind == ArithmeticOp::Multiply) {
+                other = next(2) ? half : three_halves;
+            }
+            if (arity(kind) == 1) {
+                current.push_back(op(name, kind, {previous[column]}));
+            } else {
+                current.push_back(op(name, kind, {previous[column], other}));
+            }
+        }
+        previous = std::move(current);
+    }
+    for (size_t round = 0; previous.size() > 1; ++round) {
+        std::vector<std::shared_ptr<Node<T>>> sums;
+        for (size_t i = 0; i + 1 < previous.size(); i += 2) {
+            sums.push_back(op("sum" + std::to_string(round) + "_" + std::to_string(i / 2), ArithmeticOp::Add,
+                              {previous[i], previous[i + 1]}));
+        }
+        if (previous.size() % 2) {
+            sums.push_back(previous.back());
+        }
+        previous = std::move(sums);
+    }
+    auto magnitude = op("magnitude", ArithmeticOp::Abs, {previous.front()});
+    auto root = op("root", ArithmeticOp::Sqrt, {magnitude});
+    built.ratio = op("ratio", ArithmeticOp::Divide, {root, built.inputs[7]});
+    built.spread = op("spread", ArithmeticOp::Subtract, {previous.front(), built.inputs[0]});
+    return built;
+}
+
+} // namespace test
+} // namespace flowgraph
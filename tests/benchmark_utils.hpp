@@ -0,0 +1,36 @@
+#pragma once
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace flowgraph {
+namespace test {
+
+using BenchClock = std::chrono::steady_clock;
+
+// Busy-wait for the given duration, standing in for a node's CPU work
+inline void spin_for(std::chrono::microseconds duration) {
+    auto end = BenchClock::now() + duration;
+    while (BenchClock::now() < end) {
+    }
+}
+
+// Report latency percentiles (in microseconds) as benchmark counters
+inline void report_percentiles(::benchmark::State& state, std::vector<double>& latencies_us) {
+    if (latencies_us.empty()) {
+        return;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(p * static_cast<double>(latencies_us.size() - 1));
+        return latencies_us[index];
+    };
+    state.counters["p50_us"] = percentile(0.50);
+    state.counters["p99_us"] = percentile(0.99);
+    state.counters["p999_us"] = percentile(0.999);
+    state.counters["max_us"] = latencies_us.back();
+}
+
+} // namespace test
+} // namespace flowgraph
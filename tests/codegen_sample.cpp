@@ -0,0 +1,28 @@
+// Writes the generated C++ for the arithmetic test graph into the
+// directory given as the only argument; the build compiles the result
+// into the tests and benchmarks.
+#include <array>
+#include <exception>
+#include <iostream>
+#include "arithmetic_graphs.hpp"
+#include "../include/flowgraph/compile/codegen.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <output directory>\n";
+        return 2;
+    }
+    try {
+        flowgraph::Graph<double> graph;
+        flowgraph::test::build_arithmetic_graph<double>(graph, std::array<double, 8>{});
+        flowgraph::CodegenOptions options;
+        options.name = "arithmetic_graph";
+        options.namespace_name = "flowgraph::generated::arithmetic";
+        options.outputs = {"ratio", "spread"};
+        flowgraph::write_generated(flowgraph::generate_cpp(graph, options), argv[1]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
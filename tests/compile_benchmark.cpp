@@ -0,0 +1,173 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../include/flowgraph/core/node.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+#include "../include/flowgraph/compile/bytecode.hpp"
+#include "../include/flowgraph/compile/simd_batch.hpp"
+#include "arithmetic_graphs.hpp"
+#include "arithmetic_graph.hpp"
+
+namespace flowgraph {
+namespace test {
+
+std::vector<double> arithmetic_records(size_t count) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> value(0.5, 4.0);
+    std::vector<double> records(count * ArithmeticGraph<double>::input_count);
+    for (double& v : records) {
+        v = value(rng);
+    }
+    return records;
+}
+
+} // namespace test
+} // namespace flowgraph
+
+// The arithmetic test graph executed as a Graph; values are cached per
+// graph, so each record gets a freshly built one (building and tearing
+// down are untimed)
+template<flowgraph::ExecutionStrategy Strategy>
+static void BM_ArithmeticGraphExecute(::benchmark::State& state) {
+    auto pool = std::make_shared<flowgraph::ThreadPool>();
+    flowgraph::ExecutionOptions options;
+    options.strategy = Strategy;
+    auto records = flowgraph::test::arithmetic_records(64);
+    size_t record = 0;
+    std::unique_ptr<flowgraph::Graph<double>> graph;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::array<double, 8> inputs;
+        std::copy_n(records.begin() + static_cast<std::ptrdiff_t>(record * 8), 8, inputs.begin());
+        record = (record + 1) % 64;
+        graph = std::make_unique<flowgraph::Graph<double>>(nullptr, pool);
+        graph->set_execution_options(options);
+        auto built = flowgraph::test::build_arithmetic_graph<double>(*graph, inputs);
+        graph->execution_plan();
+        state.ResumeTiming();
+
+        graph->execute().get();
+        benchmark::DoNotOptimize(built.ratio->compute().get());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// The same graph as the straight-line function generated from it
+static void BM_ArithmeticGraphGenerated(::benchmark::State& state) {
+    namespace generated = flowgraph::generated::arithmetic;
+    auto records = flowgraph::test::arithmetic_records(64);
+    double out[generated::output_count];
+    size_t record = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(generated::evaluate(records.data() + record * generated::input_count, out));
+        benchmark::ClobberMemory();
+        record = (record + 1) % 64;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Generated function over a batch of records split across a pool
+static void BM_ArithmeticGraphGeneratedBatch(::benchmark::State& state) {
+    namespace generated = flowgraph::generated::arithmetic;
+    const auto count = static_cast<size_t>(state.range(0));
+    flowgraph::ThreadPool pool;
+    auto records = flowgraph::test::arithmetic_records(count);
+    std::vector<double> out(count * generated::output_count);
+    auto ok = std::make_unique<bool[]>(count);
+    for (auto _ : state) {
+        generated::evaluate_batch(pool, records.data(), out.data(), ok.get(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+// The same graph compiled to bytecode, one record at a time
+static void BM_ArithmeticGraphBytecode(::benchmark::State& state) {
+    flowgraph::Graph<double> graph;
+    flowgraph::test::build_arithmetic_graph<double>(graph, {});
+    auto program = flowgraph::BytecodeProgram<double>::compile(graph, {"ratio", "spread"});
+    auto records = flowgraph::test::arithmetic_records(64);
+    double out[2];
+    size_t record = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(program.run(records.data() + record * program.input_count(), out));
+        benchmark::ClobberMemory();
+        record = (record + 1) % 64;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["registers"] = static_cast<double>(program.register_count());
+}
+
+// Bytecode over a batch of records on one thread, a block of lanes per
+// instruction
+static void BM_ArithmeticGraphBytecodeBatch(::benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    flowgraph::Graph<double> graph;
+    flowgraph::test::build_arithmetic_graph<double>(graph, {});
+    auto program = flowgraph::BytecodeProgram<double>::compile(graph, {"ratio", "spread"});
+    auto records = flowgraph::test::arithmetic_records(count);
+    std::vector<double> out(count * program.output_count());
+    auto ok = std::make_unique<bool[]>(count);
+    for (auto _ : state) {
+        program.run_batch(records.data(), out.data(), ok.get(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+// Column batch on one thread with the kernels of one instruction set;
+// levels the CPU lacks are skipped
+template<flowgraph::SimdLevel Level>
+static void BM_ArithmeticGraphSimdBatch(::benchmark::State& state) {
+    if (Level > flowgraph::detect_simd_level()) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+    const auto count = static_cast<size_t>(state.range(0));
+    flowgraph::Graph<double> graph;
+    flowgraph::test::build_arithmetic_graph<double>(graph, {});
+    flowgraph::SimdBatchEvaluator<double> evaluator(
+        flowgraph::BytecodeProgram<double>::compile(graph, {"ratio", "spread"}), Level);
+    auto records = flowgraph::test::arithmetic_records(count);
+    const size_t inputs = evaluator.program().input_count();
+    std::vector<std::vector<double>> columns(inputs, std::vector<double>(count));
+    for (size_t r = 0; r < count; ++r) {
+        for (size_t s = 0; s < inputs; ++s) {
+            columns[s][r] = records[r * inputs + s];
+        }
+    }
+    std::vector<double> ratio(count), spread(count);
+    std::vector<uint64_t> ratio_errors(flowgraph::SimdBatch<double>::mask_words(count));
+    std::vector<uint64_t> spread_errors(ratio_errors.size());
+    flowgraph::SimdBatch<double> batch{{}, {ratio.data(), spread.data()},
+                                       {ratio_errors.data(), spread_errors.data()}, count};
+    for (const auto& column : columns) {
+        batch.inputs.push_back(column.data());
+    }
+    for (auto _ : state) {
+        evaluator.evaluate(batch);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+BENCHMARK_TEMPLATE(BM_ArithmeticGraphExecute, flowgraph::ExecutionStrategy::DependencyDriven)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ArithmeticGraphExecute, flowgraph::ExecutionStrategy::Dataflow)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK(BM_ArithmeticGraphGenerated)->Unit(::benchmark::kNanosecond);
+BENCHMARK(BM_ArithmeticGraphGeneratedBatch)->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK(BM_ArithmeticGraphBytecode)->Unit(::benchmark::kNanosecond);
+BENCHMARK(BM_ArithmeticGraphBytecodeBatch)->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ArithmeticGraphSimdBatch, flowgraph::SimdLevel::Scalar)
+    ->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ArithmeticGraphSimdBatch, flowgraph::SimdLevel::Avx2)
+    ->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ArithmeticGraphSimdBatch, flowgraph::SimdLevel::Avx512)
+    ->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
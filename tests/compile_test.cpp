@@ -0,0 +1,385 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/flowgraph/compile/arithmetic_nodes.hpp"
+#include "../include/flowgraph/compile/bytecode.hpp"
+#include "../include/flowgraph/compile/codegen.hpp"
+#include "../include/flowgraph/compile/simd_batch.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "arithmetic_graphs.hpp"
+#include "arithmetic_graph.hpp"
+
+namespace flowgraph {
+namespace test {
+
+namespace generated = flowgraph::generated::arithmetic;
+
+std::vector<std::array<double, 8>> random_records(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> value(-4.0, 4.0);
+    std::vector<std::array<double, 8>> records(count);
+    for (auto& record : records) {
+        for (double& v : record) {
+            v = value(rng);
+        }
+    }
+    return records;
+}
+
+// Values cached in nodes are averaged as they merge, which moves a
+// graph's results off the exact ones by a few ulps per merge
+void expect_close(double actual, double graph_value) {
+    EXPECT_NEAR(actual, graph_value, 1e-9 * std::max(1.0, std::abs(graph_value)));
+}
+
+// Node kind known only to the registry it is added to
+class ClampNode : public Node<double> {
+public:
+    ClampNode(std::string name, std::shared_ptr<Node<double>> input)
+        : Node<double>(std::move(name))
+        , input_(std::move(input)) {}
+
+    std::shared_ptr<Node<double>> input() const { return input_; }
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        auto result = co_await input_->compute();
+        if (result.has_error()) {
+            co_return result;
+        }
+        co_return ComputeResult<double>(std::clamp(result.value(), 0.0, 1.0));
+    }
+
+private:
+    std::shared_ptr<Node<double>> input_;
+};
+
+// The sample's generated code is compiled into this binary by the build
+TEST(CodegenTest, GeneratedFunctionMatchesGraphExecution) {
+    ASSERT_EQ(generated::input_count, 8u);
+    ASSERT_EQ(generated::output_count, 2u);
+    EXPECT_STREQ(generated::output_names[0], "ratio");
+    EXPECT_STREQ(generated::output_names[1], "spread");
+
+    auto pool = std::make_shared<ThreadPool>(2);
+    for (const auto& record : random_records(20, 7)) {
+        Graph<double> graph(nullptr, pool);
+        auto built = build_arithmetic_graph<double>(graph, record);
+        graph.execute().get();
+        auto ratio = built.ratio->compute().get();
+        auto spread = built.spread->compute().get();
+        ASSERT_FALSE(ratio.has_error());
+        ASSERT_FALSE(spread.has_error());
+
+        double out[2];
+        ASSERT_TRUE(generated::evaluate(record.data(), out));
+        expect_close(out[0], ratio.value());
+        expect_close(out[1], spread.value());
+    }
+}
+
+TEST(CodegenTest, GeneratedFunctionReportsFailedOperations) {
+    auto record = random_records(1, 11).front();
+    record[7] = 0.0;
+
+    Graph<double> graph;
+    auto built = build_arithmetic_graph<double>(graph, record);
+    graph.execute().get();
+    auto ratio = built.ratio->compute().get();
+    ASSERT_TRUE(ratio.has_error());
+    EXPECT_EQ(ratio.error().type(), ErrorType::ComputationError);
+    EXPECT_FALSE(built.spread->compute().get().has_error());
+
+    double out[2];
+    EXPECT_FALSE(generated::evaluate(record.data(), out));
+}
+
+TEST(CodegenTest, EvaluateBatchMatchesPerRecordEvaluation) {
+    const size_t count = 5000;
+    auto records = random_records(count, 3);
+    records[1234][7] = 0.0;
+
+    ThreadPool pool(4);
+    std::vector<double> in(count * generated::input_count);
+    for (size_t r = 0; r < count; ++r) {
+        std::copy(records[r].begin(), records[r].end(), in.begin() + static_cast<std::ptrdiff_t>(r * generated::input_count));
+    }
+    std::vector<double> out(count * generated::output_count);
+    auto ok = std::make_unique<bool[]>(count);
+    generated::evaluate_batch(pool, in.data(), out.data(), ok.get(), count);
+
+    for (size_t r = 0; r < count; ++r) {
+        double expected[2];
+        bool expected_ok = generated::evaluate(records[r].data(), expected);
+        ASSERT_EQ(ok[r], expected_ok) << "record " << r;
+        EXPECT_EQ(ok[r], r != 1234);
+        if (expected_ok) {
+            EXPECT_EQ(out[r * 2], expected[0]);
+            EXPECT_EQ(out[r * 2 + 1], expected[1]);
+        }
+    }
+}
+
+TEST(CodegenTest, EmitsRegisteredKindsAndRejectsOthers) {
+    EXPECT_EQ(codegen_literal(0.1), "0x1.999999999999ap-4");
+    EXPECT_EQ(codegen_literal(-2.0f), "(-0x1p+1f)");
+
+    Graph<double> graph;
+    auto x = std::make_shared<ScalarInputNode<double>>("x", 0);
+    auto clamp = std::make_shared<ClampNode>("clamp\n*/", x);
+    graph.add_node(x);
+    graph.add_node(clamp);
+    graph.add_edge(std::make_shared<Edge<double>>(x, clamp));
+
+    CodegenRegistry<double> registry;
+    EXPECT_THROW(generate_cpp(graph, {}, registry), std::invalid_argument);
+
+    registry.register_kind<ClampNode>([](const ClampNode& node) {
+        return CodegenTerm<double>{{node.input()}, "std::clamp($0, 0.0, 1.0)", {}, std::nullopt};
+    });
+    auto generated_source = generate_cpp(graph, {}, registry);
+    EXPECT_NE(generated_source.source.find("const double v0 = in[0];"), std::string::npos);
+    EXPECT_NE(generated_source.source.find("const double v1 = std::clamp(v0, 0.0, 1.0);  // clamp */"),
+              std::string::npos);
+    EXPECT_NE(generated_source.source.find("out[0] = v1;"), std::string::npos);
+    EXPECT_NE(generated_source.header.find("output_names[] = {\"clamp\\012*/\"}"), std::string::npos);
+
+    // Operands must be in the graph too
+    Graph<double> partial;
+    partial.add_node(clamp);
+    EXPECT_THROW(generate_cpp(partial, {}, registry), std::invalid_argument);
+}
+
+TEST(BytecodeTest, MatchesGraphExecutionAndGeneratedCode) {
+    auto pool = std::make_shared<ThreadPool>(2);
+    for (const auto& record : random_records(20, 5)) {
+        Graph<double> graph(nullptr, pool);
+        auto built = build_arithmetic_graph<double>(graph, record);
+        auto program = BytecodeProgram<double>::compile(graph, {"ratio", "spread"});
+        ASSERT_EQ(program.input_count(), 8u);
+        ASSERT_EQ(program.output_count(), 2u);
+        // Dead temporaries' registers are reused
+        EXPECT_LT(program.register_count(), built.node_count / 2);
+
+        graph.execute().get();
+        double out[2];
+        ASSERT_TRUE(program.run(record.data(), out));
+        expect_close(out[0], built.ratio->compute().get().value());
+        expect_close(out[1], built.spread->compute().get().value());
+
+        double expected[2];
+        generated::evaluate(record.data(), expected);
+        EXPECT_EQ(out[0], expected[0]);
+        EXPECT_EQ(out[1], expected[1]);
+    }
+}
+
+TEST(BytecodeTest, SinglePrecisionGraphs) {
+    std::array<float, 8> record = {1.5f, -2.0f, 0.25f, 3.0f, -0.5f, 2.5f, 1.0f, 4.0f};
+    Graph<float> graph;
+    auto built = build_arithmetic_graph<float>(graph, record);
+    graph.execute().get();
+    auto program = BytecodeProgram<float>::compile(graph);
+    EXPECT_EQ(program.output_names(), (std::vector<std::string>{"ratio", "spread"}));
+
+    float out[2];
+    ASSERT_TRUE(program.run(record.data(), out));
+    EXPECT_NEAR(out[0], built.ratio->compute().get().value(), 1e-4);
+    EXPECT_NEAR(out[1], built.spread->compute().get().value(), 1e-4);
+}
+
+TEST(BytecodeTest, BatchLanesMatchSingleRunsAndFlagFailures) {
+    // Not a multiple of the lane count, so the last block is partial
+    const size_t count = 1000 + BytecodeProgram<double>::lanes / 2 + 3;
+    auto records = random_records(count, 9);
+    records[17][7] = 0.0;
+    records[count - 1][7] = 0.0;
+
+    Graph<double> graph;
+    build_arithmetic_graph<double>(graph, records[0]);
+    auto program = BytecodeProgram<double>::compile(graph, {"ratio", "spread"});
+
+    std::vector<double> in;
+    for (const auto& record : records) {
+        in.insert(in.end(), record.begin(), record.end());
+    }
+    ThreadPool pool(3);
+    for (bool pooled : {false, true}) {
+        std::vector<double> out(count * 2);
+        auto ok = std::make_unique<bool[]>(count);
+        if (pooled) {
+            program.run_batch(pool, in.data(), out.data(), ok.get(), count, 64);
+        } else {
+            program.run_batch(in.data(), out.data(), ok.get(), count);
+        }
+        for (size_t r = 0; r < count; ++r) {
+            double expected[2];
+            ASSERT_EQ(ok[r], program.run(records[r].data(), expected)) << "record " << r;
+            EXPECT_EQ(ok[r], r != 17 && r != count - 1);
+            if (ok[r]) {
+                EXPECT_EQ(out[r * 2], expected[0]);
+                EXPECT_EQ(out[r * 2 + 1], expected[1]);
+            }
+        }
+    }
+}
+
+TEST(BytecodeTest, RejectsOtherNodeKinds) {
+    Graph<double> graph;
+    auto x = std::make_shared<ScalarInputNode<double>>("x", 0);
+    graph.add_node(x);
+    graph.add_node(std::make_shared<ClampNode>("clamp", x));
+    EXPECT_THROW(BytecodeProgram<double>::compile(graph), std::invalid_argument);
+}
+
+// Every level this CPU runs, scalar first
+std::vector<SimdLevel> simd_levels() {
+    std::vector<SimdLevel> levels;
+    for (auto level : {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (level <= detect_simd_level()) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+TEST(SimdBatchTest, LanesMatchBytecodeRunsAtEveryLevel) {
+    // Two full blocks and a partial one
+    const size_t count = 2 * 64 + 37;
+    auto records = random_records(count, 13);
+    records[5][7] = 0.0;
+    records[count - 1][7] = 0.0;
+
+    Graph<double> graph;
+    build_arithmetic_graph<double>(graph, records[0]);
+    auto program = BytecodeProgram<double>::compile(graph, {"ratio", "spread"});
+
+    std::vector<std::vector<double>> columns(program.input_count(), std::vector<double>(count));
+    for (size_t r = 0; r < count; ++r) {
+        for (size_t s = 0; s < program.input_count(); ++s) {
+            columns[s][r] = records[r][s];
+        }
+    }
+
+    ThreadPool pool(3);
+    for (auto level : simd_levels()) {
+        SimdBatchEvaluator<double> evaluator(program, level);
+        ASSERT_EQ(evaluator.level(), level);
+        for (bool pooled : {false, true}) {
+            std::vector<double> ratio(count), spread(count);
+            std::vector<uint64_t> ratio_errors(SimdBatch<double>::mask_words(count));
+            std::vector<uint64_t> spread_errors(ratio_errors.size());
+            SimdBatch<double> batch{{}, {ratio.data(), spread.data()}, {ratio_errors.data(), spread_errors.data()}, count};
+            for (const auto& column : columns) {
+                batch.inputs.push_back(column.data());
+            }
+            if (pooled) {
+                evaluator.evaluate(pool, batch, 64);
+            } else {
+                evaluator.evaluate(batch);
+            }
+
+            for (size_t r = 0; r < count; ++r) {
+                double expected[2];
+                bool expected_ok = program.run(records[r].data(), expected);
+                bool ratio_failed = (ratio_errors[r / 64] >> (r % 64)) & 1;
+                ASSERT_EQ(ratio_failed, !expected_ok) << to_string(level) << " record " << r;
+                // Only the ratio divides by x7
+                EXPECT_EQ((spread_errors[r / 64] >> (r % 64)) & 1, 0u);
+                EXPECT_EQ(spread[r], expected[1]);
+                if (expected_ok) {
+                    EXPECT_EQ(ratio[r], expected[0]);
+                }
+            }
+            EXPECT_TRUE(ratio_errors[0] & (uint64_t{1} << 5));
+            // Padding lanes past the last record are never flagged
+            EXPECT_EQ(ratio_errors.back() >> 37, 0u);
+        }
+    }
+}
+
+TEST(SimdBatchTest, SinglePrecisionKernelsAndEdgeValues) {
+    // Negative zero, infinities and NaN go through sign and min/max kernels
+    const std::vector<float> a = {-0.0f, 2.0f, -3.0f, INFINITY, -INFINITY, NAN, 0.5f, 4.0f};
+    const std::vector<float> b = {0.0f, -0.0f, 1.0f, 2.0f, NAN, 1.0f, 0.0f, -4.0f};
+    const size_t count = 64 + a.size();
+
+    Graph<float> graph;
+    auto x = std::make_shared<ScalarInputNode<float>>("x", 0);
+    auto y = std::make_shared<ScalarInputNode<float>>("y", 1);
+    graph.add_node(x);
+    graph.add_node(y);
+    std::vector<std::shared_ptr<Node<float>>> ops;
+    for (auto op : {ArithmeticOp::Add, ArithmeticOp::Subtract, ArithmeticOp::Multiply, ArithmeticOp::Divide,
+                    ArithmeticOp::Min, ArithmeticOp::Max}) {
+        ops.push_back(std::make_shared<ScalarOpNode<float>>(to_string(op), op, std::vector<std::shared_ptr<Node<float>>>{x, y}));
+    }
+    for (auto op : {ArithmeticOp::Negate, ArithmeticOp::Abs, ArithmeticOp::Sqrt}) {
+        ops.push_back(std::make_shared<ScalarOpNode<float>>(to_string(op), op, std::vector<std::shared_ptr<Node<float>>>{x}));
+    }
+    std::vector<std::string> names;
+    for (const auto& node : ops) {
+        graph.add_node(node);
+        names.push_back(node->name());
+    }
+    auto program = BytecodeProgram<float>::compile(graph, names);
+
+    std::vector<float> xs(count), ys(count);
+    for (size_t r = 0; r < count; ++r) {
+        xs[r] = a[r % a.size()];
+        ys[r] = b[r % b.size()];
+    }
+    for (auto level : simd_levels()) {
+        SimdBatchEvaluator<float> evaluator(program, level);
+        std::vector<std::vector<float>> outputs(names.size(), std::vector<float>(count));
+        std::vector<std::vector<uint64_t>> errors(names.size(), std::vector<uint64_t>(2));
+        SimdBatch<float> batch{{xs.data(), ys.data()}, {}, {}, count};
+        for (size_t i = 0; i < names.size(); ++i) {
+            batch.outputs.push_back(outputs[i].data());
+            batch.errors.push_back(errors[i].data());
+        }
+        evaluator.evaluate(batch);
+
+        for (size_t i = 0; i < names.size(); ++i) {
+            auto op = ops[i]->name();
+            for (size_t r = 0; r < count; ++r) {
+                float expected[9];
+                float in[2] = {xs[r], ys[r]};
+                program.run(in, expected);
+                bool failed = (errors[i][r / 64] >> (r % 64)) & 1;
+                EXPECT_EQ(failed, failure(static_cast<const ScalarOpNode<float>&>(*ops[i]).op(), xs[r], ys[r]) != nullptr)
+                    << to_string(level) << " " << op << " record " << r;
+                if (std::isnan(expected[i])) {
+                    EXPECT_TRUE(std::isnan(outputs[i][r])) << to_string(level) << " " << op << " record " << r;
+                } else {
+                    EXPECT_EQ(outputs[i][r], expected[i]) << to_string(level) << " " << op << " record " << r;
+                    EXPECT_EQ(std::signbit(outputs[i][r]), std::signbit(expected[i]))
+                        << to_string(level) << " " << op << " record " << r;
+                }
+            }
+        }
+    }
+}
+
+TEST(SimdBatchTest, RejectsMismatchedColumns) {
+    Graph<double> graph;
+    build_arithmetic_graph<double>(graph, {});
+    SimdBatchEvaluator<double> evaluator(BytecodeProgram<double>::compile(graph, {"ratio", "spread"}));
+    double value = 0.0;
+    uint64_t mask = 0;
+    SimdBatch<double> batch{{&value}, {&value, &value}, {&mask, &mask}, 1};
+    EXPECT_THROW(evaluator.evaluate(batch), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace flowgraph
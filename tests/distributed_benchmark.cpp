@@ -0,0 +1,201 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/flowgraph/distributed/multilevel_partition.hpp"
+#include "../include/flowgraph/distributed/process_executor.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// Node dominated by small allocations, the load where threads of one
+// process contend on the allocator
+class AllocatingNode : public Node<double> {
+public:
+    AllocatingNode(std::string name, std::shared_ptr<Node<double>> input)
+        : Node<double>(std::move(name)), input_(std::move(input)) {}
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        double base = 0.0;
+        if (input_) {
+            auto result = co_await input_->compute();
+            base = result.has_error() ? 0.0 : result.value();
+        }
+        std::map<int, std::string> entries;
+        for (int i = 0; i < 2000; ++i) {
+            entries.emplace(i, std::string(48, static_cast<char>('a' + i % 26)));
+        }
+        co_return ComputeResult<double>(base + static_cast<double>(entries.size()));
+    }
+
+private:
+    std::shared_ptr<Node<double>> input_;
+};
+
+// Independent chains of allocating nodes
+inline void build_chains(Graph<double>& graph, size_t chains, size_t length) {
+    for (size_t c = 0; c < chains; ++c) {
+        std::shared_ptr<Node<double>> previous;
+        for (size_t i = 0; i < length; ++i) {
+            auto node = std::make_shared<AllocatingNode>(
+                "c" + std::to_string(c) + "_" + std::to_string(i), previous);
+            graph.add_node(node);
+            if (previous) {
+                graph.add_edge(std::make_shared<Edge<double>>(previous, node));
+            }
+            previous = node;
+        }
+    }
+}
+
+// Plan topology of a random DAG: each node reads one to three recent
+// nodes, and one in sixteen also reads a node from anywhere before it.
+// Only the adjacency is filled in; the partitioners need no nodes.
+inline ExecutionPlan<double> random_dag_plan(size_t n, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::vector<size_t>> preds(n);
+    std::vector<size_t> successor_counts(n, 0);
+    for (size_t i = 1; i < n; ++i) {
+        size_t count = 1 + rng() % 3;
+        for (size_t k = 0; k < count; ++k) {
+            preds[i].push_back(i - 1 - rng() % std::min<size_t>(i, 64));
+        }
+        if (rng() % 16 == 0) {
+            preds[i].push_back(rng() % i);
+        }
+        std::sort(preds[i].begin(), preds[i].end());
+        preds[i].erase(std::unique(preds[i].begin(), preds[i].end()), preds[i].end());
+        for (size_t pred : preds[i]) {
+            ++successor_counts[pred];
+        }
+    }
+
+    ExecutionPlan<double> plan;
+    plan.nodes.resize(n);
+    plan.level_offsets = {0, n};
+    plan.predecessor_offsets.push_back(0);
+    plan.successor_offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        plan.predecessors.insert(plan.predecessors.end(), preds[i].begin(), preds[i].end());
+        plan.predecessor_offsets.push_back(plan.predecessors.size());
+        plan.successor_offsets[i + 1] = plan.successor_offsets[i] + successor_counts[i];
+    }
+    plan.successors.resize(plan.predecessors.size());
+    std::vector<size_t> fill(plan.successor_offsets.begin(), plan.successor_offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t pred : preds[i]) {
+            plan.successors[fill[pred]++] = i;
+        }
+    }
+    return plan;
+}
+
+// The plan's graph with uneven value sizes: one edge in eight carries a
+// 4 KiB value, the others 8 bytes
+inline PartitionGraph weighted_graph(const ExecutionPlan<double>& plan) {
+    std::vector<PartitionGraph::Link> links;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        for (size_t succ : plan.successors_of(i)) {
+            links.push_back({i, succ, (i * 31 + succ) % 8 == 0 ? 4096.0 : 8.0});
+        }
+    }
+    return PartitionGraph::from_links(std::vector<double>(plan.size(), 1.0), links);
+}
+
+// Bytes crossing partitions as a fraction of all bytes, and the load
+// imbalance
+inline void report_partition_quality(::benchmark::State& state, const PartitionGraph& graph,
+                                     const PartitionMap& partition, size_t parts) {
+    double total = std::accumulate(graph.edge_weight.begin(), graph.edge_weight.end(), 0.0) / 2.0;
+    state.counters["cut_bytes"] = cut_weight(graph, partition) / total;
+    state.counters["imbalance"] = partition_imbalance(graph, partition, parts);
+}
+
+enum class Placement {
+    Threads,    // dataflow on one process's thread pool
+    Processes   // ProcessExecutor, one worker process per core
+};
+
+} // namespace test
+} // namespace flowgraph
+
+// 16 chains of 8 allocation-heavy nodes, on as many threads or processes as
+// there are cores
+template<flowgraph::test::Placement Mode>
+static void BM_AllocationHeavyGraph(::benchmark::State& state) {
+    using namespace flowgraph;
+
+    const size_t workers = std::max(2u, std::thread::hardware_concurrency());
+    auto pool = std::make_shared<ThreadPool>(workers);
+    ProcessExecutorOptions process_options;
+    process_options.processes = workers;
+    ProcessExecutor<double> executor(process_options);
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+
+    for (auto _ : state) {
+        // Fresh nodes each iteration, so none returns a cached value
+        state.PauseTiming();
+        Graph<double> graph(nullptr, pool);
+        graph.set_execution_options(options);
+        test::build_chains(graph, 16, 8);
+        graph.execution_plan();
+        state.ResumeTiming();
+
+        if constexpr (Mode == test::Placement::Threads) {
+            graph.execute().get();
+        } else {
+            executor.execute(graph);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 16 * 8));
+}
+
+BENCHMARK_TEMPLATE(BM_AllocationHeavyGraph, flowgraph::test::Placement::Threads)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_AllocationHeavyGraph, flowgraph::test::Placement::Processes)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+// Partitioning random DAGs of up to 1M nodes into 8 parts: time, and the
+// quality of the result as counters. Greedy partitioning sees only the
+// topology; the multilevel partitioner also weighs the value sizes.
+static void BM_GreedyPartition(::benchmark::State& state) {
+    using namespace flowgraph;
+    auto plan = test::random_dag_plan(static_cast<size_t>(state.range(0)), 42);
+    PartitionMap partition;
+    for (auto _ : state) {
+        partition = greedy_partition(plan, 8);
+        ::benchmark::DoNotOptimize(partition.data());
+    }
+    test::report_partition_quality(state, test::weighted_graph(plan), partition, 8);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+static void BM_MultilevelPartition(::benchmark::State& state) {
+    using namespace flowgraph;
+    auto plan = test::random_dag_plan(static_cast<size_t>(state.range(0)), 42);
+    auto graph = test::weighted_graph(plan);
+    PartitionMap partition;
+    for (auto _ : state) {
+        partition = multilevel_partition(graph, 8);
+        ::benchmark::DoNotOptimize(partition.data());
+    }
+    test::report_partition_quality(state, graph, partition, 8);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_GreedyPartition)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->Unit(::benchmark::kMillisecond);
+BENCHMARK(BM_MultilevelPartition)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->Unit(::benchmark::kMillisecond);
@@ -0,0 +1,491 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../include/flowgraph/distributed/multilevel_partition.hpp"
+#include "../include/flowgraph/distributed/process_executor.hpp"
+#include "../include/flowgraph/distributed/remote_executor.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+
+namespace flowgraph {
+namespace test {
+
+TEST(SpscByteRingTest, RecordsSurviveWrapAroundAcrossThreads) {
+    const size_t capacity = 1024;
+    std::vector<std::byte> memory(SpscByteRing::footprint(capacity));
+    auto* ring = SpscByteRing::create(memory.data(), capacity);
+    EXPECT_THROW(ring->try_write(capacity, [](std::byte*) {}), std::length_error);
+
+    // Sizes that do not divide the capacity force skip markers
+    const int records = 5000;
+    std::thread producer([ring] {
+        for (int i = 0; i < records; ++i) {
+            size_t size = static_cast<size_t>(i % 300) + 1;
+            while (!ring->try_write(size, [&](std::byte* out) {
+                for (size_t b = 0; b < size; ++b) {
+                    out[b] = static_cast<std::byte>(i + b);
+                }
+            })) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int next = 0;
+    bool intact = true;
+    while (next < records) {
+        bool read = ring->try_read([&](std::span<const std::byte> record) {
+            intact = intact && record.size() == static_cast<size_t>(next % 300) + 1;
+            for (size_t b = 0; intact && b < record.size(); ++b) {
+                intact = record[b] == static_cast<std::byte>(next + b);
+            }
+            ++next;
+        });
+        if (!read) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(intact);
+    EXPECT_TRUE(ring->empty());
+}
+
+TEST(ValueCodecTest, RoundTripsValuesAndErrors) {
+    std::vector<std::byte> buffer;
+    auto round_trip = [&buffer](const auto& result) {
+        using R = std::decay_t<decltype(result)>;
+        using V = typename R::value_type;
+        buffer.assign(ResultCodec<V>::size(result), std::byte{0});
+        ResultCodec<V>::encode(result, buffer.data());
+        return ResultCodec<V>::decode(buffer);
+    };
+
+    EXPECT_EQ(round_trip(ComputeResult<double>(2.5)).value(), 2.5);
+    std::vector<float> samples{1.0f, 2.0f, 3.0f};
+    EXPECT_EQ(round_trip(ComputeResult<std::vector<float>>(samples)).value(), samples);
+    EXPECT_EQ(round_trip(ComputeResult<std::string>(std::string("text"))).value(), "text");
+
+    auto error = ErrorState::validation_error("bad input");
+    error.set_source_node("source");
+    error.add_propagation_path("middle");
+    auto decoded = round_trip(ComputeResult<double>(error));
+    ASSERT_TRUE(decoded.has_error());
+    EXPECT_EQ(decoded.error().type(), ErrorType::ValidationError);
+    EXPECT_EQ(decoded.error().message(), "bad input");
+    EXPECT_EQ(decoded.error().source_node(), "source");
+    EXPECT_EQ(decoded.error().propagation_path(), std::vector<std::string>{"middle"});
+}
+
+// Adds its upstream nodes' values to its own, reading them through
+// compute() like any node would. `runs` only counts computations in this
+// process.
+template<typename T>
+class SumNode : public Node<T> {
+public:
+    SumNode(std::string name, T value, std::vector<std::shared_ptr<Node<T>>> inputs = {})
+        : Node<T>(std::move(name)), value_(value), inputs_(std::move(inputs)) {}
+
+    bool fail = false;
+    bool crash = false;
+    std::chrono::milliseconds delay{0};
+    int runs = 0;
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        ++runs;
+        std::this_thread::sleep_for(delay);
+        if (crash) {
+            ::_exit(3);
+        }
+        if (fail) {
+            throw std::runtime_error("sum failed");
+        }
+        T sum = value_;
+        for (const auto& input : inputs_) {
+            auto result = co_await input->compute();
+            if (result.has_error()) {
+                co_return result;
+            }
+            sum += result.value();
+        }
+        co_return ComputeResult<T>(sum);
+    }
+
+private:
+    T value_;
+    std::vector<std::shared_ptr<Node<T>>> inputs_;
+};
+
+// Alternating partitions, so every edge of a chain crosses processes
+template<typename T>
+PartitionMap alternate(const ExecutionPlan<T>& plan, size_t parts) {
+    PartitionMap partition(plan.size());
+    for (size_t i = 0; i < plan.size(); ++i) {
+        partition[i] = i % parts;
+    }
+    return partition;
+}
+
+// source -> chain of `length` nodes, each adding `step`
+template<typename T>
+std::vector<std::shared_ptr<SumNode<T>>> build_chain(Graph<T>& graph, size_t length, T source_value, T step) {
+    std::vector<std::shared_ptr<SumNode<T>>> chain;
+    chain.push_back(std::make_shared<SumNode<T>>("n0", source_value));
+    graph.add_node(chain.back());
+    for (size_t i = 1; i < length; ++i) {
+        auto node = std::make_shared<SumNode<T>>("n" + std::to_string(i), step,
+            std::vector<std::shared_ptr<Node<T>>>{chain.back()});
+        graph.add_node(node);
+        graph.add_edge(std::make_shared<Edge<T>>(chain.back(), node));
+        chain.push_back(node);
+    }
+    return chain;
+}
+
+class ProcessExecutorTest : public ::testing::Test {};
+
+TEST_F(ProcessExecutorTest, ValuesCrossPartitionsAndReturnToCaller) {
+    Graph<double> graph;
+    auto chain = build_chain(graph, 12, 100.0, 1.0);
+    // A fan-in reading several partitions at once
+    auto total = std::make_shared<SumNode<double>>("total", 0.0,
+        std::vector<std::shared_ptr<Node<double>>>{chain[3], chain[6], chain[11]});
+    graph.add_node(total);
+    for (size_t i : {3u, 6u, 11u}) {
+        graph.add_edge(std::make_shared<Edge<double>>(chain[i], total));
+    }
+
+    ProcessExecutorOptions options;
+    options.processes = 3;
+    ProcessExecutor<double> executor(options);
+    executor.set_partitioner(alternate<double>);
+    executor.execute(graph);
+
+    for (size_t i = 0; i < chain.size(); ++i) {
+        auto result = chain[i]->compute().get();
+        ASSERT_FALSE(result.has_error());
+        EXPECT_EQ(result.value(), 100.0 + static_cast<double>(i));
+        EXPECT_EQ(chain[i]->runs, 0);
+    }
+    EXPECT_EQ(total->compute().get().value(), 103.0 + 106.0 + 111.0);
+    EXPECT_FALSE(graph.get_node_error("total").has_value());
+    EXPECT_EQ(executor.last_partition().size(), 13u);
+}
+
+TEST_F(ProcessExecutorTest, ContiguousValuesThroughSmallRings) {
+    Graph<std::string> graph;
+    auto chain = build_chain(graph, 6, std::string(3000, 'x'), std::string("y"));
+    ProcessExecutorOptions options;
+    options.processes = 2;
+    options.ring_bytes = 8192;
+    ProcessExecutor<std::string> executor(options);
+    executor.set_partitioner(alternate<std::string>);
+
+    // Twice, reusing the shared arena
+    for (int run = 0; run < 2; ++run) {
+        executor.execute(graph);
+        auto result = chain.back()->compute().get();
+        ASSERT_FALSE(result.has_error());
+        EXPECT_EQ(result.value().size(), 3005u);
+    }
+}
+
+TEST_F(ProcessExecutorTest, ErrorsPropagateAcrossPartitions) {
+    Graph<double> graph;
+    auto chain = build_chain(graph, 4, 1.0, 1.0);
+    chain[1]->fail = true;
+    ProcessExecutor<double> executor;
+    executor.set_partitioner(alternate<double>);
+    executor.execute(graph);
+
+    EXPECT_FALSE(graph.get_node_error("n0").has_value());
+    auto error = graph.get_node_error("n3");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->source_node(), "n1");
+    EXPECT_EQ(error->propagation_path(), (std::vector<std::string>{"n2", "n3"}));
+    EXPECT_TRUE(chain[3]->compute().get().has_error());
+}
+
+TEST_F(ProcessExecutorTest, CrashedWorkerFailsRemainingNodes) {
+    Graph<double> graph;
+    auto chain = build_chain(graph, 6, 1.0, 1.0);
+    chain[2]->crash = true;
+    ProcessExecutor<double> executor;
+    executor.set_partitioner(alternate<double>);
+    executor.execute(graph);
+
+    EXPECT_FALSE(graph.get_node_error("n1").has_value());
+    auto error = graph.get_node_error("n5");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->type(), ErrorType::ResourceError);
+    EXPECT_NE(error->message().find("Partition process 0 failed"), std::string::npos);
+}
+
+// Worker processes on localhost, each building its graph with the same
+// function as the coordinator
+class RemoteExecutorTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (pid_t pid : workers_) {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+        }
+    }
+
+    template<typename T>
+    std::vector<Endpoint> spawn_workers(size_t count, const std::function<void(Graph<T>&)>& build) {
+        std::vector<Endpoint> endpoints;
+        for (size_t w = 0; w < count; ++w) {
+            int fds[2];
+            if (::pipe(fds) != 0) {
+                throw std::runtime_error("pipe failed");
+            }
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+                ::close(fds[0]);
+                Graph<T> graph;
+                build(graph);
+                RemoteWorker<T> worker(graph);
+                uint16_t port = worker.endpoint().port;
+                if (::write(fds[1], &port, sizeof(port)) != sizeof(port)) {
+                    ::_exit(1);
+                }
+                worker.serve();
+                ::_exit(0);
+            }
+            ::close(fds[1]);
+            workers_.push_back(pid);
+            uint16_t port = 0;
+            if (::read(fds[0], &port, sizeof(port)) != sizeof(port)) {
+                throw std::runtime_error("worker did not start");
+            }
+            ::close(fds[0]);
+            endpoints.push_back({"127.0.0.1", port});
+        }
+        return endpoints;
+    }
+
+    std::vector<pid_t> workers_;
+};
+
+TEST_F(RemoteExecutorTest, ValuesCrossWorkersAndReturnToCoordinator) {
+    std::vector<std::shared_ptr<SumNode<double>>> chain;
+    std::shared_ptr<SumNode<double>> total;
+    std::function<void(Graph<double>&)> build = [&](Graph<double>& graph) {
+        chain = build_chain(graph, 12, 100.0, 1.0);
+        total = std::make_shared<SumNode<double>>("total", 0.0,
+            std::vector<std::shared_ptr<Node<double>>>{chain[3], chain[6], chain[11]});
+        graph.add_node(total);
+        for (size_t i : {3u, 6u, 11u}) {
+            graph.add_edge(std::make_shared<Edge<double>>(chain[i], total));
+        }
+    };
+    auto endpoints = spawn_workers(3, build);
+    Graph<double> graph;
+    build(graph);
+
+    RemoteExecutor<double> executor(endpoints);
+    executor.set_partitioner(alternate<double>);
+    // Twice, the second run reusing the shipped plan
+    for (int run = 0; run < 2; ++run) {
+        executor.execute(graph);
+        for (size_t i = 0; i < chain.size(); ++i) {
+            auto result = chain[i]->compute().get();
+            ASSERT_FALSE(result.has_error());
+            EXPECT_EQ(result.value(), 100.0 + static_cast<double>(i));
+            EXPECT_EQ(chain[i]->runs, 0);
+        }
+        EXPECT_EQ(total->compute().get().value(), 103.0 + 106.0 + 111.0);
+    }
+    EXPECT_EQ(executor.last_partition().size(), 13u);
+}
+
+TEST_F(RemoteExecutorTest, LargeValuesSpanManyPackets) {
+    std::vector<std::shared_ptr<SumNode<std::string>>> chain;
+    std::function<void(Graph<std::string>&)> build = [&](Graph<std::string>& graph) {
+        chain = build_chain(graph, 5, std::string(1 << 20, 'x'), std::string("y"));
+    };
+    auto endpoints = spawn_workers(2, build);
+    Graph<std::string> graph;
+    build(graph);
+
+    RemoteExecutor<std::string> executor(endpoints);
+    executor.set_partitioner(alternate<std::string>);
+    executor.execute(graph);
+    auto result = chain.back()->compute().get();
+    ASSERT_FALSE(result.has_error());
+    EXPECT_EQ(result.value().size(), (size_t{1} << 20) + 4);
+}
+
+TEST_F(RemoteExecutorTest, ErrorsPropagateAcrossWorkers) {
+    std::vector<std::shared_ptr<SumNode<double>>> chain;
+    std::function<void(Graph<double>&)> build = [&](Graph<double>& graph) {
+        chain = build_chain(graph, 4, 1.0, 1.0);
+        chain[1]->fail = true;
+    };
+    auto endpoints = spawn_workers(2, build);
+    Graph<double> graph;
+    build(graph);
+
+    RemoteExecutor<double> executor(endpoints);
+    executor.set_partitioner(alternate<double>);
+    executor.execute(graph);
+
+    EXPECT_FALSE(graph.get_node_error("n0").has_value());
+    auto error = graph.get_node_error("n3");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->source_node(), "n1");
+    EXPECT_EQ(error->propagation_path(), (std::vector<std::string>{"n2", "n3"}));
+}
+
+TEST_F(RemoteExecutorTest, LostWorkerFailsRemainingNodes) {
+    std::vector<std::shared_ptr<SumNode<double>>> chain;
+    std::function<void(Graph<double>&)> build = [&](Graph<double>& graph) {
+        chain = build_chain(graph, 6, 1.0, 1.0);
+        chain[2]->crash = true;
+    };
+    auto endpoints = spawn_workers(2, build);
+    Graph<double> graph;
+    build(graph);
+
+    RemoteExecutor<double> executor(endpoints);
+    executor.set_partitioner(alternate<double>);
+    executor.execute(graph);
+
+    EXPECT_FALSE(graph.get_node_error("n1").has_value());
+    auto error = graph.get_node_error("n5");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->type(), ErrorType::ResourceError);
+    EXPECT_NE(error->message().find(endpoints[0].to_string() + " disconnected"), std::string::npos);
+}
+
+// Killed while another worker is still computing a result it needs: the
+// coordinator fails the run instead of dying on a write to the dead worker
+TEST_F(RemoteExecutorTest, WorkerKilledMidRunFailsTheRun) {
+    std::vector<std::shared_ptr<SumNode<double>>> chain;
+    std::function<void(Graph<double>&)> build = [&](Graph<double>& graph) {
+        chain = build_chain(graph, 4, 1.0, 1.0);
+        chain[1]->delay = std::chrono::milliseconds(500);
+    };
+    auto endpoints = spawn_workers(2, build);
+    Graph<double> graph;
+    build(graph);
+
+    RemoteExecutor<double> executor(endpoints);
+    executor.set_partitioner(alternate<double>);
+    std::thread run([&] { executor.execute(graph); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    ::kill(workers_[0], SIGKILL);
+    ::waitpid(workers_[0], nullptr, 0);
+    workers_.erase(workers_.begin());
+    run.join();
+
+    auto error = graph.get_node_error("n3");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->type(), ErrorType::ResourceError);
+    EXPECT_NE(error->message().find(endpoints[0].to_string() + " disconnected"), std::string::npos);
+    // The surviving worker outlived its writes to the dead one too
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(::waitpid(workers_[0], nullptr, WNOHANG), 0);
+}
+
+// Writes to a peer that has gone away close the connection rather than
+// raising SIGPIPE
+TEST(TcpConnectionTest, SendToClosedPeerDoesNotRaiseSigpipe) {
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::atomic<bool> closed{false};
+    TcpConnection connection(fds[0], [](FrameType, std::span<const std::byte>) {},
+                             [&] { closed = true; });
+    ::close(fds[1]);
+    for (int i = 0; i < 100; ++i) {
+        connection.send(std::move(FrameBuilder(FrameType::Cancel).put<uint64_t>(i)).finish());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    while (!closed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(connection.is_open());
+}
+
+TEST(PartitionTest, GreedyKeepsChainsTogether) {
+    Graph<double> graph;
+    // Two independent chains of four
+    for (int c = 0; c < 2; ++c) {
+        std::shared_ptr<Node<double>> previous;
+        for (int i = 0; i < 4; ++i) {
+            auto node = std::make_shared<SumNode<double>>("c" + std::to_string(c) + "_" + std::to_string(i), 1.0);
+            graph.add_node(node);
+            if (previous) {
+                graph.add_edge(std::make_shared<Edge<double>>(previous, node));
+            }
+            previous = node;
+        }
+    }
+    auto plan = graph.execution_plan();
+    auto partition = greedy_partition(*plan, 2);
+    EXPECT_EQ(cut_edges(*plan, partition), 0u);
+    EXPECT_EQ(std::count(partition.begin(), partition.end(), 0u), 4);
+}
+
+TEST(PartitionTest, MultilevelFindsClustersUnderBalance) {
+    // 8 clusters of 64 densely linked vertices, shuffled, with one light
+    // link between consecutive clusters
+    const size_t clusters = 8, size = 64;
+    std::mt19937_64 rng(7);
+    std::vector<size_t> label(clusters * size);
+    std::iota(label.begin(), label.end(), 0);
+    std::shuffle(label.begin(), label.end(), rng);
+    std::vector<PartitionGraph::Link> links;
+    for (size_t c = 0; c < clusters; ++c) {
+        for (size_t i = 0; i < size; ++i) {
+            for (size_t k = 1; k <= 4; ++k) {
+                links.push_back({label[c * size + i], label[c * size + (i + k) % size], 8.0});
+            }
+        }
+        links.push_back({label[c * size], label[(c + 1) % clusters * size], 1.0});
+    }
+    auto graph = PartitionGraph::from_links(std::vector<double>(clusters * size, 1.0), links);
+
+    auto partition = multilevel_partition(graph, 4);
+    EXPECT_LE(partition_imbalance(graph, partition, 4), 1.05);
+    // Whole clusters per partition cut only the light links
+    EXPECT_LE(cut_weight(graph, partition), 8.0);
+}
+
+TEST(PartitionTest, MultilevelPartitionerWeighsNodeCosts) {
+    Graph<double> graph;
+    auto chain = build_chain(graph, 16, 1.0, 1.0);
+    // n0 costs as much as all the others together
+    auto partitioner = multilevel_partitioner<double>({}, [](const Node<double>& node) {
+        return node.name() == "n0" ? 15.0 : 1.0;
+    });
+    auto plan = graph.execution_plan();
+    auto partition = partitioner(*plan, 2);
+    EXPECT_EQ(std::count(partition.begin(), partition.end(), partition[0]), 1);
+
+    // Usable by the executors
+    ProcessExecutor<double> executor;
+    executor.set_partitioner(partitioner);
+    executor.execute(graph);
+    EXPECT_EQ(chain.back()->compute().get().value(), 16.0);
+}
+
+} // namespace test
+} // namespace flowgraph
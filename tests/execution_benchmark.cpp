@@ -0,0 +1,381 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "../include/flowgraph/core/node.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+#include "../include/flowgraph/core/plan_cache.hpp"
+#include "../include/flowgraph/async/blocking_region.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+#include "benchmark_utils.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// Node whose computation is negligible, so scheduling overhead dominates
+template<typename T>
+class TrivialNode : public Node<T> {
+public:
+    explicit TrivialNode(std::string name) : Node<T>(std::move(name)) {}
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t precision_level) override {
+        co_return ComputeResult<T>(static_cast<T>(precision_level + 1));
+    }
+};
+
+// Build a layered DAG where node i of level l depends on nodes i and i+1 of level l-1
+inline void build_layered_graph(Graph<double>& graph, size_t levels, size_t width) {
+    std::vector<std::shared_ptr<Node<double>>> previous;
+    for (size_t l = 0; l < levels; ++l) {
+        std::vector<std::shared_ptr<Node<double>>> current;
+        current.reserve(width);
+        for (size_t i = 0; i < width; ++i) {
+            auto node = std::make_shared<TrivialNode<double>>(
+                "n" + std::to_string(l) + "_" + std::to_string(i));
+            graph.add_node(node);
+            if (!previous.empty()) {
+                graph.add_edge(std::make_shared<Edge<double>>(previous[i], node));
+                if (width > 1) {
+                    graph.add_edge(std::make_shared<Edge<double>>(previous[(i + 1) % width], node));
+                }
+            }
+            current.push_back(node);
+        }
+        previous = std::move(current);
+    }
+}
+
+// Node that transforms its predecessor's large buffer, so the successor's
+// input is hot in the cache of whichever core produced it
+class BufferNode : public Node<double> {
+public:
+    BufferNode(std::string name, std::shared_ptr<BufferNode> input, size_t elements)
+        : Node<double>(std::move(name))
+        , input_(std::move(input))
+        , buffer_(elements, 1.0) {}
+
+    const std::vector<double>& buffer() const { return buffer_; }
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        if (input_) {
+            const auto& in = input_->buffer();
+            for (size_t k = 0; k < buffer_.size(); ++k) {
+                buffer_[k] = in[k] * 0.5 + 1.0;
+            }
+        }
+        co_return ComputeResult<double>(buffer_[0]);
+    }
+
+private:
+    std::shared_ptr<BufferNode> input_;
+    std::vector<double> buffer_;
+};
+
+// Node that either burns 100us of CPU or sleeps 1ms inside a blocking
+// region, standing in for a compute kernel or a remote fetch
+class MixedWorkNode : public Node<double> {
+public:
+    MixedWorkNode(std::string name, bool blocking)
+        : Node<double>(std::move(name))
+        , blocking_(blocking) {}
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        if (blocking_) {
+            blocking_region([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+        } else {
+            spin_for(std::chrono::microseconds(100));
+        }
+        co_return ComputeResult<double>(blocking_ ? 1.0 : 0.0);
+    }
+
+private:
+    bool blocking_;
+};
+
+// Counts last-level cache read misses of this thread and every thread it
+// spawns afterwards. Inherited counts are folded in when those threads exit,
+// so read() must be called after the thread pool has been destroyed.
+// Generic perf events do not expose L2 portably; LLC misses are the closest
+// portable proxy for data leaving the producing core's private caches.
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_LL |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+#endif
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    uint64_t read() const {
+        uint64_t value = 0;
+#ifdef __linux__
+        if (fd_ >= 0 && ::read(fd_, &value, sizeof(value)) != sizeof(value)) {
+            value = 0;
+        }
+#endif
+        return value;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace test
+} // namespace flowgraph
+
+// Wide, shallow graphs: 5 levels of state.range(0) nodes each
+template<flowgraph::ExecutionStrategy Strategy>
+static void BM_WideGraph(::benchmark::State& state) {
+    const size_t width = state.range(0);
+    flowgraph::Graph<double> graph;
+    flowgraph::test::build_layered_graph(graph, 5, width);
+
+    flowgraph::ExecutionOptions options;
+    options.strategy = Strategy;
+    graph.set_execution_options(options);
+    graph.execute().get();  // Warm node storage and the cached plan
+
+    for (auto _ : state) {
+        graph.execute().get();
+    }
+    state.SetItemsProcessed(state.iterations() * width * 5);
+}
+
+// Deep, narrow graphs: a single chain of state.range(0) nodes
+template<flowgraph::ExecutionStrategy Strategy>
+static void BM_DeepGraph(::benchmark::State& state) {
+    const size_t depth = state.range(0);
+    flowgraph::Graph<double> graph;
+    flowgraph::test::build_layered_graph(graph, depth, 1);
+
+    flowgraph::ExecutionOptions options;
+    options.strategy = Strategy;
+    graph.set_execution_options(options);
+    graph.execute().get();
+
+    for (auto _ : state) {
+        graph.execute().get();
+    }
+    state.SetItemsProcessed(state.iterations() * depth);
+}
+
+// Parallel chains of nodes passing 256 KiB buffers, executed with the
+// dataflow executor either continuing on the producing worker or routing
+// every successor through the shared queue
+template<bool ContinueOnSameWorker>
+static void BM_LargeBufferChains(::benchmark::State& state) {
+    const size_t chains = 8;
+    const size_t length = state.range(0);
+    const size_t elements = 32 * 1024;
+
+    flowgraph::test::CacheMissCounter misses;
+    {
+        auto pool = std::make_shared<flowgraph::ThreadPool>();
+        flowgraph::ExecutionOptions options;
+        options.strategy = flowgraph::ExecutionStrategy::Dataflow;
+        options.continue_on_same_worker = ContinueOnSameWorker;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            flowgraph::Graph<double> graph(nullptr, pool);
+            graph.set_execution_options(options);
+            for (size_t c = 0; c < chains; ++c) {
+                std::shared_ptr<flowgraph::test::BufferNode> previous;
+                for (size_t i = 0; i < length; ++i) {
+                    auto node = std::make_shared<flowgraph::test::BufferNode>(
+                        "c" + std::to_string(c) + "_" + std::to_string(i), previous, elements);
+                    graph.add_node(node);
+                    if (previous) {
+                        graph.add_edge(std::make_shared<flowgraph::Edge<double>>(previous, node));
+                    }
+                    previous = node;
+                }
+            }
+            graph.execution_plan();
+            state.ResumeTiming();
+
+            graph.execute().get();
+        }
+    }
+
+    const double nodes = static_cast<double>(state.iterations() * chains * length);
+    state.SetBytesProcessed(static_cast<int64_t>(nodes * elements * sizeof(double)));
+    if (misses.available()) {
+        state.counters["llc_misses_per_node"] = static_cast<double>(misses.read()) / nodes;
+    }
+}
+
+// 64 independent nodes, every fourth one blocking, on a fixed pool versus
+// an elastic pool of the same base size
+template<bool Elastic>
+static void BM_MixedBlockingGraph(::benchmark::State& state) {
+    flowgraph::ThreadPoolOptions pool_options;
+    pool_options.num_threads = std::max(2u, std::thread::hardware_concurrency());
+    pool_options.elastic = Elastic;
+    auto pool = std::make_shared<flowgraph::ThreadPool>(pool_options);
+
+    flowgraph::ExecutionOptions options;
+    options.strategy = flowgraph::ExecutionStrategy::Dataflow;
+
+    // A fresh graph per iteration, since nodes serve merged values from
+    // their storage once computed often enough
+    for (auto _ : state) {
+        state.PauseTiming();
+        flowgraph::Graph<double> graph(nullptr, pool);
+        graph.set_execution_options(options);
+        for (size_t i = 0; i < 64; ++i) {
+            graph.add_node(std::make_shared<flowgraph::test::MixedWorkNode>(
+                "m" + std::to_string(i), i % 4 == 0));
+        }
+        graph.execution_plan();
+        state.ResumeTiming();
+
+        graph.execute().get();
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+    state.counters["threads"] = static_cast<double>(pool->active_thread_count());
+}
+
+// Per-execution latency of a 10-node dataflow graph (5 levels of 2) with
+// workers that park between executions versus workers that keep polling
+template<bool Polling>
+static void BM_ExecuteLatency(::benchmark::State& state) {
+    flowgraph::ThreadPoolOptions pool_options;
+    pool_options.num_threads = 2;
+    if (Polling) {
+        pool_options.spin_budget = std::chrono::microseconds(500);
+    }
+    auto pool = std::make_shared<flowgraph::ThreadPool>(pool_options);
+
+    flowgraph::Graph<double> graph(nullptr, pool);
+    flowgraph::test::build_layered_graph(graph, 5, 2);
+    flowgraph::ExecutionOptions options;
+    options.strategy = flowgraph::ExecutionStrategy::Dataflow;
+    options.continue_on_same_worker = false;
+    graph.set_execution_options(options);
+    graph.execute().get();
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(state.max_iterations);
+    for (auto _ : state) {
+        auto start = flowgraph::test::BenchClock::now();
+        graph.execute().get();
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(
+            flowgraph::test::BenchClock::now() - start).count());
+    }
+    flowgraph::test::report_percentiles(state, latencies_us);
+}
+
+// Building and planning a fresh graph of state.range(0) levels of 16, as
+// a service does per request, with and without the plan cache
+template<bool Cached>
+static void BM_PlanFreshGraph(::benchmark::State& state) {
+    const size_t levels = static_cast<size_t>(state.range(0));
+    auto pool = std::make_shared<flowgraph::ThreadPool>(1);
+    flowgraph::ExecutionOptions options;
+    options.use_plan_cache = Cached;
+    flowgraph::PlanCache::instance().clear();
+
+    for (auto _ : state) {
+        flowgraph::Graph<double> graph(nullptr, pool);
+        graph.set_execution_options(options);
+        flowgraph::test::build_layered_graph(graph, levels, 16);
+        ::benchmark::DoNotOptimize(graph.execution_plan());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * levels * 16));
+    state.counters["hit_rate"] = flowgraph::PlanCache::instance().metrics().hit_rate();
+}
+
+BENCHMARK_TEMPLATE(BM_PlanFreshGraph, false)->Arg(4)->Arg(64)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_PlanFreshGraph, true)->Arg(4)->Arg(64)->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_ExecuteLatency, false)
+    ->Iterations(20000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_ExecuteLatency, true)
+    ->Iterations(20000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_MixedBlockingGraph, false)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_MixedBlockingGraph, true)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_LargeBufferChains, true)
+    ->RangeMultiplier(2)
+    ->Range(8, 32)
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_LargeBufferChains, false)
+    ->RangeMultiplier(2)
+    ->Range(8, 32)
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_WideGraph, flowgraph::ExecutionStrategy::DependencyDriven)
+    ->RangeMultiplier(2)
+    ->Range(256, 1024)
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_WideGraph, flowgraph::ExecutionStrategy::LevelSynchronous)
+    ->RangeMultiplier(2)
+    ->Range(256, 1024)
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_WideGraph, flowgraph::ExecutionStrategy::Dataflow)
+    ->RangeMultiplier(2)
+    ->Range(256, 1024)
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_DeepGraph, flowgraph::ExecutionStrategy::DependencyDriven)
+    ->RangeMultiplier(2)
+    ->Range(64, 512)
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_DeepGraph, flowgraph::ExecutionStrategy::LevelSynchronous)
+    ->RangeMultiplier(2)
+    ->Range(64, 512)
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_DeepGraph, flowgraph::ExecutionStrategy::Dataflow)
+    ->RangeMultiplier(2)
+    ->Range(64, 512)
+    ->Unit(::benchmark::kMicrosecond);
@@ -0,0 +1,773 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <future>
+#include <thread>
+#include <memory>
+#include <vector>
+#include "../include/flowgraph/core/node.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+#include "../include/flowgraph/core/execution_plan.hpp"
+#include "../include/flowgraph/core/plan_cache.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// Node that records the global order in which it was computed
+template<typename T>
+class SequencedNode : public Node<T> {
+public:
+    SequencedNode(std::string name, std::atomic<size_t>& clock, bool fail = false)
+        : Node<T>(std::move(name))
+        , clock_(clock)
+        , fail_(fail) {}
+
+    size_t sequence() const { return sequence_.load(); }
+    size_t compute_count() const { return compute_count_.load(); }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        compute_count_.fetch_add(1);
+        sequence_.store(clock_.fetch_add(1) + 1);
+        if (fail_) {
+            auto error = ErrorState::computation_error("Simulated failure in " + this->name());
+            error.set_source_node(this->name());
+            co_return ComputeResult<T>(std::move(error));
+        }
+        co_return ComputeResult<T>(T{1});
+    }
+
+private:
+    std::atomic<size_t>& clock_;
+    bool fail_;
+    std::atomic<size_t> sequence_{0};
+    std::atomic<size_t> compute_count_{0};
+};
+
+// Node that records which pool worker computed it
+template<typename T>
+class WorkerRecordingNode : public Node<T> {
+public:
+    WorkerRecordingNode(std::string name, std::shared_ptr<ThreadPool> pool)
+        : Node<T>(std::move(name))
+        , pool_(std::move(pool)) {}
+
+    std::optional<size_t> worker() const { return worker_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        worker_ = pool_->current_worker_index();
+        co_return ComputeResult<T>(T{1});
+    }
+
+private:
+    std::shared_ptr<ThreadPool> pool_;
+    std::optional<size_t> worker_;
+};
+
+// Node that records the priority class it was computed under
+template<typename T>
+class PriorityRecordingNode : public Node<T> {
+public:
+    explicit PriorityRecordingNode(std::string name) : Node<T>(std::move(name)) {}
+
+    TaskPriority priority() const { return priority_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        priority_ = ThreadPool::current_priority();
+        co_return ComputeResult<T>(T{1});
+    }
+
+private:
+    TaskPriority priority_ = TaskPriority::Interactive;
+};
+
+// Node that records the precision level it was last computed at
+template<typename T>
+class PrecisionRecordingNode : public Node<T> {
+public:
+    explicit PrecisionRecordingNode(std::string name) : Node<T>(std::move(name)) {}
+
+    size_t computed_level() const { return computed_level_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t precision_level) override {
+        computed_level_ = precision_level;
+        co_return ComputeResult<T>(static_cast<T>(precision_level));
+    }
+
+private:
+    size_t computed_level_ = 0;
+};
+
+// Node that suspends, as on I/O, until another thread releases it
+template<typename T>
+class GatedNode : public Node<T> {
+public:
+    explicit GatedNode(std::string name) : Node<T>(std::move(name)) {}
+
+    void release() {
+        while (!waiter_.load()) {
+            std::this_thread::yield();
+        }
+        std::coroutine_handle<>::from_address(waiter_.exchange(nullptr)).resume();
+    }
+
+protected:
+    struct Gate {
+        std::atomic<void*>& waiter;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { waiter.store(handle.address()); }
+        void await_resume() const noexcept {}
+    };
+
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        co_await Gate{waiter_};
+        co_return ComputeResult<T>(T{1});
+    }
+
+private:
+    std::atomic<void*> waiter_{nullptr};
+};
+
+// Node that records the thread it was computed on
+template<typename T>
+class ThreadRecordingNode : public Node<T> {
+public:
+    explicit ThreadRecordingNode(std::string name) : Node<T>(std::move(name)) {}
+
+    std::thread::id thread() const { return thread_; }
+
+protected:
+    Task<ComputeResult<T>> compute_impl(size_t) override {
+        thread_ = std::this_thread::get_id();
+        co_return ComputeResult<T>(T{1});
+    }
+
+private:
+    std::thread::id thread_;
+};
+
+class ExecutionStrategyTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        pool_ = std::make_shared<ThreadPool>(4);
+        graph_ = std::make_unique<Graph<double>>(nullptr, pool_);
+    }
+
+    std::shared_ptr<SequencedNode<double>> make_node(const std::string& name, bool fail = false) {
+        auto node = std::make_shared<SequencedNode<double>>(name, clock_, fail);
+        graph_->add_node(node);
+        return node;
+    }
+
+    void connect(const std::shared_ptr<Node<double>>& from, const std::shared_ptr<Node<double>>& to) {
+        graph_->add_edge(std::make_shared<Edge<double>>(from, to));
+    }
+
+    void use_level_synchronous(size_t min_chunk_size = 1) {
+        ExecutionOptions options;
+        options.strategy = ExecutionStrategy::LevelSynchronous;
+        options.min_chunk_size = min_chunk_size;
+        graph_->set_execution_options(options);
+    }
+
+    void use_dataflow(bool continue_on_same_worker = true) {
+        ExecutionOptions options;
+        options.strategy = ExecutionStrategy::Dataflow;
+        options.continue_on_same_worker = continue_on_same_worker;
+        graph_->set_execution_options(options);
+    }
+
+    std::atomic<size_t> clock_{0};
+    std::shared_ptr<ThreadPool> pool_;
+    std::unique_ptr<Graph<double>> graph_;
+};
+
+// Plan groups nodes by longest-path level with CSR adjacency
+TEST_F(ExecutionStrategyTest, PlanLevels) {
+    auto source = make_node("source");
+    auto left = make_node("left");
+    auto right = make_node("right");
+    auto deep = make_node("deep");
+    auto sink = make_node("sink");
+    connect(source, left);
+    connect(source, right);
+    connect(right, deep);
+    connect(left, sink);
+    connect(deep, sink);
+
+    auto plan = graph_->execution_plan();
+    ASSERT_EQ(plan->size(), 5);
+    ASSERT_EQ(plan->level_count(), 4);
+
+    auto level_of = [&](const std::shared_ptr<Node<double>>& node) {
+        size_t i = plan->index.at(node.get());
+        size_t level = 0;
+        while (plan->level_offsets[level + 1] <= i) {
+            ++level;
+        }
+        return level;
+    };
+    EXPECT_EQ(level_of(source), 0);
+    EXPECT_EQ(level_of(left), 1);
+    EXPECT_EQ(level_of(right), 1);
+    EXPECT_EQ(level_of(deep), 2);
+    EXPECT_EQ(level_of(sink), 3);
+    EXPECT_EQ(plan->predecessors_of(plan->index.at(sink.get())).size(), 2);
+    EXPECT_EQ(plan->successors_of(plan->index.at(source.get())).size(), 2);
+
+    // Plan is cached until the topology changes
+    EXPECT_EQ(plan, graph_->execution_plan());
+    make_node("isolated");
+    EXPECT_NE(plan, graph_->execution_plan());
+}
+
+// Every node runs exactly once and after all of its predecessors
+TEST_F(ExecutionStrategyTest, LevelSynchronousRespectsDependencies) {
+    constexpr size_t width = 64;
+    constexpr size_t depth = 4;
+    std::vector<std::vector<std::shared_ptr<SequencedNode<double>>>> levels(depth);
+    for (size_t l = 0; l < depth; ++l) {
+        for (size_t i = 0; i < width; ++i) {
+            levels[l].push_back(make_node("n" + std::to_string(l) + "_" + std::to_string(i)));
+            if (l > 0) {
+                connect(levels[l - 1][i], levels[l][i]);
+                connect(levels[l - 1][(i + 1) % width], levels[l][i]);
+            }
+        }
+    }
+
+    use_level_synchronous(8);
+    graph_->execute().get();
+
+    for (size_t l = 0; l < depth; ++l) {
+        for (size_t i = 0; i < width; ++i) {
+            EXPECT_EQ(levels[l][i]->compute_count(), 1);
+            if (l > 0) {
+                EXPECT_GT(levels[l][i]->sequence(), levels[l - 1][i]->sequence());
+                EXPECT_GT(levels[l][i]->sequence(), levels[l - 1][(i + 1) % width]->sequence());
+            }
+        }
+    }
+}
+
+// Errors propagate along plan edges exactly like the dependency-driven executor
+TEST_F(ExecutionStrategyTest, LevelSynchronousErrorPropagation) {
+    auto node1 = make_node("node1", true);
+    auto node2 = make_node("node2");
+    auto node3 = make_node("node3");
+    auto unrelated = make_node("unrelated");
+    connect(node1, node2);
+    connect(node2, node3);
+
+    use_level_synchronous();
+    graph_->execute().get();
+
+    auto error = graph_->get_node_error("node3");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->source_node(), "node1");
+    ASSERT_EQ(error->propagation_path().size(), 2);
+    EXPECT_EQ(error->propagation_path()[0], "node2");
+    EXPECT_EQ(error->propagation_path()[1], "node3");
+
+    EXPECT_EQ(node2->compute_count(), 0);
+    EXPECT_EQ(node3->compute_count(), 0);
+    EXPECT_EQ(unrelated->compute_count(), 1);
+    EXPECT_FALSE(graph_->get_node_error("unrelated").has_value());
+}
+
+// Dataflow execution runs every node once, after all of its predecessors
+TEST_F(ExecutionStrategyTest, DataflowRespectsDependencies) {
+    constexpr size_t width = 32;
+    constexpr size_t depth = 6;
+    std::vector<std::vector<std::shared_ptr<SequencedNode<double>>>> levels(depth);
+    for (size_t l = 0; l < depth; ++l) {
+        for (size_t i = 0; i < width; ++i) {
+            levels[l].push_back(make_node("n" + std::to_string(l) + "_" + std::to_string(i)));
+            if (l > 0) {
+                connect(levels[l - 1][i], levels[l][i]);
+                connect(levels[l - 1][(i + 3) % width], levels[l][i]);
+            }
+        }
+    }
+
+    for (bool continue_on_same_worker : {true, false}) {
+        use_dataflow(continue_on_same_worker);
+        graph_->execute().get();
+    }
+
+    for (size_t l = 0; l < depth; ++l) {
+        for (size_t i = 0; i < width; ++i) {
+            EXPECT_EQ(levels[l][i]->compute_count(), 2);
+            if (l > 0) {
+                EXPECT_GT(levels[l][i]->sequence(), levels[l - 1][i]->sequence());
+                EXPECT_GT(levels[l][i]->sequence(), levels[l - 1][(i + 3) % width]->sequence());
+            }
+        }
+    }
+}
+
+TEST_F(ExecutionStrategyTest, DataflowErrorPropagation) {
+    auto source = make_node("source", true);
+    auto branch1 = make_node("branch1");
+    auto branch2 = make_node("branch2");
+    auto sink = make_node("sink");
+    auto unrelated = make_node("unrelated");
+    connect(source, branch1);
+    connect(source, branch2);
+    connect(branch1, sink);
+    connect(branch2, sink);
+
+    use_dataflow();
+    graph_->execute().get();
+
+    auto error = graph_->get_node_error("sink");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->source_node(), "source");
+    EXPECT_EQ(error->propagation_path().size(), 2);
+    EXPECT_EQ(sink->compute_count(), 0);
+    EXPECT_EQ(unrelated->compute_count(), 1);
+}
+
+// A chain continues on whichever thread picked up its head
+TEST_F(ExecutionStrategyTest, DataflowContinuesOnSameWorker) {
+    std::vector<std::shared_ptr<WorkerRecordingNode<double>>> chain;
+    for (size_t i = 0; i < 16; ++i) {
+        auto node = std::make_shared<WorkerRecordingNode<double>>("chain" + std::to_string(i), pool_);
+        graph_->add_node(node);
+        if (!chain.empty()) {
+            connect(chain.back(), node);
+        }
+        chain.push_back(node);
+    }
+
+    use_dataflow();
+    graph_->execute().get();
+
+    for (const auto& node : chain) {
+        EXPECT_EQ(node->worker(), chain.front()->worker());
+    }
+}
+
+// Nodes with an affinity hint run on the requested worker
+TEST_F(ExecutionStrategyTest, DataflowAffinityHint) {
+    std::vector<std::shared_ptr<WorkerRecordingNode<double>>> nodes;
+    for (size_t i = 0; i < 8; ++i) {
+        auto node = std::make_shared<WorkerRecordingNode<double>>("pinned" + std::to_string(i), pool_);
+        node->set_affinity_hint(i % 2 == 0 ? 1 : 3);
+        graph_->add_node(node);
+        if (i >= 2) {
+            connect(nodes[i - 2], node);
+        }
+        nodes.push_back(node);
+    }
+
+    use_dataflow();
+    graph_->execute().get();
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        EXPECT_EQ(nodes[i]->worker(), std::optional<size_t>(i % 2 == 0 ? 1 : 3));
+    }
+}
+
+// Pool work of an execution is queued under the requested priority class
+TEST_F(ExecutionStrategyTest, ExecutePriority) {
+    std::vector<std::shared_ptr<PriorityRecordingNode<double>>> nodes;
+    for (size_t i = 0; i < 8; ++i) {
+        auto node = std::make_shared<PriorityRecordingNode<double>>("node" + std::to_string(i));
+        graph_->add_node(node);
+        if (i >= 2) {
+            connect(nodes[i - 2], node);
+        }
+        nodes.push_back(node);
+    }
+
+    for (auto strategy : {ExecutionStrategy::LevelSynchronous, ExecutionStrategy::Dataflow}) {
+        ExecutionOptions options;
+        options.strategy = strategy;
+        options.min_chunk_size = 1;
+        graph_->set_execution_options(options);
+
+        graph_->execute(TaskPriority::Batch).get();
+        for (const auto& node : nodes) {
+            EXPECT_EQ(node->priority(), TaskPriority::Batch);
+        }
+        graph_->execute().get();
+        for (const auto& node : nodes) {
+            EXPECT_EQ(node->priority(), TaskPriority::Interactive);
+        }
+    }
+    EXPECT_GT(pool_->metrics(TaskPriority::Batch).completed, 0);
+}
+
+// A node suspended on I/O holds no worker while it waits, and its
+// successor runs on the pool rather than on the thread completing the I/O
+TEST_F(ExecutionStrategyTest, SuspendedNodesReleaseTheirWorker) {
+    for (auto strategy : {ExecutionStrategy::Dataflow, ExecutionStrategy::LevelSynchronous}) {
+        ThreadPoolOptions pool_options;
+        pool_options.num_threads = 1;
+        auto pool = std::make_shared<ThreadPool>(std::move(pool_options));
+        Graph<double> graph(nullptr, pool);
+        auto gated = std::make_shared<GatedNode<double>>("gated");
+        auto successor = std::make_shared<ThreadRecordingNode<double>>("successor");
+        auto independent = std::make_shared<SequencedNode<double>>("independent", clock_);
+        graph.add_node(gated);
+        graph.add_node(successor);
+        graph.add_node(independent);
+        graph.add_edge(std::make_shared<Edge<double>>(gated, successor));
+        ExecutionOptions options;
+        options.strategy = strategy;
+        graph.set_execution_options(options);
+
+        std::thread::id completer_id;
+        size_t blocked = 0;
+        std::thread completer([&] {
+            completer_id = std::this_thread::get_id();
+            while (independent->compute_count() == 0) {
+                std::this_thread::yield();
+            }
+            blocked = pool->blocked_thread_count();
+            gated->release();
+        });
+        graph.execute().get();
+        completer.join();
+
+        EXPECT_EQ(blocked, 0);
+        for (const auto& name : {"gated", "successor", "independent"}) {
+            EXPECT_FALSE(graph.get_node_error(name).has_value()) << name;
+        }
+        EXPECT_NE(successor->thread(), std::thread::id());
+        EXPECT_NE(successor->thread(), completer_id);
+    }
+}
+
+// A full bounded pool rejects whole executions with ResourceError
+TEST_F(ExecutionStrategyTest, AdmissionControl) {
+    ThreadPoolOptions pool_options;
+    pool_options.num_threads = 1;
+    pool_options.max_queued_tasks = 2;
+    auto pool = std::make_shared<ThreadPool>(std::move(pool_options));
+    Graph<double> graph(nullptr, pool);
+    auto source = std::make_shared<SequencedNode<double>>("source", clock_);
+    auto sink = std::make_shared<SequencedNode<double>>("sink", clock_);
+    graph.add_node(source);
+    graph.add_node(sink);
+    graph.add_edge(std::make_shared<Edge<double>>(source, sink));
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    graph.set_execution_options(options);
+
+    // Occupy the only worker and fill the queue
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    pool->enqueue([&started, released] {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+    pool->enqueue_shared([] {});
+    pool->enqueue_shared([] {});
+    EXPECT_FALSE(pool->admits(TaskPriority::Interactive));
+    EXPECT_THROW(pool->enqueue_shared([] {}), QueueFullError);
+
+    graph.execute().get();
+    for (const auto& name : {"source", "sink"}) {
+        auto error = graph.get_node_error(name);
+        ASSERT_TRUE(error.has_value());
+        EXPECT_EQ(error->type(), ErrorType::ResourceError);
+    }
+    EXPECT_EQ(source->compute_count(), 0);
+    EXPECT_EQ(pool->metrics(TaskPriority::Interactive).rejected, 1);
+
+    release.set_value();
+    while (pool->queued_tasks(TaskPriority::Interactive) != 0) {
+        std::this_thread::yield();
+    }
+    graph.execute().get();
+    EXPECT_FALSE(graph.get_node_error("sink").has_value());
+    EXPECT_EQ(sink->compute_count(), 1);
+}
+
+// Nodes that waited in the queue beyond the target are shed, not computed
+TEST_F(ExecutionStrategyTest, ShedOnQueueDelay) {
+    auto source = make_node("source");
+    auto sink = make_node("sink");
+    connect(source, sink);
+
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    options.overload_action = OverloadAction::Shed;
+    options.queue_delay_target = std::chrono::microseconds(0);
+    graph_->set_execution_options(options);
+    graph_->execute().get();
+
+    auto error = graph_->get_node_error("sink");
+    ASSERT_TRUE(error.has_value());
+    EXPECT_EQ(error->type(), ErrorType::ResourceError);
+    EXPECT_EQ(error->source_node(), "source");
+    EXPECT_EQ(source->compute_count(), 0);
+    EXPECT_EQ(sink->compute_count(), 0);
+
+    options.queue_delay_target = std::chrono::hours(1);
+    graph_->set_execution_options(options);
+    graph_->execute().get();
+    EXPECT_FALSE(graph_->get_node_error("sink").has_value());
+    EXPECT_EQ(sink->compute_count(), 1);
+}
+
+// Under queueing delay precision steps down, and recovers once it clears
+TEST_F(ExecutionStrategyTest, DegradePrecisionOnQueueDelay) {
+    auto node = std::make_shared<PrecisionRecordingNode<double>>("node");
+    graph_->add_node(node);
+    node->set_precision_range(1, 3);
+
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    options.overload_action = OverloadAction::Degrade;
+    options.queue_delay_target = std::chrono::microseconds(0);
+    graph_->set_execution_options(options);
+
+    // The first execution only produces a queue delay sample
+    graph_->execute().get();
+    EXPECT_EQ(node->computed_level(), 3);
+    for (size_t expected : {2, 1, 1}) {
+        graph_->execute().get();
+        EXPECT_EQ(node->computed_level(), expected);
+    }
+
+    options.queue_delay_target = std::chrono::hours(1);
+    graph_->set_execution_options(options);
+    for (size_t expected : {2, 3, 3}) {
+        graph_->execute().get();
+        EXPECT_EQ(node->computed_level(), expected);
+    }
+}
+
+// Default-constructed nodes start at their maximum level and have
+// precision to give up
+TEST_F(ExecutionStrategyTest, DegradeLowersDefaultNodes) {
+    auto node = std::make_shared<PrecisionRecordingNode<double>>("node");
+    graph_->add_node(node);
+    const size_t top = node->max_precision_level();
+    ASSERT_GT(top, node->min_precision_level());
+
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    options.overload_action = OverloadAction::Degrade;
+    options.queue_delay_target = std::chrono::microseconds(0);
+    graph_->set_execution_options(options);
+
+    graph_->execute().get();
+    EXPECT_EQ(node->computed_level(), top);
+    graph_->execute().get();
+    graph_->execute().get();
+    EXPECT_EQ(node->computed_level(), top - 2);
+}
+
+// Degrade is refused where it could never lower anything
+TEST_F(ExecutionStrategyTest, DegradeWithNothingToLowerThrows) {
+    auto node = std::make_shared<PrecisionRecordingNode<double>>("node");
+    graph_->add_node(node);
+    ExecutionOptions options;
+    options.overload_action = OverloadAction::Degrade;
+    EXPECT_THROW(graph_->set_execution_options(options), std::invalid_argument);
+
+    options.strategy = ExecutionStrategy::Dataflow;
+    node->set_precision_range(2, 2);
+    EXPECT_THROW(graph_->set_execution_options(options), std::invalid_argument);
+    node->set_precision_range(1, 2);
+    EXPECT_NO_THROW(graph_->set_execution_options(options));
+}
+
+// Diamond source -> {left, right} -> sink with the given name prefix; the
+// sink optionally of another kind
+struct Diamond {
+    std::unique_ptr<Graph<double>> graph;
+    std::vector<std::shared_ptr<Node<double>>> nodes;
+};
+
+Diamond build_diamond(const std::string& prefix, std::atomic<size_t>& clock, bool other_sink = false) {
+    Diamond diamond;
+    diamond.graph = std::make_unique<Graph<double>>();
+    ExecutionOptions options;
+    options.use_plan_cache = true;
+    diamond.graph->set_execution_options(options);
+    for (const char* name : {"source", "left", "right"}) {
+        diamond.nodes.push_back(std::make_shared<SequencedNode<double>>(prefix + name, clock));
+    }
+    if (other_sink) {
+        diamond.nodes.push_back(std::make_shared<PrecisionRecordingNode<double>>(prefix + "sink"));
+    } else {
+        diamond.nodes.push_back(std::make_shared<SequencedNode<double>>(prefix + "sink", clock));
+    }
+    for (const auto& node : diamond.nodes) {
+        diamond.graph->add_node(node);
+    }
+    for (auto [from, to] : {std::pair{0, 1}, std::pair{0, 2}, std::pair{1, 3}, std::pair{2, 3}}) {
+        diamond.graph->add_edge(std::make_shared<Edge<double>>(diamond.nodes[from], diamond.nodes[to]));
+    }
+    return diamond;
+}
+
+TEST(PlanCacheTest, SharesPlansAcrossGraphsOfSameTopology) {
+    PlanCache::instance().clear();
+    std::atomic<size_t> clock{0};
+    auto first = build_diamond("a_", clock);
+    auto second = build_diamond("b_", clock);
+
+    auto first_plan = first.graph->execution_plan();
+    auto second_plan = second.graph->execution_plan();
+    auto metrics = PlanCache::instance().metrics();
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.hits, 1u);
+    EXPECT_EQ(metrics.entries, 1u);
+    EXPECT_DOUBLE_EQ(metrics.hit_rate(), 0.5);
+    EXPECT_EQ(first.graph->cached_topology(), second.graph->cached_topology());
+
+    // The shared plan is laid out over the second graph's own nodes
+    ASSERT_EQ(second_plan->size(), 4u);
+    EXPECT_EQ(second_plan->level_count(), 3u);
+    auto sink = second_plan->index.at(second.nodes[3].get());
+    EXPECT_EQ(second_plan->nodes[sink], second.nodes[3]);
+    EXPECT_EQ(second_plan->predecessors_of(sink).size(), 2u);
+    EXPECT_EQ(second_plan->index.at(second.nodes[0].get()), 0u);
+
+    auto options = second.graph->execution_options();
+    options.strategy = ExecutionStrategy::Dataflow;
+    second.graph->set_execution_options(options);
+    second.graph->execute().get();
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(std::static_pointer_cast<SequencedNode<double>>(second.nodes[i])->compute_count(), 1u);
+    }
+}
+
+TEST(PlanCacheTest, DistinguishesNodeKindsAndEdges) {
+    PlanCache::instance().clear();
+    std::atomic<size_t> clock{0};
+    auto diamond = build_diamond("a_", clock);
+    auto other_kind = build_diamond("b_", clock, true);
+    auto extra_edge = build_diamond("c_", clock);
+    extra_edge.graph->add_edge(std::make_shared<Edge<double>>(extra_edge.nodes[0], extra_edge.nodes[3]));
+
+    diamond.graph->execution_plan();
+    other_kind.graph->execution_plan();
+    extra_edge.graph->execution_plan();
+    EXPECT_EQ(PlanCache::instance().metrics().misses, 3u);
+    EXPECT_NE(diamond.graph->cached_topology(), other_kind.graph->cached_topology());
+
+    // Changing the topology moves the graph to another entry
+    auto before = extra_edge.graph->cached_topology();
+    extra_edge.graph->remove_node(extra_edge.nodes[3]);
+    EXPECT_NE(before, extra_edge.graph->cached_topology());
+}
+
+// Edges are not checked one by one under the plan cache; the cycle is
+// reported once the plan is built
+TEST(PlanCacheTest, CyclesAreReportedWhenPlanning) {
+    PlanCache::instance().clear();
+    std::atomic<size_t> clock{0};
+    auto diamond = build_diamond("a_", clock);
+    EXPECT_NO_THROW(diamond.graph->add_edge(
+        std::make_shared<Edge<double>>(diamond.nodes[3], diamond.nodes[0])));
+    EXPECT_THROW(diamond.graph->execution_plan(), std::runtime_error);
+    EXPECT_THROW(diamond.graph->execute().get(), std::runtime_error);
+    EXPECT_EQ(PlanCache::instance().metrics().entries, 0u);
+}
+
+// Graphs built alike share entries; node removal and edges added before
+// their endpoints still resolve to the graph's actual topology
+TEST(PlanCacheTest, FollowsTopologyChanges) {
+    PlanCache::instance().clear();
+    std::atomic<size_t> clock{0};
+    auto first = build_diamond("a_", clock);
+    auto second = build_diamond("b_", clock);
+    first.graph->remove_node(first.nodes[2]);
+    second.graph->remove_node(second.nodes[2]);
+    auto plan = second.graph->execution_plan();
+    first.graph->execution_plan();
+    EXPECT_EQ(PlanCache::instance().metrics().hits, 1u);
+    EXPECT_EQ(first.graph->cached_topology(), second.graph->cached_topology());
+    ASSERT_EQ(plan->size(), 3u);
+    EXPECT_EQ(plan->predecessors_of(plan->index.at(second.nodes[3].get())).size(), 1u);
+
+    // An edge to a node not yet in the graph counts once the node is added
+    auto extra = std::make_shared<SequencedNode<double>>("b_extra", clock);
+    second.graph->add_edge(std::make_shared<Edge<double>>(second.nodes[3], extra));
+    EXPECT_EQ(second.graph->execution_plan()->size(), 3u);
+    second.graph->add_node(extra);
+    plan = second.graph->execution_plan();
+    ASSERT_EQ(plan->size(), 4u);
+    EXPECT_EQ(plan->predecessors_of(plan->index.at(extra.get())).size(), 1u);
+    EXPECT_EQ(plan->level_count(), 4u);
+}
+
+// Rebuilt forms follow node positions, not the order the graph's edge
+// set happens to iterate in
+TEST(PlanCacheTest, IdenticalGraphsShareAPlanAfterRemovingANode) {
+    PlanCache::instance().clear();
+    std::atomic<size_t> clock{0};
+    auto build_fan = [&](const std::string& prefix) {
+        Diamond fan;
+        fan.graph = std::make_unique<Graph<double>>();
+        ExecutionOptions options;
+        options.use_plan_cache = true;
+        fan.graph->set_execution_options(options);
+        for (size_t i = 0; i < 34; ++i) {
+            fan.nodes.push_back(std::make_shared<SequencedNode<double>>(prefix + std::to_string(i), clock));
+            fan.graph->add_node(fan.nodes.back());
+        }
+        for (size_t i = 1; i < 33; ++i) {
+            fan.graph->add_edge(std::make_shared<Edge<double>>(fan.nodes[0], fan.nodes[i]));
+            fan.graph->add_edge(std::make_shared<Edge<double>>(fan.nodes[i], fan.nodes[33]));
+        }
+        return fan;
+    };
+    auto first = build_fan("a_");
+    auto second = build_fan("b_");
+    first.graph->remove_node(first.nodes[1]);
+    second.graph->remove_node(second.nodes[1]);
+
+    first.graph->execution_plan();
+    second.graph->execution_plan();
+    auto metrics = PlanCache::instance().metrics();
+    EXPECT_EQ(metrics.misses, 1u);
+    EXPECT_EQ(metrics.hits, 1u);
+    EXPECT_EQ(metrics.entries, 1u);
+    EXPECT_EQ(first.graph->cached_topology(), second.graph->cached_topology());
+}
+
+TEST(PlanCacheTest, EvictsLeastRecentlyUsedTopologies) {
+    PlanCache::instance().clear();
+    PlanCache::instance().set_capacity(2);
+    std::atomic<size_t> clock{0};
+    // A fresh graph per lookup, of a distinct topology per g
+    auto lookup = [&](size_t g) {
+        auto diamond = build_diamond("g" + std::to_string(g) + "_", clock);
+        for (size_t i = 0; i < g; ++i) {
+            diamond.graph->add_node(std::make_shared<SequencedNode<double>>("extra" + std::to_string(i), clock));
+        }
+        diamond.graph->execution_plan();
+    };
+    lookup(0);
+    lookup(1);
+    lookup(0);
+    lookup(2);  // evicts 1
+    lookup(0);
+    lookup(1);
+    auto metrics = PlanCache::instance().metrics();
+    PlanCache::instance().set_capacity(1024);
+    EXPECT_EQ(metrics.hits, 2u);
+    EXPECT_EQ(metrics.misses, 4u);
+    EXPECT_EQ(metrics.evictions, 2u);
+    EXPECT_EQ(metrics.entries, 2u);
+}
+
+} // namespace test
+} // namespace flowgraph
@@ -0,0 +1,263 @@
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/flowgraph/io/file_nodes.hpp"
+#include "../include/flowgraph/io/columnar_sink.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// How chunk source nodes read their input
+enum class ReadMode {
+    Blocking,   // pread inside compute_impl, as nodes did before the reactors
+    Threads,
+    Uring
+};
+
+// Input size; set FLOWGRAPH_IO_BENCH_BYTES=10737418240 for the full 10 GiB
+// run. Drop the page cache first to measure the disk rather than memory.
+inline uint64_t io_bench_bytes() {
+    if (const char* bytes = std::getenv("FLOWGRAPH_IO_BENCH_BYTES")) {
+        return std::strtoull(bytes, nullptr, 10);
+    }
+    return uint64_t{256} << 20;
+}
+
+// Create (once) the input file the benchmarks read
+inline std::string io_bench_input(uint64_t bytes) {
+    auto path = std::filesystem::temp_directory_path() / ("flowgraph_io_bench_" + std::to_string(bytes) + ".bin");
+    if (!std::filesystem::exists(path) || std::filesystem::file_size(path) != bytes) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> block(1 << 20);
+        for (size_t i = 0; i < block.size(); ++i) {
+            block[i] = static_cast<char>(i * 131 + 7);
+        }
+        for (uint64_t written = 0; written < bytes; written += block.size()) {
+            out.write(block.data(), static_cast<std::streamsize>(std::min<uint64_t>(block.size(), bytes - written)));
+        }
+    }
+    return path.string();
+}
+
+// Source node that reads its chunk with a blocking pread on the worker
+class BlockingReadNode : public Node<double> {
+public:
+    BlockingReadNode(std::string name, std::string path, uint64_t offset, size_t length)
+        : Node<double>(std::move(name))
+        , path_(std::move(path))
+        , offset_(offset)
+        , data_(length) {}
+
+    const std::vector<std::byte>& data() const { return data_; }
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        FileHandle file(path_, O_RDONLY);
+        size_t done = 0;
+        while (done < data_.size()) {
+            ssize_t n = ::pread(file.fd(), data_.data() + done, data_.size() - done,
+                                static_cast<off_t>(offset_ + done));
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        co_return ComputeResult<double>(static_cast<double>(done));
+    }
+
+private:
+    std::string path_;
+    uint64_t offset_;
+    std::vector<std::byte> data_;
+};
+
+// Compute node folding its source's chunk a few times over
+class ChecksumNode : public Node<double> {
+public:
+    ChecksumNode(std::string name, std::function<std::span<const std::byte>()> input)
+        : Node<double>(std::move(name))
+        , input_(std::move(input)) {}
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        auto bytes = input_();
+        uint64_t hash = 1469598103934665603ull;
+        for (int pass = 0; pass < 4; ++pass) {
+            for (std::byte b : bytes) {
+                hash = (hash ^ static_cast<uint64_t>(b)) * 1099511628211ull;
+            }
+        }
+        co_return ComputeResult<double>(static_cast<double>(hash & 0xffff));
+    }
+
+private:
+    std::function<std::span<const std::byte>()> input_;
+};
+
+// How per-run results leave the process
+enum class ExportMode {
+    PerNode,    // compute().get() on each node and format it, as the Python wrapper does
+    Columnar    // one ColumnarSink row per run
+};
+
+// Node producing a value derived from the run counter
+class CounterNode : public Node<double> {
+public:
+    CounterNode(std::string name, const uint64_t& run) : Node<double>(std::move(name)), run_(run) {}
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        co_return ComputeResult<double>(static_cast<double>(run_) * 0.5);
+    }
+
+private:
+    const uint64_t& run_;
+};
+
+} // namespace test
+} // namespace flowgraph
+
+// Read the input in 8 MiB chunks, one source node per chunk, each feeding a
+// checksum node, on an elastic pool. Reactor-backed sources suspend and
+// report their wait as blocking, so other workers keep checksumming;
+// blocking preads hold their worker for the whole read.
+template<flowgraph::test::ReadMode Mode>
+static void BM_ChunkedReadWithCompute(::benchmark::State& state) {
+    using namespace flowgraph;
+    using test::ReadMode;
+
+    const uint64_t bytes = test::io_bench_bytes();
+    const size_t chunk = size_t{8} << 20;
+    const auto path = test::io_bench_input(bytes);
+
+    std::shared_ptr<IoReactor> reactor;
+    if (Mode != ReadMode::Blocking) {
+#ifdef __linux__
+        if (Mode == ReadMode::Uring && !UringIoReactor::available()) {
+            state.SkipWithError("io_uring is not available");
+            return;
+        }
+#endif
+        reactor = make_io_reactor(Mode == ReadMode::Uring ? IoBackend::Uring : IoBackend::Threads);
+    }
+
+    ThreadPoolOptions pool_options;
+    pool_options.num_threads = std::max(2u, std::thread::hardware_concurrency());
+    pool_options.elastic = true;
+    auto pool = std::make_shared<ThreadPool>(pool_options);
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Graph<double> graph(nullptr, pool);
+        graph.set_execution_options(options);
+        for (uint64_t offset = 0; offset < bytes; offset += chunk) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(chunk, bytes - offset));
+            auto name = std::to_string(offset / chunk);
+            std::shared_ptr<Node<double>> source;
+            std::function<std::span<const std::byte>()> input;
+            if constexpr (Mode == ReadMode::Blocking) {
+                auto node = std::make_shared<test::BlockingReadNode>("read" + name, path, offset, length);
+                input = [node] { return std::span<const std::byte>(node->data()); };
+                source = node;
+            } else {
+                auto node = std::make_shared<FileSourceNode<double>>("read" + name, reactor, path, offset, length);
+                input = [node] { return std::span<const std::byte>(node->data()); };
+                source = node;
+            }
+            auto checksum = std::make_shared<test::ChecksumNode>("sum" + name, std::move(input));
+            graph.add_node(source);
+            graph.add_node(checksum);
+            graph.add_edge(std::make_shared<Edge<double>>(source, checksum));
+        }
+        graph.execution_plan();
+        state.ResumeTiming();
+
+        graph.execute().get();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+
+BENCHMARK_TEMPLATE(BM_ChunkedReadWithCompute, flowgraph::test::ReadMode::Blocking)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_ChunkedReadWithCompute, flowgraph::test::ReadMode::Threads)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_ChunkedReadWithCompute, flowgraph::test::ReadMode::Uring)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+// Execute a graph of 256 independent nodes and export every node's result
+// each run
+template<flowgraph::test::ExportMode Mode>
+static void BM_ExportResults(::benchmark::State& state) {
+    using namespace flowgraph;
+
+    const auto path = (std::filesystem::temp_directory_path() / "flowgraph_export_bench.bin").string();
+    uint64_t run = 0;
+    Graph<double> graph;
+    std::vector<std::shared_ptr<Node<double>>> nodes;
+    for (int i = 0; i < 256; ++i) {
+        nodes.push_back(std::make_shared<test::CounterNode>("node" + std::to_string(i), run));
+        graph.add_node(nodes.back());
+    }
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    graph.set_execution_options(options);
+
+    std::unique_ptr<ColumnarSink<double>> sink;
+    std::ofstream text;
+    if constexpr (Mode == test::ExportMode::Columnar) {
+        sink = std::make_unique<ColumnarSink<double>>(path, nodes);
+    } else {
+        text.open(path, std::ios::trunc);
+    }
+
+    for (auto _ : state) {
+        graph.execute().get();
+        if constexpr (Mode == test::ExportMode::Columnar) {
+            sink->record(graph, run);
+        } else {
+            std::ostringstream line;
+            line << run;
+            for (const auto& node : nodes) {
+                auto result = node->compute().get();
+                line << ',' << (result.has_error() ? 0.0 : result.value());
+            }
+            text << line.str() << '\n';
+        }
+        ++run;
+    }
+    if (sink) {
+        sink->close();
+    }
+    text.close();
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * nodes.size()));
+}
+
+BENCHMARK_TEMPLATE(BM_ExportResults, flowgraph::test::ExportMode::PerNode)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_ExportResults, flowgraph::test::ExportMode::Columnar)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
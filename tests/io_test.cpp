@@ -0,0 +1,359 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "../include/flowgraph/io/file_nodes.hpp"
+#include "../include/flowgraph/io/mapped_file.hpp"
+#include "../include/flowgraph/io/columnar_sink.hpp"
+#include "../include/flowgraph/core/edge.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/execution_options.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// Every test runs against both reactors; io_uring is skipped where the
+// kernel (or a sandbox) refuses to create rings
+class FileIoTest : public ::testing::TestWithParam<IoBackend> {
+protected:
+    void SetUp() override {
+#ifdef __linux__
+        if (GetParam() == IoBackend::Uring && !UringIoReactor::available()) {
+            GTEST_SKIP() << "io_uring is not available";
+        }
+#else
+        if (GetParam() == IoBackend::Uring) {
+            GTEST_SKIP() << "io_uring is Linux only";
+        }
+#endif
+        reactor_ = make_io_reactor(GetParam());
+        dir_ = std::filesystem::temp_directory_path() /
+               ("flowgraph_io_" + std::string(reactor_->backend_name()));
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        reactor_.reset();
+        std::filesystem::remove_all(dir_);
+    }
+
+    // Deterministic contents with a size that is not a multiple of any chunk
+    std::vector<std::byte> write_input(const std::string& name, size_t size) {
+        std::vector<std::byte> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<std::byte>((i * 131 + 7) & 0xff);
+        }
+        std::ofstream(dir_ / name, std::ios::binary)
+            .write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(size));
+        return bytes;
+    }
+
+    std::string path(const std::string& name) const { return (dir_ / name).string(); }
+
+    std::shared_ptr<IoReactor> reactor_;
+    std::filesystem::path dir_;
+};
+
+TEST_P(FileIoTest, SourceReadsWholeFileInChunks) {
+    auto expected = write_input("input.bin", 300 * 1024 + 123);
+    FileSourceNode<double> source("source", reactor_, path("input.bin"), 0, std::nullopt,
+                                  FileTransferOptions{4096, 16});
+
+    auto result = source.compute().get();
+    ASSERT_FALSE(result.has_error());
+    EXPECT_EQ(result.value(), static_cast<double>(expected.size()));
+    EXPECT_EQ(source.data(), expected);
+}
+
+TEST_P(FileIoTest, SourceReadsRangeAndStopsAtEndOfFile) {
+    auto expected = write_input("input.bin", 10000);
+    FileSourceNode<double> range("range", reactor_, path("input.bin"), 1000, 500,
+                                 FileTransferOptions{64, 4});
+    ASSERT_FALSE(range.compute().get().has_error());
+    EXPECT_EQ(range.data(), std::vector<std::byte>(expected.begin() + 1000, expected.begin() + 1500));
+
+    // Asking for more than the file holds yields the remainder
+    FileSourceNode<double> tail("tail", reactor_, path("input.bin"), 9000, 5000,
+                                FileTransferOptions{512, 4});
+    auto result = tail.compute().get();
+    ASSERT_FALSE(result.has_error());
+    EXPECT_EQ(result.value(), 1000.0);
+    EXPECT_EQ(tail.data(), std::vector<std::byte>(expected.begin() + 9000, expected.end()));
+}
+
+TEST_P(FileIoTest, MissingFileIsANodeError) {
+    FileSourceNode<double> source("missing", reactor_, path("does_not_exist.bin"));
+    auto result = source.compute().get();
+    ASSERT_TRUE(result.has_error());
+    EXPECT_EQ(result.error().source_node(), "missing");
+}
+
+// More chunks in flight than the ring has entries
+TEST_P(FileIoTest, ManyRequestsInFlight) {
+    std::shared_ptr<IoReactor> reactor = reactor_;
+#ifdef __linux__
+    if (GetParam() == IoBackend::Uring) {
+        reactor = std::make_shared<UringIoReactor>(4);
+    }
+#endif
+    auto expected = write_input("input.bin", 64 * 1024);
+    FileHandle file(path("input.bin"), O_RDONLY);
+    std::vector<std::byte> buffer(expected.size());
+    auto read = transfer_chunked(*reactor, IoOp::Read, file.fd(), buffer.data(), buffer.size(), 0, 256, 64).get();
+    EXPECT_EQ(read, expected.size());
+    EXPECT_EQ(buffer, expected);
+}
+
+// Source -> sink through a pooled executor copies the file
+TEST_P(FileIoTest, GraphCopiesFile) {
+    auto expected = write_input("input.bin", 1 << 20);
+    auto source = std::make_shared<FileSourceNode<double>>("source", reactor_, path("input.bin"));
+    auto sink = std::make_shared<FileSinkNode<double>>(
+        "sink", reactor_, path("output.bin"),
+        [source] { return std::span<const std::byte>(source->data()); },
+        0, FileTransferOptions{64 * 1024, 4});
+
+    Graph<double> graph;
+    graph.add_node(source);
+    graph.add_node(sink);
+    graph.add_edge(std::make_shared<Edge<double>>(source, sink));
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    graph.set_execution_options(options);
+    graph.execute().get();
+
+    EXPECT_FALSE(graph.get_node_error("source").has_value());
+    EXPECT_FALSE(graph.get_node_error("sink").has_value());
+    std::ifstream in(path("output.bin"), std::ios::binary);
+    std::vector<char> written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(written.size(), expected.size());
+    EXPECT_EQ(std::memcmp(written.data(), expected.data(), expected.size()), 0);
+}
+
+// Concurrent computes of one sink share a single write of the file
+TEST_P(FileIoTest, ConcurrentComputesWriteOnce) {
+    auto expected = write_input("input.bin", 256 * 1024);
+    std::atomic<int> writes{0};
+    FileSinkNode<double> sink("sink", reactor_, path("output.bin"),
+        [&] {
+            ++writes;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return std::span<const std::byte>(expected);
+        },
+        0, FileTransferOptions{4096, 4});
+
+    ComputeResult<double> first, second;
+    std::thread a([&] { first = sink.compute(0).get(); });
+    std::thread b([&] { second = sink.compute(0).get(); });
+    a.join();
+    b.join();
+
+    EXPECT_EQ(writes.load(), 1);
+    ASSERT_FALSE(first.has_error());
+    ASSERT_FALSE(second.has_error());
+    EXPECT_EQ(first.value(), second.value());
+    EXPECT_EQ(std::filesystem::file_size(path("output.bin")), expected.size());
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, FileIoTest,
+    ::testing::Values(IoBackend::Uring, IoBackend::Threads),
+    [](const ::testing::TestParamInfo<IoBackend>& info) {
+        return info.param == IoBackend::Uring ? std::string("Uring") : std::string("Threads");
+    });
+
+class MappedSourceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = (std::filesystem::temp_directory_path() / "flowgraph_mapped.bin").string();
+        values_.resize(4096);
+        for (size_t i = 0; i < values_.size(); ++i) {
+            values_[i] = static_cast<float>(i) * 0.5f;
+        }
+        std::ofstream(path_, std::ios::binary)
+            .write(reinterpret_cast<const char*>(values_.data()),
+                   static_cast<std::streamsize>(values_.size() * sizeof(float)));
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path_);
+    }
+
+    std::string path_;
+    std::vector<float> values_;
+};
+
+TEST_F(MappedSourceTest, ExposesRegionWithoutCopying) {
+    MappedSourceNode<float> node("region", path_, 100 * sizeof(float), 50, AccessPattern::Random);
+    auto result = node.compute().get();
+    ASSERT_FALSE(result.has_error());
+    const auto& view = result.value();
+    ASSERT_EQ(view.size(), 50u);
+    EXPECT_EQ(view[0], values_[100]);
+    EXPECT_EQ(view[49], values_[149]);
+    EXPECT_EQ(view.subview(10, 5)[0], values_[110]);
+    EXPECT_EQ(view.file()->size(), values_.size() * sizeof(float));
+}
+
+TEST_F(MappedSourceTest, NodesShareOneMapping) {
+    auto file = MappedFile::open(path_);
+    MappedSourceNode<float> head("head", file, 0, 2048);
+    MappedSourceNode<float> rest("rest", file, 2048 * sizeof(float));
+    auto a = head.compute().get().value();
+    auto b = rest.compute().get().value();
+    EXPECT_EQ(a.file(), b.file());
+    EXPECT_EQ(a.data() + a.size(), b.data());
+    EXPECT_EQ(b.size(), 2048u);
+    EXPECT_EQ(b[2047], values_.back());
+}
+
+TEST_F(MappedSourceTest, RegionPastEndIsANodeError) {
+    MappedSourceNode<float> node("overrun", path_, 4000 * sizeof(float), 200);
+    auto result = node.compute().get();
+    ASSERT_TRUE(result.has_error());
+    EXPECT_EQ(result.error().source_node(), "overrun");
+
+    MappedSourceNode<float> misaligned("misaligned", path_, 2, 1);
+    EXPECT_TRUE(misaligned.compute().get().has_error());
+}
+
+// Views outlive the node and the graph that produced them
+TEST_F(MappedSourceTest, ViewsAsGraphValues) {
+    MappedView<float> kept;
+    {
+        Graph<MappedView<float>> graph;
+        auto file = MappedFile::open(path_);
+        auto left = std::make_shared<MappedSourceNode<float>>("left", file, 0, 16);
+        auto right = std::make_shared<MappedSourceNode<float>>("right", file, 16 * sizeof(float), 16);
+        graph.add_node(left);
+        graph.add_node(right);
+        ExecutionOptions options;
+        options.strategy = ExecutionStrategy::Dataflow;
+        graph.set_execution_options(options);
+        graph.execute().get();
+        EXPECT_FALSE(graph.get_node_error("left").has_value());
+        kept = right->compute().get().value();
+    }
+    ASSERT_EQ(kept.size(), 16u);
+    EXPECT_EQ(kept[0], values_[16]);
+}
+
+class ColumnarFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = (std::filesystem::temp_directory_path() / "flowgraph_columnar.bin").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path_);
+    }
+
+    std::string path_;
+};
+
+TEST_F(ColumnarFileTest, WriterRoundTripsChunks) {
+    {
+        ColumnarWriter writer(path_, {{"id", ColumnType::Int64, 8}, {"value", ColumnType::Float32, 4}}, 100);
+        for (int64_t row = 0; row < 1050; ++row) {
+            float value = static_cast<float>(row) * 0.25f;
+            std::memcpy(writer.slot(0), &row, sizeof(row));
+            std::memcpy(writer.slot(1), &value, sizeof(value));
+            writer.commit_row();
+        }
+        EXPECT_EQ(writer.row_count(), 1050u);
+        writer.close();
+    }
+
+    ColumnarReader reader(path_);
+    ASSERT_EQ(reader.columns().size(), 2u);
+    EXPECT_EQ(reader.columns()[1].name, "value");
+    EXPECT_EQ(reader.row_count(), 1050u);
+    ASSERT_EQ(reader.chunk_count(), 11u);
+    EXPECT_EQ(reader.chunk_rows(10), 50u);
+
+    int64_t expected = 0;
+    for (size_t chunk = 0; chunk < reader.chunk_count(); ++chunk) {
+        auto ids = reader.column<int64_t>(chunk, "id");
+        auto values = reader.column<float>(chunk, 1);
+        ASSERT_EQ(ids.size(), values.size());
+        for (size_t i = 0; i < ids.size(); ++i, ++expected) {
+            ASSERT_EQ(ids[i], expected);
+            ASSERT_EQ(values[i], static_cast<float>(expected) * 0.25f);
+        }
+    }
+    EXPECT_THROW(reader.column<double>(0, "value"), std::invalid_argument);
+    EXPECT_THROW(reader.column_index("missing"), std::out_of_range);
+}
+
+TEST_F(ColumnarFileTest, ReaderRejectsIncompleteFile) {
+    std::ofstream(path_, std::ios::binary) << "FGCOLUM1 but nothing else";
+    EXPECT_THROW(ColumnarReader reader(path_), std::runtime_error);
+}
+
+// Node whose value (or failure) each run is set by the test
+class RunValueNode : public Node<double> {
+public:
+    explicit RunValueNode(std::string name) : Node<double>(std::move(name)) {}
+
+    double next = 0.0;
+    bool fail = false;
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t) override {
+        if (fail) {
+            throw std::runtime_error("run failed");
+        }
+        co_return ComputeResult<double>(next);
+    }
+};
+
+TEST_F(ColumnarFileTest, SinkRecordsNodeValuesPerRun) {
+    auto stable = std::make_shared<RunValueNode>("stable");
+    auto flaky = std::make_shared<RunValueNode>("flaky");
+    Graph<double> graph;
+    graph.add_node(stable);
+    graph.add_node(flaky);
+    ExecutionOptions options;
+    options.strategy = ExecutionStrategy::Dataflow;
+    graph.set_execution_options(options);
+
+    {
+        ColumnarSink<double> sink(path_, {stable, flaky}, 2);
+        for (uint64_t run = 0; run < 5; ++run) {
+            stable->next = static_cast<double>(run) * 10.0;
+            flaky->next = static_cast<double>(run);
+            flaky->fail = run == 3;
+            graph.execute().get();
+            sink.record(graph, run);
+        }
+        sink.close();
+    }
+
+    ColumnarReader reader(path_);
+    ASSERT_EQ(reader.row_count(), 5u);
+    std::vector<uint64_t> runs;
+    std::vector<double> stable_values;
+    std::vector<uint8_t> flaky_valid;
+    for (size_t chunk = 0; chunk < reader.chunk_count(); ++chunk) {
+        for (uint64_t run : reader.column<uint64_t>(chunk, "run")) runs.push_back(run);
+        for (double value : reader.column<double>(chunk, "stable")) stable_values.push_back(value);
+        for (uint8_t valid : reader.column<uint8_t>(chunk, "flaky.valid")) flaky_valid.push_back(valid);
+    }
+    EXPECT_EQ(runs, (std::vector<uint64_t>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(stable_values, (std::vector<double>{0.0, 10.0, 20.0, 30.0, 40.0}));
+    EXPECT_EQ(flaky_valid, (std::vector<uint8_t>{1, 1, 1, 0, 1}));
+    EXPECT_EQ(reader.column<double>(2, "flaky")[0], 4.0);
+}
+
+} // namespace test
+} // namespace flowgraph
@@ -0,0 +1,453 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include "../include/flowgraph/cache/approximate_memo.hpp"
+#include "../include/flowgraph/cache/content_hash.hpp"
+#include "../include/flowgraph/cache/spill_store.hpp"
+#include "../include/flowgraph/cache/value_compression.hpp"
+#include "../include/flowgraph/core/fractal_tree_node.hpp"
+#include "../include/flowgraph/core/precision_storage.hpp"
+
+namespace flowgraph {
+namespace test {
+
+std::vector<double> signal_values(size_t count) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = std::sin(static_cast<double>(i) * 0.001) + noise(rng);
+    }
+    return values;
+}
+
+// A vector value refined over levels 0..8, each level's error a quarter
+// of the one below
+std::vector<std::vector<double>> refined_signal(size_t count) {
+    auto base = signal_values(count);
+    std::vector<std::vector<double>> levels;
+    for (size_t level = 0; level <= 8; ++level) {
+        std::vector<double> values(count);
+        for (size_t i = 0; i < count; ++i) {
+            double exact = std::sin(static_cast<double>(i) * 0.001);
+            values[i] = exact + (base[i] - exact) / std::pow(4.0, static_cast<double>(level));
+        }
+        levels.push_back(std::move(values));
+    }
+    return levels;
+}
+
+void store_refined(FractalTreeNode<std::vector<double>>& tree, const std::vector<std::vector<double>>& levels,
+                   LevelEncoding encoding) {
+    tree.set_level_encoding(encoding);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        tree.store(levels[level], level);
+    }
+    tree.merge_all();
+}
+
+// Cold values: a smooth series (a ramp sampled at a high rate), the
+// noisy signal above, and log-like text
+std::vector<double> cold_values(bool smooth, size_t count) {
+    if (!smooth) {
+        return signal_values(count);
+    }
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = std::round(std::sin(static_cast<double>(i) * 0.001) * 1024.0) / 1024.0;
+    }
+    return values;
+}
+
+std::string cold_text(size_t bytes) {
+    std::mt19937 rng(7);
+    std::string text;
+    while (text.size() < bytes) {
+        text += "node_" + std::to_string(rng() % 64) + " level=" + std::to_string(rng() % 9) +
+                " status=ok elapsed_us=" + std::to_string(rng() % 5000) + "\n";
+    }
+    text.resize(bytes);
+    return text;
+}
+
+} // namespace test
+} // namespace flowgraph
+
+// Packing a buffer of doubles into one format
+template<flowgraph::StorageFormat Format>
+static void BM_PackValues(::benchmark::State& state) {
+    auto values = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        flowgraph::PackedValues packed(std::span<const double>(values), Format);
+        bytes = packed.bytes();
+        benchmark::DoNotOptimize(packed);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(double)));
+    state.counters["bytes_per_value"] = static_cast<double>(bytes) / static_cast<double>(values.size());
+}
+
+template<flowgraph::StorageFormat Format>
+static void BM_UnpackValues(::benchmark::State& state) {
+    auto values = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)));
+    flowgraph::PackedValues packed(std::span<const double>(values), Format);
+    std::vector<double> out(values.size());
+    for (auto _ : state) {
+        packed.unpack(std::span(out));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(double)));
+}
+
+// float -> fp16 -> float with the dispatched kernels against the scalar
+// reference
+template<bool Vectorized>
+static void BM_HalfRoundTrip(::benchmark::State& state) {
+    auto doubles = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)));
+    std::vector<float> values(doubles.begin(), doubles.end());
+    std::vector<uint16_t> half(values.size());
+    std::vector<float> out(values.size());
+    for (auto _ : state) {
+        if constexpr (Vectorized) {
+            flowgraph::packing::to_half(values.data(), half.data(), values.size());
+            flowgraph::packing::from_half(half.data(), out.data(), values.size());
+        } else {
+            flowgraph::packing::scalar::to_half(values.data(), half.data(), values.size());
+            flowgraph::packing::scalar::from_half(half.data(), out.data(), values.size());
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(float)));
+}
+
+// One vector value cached at every level of a tree with the tiered
+// formats; reports the bytes held per level and times reading them all
+static void BM_TieredTreeMemory(::benchmark::State& state) {
+    auto values = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)));
+    flowgraph::FractalTreeNode<std::vector<double>> tree(8);
+    tree.set_storage_formats(flowgraph::tiered_storage_formats(8));
+    for (size_t level = 0; level <= 8; ++level) {
+        tree.store(values, level);
+    }
+    tree.merge_all();
+    for (auto _ : state) {
+        for (size_t level = 0; level <= 8; ++level) {
+            benchmark::DoNotOptimize(tree.get(level));
+        }
+    }
+    const double full = static_cast<double>(9 * values.size() * sizeof(double));
+    state.counters["bytes_per_level"] = static_cast<double>(tree.memory_bytes()) / 9;
+    state.counters["fraction_of_fp64"] = static_cast<double>(tree.memory_bytes()) / full;
+}
+
+// Reading the top level of a vector value held at every level, which
+// with Delta applies eight residuals; reports the bytes held per node
+template<flowgraph::LevelEncoding Encoding>
+static void BM_LevelEncodingGet(::benchmark::State& state) {
+    auto levels = flowgraph::test::refined_signal(static_cast<size_t>(state.range(0)));
+    flowgraph::FractalTreeNode<std::vector<double>> tree(8, 1e-3);
+    flowgraph::test::store_refined(tree, levels, Encoding);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tree.get(8));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * levels[8].size()));
+    state.counters["bytes_per_node"] = static_cast<double>(tree.memory_bytes());
+}
+
+// Replacing one middle level and merging it in, which with Delta
+// re-encodes the levels around it
+template<flowgraph::LevelEncoding Encoding>
+static void BM_LevelEncodingStore(::benchmark::State& state) {
+    auto levels = flowgraph::test::refined_signal(static_cast<size_t>(state.range(0)));
+    flowgraph::FractalTreeNode<std::vector<double>> tree(8, 1e-3);
+    flowgraph::test::store_refined(tree, levels, Encoding);
+    std::vector<std::vector<double>> updates = {levels[4], levels[4]};
+    for (double& v : updates[1]) {
+        v += 0.01;
+    }
+    size_t round = 0;
+    for (auto _ : state) {
+        tree.store(updates[round++ % 2], 4);
+        tree.merge_all();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * levels[4].size()));
+    state.counters["bytes_per_node"] = static_cast<double>(tree.memory_bytes());
+}
+
+// Compressing and decompressing one cold vector value with the float
+// codec; reports the compression ratio
+template<bool Smooth>
+static void BM_CompressColdValue(::benchmark::State& state) {
+    auto values = flowgraph::test::cold_values(Smooth, static_cast<size_t>(state.range(0)));
+    double ratio = 0.0;
+    for (auto _ : state) {
+        auto compressed = flowgraph::CompressedValue<std::vector<double>>::compress(values);
+        ratio = compressed ? static_cast<double>(compressed->original_bytes()) / compressed->bytes() : 1.0;
+        benchmark::DoNotOptimize(compressed);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(double)));
+    state.counters["ratio"] = ratio;
+}
+
+template<bool Smooth>
+static void BM_DecompressColdValue(::benchmark::State& state) {
+    auto values = flowgraph::test::cold_values(Smooth, static_cast<size_t>(state.range(0)));
+    auto compressed = flowgraph::CompressedValue<std::vector<double>>::compress(values, 0);
+    if (!compressed) {
+        state.SkipWithError("Value does not compress");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compressed->decompress());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * values.size() * sizeof(double)));
+    state.counters["ratio"] = static_cast<double>(compressed->original_bytes()) / compressed->bytes();
+}
+
+// The LZ codec alone on text
+static void BM_LzCompressText(::benchmark::State& state) {
+    auto text = flowgraph::test::cold_text(static_cast<size_t>(state.range(0)));
+    auto bytes = std::as_bytes(std::span(text));
+    size_t compressed_bytes = 0;
+    for (auto _ : state) {
+        auto compressed = flowgraph::compression::lz_compress(bytes);
+        compressed_bytes = compressed.size();
+        benchmark::DoNotOptimize(compressed);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+    state.counters["ratio"] = static_cast<double>(text.size()) / static_cast<double>(compressed_bytes);
+}
+
+static void BM_LzDecompressText(::benchmark::State& state) {
+    auto text = flowgraph::test::cold_text(static_cast<size_t>(state.range(0)));
+    auto compressed = flowgraph::compression::lz_compress(std::as_bytes(std::span(text)));
+    std::vector<std::byte> out(text.size());
+    for (auto _ : state) {
+        flowgraph::compression::lz_decompress(compressed, out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// Reading a level of a tree that has gone cold: each iteration compresses
+// it (outside the timing) and reads it back, which is the latency a
+// computation sees on its first read after the level went cold
+static void BM_ColdLevelRead(::benchmark::State& state) {
+    auto values = flowgraph::test::cold_values(true, static_cast<size_t>(state.range(0)));
+    flowgraph::FractalTreeNode<std::vector<double>> tree(8);
+    auto stats = std::make_shared<flowgraph::CompressionStats>();
+    tree.set_cold_compression({1, 256, stats});
+    tree.store(values, 0);
+    tree.merge_all();
+    for (auto _ : state) {
+        state.PauseTiming();
+        tree.end_run();
+        tree.end_run();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(tree.get(0));
+    }
+    auto metrics = stats->snapshot();
+    state.counters["ratio"] = metrics.ratio();
+    state.counters["mean_decompress_us"] =
+        static_cast<double>(metrics.mean_decompression_time().count()) / 1000.0;
+}
+
+// 64 trees holding 512 KB each (32 MB) against a 16 MB budget. Each run
+// reads 16 trees picked with a skew towards low indices, then ends the run
+// and, with spilling, enforces the budget. Reports resident and spilled
+// bytes, reloads per run and their mean latency.
+template<bool Spill>
+static void BM_SpillBudget(::benchmark::State& state) {
+    constexpr size_t trees_count = 64;
+    auto values = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)));
+    const size_t dataset = trees_count * values.size() * sizeof(double);
+    flowgraph::SpillOptions options;
+    options.memory_budget = dataset / 2;
+    auto store = std::make_shared<flowgraph::SpillStore>(options);
+    std::vector<std::unique_ptr<flowgraph::FractalTreeNode<std::vector<double>>>> trees;
+    for (size_t i = 0; i < trees_count; ++i) {
+        trees.push_back(std::make_unique<flowgraph::FractalTreeNode<std::vector<double>>>(8));
+        if constexpr (Spill) {
+            trees.back()->set_spill_store(store);
+        }
+        trees.back()->store(values, 0);
+        trees.back()->merge_all();
+    }
+
+    std::mt19937 rng(11);
+    std::geometric_distribution<size_t> pick(0.08);
+    for (auto _ : state) {
+        for (int read = 0; read < 16; ++read) {
+            benchmark::DoNotOptimize(trees[pick(rng) % trees_count]->get(0));
+        }
+        for (auto& tree : trees) {
+            tree->end_run();
+        }
+        if constexpr (Spill) {
+            flowgraph::enforce_spill_budget(trees, *store);
+        }
+    }
+
+    size_t resident = 0;
+    for (const auto& tree : trees) {
+        resident += tree->memory_bytes();
+    }
+    auto metrics = store->metrics();
+    state.counters["dataset_MB"] = static_cast<double>(dataset) / (1 << 20);
+    state.counters["resident_MB"] = static_cast<double>(resident) / (1 << 20);
+    state.counters["on_disk_MB"] = static_cast<double>(metrics.bytes_on_disk) / (1 << 20);
+    state.counters["reloads_per_run"] =
+        static_cast<double>(metrics.levels_reloaded) / static_cast<double>(state.iterations());
+    state.counters["mean_reload_us"] = static_cast<double>(metrics.mean_reload_time().count()) / 1000.0;
+}
+
+// 4096 noisy readings of 16 underlying signals of range(0) samples
+// (Gaussian noise, sigma 1e-3) through a memo of tolerance range(1) * 1e-4
+// in front of a smoothing filter (up to 16 taps) and RMS. Reports the hit
+// rate, candidates compared per lookup and the error of outputs against
+// computing each reading.
+static void BM_ApproximateMemoNoisySignal(::benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    const double tolerance = static_cast<double>(state.range(1)) * 1e-4;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> phase(0.0, 6.28);
+    std::normal_distribution<double> noise(0.0, 1e-3);
+    std::vector<std::vector<double>> signals(16, std::vector<double>(size));
+    for (auto& signal : signals) {
+        double offset = phase(rng);
+        for (size_t i = 0; i < size; ++i) {
+            signal[i] = std::sin(offset + static_cast<double>(i) * 0.05);
+        }
+    }
+    const size_t taps = std::min<size_t>(16, size);
+    auto filtered_rms = [taps](const std::vector<double>& x) {
+        double sum = 0.0;
+        for (size_t i = 0; i + taps <= x.size(); ++i) {
+            double y = 0.0;
+            for (size_t k = 0; k < taps; ++k) {
+                y += x[i + k] / static_cast<double>(taps);
+            }
+            sum += y * y;
+        }
+        return std::sqrt(sum / static_cast<double>(x.size()));
+    };
+
+    std::vector<std::vector<double>> readings(4096, std::vector<double>(size));
+    for (auto& reading : readings) {
+        const auto& signal = signals[rng() % signals.size()];
+        for (size_t i = 0; i < size; ++i) {
+            reading[i] = signal[i] + noise(rng);
+        }
+    }
+    auto memoized = [&](flowgraph::ApproximateMemo<double>& memo, const std::vector<double>& reading) {
+        if (auto output = memo.find(reading, 0)) {
+            return *output;
+        }
+        double output = filtered_rms(reading);
+        memo.insert(reading, 0, output);
+        return output;
+    };
+
+    flowgraph::ApproximateMemo<double> memo(tolerance);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(memoized(memo, readings[next++ % readings.size()]));
+    }
+
+    // Accuracy over one pass of the readings, against computing each
+    flowgraph::ApproximateMemo<double> replay(tolerance);
+    double total_error = 0.0;
+    double max_error = 0.0;
+    for (const auto& reading : readings) {
+        double error = std::abs(memoized(replay, reading) - filtered_rms(reading));
+        total_error += error;
+        max_error = std::max(max_error, error);
+    }
+    auto metrics = memo.metrics();
+    state.counters["hit_rate"] = metrics.hit_rate();
+    state.counters["candidates_per_lookup"] =
+        static_cast<double>(metrics.candidates) / static_cast<double>(metrics.lookups);
+    state.counters["mean_abs_error"] = total_error / static_cast<double>(readings.size());
+    state.counters["max_abs_error"] = max_error;
+}
+
+// Hashing a vector of range(0) bytes of doubles: flowgraph::hash_value
+// (Bulk) against combining std::hash<double> per element, as value types
+// did before (see examples/matrix_operations.cpp)
+template<bool Bulk>
+static void BM_HashValue(::benchmark::State& state) {
+    auto values = flowgraph::test::signal_values(static_cast<size_t>(state.range(0)) / sizeof(double));
+    for (auto _ : state) {
+        if constexpr (Bulk) {
+            benchmark::DoNotOptimize(flowgraph::hash_value(values));
+        } else {
+            size_t seed = values.size();
+            for (double v : values) {
+                seed ^= std::hash<double>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            }
+            benchmark::DoNotOptimize(seed);
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+// 64- and 128-bit hashes of range(0) bytes, with the widest kernels this
+// CPU runs (Vectorized) or one lane at a time
+template<bool Vectorized, bool Wide>
+static void BM_HashBytes(::benchmark::State& state) {
+    std::vector<std::byte> bytes(static_cast<size_t>(state.range(0)));
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<std::byte>(i * 131 + 7);
+    }
+    for (auto _ : state) {
+        if constexpr (Wide) {
+            benchmark::DoNotOptimize(Vectorized ? flowgraph::hashing::hash128(bytes)
+                                                : flowgraph::hashing::scalar::hash128(bytes));
+        } else {
+            benchmark::DoNotOptimize(Vectorized ? flowgraph::hashing::hash64(bytes)
+                                                : flowgraph::hashing::scalar::hash64(bytes));
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_PackValues, flowgraph::StorageFormat::Int8)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PackValues, flowgraph::StorageFormat::BFloat16)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PackValues, flowgraph::StorageFormat::Float16)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PackValues, flowgraph::StorageFormat::Float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PackValues, flowgraph::StorageFormat::Float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_UnpackValues, flowgraph::StorageFormat::Int8)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_UnpackValues, flowgraph::StorageFormat::BFloat16)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_UnpackValues, flowgraph::StorageFormat::Float16)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_UnpackValues, flowgraph::StorageFormat::Float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_UnpackValues, flowgraph::StorageFormat::Float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_HalfRoundTrip, false)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_HalfRoundTrip, true)->Arg(1 << 16);
+BENCHMARK(BM_TieredTreeMemory)->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LevelEncodingGet, flowgraph::LevelEncoding::Absolute)->Arg(1 << 14)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LevelEncodingGet, flowgraph::LevelEncoding::Delta)->Arg(1 << 14)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LevelEncodingStore, flowgraph::LevelEncoding::Absolute)->Arg(1 << 14)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LevelEncodingStore, flowgraph::LevelEncoding::Delta)->Arg(1 << 14)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_CompressColdValue, true)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_CompressColdValue, false)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_DecompressColdValue, true)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_DecompressColdValue, false)->Arg(1 << 16);
+BENCHMARK(BM_LzCompressText)->Arg(1 << 20);
+BENCHMARK(BM_LzDecompressText)->Arg(1 << 20);
+BENCHMARK(BM_ColdLevelRead)->Arg(1 << 16)->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SpillBudget, false)->Arg(1 << 16)->Unit(::benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SpillBudget, true)->Arg(1 << 16)->Unit(::benchmark::kMillisecond);
+BENCHMARK(BM_ApproximateMemoNoisySignal)->Args({2, 0})->Args({2, 30})->Args({1024, 0})->Args({1024, 20})->Args({1024, 50})->Args({1024, 100})->Unit(::benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_HashValue, true)->Arg(64)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_HashValue, false)->Arg(64)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_HashBytes, true, false)->Arg(16)->Arg(100)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_HashBytes, false, false)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_HashBytes, true, true)->Arg(1 << 16);
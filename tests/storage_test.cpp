@@ -0,0 +1,913 @@
+#include <gtest/gtest.h>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/flowgraph/core/node.hpp"
+#include "../include/flowgraph/core/graph.hpp"
+#include "../include/flowgraph/core/fractal_tree_node.hpp"
+#include "../include/flowgraph/core/precision_storage.hpp"
+#include "../include/flowgraph/cache/approximate_memo.hpp"
+#include "../include/flowgraph/cache/content_hash.hpp"
+#include "../include/flowgraph/cache/graph_cache.hpp"
+#include "../include/flowgraph/cache/spill_store.hpp"
+#include "../include/flowgraph/cache/value_compression.hpp"
+
+namespace flowgraph {
+namespace test {
+
+std::vector<float> random_floats(size_t count, unsigned seed, float range) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> value(-range, range);
+    std::vector<float> values(count);
+    for (float& v : values) {
+        v = value(rng);
+    }
+    return values;
+}
+
+// Edge values followed by random ones; the count leaves a scalar tail
+// after the vector loops
+std::vector<float> conversion_inputs() {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> values = {0.0f, -0.0f, 1.0f, -1.0f, 65504.0f, 65519.0f, 65520.0f, 1e-8f, 6e-8f,
+                                 3e-5f, -2.5e-6f, 1.00390625f, std::bit_cast<float>(0x3f818000u),
+                                 inf, -inf, std::numeric_limits<float>::quiet_NaN(), 1e30f, -1e-30f};
+    auto random = random_floats(1000, 1, 100.0f);
+    values.insert(values.end(), random.begin(), random.end());
+    auto tiny = random_floats(61, 2, 1e-4f);
+    values.insert(values.end(), tiny.begin(), tiny.end());
+    return values;
+}
+
+TEST(PrecisionStorageTest, VectorKernelsMatchScalarConversions) {
+    auto in = conversion_inputs();
+    const size_t n = in.size();
+
+    std::vector<uint16_t> half(n), half_expected(n);
+    packing::to_half(in.data(), half.data(), n);
+    packing::scalar::to_half(in.data(), half_expected.data(), n);
+    std::vector<uint16_t> bfloat(n), bfloat_expected(n);
+    packing::to_bfloat(in.data(), bfloat.data(), n);
+    packing::scalar::to_bfloat(in.data(), bfloat_expected.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        if (std::isnan(in[i])) {
+            EXPECT_TRUE(std::isnan(packing::scalar::from_half(half[i])));
+            EXPECT_TRUE(std::isnan(packing::scalar::from_bfloat(bfloat[i])));
+        } else {
+            EXPECT_EQ(half[i], half_expected[i]) << in[i];
+            EXPECT_EQ(bfloat[i], bfloat_expected[i]) << in[i];
+        }
+    }
+
+    std::vector<float> back(n), back_expected(n);
+    packing::from_half(half_expected.data(), back.data(), n);
+    packing::scalar::from_half(half_expected.data(), back_expected.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        if (!std::isnan(back_expected[i])) {
+            EXPECT_EQ(std::bit_cast<uint32_t>(back[i]), std::bit_cast<uint32_t>(back_expected[i]));
+        }
+    }
+
+    const float scale = packing::scalar::max_magnitude(in.data(), n) / 127.0f;
+    EXPECT_EQ(packing::max_magnitude(in.data(), n), 1e30f);
+    std::vector<int8_t> q(n), q_expected(n);
+    packing::to_int8(in.data(), q.data(), n, 1.0f / scale);
+    packing::scalar::to_int8(in.data(), q_expected.data(), n, 1.0f / scale);
+    EXPECT_EQ(q, q_expected);
+    EXPECT_EQ(q[15], 0);  // NaN
+    EXPECT_EQ(q[13], 127);
+    EXPECT_EQ(q[14], -127);
+}
+
+TEST(PrecisionStorageTest, HalfAndBfloatRoundToNearestEven) {
+    using packing::scalar::to_bfloat;
+    using packing::scalar::to_half;
+    EXPECT_EQ(to_half(1.0f), 0x3c00);
+    EXPECT_EQ(to_half(-2.0f), 0xc000);
+    EXPECT_EQ(to_half(65504.0f), 0x7bff);
+    EXPECT_EQ(to_half(65519.0f), 0x7bff);
+    EXPECT_EQ(to_half(65520.0f), 0x7c00);
+    EXPECT_EQ(to_half(6e-8f), 0x0001);  // Smallest subnormal
+    EXPECT_EQ(to_half(1e-8f), 0x0000);
+    EXPECT_EQ(packing::scalar::from_half(0x0001), 0x1p-24f);
+
+    EXPECT_EQ(to_bfloat(1.0f), 0x3f80);
+    EXPECT_EQ(to_bfloat(1.00390625f), 0x3f80);  // Tie to even, down
+    EXPECT_EQ(to_bfloat(std::bit_cast<float>(0x3f818000u)), 0x3f82);  // Tie to even, up
+    EXPECT_EQ(packing::scalar::from_bfloat(0xc040), -3.0f);
+}
+
+TEST(PrecisionStorageTest, PackedValuesUseTheFormatsWidth) {
+    std::vector<double> values(1000);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    for (double& v : values) {
+        v = value(rng);
+    }
+    // Largest error relative to the largest magnitude (about 1)
+    const std::pair<StorageFormat, double> formats[] = {
+        {StorageFormat::Int8, 0.5 / 127 + 1e-6}, {StorageFormat::BFloat16, 0x1p-9},
+        {StorageFormat::Float16, 0x1p-11}, {StorageFormat::Float32, 0x1p-24}, {StorageFormat::Float64, 0.0}};
+    for (auto [format, tolerance] : formats) {
+        PackedValues packed(std::span<const double>(values), format);
+        EXPECT_EQ(packed.format(), format);
+        EXPECT_EQ(packed.bytes(), values.size() * element_bytes(format)) << to_string(format);
+        std::vector<double> out(values.size());
+        packed.unpack(std::span(out));
+        for (size_t i = 0; i < values.size(); ++i) {
+            ASSERT_NEAR(out[i], values[i], tolerance) << to_string(format) << " " << i;
+        }
+        std::vector<float> floats(values.size());
+        packed.unpack(std::span(floats));
+        EXPECT_NEAR(floats[7], values[7], std::max(tolerance, 0x1p-24));
+    }
+
+    // Float elements are never widened
+    std::vector<float> floats(100, 1.5f);
+    PackedValues packed(std::span<const float>(floats), StorageFormat::Float64);
+    EXPECT_EQ(packed.format(), StorageFormat::Float32);
+    EXPECT_EQ(packed.bytes(), 400u);
+    std::vector<double> wrong_size(99);
+    EXPECT_THROW(packed.unpack(std::span(wrong_size)), std::invalid_argument);
+}
+
+TEST(PrecisionStorageTest, FractalTreeStoresLevelsInTheirFormats) {
+    std::vector<double> values(4096);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = std::sin(static_cast<double>(i) * 0.01);
+    }
+
+    FractalTreeNode<std::vector<double>> tree(8);
+    EXPECT_EQ(tree.storage_format(0), StorageFormat::Float64);
+    tree.store(values, 0);
+    tree.store(values, 8);
+    tree.merge_all();
+    EXPECT_EQ(tree.get(0).value(), values);
+    EXPECT_EQ(tree.memory_bytes(), 2 * values.size() * sizeof(double));
+
+    tree.set_storage_formats(tiered_storage_formats(8));
+    EXPECT_EQ(tree.storage_format(0), StorageFormat::Int8);
+    EXPECT_EQ(tree.storage_format(2), StorageFormat::Float16);
+    EXPECT_EQ(tree.storage_format(4), StorageFormat::Float32);
+    EXPECT_EQ(tree.storage_format(8), StorageFormat::Float64);
+    EXPECT_EQ(tree.memory_bytes(), values.size() * (1 + sizeof(double)));
+    EXPECT_EQ(tree.get(8).value(), values);
+    auto coarse = tree.get(0).value();
+    ASSERT_EQ(coarse.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_NEAR(coarse[i], values[i], 0.5 / 127 + 1e-6);
+    }
+
+    tree.store(values, 2);
+    tree.merge_all();
+    EXPECT_EQ(tree.memory_bytes(), values.size() * (1 + 2 + sizeof(double)));
+}
+
+TEST(PrecisionStorageTest, NodesCacheValuesInTheLevelsFormat) {
+    class RampNode : public Node<std::vector<float>> {
+    public:
+        RampNode() : Node<std::vector<float>>("ramp") {}
+        size_t computations = 0;
+
+    protected:
+        Task<ComputeResult<std::vector<float>>> compute_impl(size_t) override {
+            ++computations;
+            std::vector<float> ramp(256);
+            for (size_t i = 0; i < ramp.size(); ++i) {
+                ramp[i] = static_cast<float>(i) / 3.0f;
+            }
+            co_return ComputeResult<std::vector<float>>(std::move(ramp));
+        }
+    };
+
+    auto node = std::make_shared<RampNode>();
+    node->set_storage_formats({StorageFormat::BFloat16});
+    auto exact = node->compute(0).get().value();
+    node->merge_updates();
+    auto cached = node->compute(0).get().value();
+    EXPECT_EQ(node->computations, 1u);
+    ASSERT_EQ(cached.size(), exact.size());
+    for (size_t i = 0; i < exact.size(); ++i) {
+        EXPECT_EQ(cached[i], packing::scalar::from_bfloat(packing::scalar::to_bfloat(exact[i])));
+    }
+}
+
+TEST(PrecisionStorageTest, ResidualsUseTheNarrowestWidth) {
+    std::vector<int64_t> reference = {5, -3, 1000000, 0};
+    auto residual_for = [&](int64_t difference) {
+        auto steps = reference;
+        steps[2] += difference;
+        return QuantizedResidual::encode(steps, reference);
+    };
+    EXPECT_EQ(residual_for(0)->bytes(), 0u);
+    EXPECT_EQ(residual_for(-100)->width(), 1u);
+    EXPECT_EQ(residual_for(1000)->width(), 2u);
+    EXPECT_EQ(residual_for(-1000000)->width(), 4u);
+    EXPECT_FALSE(residual_for(int64_t{1} << 40));
+
+    auto steps = reference;
+    steps[0] = -70000;
+    auto residual = QuantizedResidual::encode(steps, reference);
+    auto restored = reference;
+    residual->apply(restored);
+    EXPECT_EQ(restored, steps);
+    EXPECT_FALSE(QuantizedResidual::encode(steps, std::span(reference).first(3)));
+
+    // Step kernels against the scalar ones, with a tail
+    std::vector<double> values(103);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = std::sin(static_cast<double>(i)) * 50.0 + (i == 7 ? 0.0025 : 0.0);
+    }
+    std::vector<int64_t> counts(values.size()), expected(values.size());
+    EXPECT_TRUE(packing::to_steps(values.data(), counts.data(), values.size(), 1e3));
+    EXPECT_TRUE(packing::scalar::to_steps(values.data(), expected.data(), values.size(), 1e3));
+    EXPECT_EQ(counts, expected);
+    std::vector<int16_t> differences(values.size());
+    for (size_t i = 0; i < differences.size(); ++i) {
+        differences[i] = static_cast<int16_t>(static_cast<int>(i * 331) - 20000);
+    }
+    packing::add_steps(counts.data(), differences.data(), counts.size());
+    packing::scalar::add_steps(expected.data(), differences.data(), expected.size());
+    EXPECT_EQ(counts, expected);
+    std::vector<double> back(values.size()), back_expected(values.size());
+    packing::from_steps(counts.data(), back.data(), counts.size(), 1e-3);
+    packing::scalar::from_steps(expected.data(), back_expected.data(), expected.size(), 1e-3);
+    EXPECT_EQ(back, back_expected);
+    values[50] = 1e300;
+    EXPECT_FALSE(packing::to_steps(values.data(), counts.data(), values.size(), 1e3));
+    values[50] = 0.0;
+    values[101] = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_FALSE(packing::to_steps(values.data(), counts.data(), values.size(), 1e3));
+}
+
+// Successive refinements of one signal: each level's error is a quarter
+// of the one below
+std::vector<std::vector<double>> refined_levels(size_t count) {
+    std::mt19937 rng(5);
+    std::normal_distribution<double> noise(0.0, 0.2);
+    std::vector<double> error(count);
+    for (double& e : error) {
+        e = noise(rng);
+    }
+    std::vector<std::vector<double>> levels;
+    for (size_t level = 0; level <= 8; ++level) {
+        std::vector<double> values(count);
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = std::sin(static_cast<double>(i) * 0.01) + error[i] / std::pow(4.0, static_cast<double>(level));
+        }
+        levels.push_back(std::move(values));
+    }
+    return levels;
+}
+
+TEST(PrecisionStorageTest, DeltaLevelsReadBackWithinHalfAThreshold) {
+    const double threshold = 1e-3;
+    auto levels = refined_levels(4096);
+    FractalTreeNode<std::vector<double>> absolute(8, threshold);
+    FractalTreeNode<std::vector<double>> delta(8, threshold);
+    delta.set_level_encoding(LevelEncoding::Delta);
+    for (size_t level = 0; level <= 8; ++level) {
+        absolute.store(levels[level], level);
+        delta.store(levels[level], level);
+    }
+    absolute.merge_all();
+    delta.merge_all();
+
+    EXPECT_EQ(delta.get(0).value(), levels[0]);
+    for (size_t level = 1; level <= 8; ++level) {
+        auto values = delta.get(level).value();
+        ASSERT_EQ(values.size(), levels[level].size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            ASSERT_NEAR(values[i], levels[level][i], threshold / 2 * (1 + 1e-9)) << level << " " << i;
+        }
+    }
+    // Residuals of the upper levels are at most two bytes wide, and none
+    // once levels differ by less than half a threshold
+    EXPECT_LT(delta.memory_bytes() * 3, absolute.memory_bytes());
+
+    // Replacing a lower level leaves the values above where they were
+    auto before = delta.get(5).value();
+    auto shifted = levels[0];
+    for (double& v : shifted) {
+        v += 0.25;
+    }
+    delta.store(shifted, 0);
+    delta.merge_all();
+    EXPECT_EQ(delta.get(0).value(), shifted);
+    EXPECT_EQ(delta.get(5).value(), before);
+
+    // Back to full levels, with the values as they read
+    delta.set_level_encoding(LevelEncoding::Absolute);
+    EXPECT_EQ(delta.get(5).value(), before);
+    EXPECT_EQ(delta.memory_bytes(), absolute.memory_bytes());
+}
+
+TEST(PrecisionStorageTest, DeltaKeepsLevelsThatCannotBeQuantizedInFull) {
+    auto levels = refined_levels(64);
+    levels[3][10] = std::numeric_limits<double>::infinity();
+    FractalTreeNode<std::vector<double>> tree(8, 1e-3);
+    tree.set_level_encoding(LevelEncoding::Delta);
+    tree.set_storage_formats({StorageFormat::Float32});
+    for (size_t level = 0; level <= 8; ++level) {
+        tree.store(levels[level], level);
+    }
+    tree.merge_all();
+
+    auto third = tree.get(3).value();
+    EXPECT_TRUE(std::isinf(third[10]));
+    EXPECT_NEAR(third[11], levels[3][11], 1e-6);  // Held as fp32
+    auto fourth = tree.get(4).value();
+    for (size_t i = 0; i < fourth.size(); ++i) {
+        EXPECT_NEAR(fourth[i], levels[4][i], 5e-4 + 1e-9);
+    }
+}
+
+std::vector<std::byte> as_bytes(const std::string& text) {
+    auto bytes = std::as_bytes(std::span(text));
+    return {bytes.begin(), bytes.end()};
+}
+
+std::vector<double> smooth_signal(size_t count) {
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<double>(i / 16) * 0.25;
+    }
+    return values;
+}
+
+// A long string value, distinct per seed, that compresses well
+std::string log_text(int seed) {
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "node " + std::to_string(seed) + " computed level " + std::to_string(i % 9) + "\n";
+    }
+    return text;
+}
+
+TEST(ColdCompressionTest, LzRoundTripsAndRejectsCorruptInput) {
+    std::mt19937 rng(3);
+    std::string random(5000, '\0');
+    for (char& c : random) {
+        c = static_cast<char>(rng());
+    }
+    std::vector<std::string> inputs = {"", "a", "abcdefgh", std::string(10000, 'z'), log_text(1),
+                                       random, "abc" + std::string(300, 'x') + random.substr(0, 100) + "abcabcabcabc"};
+    for (const auto& input : inputs) {
+        auto in = as_bytes(input);
+        auto compressed = compression::lz_compress(in);
+        std::vector<std::byte> out(in.size());
+        compression::lz_decompress(compressed, out);
+        EXPECT_EQ(out, in) << input.size();
+    }
+
+    auto run = compression::lz_compress(as_bytes(std::string(10000, 'z')));
+    EXPECT_LT(run.size(), 100u);
+    auto noise = compression::lz_compress(as_bytes(random));
+    EXPECT_LT(noise.size(), random.size() + random.size() / 100);
+
+    auto in = as_bytes(log_text(1));
+    auto compressed = compression::lz_compress(in);
+    std::vector<std::byte> out(in.size());
+    std::vector<std::byte> truncated(compressed.begin(), compressed.end() - 3);
+    EXPECT_THROW(compression::lz_decompress(truncated, out), std::runtime_error);
+    std::vector<std::byte> larger(in.size() + 1);
+    EXPECT_THROW(compression::lz_decompress(compressed, larger), std::runtime_error);
+}
+
+TEST(ColdCompressionTest, FloatCodecIsLossless) {
+    auto values = smooth_signal(4096);
+    values[7] = std::numeric_limits<double>::quiet_NaN();
+    values[8] = -std::numeric_limits<double>::infinity();
+    values[9] = -0.0;
+    auto compressed = CompressedValue<std::vector<double>>::compress(values).value();
+    EXPECT_EQ(compressed.codec(), CompressionCodec::Floats);
+    EXPECT_EQ(compressed.original_bytes(), values.size() * sizeof(double));
+    EXPECT_LT(compressed.bytes() * 8, compressed.original_bytes());
+    auto back = compressed.decompress();
+    ASSERT_EQ(back.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(std::bit_cast<uint64_t>(back[i]), std::bit_cast<uint64_t>(values[i]));
+    }
+
+    auto floats = random_floats(1000, 4, 1.0f);
+    auto noisy = CompressedValue<std::vector<float>>::compress(floats);
+    if (noisy) {
+        EXPECT_EQ(noisy->decompress(), floats);
+    }
+
+    auto text = CompressedValue<std::string>::compress(log_text(2)).value();
+    EXPECT_EQ(text.codec(), CompressionCodec::Bytes);
+    EXPECT_EQ(text.decompress(), log_text(2));
+
+    // Too small to be worth it
+    EXPECT_FALSE(CompressedValue<std::vector<double>>::compress(std::vector<double>(4, 1.0)).has_value());
+}
+
+TEST(ColdCompressionTest, GraphCacheCompressesValuesNotReadForIdleRuns) {
+    GraphCache<std::string> cache;
+    auto stats = std::make_shared<CompressionStats>();
+    cache.set_cold_compression({2, 256, stats});
+    cache.store(log_text(1));
+    cache.store(log_text(2));
+    cache.store("short");
+
+    cache.end_run();
+    EXPECT_TRUE(cache.get(log_text(1)).has_value());
+    cache.end_run();
+    EXPECT_EQ(cache.compressed_count(), 0u);
+    cache.end_run();  // Value 2 unread for three runs, value 1 for two
+    EXPECT_EQ(cache.compressed_count(), 1u);
+    cache.end_run();
+    EXPECT_EQ(cache.compressed_count(), 2u);
+
+    EXPECT_EQ(cache.get(log_text(2)).value(), log_text(2));
+    EXPECT_EQ(cache.get("short").value(), "short");
+    EXPECT_FALSE(cache.get(log_text(3)).has_value());
+    EXPECT_EQ(cache.compressed_count(), 1u);
+
+    auto metrics = stats->snapshot();
+    EXPECT_EQ(metrics.values_compressed, 2u);
+    EXPECT_GT(metrics.ratio(), 4.0);
+    EXPECT_EQ(metrics.decompressions, 1u);
+    EXPECT_GE(metrics.max_decompression_time, metrics.mean_decompression_time());
+}
+
+TEST(ColdCompressionTest, FractalTreeCompressesLevelsInPlace) {
+    auto values = smooth_signal(4096);
+    auto finer = values;
+    finer[0] = 1.0;
+    FractalTreeNode<std::vector<double>> tree(8);
+    auto stats = std::make_shared<CompressionStats>();
+    tree.set_cold_compression({1, 256, stats});
+    tree.store(values, 0);
+    tree.store(finer, 3);
+    tree.merge_all();
+    const size_t full = tree.memory_bytes();
+
+    tree.end_run();
+    EXPECT_EQ(tree.get(3).value(), finer);
+    tree.end_run();
+    EXPECT_EQ(tree.compressed_levels(), 1u);
+    tree.end_run();
+    EXPECT_EQ(tree.compressed_levels(), 2u);
+    EXPECT_LT(tree.memory_bytes() * 8, full);
+
+    // Level 5 reads through level 3
+    EXPECT_EQ(tree.get(5).value(), finer);
+    EXPECT_EQ(tree.compressed_levels(), 1u);
+    tree.store(values, 0);
+    tree.merge_all();
+    EXPECT_EQ(tree.compressed_levels(), 0u);
+    EXPECT_EQ(tree.get(0).value(), values);
+    EXPECT_EQ(stats->snapshot().decompressions, 2u);
+
+    // Residual chains thaw the level they count from
+    tree.set_level_encoding(LevelEncoding::Delta);
+    tree.end_run();
+    tree.end_run();
+    EXPECT_EQ(tree.compressed_levels(), 1u);
+    auto third = tree.get(3).value();
+    for (size_t i = 0; i < third.size(); ++i) {
+        EXPECT_NEAR(third[i], finer[i], 5e-4 + 1e-12);
+    }
+}
+
+// Unpacked, an Int8 level no longer compresses below its packed size
+TEST(ColdCompressionTest, PackedLevelsNeverGrow) {
+    FractalTreeNode<std::vector<double>> tree(8);
+    tree.set_storage_formats({StorageFormat::Int8});
+    tree.set_cold_compression({1, 256, std::make_shared<CompressionStats>()});
+    std::vector<double> noisy(4096);
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (double& v : noisy) {
+        v = uniform(rng);
+    }
+    tree.store(noisy, 0);
+    tree.merge_all();
+    const size_t packed = tree.memory_bytes();
+    EXPECT_EQ(packed, 4096u);
+
+    for (int run = 0; run < 3; ++run) {
+        tree.end_run();
+    }
+    EXPECT_EQ(tree.compressed_levels(), 0u);
+    EXPECT_EQ(tree.memory_bytes(), packed);
+
+    tree.set_spill_store(std::make_shared<SpillStore>());
+    EXPECT_EQ(tree.spill_level(0), 0u);
+    EXPECT_EQ(tree.spilled_levels(), 0u);
+    EXPECT_EQ(tree.memory_bytes(), packed);
+}
+
+class TextNode : public Node<std::string> {
+public:
+    using Node<std::string>::Node;
+    int runs = 0;
+
+protected:
+    Task<ComputeResult<std::string>> compute_impl(size_t) override {
+        co_return ComputeResult<std::string>(log_text(++runs));
+    }
+};
+
+TEST(ColdCompressionTest, GraphCompressesOnThePoolAfterEachExecution) {
+    Graph<std::string> graph;
+    auto node = std::make_shared<TextNode>("text");
+    graph.add_node(node);
+    ColdCompressionOptions options;
+    options.idle_runs = 1;
+    graph.set_cold_compression(options);
+
+    for (int run = 0; run < 4; ++run) {
+        graph.execute().get();
+        graph.wait_for_cold_compression();
+    }
+    auto metrics = graph.compression_metrics();
+    EXPECT_GE(metrics.values_compressed, 2u);
+    EXPECT_GT(metrics.ratio(), 4.0);
+}
+
+// A full batch lane skips the pass instead of failing the execution
+TEST(ColdCompressionTest, FullBatchLaneSkipsThePass) {
+    ThreadPoolOptions pool_options;
+    pool_options.num_threads = 1;
+    pool_options.max_queued_tasks = 1;
+    auto pool = std::make_shared<ThreadPool>(std::move(pool_options));
+    Graph<std::string> graph(nullptr, pool);
+    auto node = std::make_shared<TextNode>("text");
+    graph.add_node(node);
+    ColdCompressionOptions options;
+    options.idle_runs = 1;
+    graph.set_cold_compression(options);
+
+    // Occupy the only worker and fill the batch lane
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    pool->enqueue([&started, released] {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+    {
+        ThreadPool::PriorityScope scope(TaskPriority::Batch);
+        pool->enqueue_shared([] {});
+    }
+    EXPECT_FALSE(pool->admits(TaskPriority::Batch));
+
+    EXPECT_NO_THROW(graph.execute().get());
+    EXPECT_FALSE(graph.get_node_error("text").has_value());
+    EXPECT_EQ(node->runs, 1);
+
+    release.set_value();
+    for (int run = 0; run < 3; ++run) {
+        graph.execute().get();
+        graph.wait_for_cold_compression();
+    }
+    EXPECT_GE(graph.compression_metrics().values_compressed, 1u);
+}
+
+TEST(SpillStoreTest, SpillFileReusesFreedSpace) {
+    SpillFile file;
+    auto small = as_bytes(log_text(1));
+    auto large = as_bytes(std::string(3 << 20, 'q'));
+    auto first = file.write(small);
+    auto second = file.write(large);
+    auto third = file.write(small);
+    EXPECT_GE(file.file_bytes(), small.size() * 2 + large.size());
+
+    std::vector<std::byte> out(large.size());
+    file.read(second, out);
+    EXPECT_EQ(out, large);
+    out.resize(small.size());
+    file.read(third, out);
+    EXPECT_EQ(out, small);
+    EXPECT_THROW(file.read(first, std::span(out).first(10)), std::out_of_range);
+
+    const size_t used = file.used_bytes();
+    file.free(second);
+    EXPECT_EQ(file.used_bytes(), used - large.size());
+    auto reused = file.write(small);
+    EXPECT_EQ(reused.offset, second.offset);
+    file.read(first, out);
+    EXPECT_EQ(out, small);
+}
+
+TEST(SpillStoreTest, MemoryPressureReadsPsi) {
+    auto path = (std::filesystem::temp_directory_path() / "flowgraph-psi-test").string();
+    {
+        std::ofstream psi(path);
+        psi << "some avg10=12.50 avg60=4.00 avg300=1.00 total=123456\n"
+            << "full avg10=3.25 avg60=1.00 avg300=0.20 total=23456\n";
+    }
+    auto pressure = MemoryPressure::read(path);
+    ASSERT_TRUE(pressure.has_value());
+    EXPECT_DOUBLE_EQ(pressure->some_avg10, 12.5);
+    EXPECT_DOUBLE_EQ(pressure->full_avg10, 3.25);
+    EXPECT_FALSE(MemoryPressure::read(path + "-missing").has_value());
+
+    SpillOptions options;
+    options.pressure_path = path;
+    EXPECT_FALSE(SpillStore(options).under_pressure());  // No threshold
+    options.pressure_threshold = 10.0;
+    EXPECT_TRUE(SpillStore(options).under_pressure());
+    options.pressure_threshold = 20.0;
+    EXPECT_FALSE(SpillStore(options).under_pressure());
+    std::filesystem::remove(path);
+}
+
+TEST(SpillStoreTest, FractalTreeSpillsAndReloadsLevels) {
+    auto smooth = smooth_signal(4096);
+    std::vector<double> noisy(4096);
+    std::mt19937_64 rng(5);
+    for (double& v : noisy) {
+        v = std::bit_cast<double>(rng() >> 2);
+    }
+    auto store = std::make_shared<SpillStore>();
+    FractalTreeNode<std::vector<double>> tree(8);
+    EXPECT_EQ(tree.spill_level(0), 0u);  // No store yet
+    tree.set_spill_store(store);
+    tree.store(smooth, 0);
+    tree.store(noisy, 3);
+    tree.merge_all();
+    const size_t full = tree.memory_bytes();
+
+    EXPECT_EQ(tree.spill_level(0), smooth.size() * sizeof(double));
+    EXPECT_EQ(tree.spill_level(3), noisy.size() * sizeof(double));
+    EXPECT_EQ(tree.spill_level(5), 0u);
+    EXPECT_EQ(tree.spilled_levels(), 2u);
+    EXPECT_EQ(tree.memory_bytes(), 0u);
+    EXPECT_TRUE(tree.level_usage().empty());
+    EXPECT_GT(store->metrics().bytes_on_disk, 0u);
+
+    EXPECT_EQ(tree.get(0).value(), smooth);
+    EXPECT_EQ(tree.get(4).value(), noisy);  // Through level 3
+    EXPECT_EQ(tree.spilled_levels(), 0u);
+    EXPECT_EQ(tree.memory_bytes(), full);
+
+    auto metrics = store->metrics();
+    EXPECT_EQ(metrics.levels_spilled, 2u);
+    EXPECT_EQ(metrics.levels_reloaded, 2u);
+    EXPECT_LT(metrics.bytes_spilled, 2 * full);
+    EXPECT_EQ(metrics.bytes_on_disk, 0u);
+    EXPECT_GE(metrics.max_reload_time, metrics.mean_reload_time());
+}
+
+TEST(SpillStoreTest, BudgetSpillsLongestIdleLevelsFirst) {
+    SpillOptions options;
+    std::vector<std::unique_ptr<FractalTreeNode<std::vector<double>>>> trees;
+    for (int i = 0; i < 4; ++i) {
+        trees.push_back(std::make_unique<FractalTreeNode<std::vector<double>>>(8));
+    }
+    auto values = smooth_signal(8192);
+    options.memory_budget = 2 * values.size() * sizeof(double);
+    auto store = std::make_shared<SpillStore>(options);
+    for (auto& tree : trees) {
+        tree->set_spill_store(store);
+        tree->store(values, 0);
+        tree->merge_all();
+        tree->end_run();
+    }
+    trees[2]->get(0);
+    trees[3]->get(0);
+    for (auto& tree : trees) {
+        tree->end_run();
+    }
+
+    EXPECT_EQ(enforce_spill_budget(trees, *store), options.memory_budget);
+    EXPECT_EQ(trees[0]->spilled_levels() + trees[1]->spilled_levels(), 2u);
+    EXPECT_EQ(trees[2]->spilled_levels() + trees[3]->spilled_levels(), 0u);
+    EXPECT_EQ(enforce_spill_budget(trees, *store), 0u);
+    EXPECT_EQ(trees[0]->get(0).value(), values);
+}
+
+TEST(SpillStoreTest, GraphSpillsOverBudgetAfterExecution) {
+    Graph<std::string> graph;
+    auto node = std::make_shared<TextNode>("text");
+    graph.add_node(node);
+    graph.execute().get();
+    node->merge_updates();
+
+    SpillOptions options;
+    options.memory_budget = 1;
+    auto store = std::make_shared<SpillStore>(options);
+    graph.set_spill_store(store);
+    graph.execute().get();
+    graph.wait_for_cold_compression();
+    EXPECT_EQ(node->memory_bytes(), 0u);
+    EXPECT_EQ(store->metrics().levels_spilled, 1u);
+
+    graph.execute().get();
+    graph.wait_for_cold_compression();
+    EXPECT_EQ(node->runs, 1);  // Read back, not recomputed
+    EXPECT_EQ(store->metrics().levels_reloaded, 1u);
+    EXPECT_EQ(node->compute().get().value(), log_text(1));
+}
+
+TEST(ApproximateMemoTest, ScalarInputsHitWithinTolerance) {
+    ApproximateMemo<double> memo(0.01);
+    memo.insert(std::vector{1.0, 2.0}, 0, 3.0);
+    memo.insert(std::vector{1.012, 2.0}, 0, 3.012);
+
+    EXPECT_EQ(memo.find(std::vector{1.009, 1.991}, 0), 3.0);
+    EXPECT_EQ(memo.find(std::vector{1.008, 2.0}, 0), 3.012);
+    EXPECT_FALSE(memo.find(std::vector{1.025, 2.0}, 0));
+    EXPECT_FALSE(memo.find(std::vector{1.0, 2.0}, 1));
+    EXPECT_FALSE(memo.find(std::vector{1.0}, 0));
+    EXPECT_FALSE(memo.find(std::vector{std::nan(""), 2.0}, 0));
+
+    auto metrics = memo.metrics();
+    EXPECT_EQ(metrics.lookups, 6u);
+    EXPECT_EQ(metrics.hits, 2u);
+    EXPECT_EQ(metrics.entries, 2u);
+    EXPECT_THROW(ApproximateMemo<double>(-1.0), std::invalid_argument);
+}
+
+// Inputs far beyond tolerance * 2^63 saturate their cells rather than
+// overflowing; lookups stay exact-checked
+TEST(ApproximateMemoTest, InputsOutsideTheCellRangeStillMatch) {
+    ApproximateMemo<double> memo(1e-9);
+    memo.insert(std::vector{1e12, -1e300}, 0, 1.0);
+    EXPECT_EQ(memo.find(std::vector{1e12, -1e300}, 0), 1.0);
+    EXPECT_FALSE(memo.find(std::vector{1e12 + 1.0, -1e300}, 0));
+
+    ApproximateMemo<double> vectors(1e-12);
+    std::vector<double> large(64, 1e15);
+    vectors.insert(large, 0, 2.0);
+    EXPECT_EQ(vectors.find(large, 0), 2.0);
+}
+
+TEST(ApproximateMemoTest, VectorInputsHitThroughLocalityHashing) {
+    const double tolerance = 0.01;
+    ApproximateMemo<int> memo(tolerance);
+    std::vector<std::vector<double>> signals;
+    for (int i = 0; i < 8; ++i) {
+        signals.push_back(smooth_signal(256));
+        for (double& v : signals.back()) {
+            v += i;
+        }
+        memo.insert(signals.back(), 0, i);
+    }
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> near(-tolerance, tolerance);
+    std::uniform_real_distribution<double> far(2 * tolerance, 3 * tolerance);
+    int hits = 0;
+    for (int trial = 0; trial < 200; ++trial) {
+        auto i = static_cast<size_t>(trial % 8);
+        auto noisy = signals[i];
+        for (double& v : noisy) {
+            v += near(rng) / 2;
+        }
+        if (auto found = memo.find(noisy, 0)) {
+            EXPECT_EQ(*found, static_cast<int>(i));
+            ++hits;
+        }
+        noisy[trial % noisy.size()] = signals[i][trial % noisy.size()] + far(rng);
+        EXPECT_FALSE(memo.find(noisy, 0));
+    }
+    EXPECT_GE(hits, 190);
+}
+
+TEST(ApproximateMemoTest, ZeroToleranceIsExactAndEvictsLeastRecentlyUsed) {
+    ApproximateMemo<int> memo(0.0, 2);
+    std::vector<double> a(16, 1.0), b(16, 2.0), c(16, 3.0);
+    memo.insert(a, 0, 1);
+    memo.insert(b, 0, 2);
+    EXPECT_EQ(memo.find(a, 0), 1);
+    b[3] = std::nextafter(2.0, 3.0);
+    EXPECT_FALSE(memo.find(b, 0));
+    memo.insert(c, 0, 3);
+
+    b[3] = 2.0;
+    EXPECT_FALSE(memo.find(b, 0));
+    EXPECT_EQ(memo.find(a, 0), 1);
+    EXPECT_EQ(memo.find(c, 0), 3);
+    EXPECT_EQ(memo.metrics().exact_hits, 3u);
+    EXPECT_EQ(memo.metrics().entries, 2u);
+}
+
+class ScaleNode : public Node<double> {
+public:
+    using Node<double>::Node;
+    double input = 0.0;
+    int runs = 0;
+
+protected:
+    Task<ComputeResult<double>> compute_impl(size_t precision_level) override {
+        co_return memoize(std::span(&input, 1), precision_level, [this] {
+            ++runs;
+            return input * 2.0;
+        });
+    }
+};
+
+TEST(ApproximateMemoTest, NodeReusesResultsForInputsWithinCompressionThreshold) {
+    auto node = std::make_shared<ScaleNode>("scale", 8, 0.001);
+    node->enable_approximate_memo();
+    for (double input : {1.0, 1.0004, 1.0009, 1.5, 1.4995}) {
+        node->input = input;
+        auto result = node->compute(0).get();
+        EXPECT_NEAR(result.value(), input * 2.0, 0.002);
+    }
+    EXPECT_EQ(node->runs, 2);
+    auto metrics = node->approximate_memo_metrics().value();
+    EXPECT_EQ(metrics.hits, 3u);
+    EXPECT_EQ(metrics.entries, 2u);
+}
+
+TEST(ContentHashTest, VectorizedHashMatchesScalarAtEverySize) {
+    std::vector<std::byte> buffer(5000);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<std::byte>(i * 131 + 7);
+    }
+    for (size_t size = 0; size <= buffer.size(); size += size < 1100 ? 1 : 97) {
+        std::span<const std::byte> bytes(buffer.data(), size);
+        EXPECT_EQ(hashing::hash64(bytes), hashing::scalar::hash64(bytes)) << size;
+        EXPECT_EQ(hashing::hash64(bytes, 42), hashing::scalar::hash64(bytes, 42)) << size;
+        EXPECT_EQ(hashing::hash128(bytes), hashing::scalar::hash128(bytes)) << size;
+        EXPECT_EQ(hashing::hash128(bytes).low, hashing::hash64(bytes)) << size;
+    }
+    auto values = random_floats(3000, 9, 1.0f);
+    EXPECT_EQ(hashing::hash64(std::span<const float>(values)), hashing::scalar::hash64(std::span<const float>(values)));
+}
+
+TEST(ContentHashTest, SizesBitsAndSeedsGiveDistinctHashes) {
+    std::vector<std::byte> zeros(2100);
+    std::set<uint64_t> seen;
+    size_t hashed = 0;
+    for (size_t size = 0; size <= zeros.size(); size += size < 300 ? 1 : 100) {
+        seen.insert(hashing::hash64(std::span<const std::byte>(zeros.data(), size)));
+        ++hashed;
+    }
+    for (size_t bit = 0; bit < zeros.size() * 8; bit += 3) {
+        auto flipped = zeros;
+        flipped[bit / 8] ^= static_cast<std::byte>(1 << (bit % 8));
+        seen.insert(hashing::hash64(std::span<const std::byte>(flipped)));
+        ++hashed;
+    }
+    for (uint64_t seed = 1; seed <= 64; ++seed) {
+        seen.insert(hashing::hash64(std::span<const std::byte>(zeros), seed));
+        seen.insert(hashing::hash64(std::span<const std::byte>(zeros.data(), 40), seed));
+        hashed += 2;
+    }
+    EXPECT_EQ(seen.size(), hashed);
+}
+
+struct Reading {
+    int sensor = 0;
+    double value = 0.0;
+    std::string note;   // Not part of the reading's identity
+
+    bool operator==(const Reading& other) const { return sensor == other.sensor && value == other.value; }
+};
+
+uint64_t hash_value(const Reading& reading) {
+    return flowgraph::hash_value(reading.value, static_cast<uint64_t>(reading.sensor));
+}
+
+TEST(ContentHashTest, HashValueFollowsEquality) {
+    // Qualified: the hash_value overload above hides the customization point
+    const auto& hash = flowgraph::hash_value;
+    EXPECT_EQ(hash(std::vector<double>{1.0, 0.0, 2.0}), hash(std::vector<double>{1.0, -0.0, 2.0}));
+    EXPECT_EQ(hash(std::vector<float>(300, 0.0f)), hash(std::vector<float>(300, -0.0f)));
+    EXPECT_EQ(hash(0.0), hash(-0.0));
+    EXPECT_NE(hash(std::vector<double>{1.0, 2.0}), hash(std::vector<double>{2.0, 1.0}));
+
+    std::string text = "content hash";
+    EXPECT_EQ(hash(text), hashing::hash64(std::as_bytes(std::span(text))));
+    EXPECT_EQ(hash(text), hash(std::string_view(text)));
+
+    using Matrix = std::vector<std::vector<double>>;
+    EXPECT_NE(hash(Matrix{{1.0, 2.0}, {3.0}}), hash(Matrix{{1.0}, {2.0, 3.0}}));
+    EXPECT_EQ(hash(Reading{1, 2.5, "a"}), hash(Reading{1, 2.5, "b"}));
+    EXPECT_NE(hash(Reading{1, 2.5, "a"}), hash(Reading{2, 2.5, "a"}));
+}
+
+TEST(ContentHashTest, GraphCacheHoldsValuesWithoutStdHash) {
+    GraphCache<std::vector<double>> cache(std::make_unique<LRUCachePolicy<std::vector<double>>>(2));
+    std::vector<double> a(1000, 1.0), b(1000, 2.0), c(1000, 3.0);
+    cache.store(a);
+    cache.store(b);
+    EXPECT_EQ(cache.get(a), a);
+    cache.store(c);
+    EXPECT_FALSE(cache.get(b));
+    EXPECT_EQ(cache.get(a), a);
+    EXPECT_EQ(cache.get(c), c);
+}
+
+} // namespace test
+} // namespace flowgraph
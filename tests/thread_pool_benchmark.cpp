@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../include/flowgraph/async/thread_pool.hpp"
+#include "benchmark_utils.hpp"
+
+namespace flowgraph {
+namespace test {
+
+// How the pool is configured against the batch load
+enum class QosMode {
+    Fifo,       // Batch load submitted in the same class as interactive work
+    Strict,
+    Weighted,
+    Reserved    // Strict, plus one worker reserved for interactive work
+};
+
+// Submission paths compared by the throughput benchmarks
+enum class SubmitPath {
+    Enqueue,        // Future-returning enqueue()
+    EnqueueShared,  // Fire-and-forget std::function through the locked queues
+    Post,           // InlineTask through the lock-free ring
+    Bulk            // One enqueue_bulk() batch, as a fan-out node releases successors
+};
+
+} // namespace test
+} // namespace flowgraph
+
+// Latency of trivial interactive tasks while a generator thread keeps the
+// pool saturated with 200us batch tasks
+template<flowgraph::test::QosMode Mode>
+static void BM_InteractiveLatencyUnderBatchLoad(::benchmark::State& state) {
+    using namespace flowgraph;
+    using test::QosMode;
+
+    ThreadPoolOptions options;
+    options.num_threads = std::max(2u, std::thread::hardware_concurrency());
+    if (Mode == QosMode::Weighted) {
+        options.priority_policy = PriorityPolicy::Weighted;
+    }
+    if (Mode == QosMode::Reserved) {
+        options.reserved_interactive_workers = 1;
+    }
+    ThreadPool pool(options);
+
+    const size_t backlog = options.num_threads * 4;
+    std::atomic<size_t> outstanding{0};
+    std::atomic<bool> stop{false};
+    std::thread generator([&] {
+        ThreadPool::PriorityScope scope(Mode == QosMode::Fifo ? TaskPriority::Interactive : TaskPriority::Batch);
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (outstanding.load(std::memory_order_relaxed) >= backlog) {
+                std::this_thread::yield();
+                continue;
+            }
+            outstanding.fetch_add(1, std::memory_order_relaxed);
+            pool.enqueue_shared([&outstanding] {
+                test::spin_for(std::chrono::microseconds(200));
+                outstanding.fetch_sub(1, std::memory_order_relaxed);
+            });
+        }
+    });
+
+    // Let the backlog build up before measuring
+    while (outstanding.load() < backlog) {
+        std::this_thread::yield();
+    }
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(state.max_iterations);
+    for (auto _ : state) {
+        auto submitted = test::BenchClock::now();
+        pool.enqueue([] {}).get();
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(
+            test::BenchClock::now() - submitted).count());
+    }
+
+    stop.store(true);
+    generator.join();
+    while (outstanding.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    test::report_percentiles(state, latencies_us);
+    state.counters["batch_completed"] = static_cast<double>(pool.metrics(
+        Mode == QosMode::Fifo ? TaskPriority::Interactive : TaskPriority::Batch).completed);
+}
+
+// Submit state.range(0) trivial tasks from one thread and wait for all of
+// them, helping the pool while waiting
+template<flowgraph::test::SubmitPath Path>
+static void BM_SubmitThroughput(::benchmark::State& state) {
+    using flowgraph::test::SubmitPath;
+    const size_t count = state.range(0);
+    flowgraph::ThreadPool pool;
+    std::atomic<size_t> done{0};
+
+    for (auto _ : state) {
+        done.store(0, std::memory_order_relaxed);
+        if constexpr (Path == SubmitPath::Bulk) {
+            std::vector<std::function<void()>> batch(
+                count, [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            pool.enqueue_bulk(std::move(batch));
+        }
+        for (size_t i = 0; i < count && Path != SubmitPath::Bulk; ++i) {
+            auto task = [&done] { done.fetch_add(1, std::memory_order_relaxed); };
+            if constexpr (Path == SubmitPath::Enqueue) {
+                pool.enqueue(task);
+            } else if constexpr (Path == SubmitPath::EnqueueShared) {
+                pool.enqueue_shared(task);
+            } else {
+                pool.post(task);
+            }
+        }
+        while (done.load(std::memory_order_relaxed) != count) {
+            if (!pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK_TEMPLATE(BM_SubmitThroughput, flowgraph::test::SubmitPath::Enqueue)
+    ->Arg(1 << 14)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_SubmitThroughput, flowgraph::test::SubmitPath::EnqueueShared)
+    ->Arg(1 << 14)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_SubmitThroughput, flowgraph::test::SubmitPath::Post)
+    ->Arg(1 << 14)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_SubmitThroughput, flowgraph::test::SubmitPath::Bulk)
+    ->Arg(1 << 14)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_InteractiveLatencyUnderBatchLoad, flowgraph::test::QosMode::Fifo)
+    ->Iterations(1000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_InteractiveLatencyUnderBatchLoad, flowgraph::test::QosMode::Strict)
+    ->Iterations(1000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_InteractiveLatencyUnderBatchLoad, flowgraph::test::QosMode::Weighted)
+    ->Iterations(1000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(BM_InteractiveLatencyUnderBatchLoad, flowgraph::test::QosMode::Reserved)
+    ->Iterations(1000)
+    ->UseRealTime()
+    ->Unit(::benchmark::kMicrosecond);
@@ -0,0 +1,581 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../include/flowgraph/async/blocking_region.hpp"
+#include "../include/flowgraph/async/inline_task.hpp"
+#include "../include/flowgraph/async/mpmc_queue.hpp"
+#include "../include/flowgraph/async/numa.hpp"
+#include "../include/flowgraph/async/task.hpp"
+#include "../include/flowgraph/async/thread_pool.hpp"
+
+namespace flowgraph {
+namespace test {
+
+TEST(NumaTopologyTest, ParseCpuList) {
+    EXPECT_EQ(NumaTopology::parse_cpu_list("0-3,8,10-11\n"),
+              (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_TRUE(NumaTopology::parse_cpu_list("").empty());
+    EXPECT_THROW(NumaTopology::parse_cpu_list("3-1"), std::invalid_argument);
+    EXPECT_THROW(NumaTopology::parse_cpu_list("a-b"), std::invalid_argument);
+}
+
+// Topology is read from a sysfs-shaped directory; memory-only nodes are skipped
+TEST(NumaTopologyTest, FromSysfs) {
+    auto root = std::filesystem::temp_directory_path() / "flowgraph_numa_sysfs";
+    std::filesystem::remove_all(root);
+    auto write_node = [&](const std::string& name, const std::string& cpulist) {
+        std::filesystem::create_directories(root / name);
+        std::ofstream(root / name / "cpulist") << cpulist << "\n";
+    };
+    write_node("node1", "4-7");
+    write_node("node0", "0-3");
+    write_node("node2", "");
+    std::ofstream(root / "possible") << "0-2\n";
+
+    auto topology = NumaTopology::from_sysfs(root);
+    std::filesystem::remove_all(root);
+
+    ASSERT_EQ(topology.node_count(), 2);
+    EXPECT_FALSE(topology.simulated());
+    EXPECT_EQ(topology.cpus_of(0), (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(topology.cpus_of(1), (std::vector<int>{4, 5, 6, 7}));
+    EXPECT_EQ(topology.node_of_cpu(5), std::optional<size_t>(1));
+    EXPECT_FALSE(topology.node_of_cpu(9).has_value());
+
+    // Missing directory falls back to a single node
+    EXPECT_EQ(NumaTopology::from_sysfs(root).node_count(), 1);
+}
+
+class NumaThreadPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ThreadPoolOptions options;
+        options.num_threads = 4;
+        options.numa_aware = true;
+        options.topology = NumaTopology::simulated(2, 2);
+        pool_ = std::make_unique<ThreadPool>(std::move(options));
+    }
+
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+// Workers are split into contiguous per-node blocks and steal locally first
+TEST_F(NumaThreadPoolTest, WorkersGroupedByNode) {
+    ASSERT_TRUE(pool_->numa_aware());
+    EXPECT_EQ(pool_->numa_node_of_worker(0), 0);
+    EXPECT_EQ(pool_->numa_node_of_worker(1), 0);
+    EXPECT_EQ(pool_->numa_node_of_worker(2), 1);
+    EXPECT_EQ(pool_->numa_node_of_worker(3), 1);
+
+    EXPECT_EQ(pool_->steal_order(0), (std::vector<size_t>{1, 2, 3}));
+    EXPECT_EQ(pool_->steal_order(2), (std::vector<size_t>{3, 0, 1}));
+    EXPECT_EQ(pool_->steal_order(3), (std::vector<size_t>{2, 0, 1}));
+}
+
+// Worker threads report their node, and buffers they allocate are placed there
+TEST_F(NumaThreadPoolTest, AllocationFollowsWorkerNode) {
+    EXPECT_FALSE(numa::current_node().has_value());
+
+    for (size_t worker = 0; worker < pool_->thread_count(); ++worker) {
+        std::promise<std::optional<size_t>> placed;
+        auto future = placed.get_future();
+        pool_->enqueue_to(worker, [&placed] {
+            numa_vector<double> buffer(1 << 16, 1.0);
+            placed.set_value(buffer.get_allocator().node());
+        });
+        EXPECT_EQ(future.get(), std::optional<size_t>(pool_->numa_node_of_worker(worker)));
+    }
+
+    auto allocator = pool_->allocator_for_worker<double>(3);
+    EXPECT_EQ(allocator.node(), std::optional<size_t>(1));
+    // Simulated nodes are never passed to mbind
+    EXPECT_FALSE(allocator.kernel_node().has_value());
+    numa_vector<double> buffer(1 << 16, 2.0, allocator);
+    EXPECT_DOUBLE_EQ(buffer.back(), 2.0);
+}
+
+// All submission paths still drain through the per-node queues
+TEST_F(NumaThreadPoolTest, RunsAllTasks) {
+    constexpr size_t count = 1000;
+    std::atomic<size_t> done{0};
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < count; ++i) {
+        futures.push_back(pool_->enqueue([this, &done] {
+            pool_->enqueue_local([&done] { done.fetch_add(1); });
+            done.fetch_add(1);
+        }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    while (done.load() != 2 * count) {
+        pool_->run_pending_task();
+    }
+    EXPECT_EQ(done.load(), 2 * count);
+}
+
+// Blocks a pool worker until released, so queue order can be observed
+class Gate {
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered_ = true;
+        entered_condition_.notify_all();
+        condition_.wait(lock, [this] { return open_; });
+    }
+
+    void wait_entered() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered_condition_.wait(lock, [this] { return entered_; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        condition_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::condition_variable entered_condition_;
+    bool entered_ = false;
+    bool open_ = false;
+};
+
+// Runs tasks of both classes on a single worker blocked by a gate and
+// returns the priority of every task in execution order
+std::vector<TaskPriority> run_mixed(ThreadPool& pool, size_t per_class) {
+    Gate gate;
+    std::mutex order_mutex;
+    std::vector<TaskPriority> order;
+    std::vector<std::future<void>> futures;
+    {
+        ThreadPool::PriorityScope scope(TaskPriority::Batch);
+        futures.push_back(pool.enqueue([&gate] { gate.wait(); }));
+    }
+    gate.wait_entered();
+
+    for (TaskPriority priority : {TaskPriority::Batch, TaskPriority::Interactive}) {
+        ThreadPool::PriorityScope scope(priority);
+        for (size_t i = 0; i < per_class; ++i) {
+            futures.push_back(pool.enqueue([&] {
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order.push_back(ThreadPool::current_priority());
+            }));
+        }
+    }
+    gate.open();
+    for (auto& future : futures) {
+        future.get();
+    }
+    return order;
+}
+
+TEST(PriorityThreadPoolTest, StrictServesInteractiveFirst) {
+    ThreadPool pool(1);
+    auto order = run_mixed(pool, 4);
+    ASSERT_EQ(order.size(), 8);
+    for (size_t i = 0; i < order.size(); ++i) {
+        EXPECT_EQ(order[i], i < 4 ? TaskPriority::Interactive : TaskPriority::Batch);
+    }
+}
+
+TEST(PriorityThreadPoolTest, WeightedLetsBatchThrough) {
+    ThreadPoolOptions options;
+    options.num_threads = 1;
+    options.priority_policy = PriorityPolicy::Weighted;
+    options.interactive_weight = 2;
+    ThreadPool pool(std::move(options));
+
+    auto order = run_mixed(pool, 4);
+    using P = TaskPriority;
+    EXPECT_EQ(order, (std::vector<P>{P::Interactive, P::Interactive, P::Batch,
+                                     P::Interactive, P::Interactive, P::Batch,
+                                     P::Batch, P::Batch}));
+}
+
+// Reserved workers never run batch tasks and stay free for interactive ones
+TEST(PriorityThreadPoolTest, ReservedInteractiveWorkers) {
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.reserved_interactive_workers = 1;
+    ThreadPool pool(std::move(options));
+
+    Gate gate;
+    std::vector<std::future<std::optional<size_t>>> batch;
+    {
+        ThreadPool::PriorityScope scope(TaskPriority::Batch);
+        batch.push_back(pool.enqueue([&] {
+            gate.wait();
+            return pool.current_worker_index();
+        }));
+        for (size_t i = 0; i < 8; ++i) {
+            batch.push_back(pool.enqueue([&] { return pool.current_worker_index(); }));
+        }
+    }
+    gate.wait_entered();
+
+    // The only non-reserved worker is blocked, yet interactive work still runs
+    auto interactive = pool.enqueue([&] { return pool.current_worker_index(); });
+    EXPECT_EQ(interactive.get(), std::optional<size_t>(0));
+
+    gate.open();
+    for (auto& future : batch) {
+        EXPECT_EQ(future.get(), std::optional<size_t>(1));
+    }
+
+    options = ThreadPoolOptions{};
+    options.num_threads = 2;
+    options.reserved_interactive_workers = 2;
+    EXPECT_THROW(ThreadPool{std::move(options)}, std::invalid_argument);
+}
+
+// Tasks spawned by a task inherit its class, and each class is metered
+TEST(PriorityThreadPoolTest, InheritanceAndMetrics) {
+    ThreadPool pool(2);
+    std::promise<TaskPriority> inherited;
+    {
+        ThreadPool::PriorityScope scope(TaskPriority::Batch);
+        pool.enqueue([&] {
+            pool.enqueue_local([&] { inherited.set_value(ThreadPool::current_priority()); });
+        });
+    }
+    EXPECT_EQ(ThreadPool::current_priority(), TaskPriority::Interactive);
+    EXPECT_EQ(inherited.get_future().get(), TaskPriority::Batch);
+    pool.enqueue([] {}).get();
+
+    // Completion is recorded after the task body returns
+    while (pool.metrics(TaskPriority::Batch).completed < 2 ||
+           pool.metrics(TaskPriority::Interactive).completed < 1) {
+        std::this_thread::yield();
+    }
+    auto batch = pool.metrics(TaskPriority::Batch);
+    auto interactive = pool.metrics(TaskPriority::Interactive);
+    EXPECT_EQ(batch.submitted, 2);
+    EXPECT_EQ(batch.completed, 2);
+    EXPECT_EQ(interactive.submitted, 1);
+    EXPECT_EQ(interactive.completed, 1);
+    EXPECT_GE(batch.max_queue_time, batch.mean_queue_time());
+}
+
+TEST(InlineTaskTest, MoveOnlyCallable) {
+    static_assert(sizeof(InlineTask) == 64);
+    auto counter = std::make_shared<int>(0);
+    std::unique_ptr<int> owned = std::make_unique<int>(5);
+
+    InlineTask task([counter, owned = std::move(owned)] { *counter += *owned; });
+    InlineTask moved(std::move(task));
+    EXPECT_FALSE(static_cast<bool>(task));
+    ASSERT_TRUE(static_cast<bool>(moved));
+    moved();
+    moved();
+    EXPECT_EQ(*counter, 10);
+
+    // The callable is destroyed with the task
+    EXPECT_EQ(counter.use_count(), 2);
+    moved = InlineTask();
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(MpmcQueueTest, BoundedFifo) {
+    MpmcQueue<int> queue(3);
+    ASSERT_EQ(queue.capacity(), 4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push(i));
+    }
+    int rejected = 99;
+    EXPECT_FALSE(queue.try_push(rejected));
+    EXPECT_EQ(rejected, 99);
+    EXPECT_EQ(queue.size_approx(), 4);
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(MpmcQueueTest, ConcurrentProducersAndConsumers) {
+    constexpr size_t per_producer = 20000;
+    constexpr size_t producers = 3;
+    MpmcQueue<size_t> queue(64);
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> sum{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (size_t i = 1; i <= per_producer; ++i) {
+                size_t value = p * per_producer + i;
+                while (!queue.try_push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            size_t value;
+            while (consumed.load() < producers * per_producer) {
+                if (queue.try_pop(value)) {
+                    sum.fetch_add(value);
+                    consumed.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t n = producers * per_producer;
+    EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+}
+
+TEST(ThreadPoolPostTest, RunsPostedTasks) {
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.post_queue_capacity = 8;
+    ThreadPool pool(std::move(options));
+
+    // post() helps drain the small ring rather than dropping tasks
+    constexpr size_t count = 10000;
+    std::atomic<size_t> done{0};
+    std::thread other([&] {
+        for (size_t i = 0; i < count; ++i) {
+            pool.post([&done] { done.fetch_add(1); });
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        pool.post([&done] { done.fetch_add(1); });
+    }
+    other.join();
+    while (done.load() != 2 * count) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPoolPostTest, TryPostRejectsWhenFull) {
+    ThreadPoolOptions options;
+    options.num_threads = 1;
+    options.post_queue_capacity = 2;
+    ThreadPool pool(std::move(options));
+
+    Gate gate;
+    pool.enqueue([&gate] { gate.wait(); });
+    gate.wait_entered();
+
+    std::atomic<int> done{0};
+    InlineTask first([&done] { done.fetch_add(1); });
+    InlineTask second([&done] { done.fetch_add(1); });
+    InlineTask third([&done] { done.fetch_add(1); });
+    EXPECT_TRUE(pool.try_post(first));
+    EXPECT_TRUE(pool.try_post(second));
+    EXPECT_FALSE(pool.try_post(third));
+    EXPECT_TRUE(static_cast<bool>(third));
+
+    gate.open();
+    pool.post(std::move(third));
+    while (done.load() != 3) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPoolBulkTest, RunsBatchFromAnyThread) {
+    ThreadPool pool(3);
+    constexpr size_t count = 1000;
+    std::atomic<size_t> done{0};
+    auto make_batch = [&done] {
+        std::vector<std::function<void()>> batch;
+        for (size_t i = 0; i < count; ++i) {
+            batch.emplace_back([&done] { done.fetch_add(1); });
+        }
+        return batch;
+    };
+
+    pool.enqueue_bulk(make_batch());
+    // From a worker, the local variant fills that worker's deque for stealing
+    pool.enqueue([&] { pool.enqueue_local_bulk(make_batch()); });
+    while (done.load() != 2 * count) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(pool.metrics(TaskPriority::Interactive).submitted, 2 * count + 1);
+}
+
+TEST(ThreadPoolBulkTest, BoundedPoolRejectsWholeBatch) {
+    ThreadPoolOptions options;
+    options.num_threads = 1;
+    options.max_queued_tasks = 4;
+    ThreadPool pool(std::move(options));
+
+    Gate gate;
+    pool.enqueue_shared([&gate] { gate.wait(); });
+    gate.wait_entered();
+
+    std::atomic<int> done{0};
+    std::vector<std::function<void()>> batch(5, [&done] { done.fetch_add(1); });
+    EXPECT_THROW(pool.enqueue_bulk(batch), QueueFullError);
+    EXPECT_EQ(pool.queued_tasks(TaskPriority::Interactive), 0u);
+    EXPECT_EQ(pool.metrics(TaskPriority::Interactive).rejected, 5u);
+
+    batch.pop_back();
+    pool.enqueue_bulk(batch);
+    gate.open();
+    while (done.load() != 4) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(PollingThreadPoolTest, PollingWorkersRunTasksAndPinToOneCpu) {
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.spin_budget = std::chrono::milliseconds(5);
+    ThreadPool pool(std::move(options));
+
+    // Back-to-back hops: each task is picked up while workers poll
+    for (int round = 0; round < 100; ++round) {
+        EXPECT_EQ(pool.enqueue([round] { return round; }).get(), round);
+    }
+
+    auto allowed = numa::allowed_cpus();
+    auto worker_cpus = pool.enqueue([] { return numa::allowed_cpus(); }).get();
+#ifdef __linux__
+    EXPECT_EQ(worker_cpus.size(), 1u);
+    EXPECT_NE(std::find(allowed.begin(), allowed.end(), worker_cpus[0]), allowed.end());
+#else
+    EXPECT_EQ(worker_cpus, allowed);
+#endif
+
+    // Past the budget, workers park and are woken as usual
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(pool.enqueue([] { return 7; }).get(), 7);
+}
+
+class ElasticThreadPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ThreadPoolOptions options;
+        options.num_threads = 1;
+        options.elastic = true;
+        options.max_threads = 3;
+        options.idle_timeout = std::chrono::milliseconds(20);
+        pool_ = std::make_unique<ThreadPool>(std::move(options));
+    }
+
+    // Poll until the condition holds or a generous deadline passes
+    template<typename Condition>
+    static bool eventually(Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+// A worker blocked in a marked region does not stall the queue
+TEST_F(ElasticThreadPoolTest, GrowsWhileWorkersBlock) {
+    EXPECT_EQ(pool_->thread_count(), 3);
+    EXPECT_EQ(pool_->active_thread_count(), 1);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    auto blocked = pool_->enqueue([released] {
+        blocking_region([&] { released.wait(); });
+    });
+    ASSERT_TRUE(eventually([&] { return pool_->blocked_thread_count() == 1; }));
+
+    auto other = pool_->enqueue([] { return 42; });
+    ASSERT_EQ(other.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(other.get(), 42);
+    EXPECT_EQ(pool_->active_thread_count(), 2);
+
+    release.set_value();
+    blocked.get();
+    EXPECT_EQ(pool_->blocked_thread_count(), 0);
+
+    // The extra worker retires after the idle timeout
+    EXPECT_TRUE(eventually([&] { return pool_->active_thread_count() == 1; }));
+}
+
+// Suspends a coroutine until another thread resumes it
+struct ExternalResume {
+    std::promise<std::coroutine_handle<>> handle;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { handle.set_value(h); }
+    int await_resume() const noexcept { return 7; }
+};
+
+inline Task<int> wait_for_resume(ExternalResume& resume) {
+    co_return co_await resume;
+}
+
+// Waiting on an unfinished Task counts as blocking
+TEST_F(ElasticThreadPoolTest, TaskWaitIsBlocking) {
+    ExternalResume resume;
+    auto handle = resume.handle.get_future();
+    auto waiting = pool_->enqueue([&resume] {
+        return wait_for_resume(resume).get();
+    });
+    ASSERT_TRUE(eventually([&] { return pool_->blocked_thread_count() == 1; }));
+
+    pool_->enqueue([h = handle.get()] { h.resume(); });
+    ASSERT_EQ(waiting.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(waiting.get(), 7);
+}
+
+// Pinning work to a retired slot starts its worker again
+TEST_F(ElasticThreadPoolTest, EnqueueToInactiveSlot) {
+    std::promise<std::optional<size_t>> ran;
+    pool_->enqueue_to(2, [&] { ran.set_value(pool_->current_worker_index()); });
+    EXPECT_EQ(ran.get_future().get(), std::optional<size_t>(2));
+    EXPECT_TRUE(eventually([&] { return pool_->active_thread_count() == 1; }));
+
+    std::promise<void> again;
+    pool_->enqueue_to(2, [&] { again.set_value(); });
+    again.get_future().get();
+}
+
+// Tasks pinning work to inactive slots while the pool is destroyed neither
+// start workers nor hold up the destructor
+TEST_F(ElasticThreadPoolTest, DestroyWhileTasksPinToInactiveSlots) {
+    for (int round = 0; round < 20; ++round) {
+        SetUp();
+        for (int task = 0; task < 4; ++task) {
+            pool_->enqueue_to(0, [pool = pool_.get(), task] {
+                try {
+                    for (size_t i = 0; i < 200; ++i) {
+                        pool->enqueue_to(1 + (i + task) % 2, [] {});
+                    }
+                } catch (const std::runtime_error&) {
+                    // Stopped meanwhile
+                }
+            });
+        }
+        auto destroyed = std::async(std::launch::async, [this] { pool_.reset(); });
+        ASSERT_EQ(destroyed.wait_for(std::chrono::seconds(10)), std::future_status::ready) << round;
+    }
+}
+
+} // namespace test
+} // namespace flowgraph